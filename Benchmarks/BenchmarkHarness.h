@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Shared bits of the headless benchmarks. Every benchmark takes --quick,
+// which shrinks the workload so ctest can run it as a smoke test.
+
+inline bool QuickRun(int argc, char **argv) {
+	for (int i = 1; i < argc; ++i)
+		if (strcmp(argv[i], "--quick") == 0)
+			return true;
+	return false;
+}
+
+class BenchmarkTimer {
+public:
+	BenchmarkTimer() : mStart(std::chrono::steady_clock::now()) {}
+
+	double Milliseconds() const {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mStart).count();
+	}
+
+private:
+	std::chrono::steady_clock::time_point mStart;
+};
+
+// Keeps the optimizer from discarding a result.
+template<typename T>
+inline void DoNotOptimize(const T &value) {
+#if defined(_MSC_VER)
+	static const void *volatile sink;
+	sink = &value;
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
@@ -0,0 +1,49 @@
+// Bindless slot churn: each frame releases and registers a share of the
+// live resources (streaming textures and buffers coming and going) with
+// three frames in flight, the GPU retiring each frame two frames later.
+// Reports the cost per register+release and how many slots sit waiting on
+// the GPU, which is the headroom the table needs on top of the live set.
+
+#include "BenchmarkHarness.h"
+#include "BindlessRegistry.h"
+#include <random>
+#include <vector>
+
+int main(int argc, char **argv) {
+	bool quick = QuickRun(argc, argv);
+	const int Frames = quick ? 200 : 20000;
+	const uint32_t Live = 50000;
+	const uint32_t ChurnPerFrame[] = { 100, 1000, 5000 };
+
+	for (uint32_t churn : ChurnPerFrame) {
+		std::mt19937 rng(43);
+		BindlessRegistry registry(Live + 3 * churn);
+		std::vector<BindlessHandle> live;
+		for (uint32_t i = 0; i < Live; ++i)
+			live.push_back(registry.Register());
+		std::vector<uint32_t> victims(4096);
+		for (uint32_t &victim : victims)
+			victim = rng() % Live;
+
+		uint32_t failed = 0, peakPending = 0, op = 0;
+		BenchmarkTimer timer;
+		for (int frame = 1; frame <= Frames; ++frame) {
+			for (uint32_t i = 0; i < churn; ++i, ++op) {
+				BindlessHandle &handle = live[victims[op & 4095]];
+				registry.Release(handle);
+				handle = registry.Register();
+				failed += !handle.IsValid();
+			}
+			if (registry.PendingCount() > peakPending)
+				peakPending = registry.PendingCount();
+			registry.FinishFrame(frame);
+			if (frame > 2)
+				registry.Retire(frame - 2);
+		}
+		double ms = timer.Milliseconds();
+		DoNotOptimize(live[0]);
+		printf("%4u of %u per frame: %5.1f ns per release+register, peak %5u pending, %u failed\n", churn, Live,
+				ms * 1e6 / (double(Frames) * churn), peakPending, failed);
+	}
+	return 0;
+}
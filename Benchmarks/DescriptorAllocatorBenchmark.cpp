@@ -0,0 +1,72 @@
+// Descriptor allocation costs. The free list (long-lived views) is churned
+// with random sizes at a steady fill level; the ring (per-frame tables, what
+// D3D12DescriptorHeap::AllocateTransient uses) runs frames with three in
+// flight, the GPU retiring each frame two frames later.
+
+#include "BenchmarkHarness.h"
+#include "DescriptorAllocator.h"
+#include <random>
+#include <vector>
+
+int main(int argc, char **argv) {
+	bool quick = QuickRun(argc, argv);
+	const int FreeListOps = quick ? 100000 : 10000000;
+	const int Frames = quick ? 1000 : 100000;
+	const uint32_t TablesPerFrame = 1000;
+
+	// Free list at about half full: every op frees one range and allocates one.
+	{
+		std::mt19937 rng(29);
+		DescriptorFreeList list(0, 65536);
+		std::vector<DescriptorRange> live;
+		while (list.FreeCount() > 32768)
+			live.push_back(list.Allocate(1 + rng() % 8));
+		std::vector<uint32_t> sizes(4096), victims(4096);
+		for (uint32_t i = 0; i < 4096; ++i) {
+			sizes[i] = 1 + rng() % 8;
+			victims[i] = rng();
+		}
+
+		uint32_t failed = 0;
+		BenchmarkTimer timer;
+		for (int op = 0; op < FreeListOps; ++op) {
+			size_t victim = victims[op & 4095] % live.size();
+			list.Free(live[victim]);
+			DescriptorRange range = list.Allocate(sizes[op & 4095]);
+			if (range.IsValid())
+				live[victim] = range;
+			else
+				++failed;
+		}
+		double ms = timer.Milliseconds();
+		printf("free list: %6.1f ns per free+allocate, %u free ranges, largest %u, %u failed\n",
+				ms * 1e6 / FreeListOps, list.FreeRangeCount(), list.LargestFreeRange(), failed);
+	}
+
+	// Transient ring.
+	{
+		std::mt19937 rng(31);
+		std::vector<uint32_t> sizes(TablesPerFrame);
+		for (uint32_t &size : sizes)
+			size = 1 + rng() % 8;
+		DescriptorRing ring(1024, 3 * TablesPerFrame * 8);
+		uint32_t failed = 0;
+		uint64_t offsets = 0;
+		BenchmarkTimer timer;
+		for (int frame = 1; frame <= Frames; ++frame) {
+			for (uint32_t size : sizes) {
+				DescriptorRange range = ring.Allocate(size);
+				failed += !range.IsValid();
+				offsets += range.Offset;
+			}
+			ring.FinishFrame(frame);
+			if (frame > 2)
+				ring.Retire(frame - 2);
+		}
+		double ms = timer.Milliseconds();
+		DoNotOptimize(offsets);
+		printf("ring:      %6.1f ns per allocation, %.1f us per %u-table frame, %u failed\n",
+				ms * 1e6 / (double(Frames) * TablesPerFrame), ms * 1e3 / Frames, TablesPerFrame, failed);
+	}
+	return 0;
+}
@@ -0,0 +1,122 @@
+// Frame pacing policy on a simulated GPU, and the CPU overhead of pacing.
+//
+// SimulatedFence runs a virtual clock: the CPU spends a fixed time per frame,
+// the GPU a jittered one, and waiting advances the CPU clock to the moment
+// the GPU reaches the value. For each latency target this reports the frame
+// rate, how often the CPU stalled and the input-to-display latency, which is
+// the trade-off SetMaxLatency controls.
+
+#include "BenchmarkHarness.h"
+#include "FramePacer.h"
+#include <deque>
+#include <random>
+
+class SimulatedFence : public IFrameFence {
+public:
+	SimulatedFence(double gpuMs, double jitterMs) : mGpuMs(gpuMs), mJitter(-jitterMs, jitterMs) {}
+
+	virtual uint64_t CompletedValue() const override {
+		uint64_t completed = mCompleted;
+		for (const Pending &pending : mPending) {
+			if (pending.DoneMs > CpuMs)
+				break;
+			completed = pending.Value;
+		}
+		return completed;
+	}
+	virtual void Signal(uint64_t value) override {
+		// Work starts when the GPU is free and the CPU has submitted it.
+		double start = mGpuFreeMs > CpuMs ? mGpuFreeMs : CpuMs;
+		mGpuFreeMs = start + mGpuMs + mJitter(mRandom);
+		mPending.push_back({ value, mGpuFreeMs, CpuMs });
+	}
+	virtual void Wait(uint64_t value) override {
+		while (!mPending.empty() && mCompleted < value) {
+			if (mPending.front().DoneMs > CpuMs) {
+				StallMs += mPending.front().DoneMs - CpuMs;
+				CpuMs = mPending.front().DoneMs;
+			}
+			Complete();
+		}
+	}
+	void Collect() {
+		while (!mPending.empty() && mPending.front().DoneMs <= CpuMs)
+			Complete();
+	}
+
+	double CpuMs = 0.0;
+	double StallMs = 0.0;
+	double LatencyMsSum = 0.0;
+	uint64_t FramesCompleted = 0;
+
+private:
+	struct Pending {
+		uint64_t Value;
+		double DoneMs;
+		double SubmitMs;
+	};
+
+	void Complete() {
+		mCompleted = mPending.front().Value;
+		LatencyMsSum += mPending.front().DoneMs - mPending.front().SubmitMs;
+		++FramesCompleted;
+		mPending.pop_front();
+	}
+
+	double mGpuMs;
+	std::uniform_real_distribution<double> mJitter;
+	std::mt19937 mRandom{ 1 };
+	double mGpuFreeMs = 0.0;
+	uint64_t mCompleted = 0;
+	std::deque<Pending> mPending;
+};
+
+int main(int argc, char **argv) {
+	bool quick = QuickRun(argc, argv);
+	const uint32_t FramesInFlight = 3;
+	const int Frames = quick ? 1000 : 100000;
+
+	struct Scenario {
+		const char *Name;
+		double CpuMs;
+		double GpuMs;
+	};
+	const Scenario Scenarios[] = {
+		{ "GPU bound (cpu 8 ms, gpu 12 ms)", 8.0, 12.0 },
+		{ "CPU bound (cpu 12 ms, gpu 8 ms)", 12.0, 8.0 },
+		{ "balanced  (cpu 10 ms, gpu 10 ms)", 10.0, 10.0 },
+	};
+	for (const Scenario &scenario : Scenarios) {
+		printf("%s, +-3 ms GPU jitter\n", scenario.Name);
+		for (uint32_t latency = 1; latency <= FramesInFlight; ++latency) {
+			SimulatedFence fence(scenario.GpuMs, 3.0);
+			FramePacer pacer(&fence, FramesInFlight, latency);
+			for (int frame = 0; frame < Frames; ++frame) {
+				pacer.BeginFrame();
+				fence.CpuMs += scenario.CpuMs;
+				pacer.EndFrame();
+				fence.Collect();
+			}
+			// Measured before draining the queue, which would count as a stall.
+			FramePacerStats stats = pacer.Stats();
+			double stallMs = fence.StallMs;
+			pacer.Flush();
+			printf("  latency %u: %6.1f fps, %5.1f%% frames stalled (%.2f ms per stall), submit-to-done %5.1f ms\n",
+					latency, 1000.0 * Frames / fence.CpuMs, 100.0 * stats.Stalls / Frames,
+					stats.Stalls ? stallMs / stats.Stalls : 0.0, fence.LatencyMsSum / fence.FramesCompleted);
+		}
+	}
+
+	// Bookkeeping cost per frame with a fence that never blocks.
+	FakeFence fence;
+	FramePacer pacer(&fence, FramesInFlight);
+	const int OverheadFrames = quick ? 10000 : 10000000;
+	BenchmarkTimer timer;
+	for (int frame = 0; frame < OverheadFrames; ++frame) {
+		DoNotOptimize(pacer.BeginFrame());
+		pacer.EndFrame();
+		fence.Retire();
+	}
+	printf("pacing overhead: %.1f ns per frame (BeginFrame + EndFrame)\n", timer.Milliseconds() * 1e6 / OverheadFrames);
+	return 0;
+}
@@ -0,0 +1,102 @@
+// Frustum culling of 1M boxes: a per-box scalar loop over an array of
+// structures (what culling each RenderItem in turn amounts to) against the
+// SoA CullAabbRange kernel, and FrustumCuller over 1..N job system threads.
+
+#include "BenchmarkHarness.h"
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <thread>
+
+struct AabbAoS {
+	Float3 Center;
+	Float3 Extents;
+};
+
+static Frustum MakeFrustum() {
+	const float n = 1.0f, f = 1000.0f;
+	Float4x4 proj;
+	proj.m[0][0] = 1.0f;
+	proj.m[1][1] = 1.0f;
+	proj.m[2][2] = f / (f - n);
+	proj.m[2][3] = 1.0f;
+	proj.m[3][2] = -n * f / (f - n);
+	proj.m[3][3] = 0.0f;
+	return Frustum::FromViewProj(proj);
+}
+
+static uint32_t CullAoS(const Frustum &frustum, const std::vector<AabbAoS> &boxes, uint32_t *outVisible) {
+	uint32_t written = 0;
+	for (uint32_t i = 0; i < boxes.size(); ++i) {
+		const AabbAoS &box = boxes[i];
+		bool visible = true;
+		for (const Float4 &p : frustum.Planes) {
+			float dist = p.x * box.Center.x + p.y * box.Center.y + p.z * box.Center.z + p.w;
+			float radius = std::fabs(p.x) * box.Extents.x + std::fabs(p.y) * box.Extents.y +
+					std::fabs(p.z) * box.Extents.z;
+			if (dist + radius < 0.0f) {
+				visible = false;
+				break;
+			}
+		}
+		if (visible)
+			outVisible[written++] = i;
+	}
+	return written;
+}
+
+int main(int argc, char **argv) {
+	bool quick = QuickRun(argc, argv);
+	const uint32_t Count = quick ? 50000 : 1000000;
+	const int Reps = quick ? 3 : 50;
+
+	// Boxes scattered all around the camera, so roughly a sixth are visible.
+	std::mt19937 rng(3);
+	std::uniform_real_distribution<float> pos(-1000.0f, 1000.0f);
+	std::uniform_real_distribution<float> size(0.5f, 4.0f);
+	AabbSoA soa;
+	std::vector<AabbAoS> aos(Count);
+	for (uint32_t i = 0; i < Count; ++i) {
+		aos[i].Center = { pos(rng), pos(rng), pos(rng) };
+		aos[i].Extents = { size(rng), size(rng), size(rng) };
+		soa.PushBack(aos[i].Center, aos[i].Extents);
+	}
+	Frustum frustum = MakeFrustum();
+	std::vector<uint32_t> visible(Count);
+
+	uint32_t aosVisible = 0;
+	BenchmarkTimer aosTimer;
+	for (int rep = 0; rep < Reps; ++rep)
+		aosVisible = CullAoS(frustum, aos, visible.data());
+	double aosMs = aosTimer.Milliseconds() / Reps;
+
+	uint32_t soaVisible = 0;
+	BenchmarkTimer soaTimer;
+	for (int rep = 0; rep < Reps; ++rep)
+		soaVisible = CullAabbRange(frustum, soa, 0, Count, visible.data());
+	double soaMs = soaTimer.Milliseconds() / Reps;
+
+	printf("%u boxes, %u visible\n", Count, soaVisible);
+	printf("  AoS scalar        %7.3f ms (%6.1f M boxes/s)\n", aosMs, Count / aosMs / 1e3);
+	printf("  SoA CullAabbRange %7.3f ms (%6.1f M boxes/s), %.2fx\n", soaMs, Count / soaMs / 1e3, aosMs / soaMs);
+	if (aosVisible != soaVisible)
+		printf("  mismatch: AoS found %u visible\n", aosVisible);
+
+	uint32_t maxThreads = std::max(2u, std::thread::hardware_concurrency());
+	for (uint32_t threads = 1; threads <= maxThreads; threads *= 2) {
+		// JobSystem(0) means one worker per core, so one thread is no job system.
+		std::unique_ptr<JobSystem> jobs = threads > 1 ? std::make_unique<JobSystem>(threads - 1) : nullptr;
+		FrustumCuller culler(jobs.get());
+		std::vector<uint32_t> out;
+		culler.Cull(frustum, soa, out);
+		BenchmarkTimer timer;
+		for (int rep = 0; rep < Reps; ++rep)
+			culler.Cull(frustum, soa, out);
+		double ms = timer.Milliseconds() / Reps;
+		printf("  FrustumCuller %2u thread(s) %7.3f ms (%6.1f M boxes/s)\n", threads, ms, Count / ms / 1e3);
+	}
+	return 0;
+}
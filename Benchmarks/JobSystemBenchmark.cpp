@@ -0,0 +1,59 @@
+// Job system scaling from 1 to N threads: a compute-bound ParallelFor, and the
+// per-job cost of Run/Wait with empty jobs (scheduling overhead only).
+
+#include "BenchmarkHarness.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+int main(int argc, char **argv) {
+	bool quick = QuickRun(argc, argv);
+	const uint32_t Items = quick ? 100000 : 4000000;
+	const int Reps = quick ? 2 : 10;
+	const int EmptyJobs = quick ? 10000 : 500000;
+
+	std::vector<float> input(Items), output(Items);
+	for (uint32_t i = 0; i < Items; ++i)
+		input[i] = float(i) * 0.001f;
+
+	auto work = [&](uint32_t first, uint32_t count) {
+		for (uint32_t i = first; i < first + count; ++i)
+			output[i] = std::sin(input[i]) * std::cos(input[i]) + std::sqrt(input[i]);
+	};
+
+	// The 1 thread baseline is the plain loop: JobSystem(0) would start one
+	// worker per core, so a job system cannot be made to run single threaded.
+	BenchmarkTimer serialTimer;
+	for (int rep = 0; rep < Reps; ++rep) {
+		work(0, Items);
+		DoNotOptimize(output[0]);
+	}
+	double baseMs = serialTimer.Milliseconds() / Reps;
+	printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+	printf(" 1 thread   : serial loop %8.3f ms\n", baseMs);
+
+	uint32_t maxThreads = std::max(4u, std::thread::hardware_concurrency());
+	for (uint32_t threads = 2; threads <= maxThreads; threads *= 2) {
+		JobSystem jobs(threads - 1);
+
+		BenchmarkTimer forTimer;
+		for (int rep = 0; rep < Reps; ++rep) {
+			jobs.ParallelFor(Items, 1024, work);
+			DoNotOptimize(output[0]);
+		}
+		double forMs = forTimer.Milliseconds() / Reps;
+
+		JobCounter counter;
+		BenchmarkTimer jobTimer;
+		for (int i = 0; i < EmptyJobs; ++i)
+			jobs.Run([]() {}, &counter);
+		jobs.Wait(counter);
+		double jobMs = jobTimer.Milliseconds();
+
+		printf("%2u thread(s): ParallelFor %8.3f ms (%.2fx of 1 thread), empty job %6.1f ns\n", threads, forMs,
+				baseMs / forMs, jobMs * 1e6 / EmptyJobs);
+	}
+	return 0;
+}
@@ -0,0 +1,54 @@
+// Per-frame upload allocation cost: a frame's worth of constant-buffer sized
+// allocations followed by Reset(), against one malloc per allocation (what
+// separately created upload buffers amount to on the CPU side).
+
+#include "BenchmarkHarness.h"
+#include "LinearAllocator.h"
+#include <cstdlib>
+#include <vector>
+
+int main(int argc, char **argv) {
+	bool quick = QuickRun(argc, argv);
+	const int Frames = quick ? 10 : 1000;
+	const uint32_t AllocationCounts[] = { 1000, 10000, 100000 };
+
+	MallocPageProvider provider;
+	for (uint32_t count : AllocationCounts) {
+		LinearAllocator allocator(&provider, 4 * 1024 * 1024);
+		// Warm up to the high-water mark, as the engine does on its first frames.
+		for (uint32_t i = 0; i < count; ++i)
+			allocator.Allocate(64 + (i % 4) * 64);
+		allocator.Reset();
+
+		BenchmarkTimer linearTimer;
+		for (int frame = 0; frame < Frames; ++frame) {
+			for (uint32_t i = 0; i < count; ++i) {
+				UploadAllocation alloc = allocator.Allocate(64 + (i % 4) * 64);
+				alloc.Cpu[0] = uint8_t(i);
+				DoNotOptimize(alloc.Gpu);
+			}
+			allocator.Reset();
+		}
+		double linearMs = linearTimer.Milliseconds();
+
+		std::vector<void *> blocks(count);
+		BenchmarkTimer mallocTimer;
+		for (int frame = 0; frame < Frames; ++frame) {
+			for (uint32_t i = 0; i < count; ++i) {
+				blocks[i] = malloc(64 + (i % 4) * 64);
+				static_cast<uint8_t *>(blocks[i])[0] = uint8_t(i);
+				DoNotOptimize(blocks[i]);
+			}
+			for (uint32_t i = 0; i < count; ++i)
+				free(blocks[i]);
+		}
+		double mallocMs = mallocTimer.Milliseconds();
+
+		double allocations = double(count) * Frames;
+		printf("%7u allocations/frame: linear %6.2f ns/alloc (%.1f M/s), malloc+free %6.2f ns/alloc, "
+			   "%zu pages, high-water %.1f KB\n",
+				count, linearMs * 1e6 / allocations, allocations / linearMs / 1e3, mallocMs * 1e6 / allocations,
+				allocator.PageCount(), allocator.HighWaterMark() / 1024.0);
+	}
+	return 0;
+}
@@ -0,0 +1,141 @@
+// Load time of the same grid meshes three ways: OBJ text read and parsed
+// with DecodeObjMesh, mesh files read and copied out with DecodeMeshFile
+// (MeshStreamer with a decode function), and mesh files mapped, parsed in
+// place and copied straight into upload staging (MeshStreamer without one,
+// as GameApp streams). Files are in the temp directory and read warm, so
+// this is parsing and copying cost rather than disk speed.
+
+#include "BenchmarkHarness.h"
+#include "MappedFile.h"
+#include "MeshFile.h"
+#include "UploadQueue.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// An n x n vertex grid with texture coordinates and normals, as an exporter
+// would write it.
+static std::string GridObj(uint32_t n, uint32_t seed) {
+	std::string text;
+	char line[128];
+	for (uint32_t y = 0; y < n; ++y)
+		for (uint32_t x = 0; x < n; ++x) {
+			float h = float((x * 7 + y * 13 + seed) % 17) * 0.01f;
+			snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn 0.000000 1.000000 0.000000\n",
+					x * 0.1f, h, y * 0.1f, x / float(n - 1), y / float(n - 1));
+			text += line;
+		}
+	for (uint32_t y = 0; y + 1 < n; ++y)
+		for (uint32_t x = 0; x + 1 < n; ++x) {
+			uint32_t a = y * n + x + 1, b = a + 1, c = a + n, d = c + 1;
+			snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, c, c, c, d, d, d, b,
+					b, b);
+			text += line;
+		}
+	return text;
+}
+
+static bool ReadFile(const std::string &path, std::vector<uint8_t> &bytes) {
+	std::ifstream fin(path, std::ios::binary | std::ios::ate);
+	if (!fin)
+		return false;
+	bytes.resize(static_cast<size_t>(fin.tellg()));
+	fin.seekg(0);
+	return fin.read(reinterpret_cast<char *>(bytes.data()), bytes.size()).good();
+}
+
+int main(int argc, char **argv) {
+	bool quick = QuickRun(argc, argv);
+	const uint32_t MeshCount = quick ? 4 : 32;
+	const uint32_t GridSize = quick ? 64 : 300;
+	const int Passes = quick ? 1 : 5;
+
+	fs::path dir = fs::temp_directory_path() / "photon_meshfile_benchmark";
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+	std::vector<std::string> objPaths, meshPaths;
+	uint64_t objBytes = 0, meshBytes = 0;
+	for (uint32_t i = 0; i < MeshCount; ++i) {
+		std::string obj = GridObj(GridSize, i);
+		objPaths.push_back((dir / ("grid" + std::to_string(i) + ".obj")).string());
+		std::ofstream(objPaths.back(), std::ios::binary) << obj;
+		objBytes += obj.size();
+
+		// Written straight from the decoded OBJ, without the converter's
+		// optimization passes, so both formats hold the same mesh.
+		MeshData mesh;
+		std::string error;
+		if (!DecodeObjMesh(reinterpret_cast<const uint8_t *>(obj.data()), obj.size(), mesh, error) ||
+				!WriteMeshFile((dir / ("grid" + std::to_string(i) + ".mesh")).string(), mesh, error)) {
+			printf("%s\n", error.c_str());
+			return 1;
+		}
+		meshPaths.push_back((dir / ("grid" + std::to_string(i) + ".mesh")).string());
+		meshBytes += fs::file_size(meshPaths.back());
+	}
+
+	auto report = [&](const char *label, double ms, uint64_t bytes) {
+		printf("%-28s %8.1f ms per pass (%5.1f MB, %6.0f MB/s)\n", label, ms / Passes, bytes / 1e6,
+				bytes * Passes / (ms * 1e3));
+	};
+
+	// OBJ text.
+	{
+		std::vector<uint8_t> bytes;
+		uint64_t vertices = 0;
+		BenchmarkTimer timer;
+		for (int pass = 0; pass < Passes; ++pass)
+			for (const std::string &path : objPaths) {
+				MeshData mesh;
+				std::string error;
+				if (ReadFile(path, bytes) && DecodeObjMesh(bytes.data(), bytes.size(), mesh, error))
+					vertices += mesh.VertexCount;
+			}
+		DoNotOptimize(vertices);
+		report("OBJ read + decode:", timer.Milliseconds(), objBytes);
+	}
+
+	// Mesh files, decoded.
+	{
+		std::vector<uint8_t> bytes;
+		uint64_t vertices = 0;
+		BenchmarkTimer timer;
+		for (int pass = 0; pass < Passes; ++pass)
+			for (const std::string &path : meshPaths) {
+				MeshData mesh;
+				std::string error;
+				if (ReadFile(path, bytes) && DecodeMeshFile(bytes.data(), bytes.size(), mesh, error))
+					vertices += mesh.VertexCount;
+			}
+		DoNotOptimize(vertices);
+		report("mesh read + decode:", timer.Milliseconds(), meshBytes);
+	}
+
+	// Mesh files mapped and uploaded from the view, with the GPU keeping up.
+	{
+		MallocPageProvider pages;
+		FakeFence fence;
+		NullUploadCopyQueue copyQueue(&fence);
+		UploadQueue uploads(&pages, &copyQueue, &fence, UploadQueueDesc());
+		int vertexBuffer = 0, indexBuffer = 0;
+		BenchmarkTimer timer;
+		for (int pass = 0; pass < Passes; ++pass)
+			for (const std::string &path : meshPaths) {
+				MappedFile file;
+				MeshFileView view;
+				std::string error;
+				if (!file.Open(path) || !ParseMeshFile(file.Data(), file.Size(), view, error))
+					continue;
+				uploads.UploadBuffer(&vertexBuffer, 0, view.Vertices, view.VertexByteSize());
+				uploads.UploadBuffer(&indexBuffer, 0, view.Indices, view.IndexByteSize());
+				fence.RetireAll();
+			}
+		report("mesh map + copy to staging:", timer.Milliseconds(), meshBytes);
+	}
+
+	fs::remove_all(dir);
+	return 0;
+}
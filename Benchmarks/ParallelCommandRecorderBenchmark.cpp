@@ -0,0 +1,46 @@
+// Recording scaling: a frame of draws recorded into stub command lists by
+// ParallelCommandRecorder on 1..N threads. The stub spins per draw for about
+// the cost of encoding a D3D12 draw with its root arguments, so the numbers
+// show how well chunking and the job system overlap recording work.
+
+#include "BenchmarkHarness.h"
+#include "JobSystem.h"
+#include "ParallelCommandRecorder.h"
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+int main(int argc, char **argv) {
+	bool quick = QuickRun(argc, argv);
+	const uint32_t DrawCounts[] = { 1000, 10000, 50000 };
+	const uint32_t WorkPerDraw = 100;
+	const int Frames = quick ? 2 : 50;
+
+	uint32_t maxThreads = std::max(4u, std::thread::hardware_concurrency());
+	printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+	for (uint32_t draws : DrawCounts) {
+		if (quick && draws > 10000)
+			break;
+		double baseMs = 0.0;
+		for (uint32_t threads = 1; threads <= maxThreads; threads *= 2) {
+			// JobSystem(0) means one worker per core, so one thread is no job system.
+			std::unique_ptr<JobSystem> jobs = threads > 1 ? std::make_unique<JobSystem>(threads - 1) : nullptr;
+			ParallelCommandRecorder recorder(jobs.get(), threads);
+			StubCommandLists lists(threads, WorkPerDraw);
+			auto record = [&](const RecordChunk &chunk) { lists.Record(chunk); };
+
+			BenchmarkTimer timer;
+			for (int frame = 0; frame < Frames; ++frame) {
+				lists.Reset();
+				recorder.Record(draws, record);
+			}
+			double ms = timer.Milliseconds() / Frames;
+			DoNotOptimize(lists.Checksum());
+			if (threads == 1)
+				baseMs = ms;
+			printf("%6u draws, %2u thread(s), %2zu list(s): %7.3f ms/frame, %6.1f ns/draw, %.2fx of 1 thread\n",
+					draws, threads, recorder.Chunks().size(), ms, ms * 1e6 / draws, baseMs / ms);
+		}
+	}
+	return 0;
+}
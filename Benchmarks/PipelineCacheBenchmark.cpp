@@ -0,0 +1,64 @@
+// PipelineKey hashing and PipelineCache lookups for pipelines with
+// realistic shader sizes. Keys carry the full bytecode, so building a key
+// hashes and copies every byte and a hit compares them all; this measures
+// what that costs per GetOrCreate() call.
+
+#include "BenchmarkHarness.h"
+#include "PipelineCache.h"
+#include <random>
+
+int main(int argc, char **argv) {
+	bool quick = QuickRun(argc, argv);
+	const int Reps = quick ? 200 : 20000;
+	const size_t ShaderSizes[] = { 1024, 4096, 16384, 65536 };
+	const int PipelineCount = 64;
+
+	std::mt19937 rng(13);
+	std::vector<uint8_t> rootSignature(256);
+	for (uint8_t &b : rootSignature)
+		b = uint8_t(rng());
+
+	for (size_t shaderSize : ShaderSizes) {
+		// Each pipeline has its own VS and PS of this size.
+		std::vector<std::vector<uint8_t>> shaders(PipelineCount * 2, std::vector<uint8_t>(shaderSize));
+		for (std::vector<uint8_t> &shader : shaders)
+			for (uint8_t &b : shader)
+				b = uint8_t(rng());
+
+		auto makeKey = [&](int pipeline) {
+			PipelineKey key;
+			key.Blob(rootSignature.data(), rootSignature.size());
+			key.Blob(shaders[pipeline * 2].data(), shaderSize);
+			key.Blob(shaders[pipeline * 2 + 1].data(), shaderSize);
+			for (uint32_t field = 0; field < 40; ++field)
+				key.U32(field);
+			return key;
+		};
+
+		BenchmarkTimer keyTimer;
+		uint64_t hashes = 0;
+		for (int rep = 0; rep < Reps; ++rep)
+			hashes ^= makeKey(rep % PipelineCount).Hash();
+		double keyUs = keyTimer.Milliseconds() * 1e3 / Reps;
+		DoNotOptimize(hashes);
+
+		PipelineCache<int> cache;
+		int next = 0;
+		for (int p = 0; p < PipelineCount; ++p)
+			cache.GetOrCreate(makeKey(p), [&]() { return ++next; });
+		std::vector<PipelineKey> keys;
+		for (int p = 0; p < PipelineCount; ++p)
+			keys.push_back(makeKey(p));
+		BenchmarkTimer lookupTimer;
+		int sum = 0;
+		for (int rep = 0; rep < Reps; ++rep)
+			sum += cache.GetOrCreate(keys[rep % PipelineCount], [&]() { return ++next; });
+		double lookupUs = lookupTimer.Milliseconds() * 1e3 / Reps;
+		DoNotOptimize(sum);
+
+		size_t keyBytes = keys[0].Data().size();
+		printf("2 x %5zu byte shaders: key %6.2f us (%5.0f MB/s), hit lookup %6.2f us, key %zu bytes\n", shaderSize,
+				keyUs, keyBytes / keyUs, lookupUs, keyBytes);
+	}
+	return 0;
+}
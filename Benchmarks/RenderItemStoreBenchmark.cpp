@@ -0,0 +1,143 @@
+// Per-frame constant update for 10k/100k/1M render items with 1%, 10% and
+// 100% of them moving. The AoS baseline is the layout GameApp used before
+// RenderItemStore: one heap-allocated RenderItem per object with a
+// NumFramesDirty counter, walked in full every frame. The SoA path is
+// RenderItemStore's dirty ranges packed with BatchTransposeWorlds. Both
+// write world + color (80 bytes) per object and keep world bounds current.
+
+#include "BenchmarkHarness.h"
+#include "RenderItemStore.h"
+#include "TransformBatch.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+static const uint32_t FramesInFlight = 3;
+
+struct PackedObject {
+	Float4x4 World;
+	Float4 Color;
+};
+
+struct AosRenderItem {
+	Float4x4 World;
+	Float4 Color;
+	int NumFramesDirty = FramesInFlight;
+	uint32_t ObjCBIndex = 0;
+	void *Geo = nullptr;
+	uint32_t PrimitiveType = 4;
+	uint32_t IndexCount = 36;
+	uint32_t StartIndexLocation = 0;
+	int32_t BaseVertexLocation = 0;
+	Float3 LocalCenter, LocalExtents;
+	Float3 WorldCenter, WorldExtents;
+};
+
+static Float4x4 Translation(float x, float y, float z) {
+	Float4x4 world;
+	world.m[3][0] = x;
+	world.m[3][1] = y;
+	world.m[3][2] = z;
+	return world;
+}
+
+static double RunAos(uint32_t count, const std::vector<uint32_t> &movers, int frames) {
+	// Allocate in a shuffled order so consecutive items are not adjacent in
+	// memory, as happens once items are created and destroyed over time.
+	std::vector<uint32_t> order(count);
+	for (uint32_t i = 0; i < count; ++i)
+		order[i] = i;
+	std::shuffle(order.begin(), order.end(), std::mt19937(7));
+	std::vector<std::unique_ptr<AosRenderItem>> items(count);
+	for (uint32_t i : order) {
+		items[i] = std::make_unique<AosRenderItem>();
+		items[i]->ObjCBIndex = i;
+		items[i]->LocalExtents = { 1.0f, 1.0f, 1.0f };
+	}
+	std::vector<std::vector<PackedObject>> buffers(FramesInFlight, std::vector<PackedObject>(count));
+
+	BenchmarkTimer timer;
+	for (int frame = 0; frame < frames; ++frame) {
+		for (uint32_t i : movers) {
+			AosRenderItem &item = *items[i];
+			item.World = Translation(float(frame), float(i), 0.0f);
+			TransformAabb(item.LocalCenter, item.LocalExtents, item.World, item.WorldCenter, item.WorldExtents);
+			item.NumFramesDirty = FramesInFlight;
+		}
+		PackedObject *mapped = buffers[frame % FramesInFlight].data();
+		for (const std::unique_ptr<AosRenderItem> &item : items) {
+			if (item->NumFramesDirty > 0) {
+				PackedObject &dst = mapped[item->ObjCBIndex];
+				for (int r = 0; r < 4; ++r)
+					for (int c = 0; c < 4; ++c)
+						dst.World.m[r][c] = item->World.m[c][r];
+				dst.Color = item->Color;
+				--item->NumFramesDirty;
+			}
+		}
+		DoNotOptimize(mapped[0]);
+	}
+	return timer.Milliseconds();
+}
+
+static double RunSoa(uint32_t count, const std::vector<uint32_t> &movers, int frames) {
+	RenderItemStore store(count, FramesInFlight);
+	std::vector<RenderItemHandle> handles(count);
+	RenderItemDesc desc;
+	desc.BoundsExtents = { 1.0f, 1.0f, 1.0f };
+	desc.IndexCount = 36;
+	for (uint32_t i = 0; i < count; ++i)
+		handles[i] = store.Create(desc);
+	std::vector<std::vector<PackedObject>> buffers(FramesInFlight, std::vector<PackedObject>(count));
+
+	TransformStreamLayout layout;
+	layout.Stride = sizeof(PackedObject);
+	layout.WorldOffset = offsetof(PackedObject, World);
+
+	BenchmarkTimer timer;
+	for (int frame = 0; frame < frames; ++frame) {
+		for (uint32_t i : movers)
+			store.SetWorld(handles[i], Translation(float(frame), float(i), 0.0f));
+		uint8_t *mapped = reinterpret_cast<uint8_t *>(buffers[frame % FramesInFlight].data());
+		const Float4x4 *worlds = store.World();
+		const Float4 *colors = store.Color();
+		store.ForEachDirtyRange(frame % FramesInFlight, [&](uint32_t first, uint32_t n) {
+			BatchTransposeWorlds(worlds + first, n, mapped + first * layout.Stride, layout);
+			for (uint32_t i = first; i < first + n; ++i)
+				memcpy(mapped + i * layout.Stride + offsetof(PackedObject, Color), &colors[i], sizeof(Float4));
+		});
+		DoNotOptimize(mapped[0]);
+	}
+	return timer.Milliseconds();
+}
+
+int main(int argc, char **argv) {
+	bool quick = QuickRun(argc, argv);
+	const uint32_t Counts[] = { 10000, 100000, 1000000 };
+	const double MovingFractions[] = { 0.01, 0.1, 1.0 };
+
+	for (uint32_t count : Counts) {
+		if (quick && count > 10000)
+			break;
+		// Enough frames that the first FramesInFlight (everything dirty after
+		// creation) do not dominate.
+		int frames = quick ? 6 : std::max(30, int(30000000 / count));
+		for (double fraction : MovingFractions) {
+			// The same random subset moves every frame (the dynamic objects).
+			std::vector<uint32_t> movers(count);
+			for (uint32_t i = 0; i < count; ++i)
+				movers[i] = i;
+			std::shuffle(movers.begin(), movers.end(), std::mt19937(11));
+			movers.resize(std::max<size_t>(1, size_t(count * fraction)));
+			std::sort(movers.begin(), movers.end());
+
+			double aosMs = RunAos(count, movers, frames) / frames;
+			double soaMs = RunSoa(count, movers, frames) / frames;
+			printf("%8u items, %5.1f%% moving: AoS %8.3f ms/frame, SoA %8.3f ms/frame (%.2fx)\n", count,
+					fraction * 100.0, aosMs, soaMs, aosMs / soaMs);
+		}
+	}
+	return 0;
+}
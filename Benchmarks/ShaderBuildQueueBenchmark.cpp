@@ -0,0 +1,64 @@
+// Startup shader builds through ShaderBuildQueue on 1..N threads with a fake
+// compiler. The speedup reported is ShaderBuildStats::SerialSeconds over
+// WallSeconds, the same figure the app logs after BuildPSO. A spinning
+// compiler is CPU-bound like D3DCompiler and can only scale with cores; a
+// sleeping one shows how much the queue itself lets builds overlap.
+
+#include "BenchmarkHarness.h"
+#include "ShaderBuildQueue.h"
+#include <fstream>
+#include <memory>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char **argv) {
+	bool quick = QuickRun(argc, argv);
+	const int ShaderCount = quick ? 8 : 48;
+	const double CompileMs = quick ? 1.0 : 10.0;
+
+	fs::path dir = fs::temp_directory_path() / "photon_buildqueue_bench";
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+	std::vector<ShaderCompileRequest> requests;
+	for (int i = 0; i < ShaderCount; ++i) {
+		fs::path path = dir / ("shader" + std::to_string(i) + ".hlsl");
+		std::ofstream(path) << "// shader " << i << "\n";
+		ShaderCompileRequest request;
+		request.SourcePath = path;
+		request.EntryPoint = "VS";
+		request.Target = "vs_5_1";
+		requests.push_back(request);
+	}
+
+	uint32_t maxThreads = std::max(8u, std::thread::hardware_concurrency());
+	printf("%d shaders, %.0f ms each, %u hardware threads\n", ShaderCount, CompileMs,
+			std::thread::hardware_concurrency());
+	for (bool spin : { true, false }) {
+		double oneThreadSeconds = 0.0;
+		for (uint32_t threads = 1; threads <= maxThreads; threads *= 2) {
+			FakeShaderCompiler compiler(CompileMs, spin);
+			// No cache file: every run is cold.
+			ShaderCache cache(dir / "unused.bin", compiler.Fn(), "fake");
+			// JobSystem(0) means one worker per core, so one thread is no job system.
+			std::unique_ptr<JobSystem> jobs = threads > 1 ? std::make_unique<JobSystem>(threads - 1) : nullptr;
+			ShaderBuildQueue queue(jobs.get(), &cache);
+			for (const ShaderCompileRequest &request : requests)
+				queue.Enqueue(request);
+			queue.WaitAll();
+
+			const ShaderBuildStats &stats = queue.Stats();
+			if (threads == 1)
+				oneThreadSeconds = stats.WallSeconds;
+			// The stats speedup assumes each build had a core to itself; with more
+			// threads than cores the wall time against one thread is the real one.
+			printf("  %-8s %2u thread(s): wall %7.1f ms, serial %7.1f ms, stats speedup %.2fx, "
+				   "vs 1 thread %.2fx, peak %u concurrent\n",
+					spin ? "spinning" : "sleeping", threads, stats.WallSeconds * 1e3, stats.SerialSeconds * 1e3,
+					stats.SerialSeconds / stats.WallSeconds, oneThreadSeconds / stats.WallSeconds,
+					compiler.PeakConcurrency());
+		}
+	}
+	fs::remove_all(dir);
+	return 0;
+}
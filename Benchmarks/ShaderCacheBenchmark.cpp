@@ -0,0 +1,79 @@
+// Cold and warm shader startup through ShaderCache. The fake compiler spins
+// for a fixed time per shader (D3DCompileFromFile takes milliseconds for
+// small shaders), so the cold run is dominated by it; the warm run loads the
+// cache file and pays only for hashing the sources and the lookups.
+
+#include "BenchmarkHarness.h"
+#include "ShaderCache.h"
+#include <chrono>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char **argv) {
+	bool quick = QuickRun(argc, argv);
+	const int ShaderCount = quick ? 8 : 64;
+	const double CompileMs = quick ? 0.5 : 5.0;
+
+	fs::path dir = fs::temp_directory_path() / "photon_shadercache_bench";
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+	std::ofstream(dir / "common.hlsli") << std::string(4096, '/') << "\n";
+	std::vector<ShaderCompileRequest> requests;
+	for (int i = 0; i < ShaderCount; ++i) {
+		std::string name = "shader" + std::to_string(i) + ".hlsl";
+		// Keys hash contents, not paths, so every shader needs its own text.
+		std::ofstream(dir / name) << "#include \"common.hlsli\"\n// shader " << i << "\n"
+				<< std::string(8192, ' ') << "\n";
+		ShaderCompileRequest request;
+		request.SourcePath = dir / name;
+		request.EntryPoint = "VS";
+		request.Target = "vs_5_1";
+		requests.push_back(request);
+	}
+
+	auto compiler = [CompileMs](const ShaderCompileRequest &request, std::vector<uint8_t> &byteCode, std::string &) {
+		auto end = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(CompileMs);
+		while (std::chrono::steady_clock::now() < end) {
+		}
+		byteCode.assign(4096, uint8_t(request.SourcePath.string().size()));
+		return true;
+	};
+
+	auto startup = [&](bool &allOk) {
+		ShaderCache cache(dir / "cache.bin", compiler, "fake 1.0");
+		cache.Load();
+		std::vector<uint8_t> code;
+		allOk = true;
+		for (const ShaderCompileRequest &request : requests)
+			allOk = cache.GetOrCompile(request, code) && allOk;
+		cache.Save();
+		return cache.Stats();
+	};
+
+	bool ok = false;
+	BenchmarkTimer coldTimer;
+	ShaderCacheStats cold = startup(ok);
+	double coldMs = coldTimer.Milliseconds();
+
+	BenchmarkTimer warmTimer;
+	ShaderCacheStats warm = startup(ok);
+	double warmMs = warmTimer.Milliseconds();
+
+	printf("%d shaders, %.1f ms simulated compile each\n", ShaderCount, CompileMs);
+	printf("  cold: %8.2f ms (%u misses)\n", coldMs, cold.Misses);
+	printf("  warm: %8.2f ms (%u hits), %.1fx faster\n", warmMs, warm.Hits, coldMs / warmMs);
+
+	// What a warm start spends without the compiler: hashing alone.
+	ShaderCache hasher(dir / "cache.bin", compiler, "fake 1.0");
+	BenchmarkTimer hashTimer;
+	uint64_t keys = 0;
+	for (const ShaderCompileRequest &request : requests)
+		keys ^= hasher.HashRequest(request);
+	DoNotOptimize(keys);
+	printf("  hashing sources: %.3f ms\n", hashTimer.Milliseconds());
+
+	fs::remove_all(dir);
+	return ok ? 0 : 1;
+}
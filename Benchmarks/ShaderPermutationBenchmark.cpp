@@ -0,0 +1,76 @@
+// Hot ShaderVariantCache::Get latency: every key is already resident, so this
+// is the per-draw cost of looking a variant up by key (hash lookup plus LRU
+// splice) for working sets of 4 to 256 variants. For contrast, the same keys
+// through a cache too small to hold them, where each Get evicts and goes back
+// to the ShaderCache (hashing the source on every call).
+
+#include "BenchmarkHarness.h"
+#include "ShaderPermutation.h"
+#include <fstream>
+#include <random>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char **argv) {
+	bool quick = QuickRun(argc, argv);
+	const int Lookups = quick ? 20000 : 5000000;
+	const uint32_t WorkingSets[] = { 4, 16, 64, 256 };
+
+	fs::path dir = fs::temp_directory_path() / "photon_permutation_bench";
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+	std::ofstream(dir / "color.hlsl") << std::string(4096, '/') << "\n";
+	auto compiler = [](const ShaderCompileRequest &request, std::vector<uint8_t> &byteCode, std::string &) {
+		byteCode.assign(2048, uint8_t(request.Defines.size()));
+		return true;
+	};
+	ShaderCache cache(dir / "cache.bin", compiler, "fake 1.0");
+	ShaderCompileRequest base;
+	base.SourcePath = dir / "color.hlsl";
+	base.EntryPoint = "VS";
+	base.Target = "vs_5_1";
+
+	// Six options in 8 bits: 256 variants.
+	ShaderPermutationDesc desc;
+	desc.AddBool("SKINNED");
+	desc.AddBool("FOG");
+	desc.AddBool("ALPHA_TEST");
+	desc.AddEnum("QUALITY", { "LOW", "MEDIUM", "HIGH", "ULTRA" });
+	desc.AddEnum("LIGHTS", { "L0", "L1", "L2", "L4" });
+	desc.AddBool("SHADOWS");
+
+	for (uint32_t workingSet : WorkingSets) {
+		std::mt19937 rng(workingSet);
+		std::vector<uint64_t> keys(1024);
+		for (uint64_t &key : keys)
+			key = rng() % workingSet;
+
+		ShaderVariantCache variants(&desc, base, &cache, workingSet);
+		for (uint32_t key = 0; key < workingSet; ++key)
+			variants.Get(key);
+		ShaderVariantStats before = variants.Stats();
+
+		BenchmarkTimer timer;
+		size_t bytes = 0;
+		for (int i = 0; i < Lookups; ++i)
+			bytes += variants.Get(keys[i & 1023])->size();
+		double ns = timer.Milliseconds() * 1e6 / Lookups;
+		DoNotOptimize(bytes);
+		bool allHits = variants.Stats().Misses == before.Misses;
+
+		// Half the capacity: about half the lookups miss and refetch from the
+		// ShaderCache.
+		const int MissLookups = Lookups / 100;
+		ShaderVariantCache small(&desc, base, &cache, workingSet / 2);
+		BenchmarkTimer missTimer;
+		for (int i = 0; i < MissLookups; ++i)
+			bytes += small.Get(keys[i & 1023])->size();
+		double missNs = missTimer.Milliseconds() * 1e6 / MissLookups;
+		DoNotOptimize(bytes);
+
+		printf("%3u variants: hot Get %6.1f ns%s; at half capacity %8.1f ns (%.0f%% misses)\n", workingSet, ns,
+				allHits ? "" : " (MISSED)", missNs, 100.0 * small.Stats().Misses / MissLookups);
+	}
+	fs::remove_all(dir);
+	return 0;
+}
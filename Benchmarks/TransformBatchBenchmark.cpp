@@ -0,0 +1,60 @@
+// Matrices per second on one core for each transform path the CPU supports,
+// writing into an ObjectConstants-like stream. 1k matrices stay in L1/L2; 1M
+// matrices (64 MB in, 128 MB out) show the memory-bound rate.
+
+#include "BenchmarkHarness.h"
+#include "TransformBatch.h"
+#include <vector>
+
+int main(int argc, char **argv) {
+	bool quick = QuickRun(argc, argv);
+	const uint32_t Counts[] = { 1000, 100000, 1000000 };
+	const double TargetMatrices = quick ? 2e5 : 1e8;
+
+	std::vector<SimdPath> paths = { SimdPath::Scalar };
+	if (DetectSimdPath() != SimdPath::Scalar)
+		paths.push_back(SimdPath::SSE2);
+	if (DetectSimdPath() == SimdPath::AVX2)
+		paths.push_back(SimdPath::AVX2);
+
+	TransformStreamLayout layout;
+	layout.Stride = 2 * sizeof(Float4x4);
+	layout.WorldViewProjOffset = 0;
+	layout.WorldOffset = sizeof(Float4x4);
+
+	Float4x4 viewProj;
+	viewProj.m[2][3] = 1.0f;
+	viewProj.m[3][2] = -0.5f;
+	for (uint32_t count : Counts) {
+		if (quick && count > 100000)
+			break;
+		std::vector<Float4x4> worlds(count);
+		for (uint32_t i = 0; i < count; ++i)
+			worlds[i].m[3][0] = float(i);
+		std::vector<uint8_t> out(count * layout.Stride);
+		int reps = int(TargetMatrices / count) + 1;
+
+		for (SimdPath path : paths) {
+			// Touch the output once so page faults are not timed.
+			BatchWorldViewProj(worlds.data(), count, viewProj, out.data(), layout, path);
+			BenchmarkTimer wvpTimer;
+			for (int rep = 0; rep < reps; ++rep) {
+				BatchWorldViewProj(worlds.data(), count, viewProj, out.data(), layout, path);
+				DoNotOptimize(out[0]);
+			}
+			double wvpMs = wvpTimer.Milliseconds();
+
+			BenchmarkTimer transposeTimer;
+			for (int rep = 0; rep < reps; ++rep) {
+				BatchTransposeWorlds(worlds.data(), count, out.data(), layout, path);
+				DoNotOptimize(out[0]);
+			}
+			double transposeMs = transposeTimer.Milliseconds();
+
+			double matrices = double(count) * reps;
+			printf("%8u matrices %-6s: world*viewProj %7.1f M/s/core, transpose only %7.1f M/s/core\n", count,
+					SimdPathName(path), matrices / wvpMs / 1e3, matrices / transposeMs / 1e3);
+		}
+	}
+	return 0;
+}
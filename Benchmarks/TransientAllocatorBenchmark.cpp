@@ -0,0 +1,77 @@
+// Transient heap packing over frame traces: the heap PackTransientAllocations
+// lays out, next to what the same resources take as committed allocations
+// and the peak live size (no packing can go below it), and the time packing
+// takes. Packing runs once per graph compile, not per frame.
+
+#include "BenchmarkHarness.h"
+#include "TransientAllocator.h"
+#include <random>
+
+static const double MiB = 1024.0 * 1024.0;
+
+static TransientAllocationRequest Texture(uint64_t bytes, uint32_t first, uint32_t last) {
+	TransientAllocationRequest request;
+	request.ByteSize = (bytes + 65535) / 65536 * 65536;
+	request.FirstPass = first;
+	request.LastPass = last;
+	return request;
+}
+
+// Deferred frame at the given resolution; see DeferredFrameTrace in the tests.
+static std::vector<TransientAllocationRequest> DeferredTrace(uint64_t width, uint64_t height) {
+	const uint64_t Rgba8 = width * height * 4, Rgba16f = width * height * 8;
+	return {
+		Texture(Rgba8, 0, 3), Texture(Rgba8, 0, 3), Texture(Rgba8, 0, 3), Texture(Rgba8, 0, 3),
+		Texture(Rgba8 / 4, 1, 2), Texture(Rgba8 / 4, 2, 3), Texture(Rgba16f, 3, 6),
+		Texture(Rgba16f / 4, 4, 5), Texture(Rgba16f / 16, 4, 5), Texture(Rgba16f / 4, 5, 6),
+		Texture(Rgba8, 6, 7),
+	};
+}
+
+// Today's forward frame: just the depth buffer, from the clear to the scene.
+static std::vector<TransientAllocationRequest> ForwardTrace() {
+	return { Texture(1920 * 1080 * 4, 0, 1) };
+}
+
+static std::vector<TransientAllocationRequest> RandomTrace(uint32_t count, uint32_t passes) {
+	std::mt19937 rng(59);
+	std::vector<TransientAllocationRequest> requests;
+	for (uint32_t i = 0; i < count; ++i) {
+		uint32_t first = rng() % passes;
+		requests.push_back(Texture(65536 + rng() % (32u << 20), first, first + rng() % 8));
+	}
+	return requests;
+}
+
+static uint64_t PeakLiveBytes(const std::vector<TransientAllocationRequest> &requests) {
+	uint64_t peak = 0;
+	for (const TransientAllocationRequest &at : requests) {
+		uint64_t live = 0;
+		for (const TransientAllocationRequest &r : requests)
+			live += r.FirstPass <= at.FirstPass && at.FirstPass <= r.LastPass ? r.ByteSize : 0;
+		peak = live > peak ? live : peak;
+	}
+	return peak;
+}
+
+static void Report(const char *name, const std::vector<TransientAllocationRequest> &requests, int reps) {
+	TransientAllocationResult result;
+	BenchmarkTimer timer;
+	for (int rep = 0; rep < reps; ++rep)
+		PackTransientAllocations(requests, result);
+	double us = timer.Milliseconds() * 1e3 / reps;
+	printf("%-16s %3zu resources: heap %7.1f MiB, committed %7.1f MiB (%3.0f%%), peak live %7.1f MiB, pack %8.2f us\n",
+			name, requests.size(), result.HeapSize / MiB, result.CommittedSize / MiB,
+			100.0 * result.HeapSize / result.CommittedSize, PeakLiveBytes(requests) / MiB, us);
+}
+
+int main(int argc, char **argv) {
+	bool quick = QuickRun(argc, argv);
+	int reps = quick ? 10 : 1000;
+	Report("forward 1080p", ForwardTrace(), reps);
+	Report("deferred 1080p", DeferredTrace(1920, 1080), reps);
+	Report("deferred 4K", DeferredTrace(3840, 2160), reps);
+	Report("random 64/32", RandomTrace(64, 32), reps);
+	Report("random 256/128", RandomTrace(256, 128), quick ? 1 : 20);
+	return 0;
+}
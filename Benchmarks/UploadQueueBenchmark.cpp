@@ -0,0 +1,52 @@
+// Upload throughput through UploadQueue for a streaming-like mix of buffer
+// sizes, against staging rings of several sizes. The copy queue is the null
+// one and the GPU retires one batch for every few submitted, so a small ring
+// shows up as stalls. Measures the queue's bookkeeping plus the memcpy into
+// staging.
+
+#include "BenchmarkHarness.h"
+#include "UploadQueue.h"
+#include <random>
+#include <vector>
+
+int main(int argc, char **argv) {
+	bool quick = QuickRun(argc, argv);
+	const int Uploads = quick ? 2000 : 200000;
+	const uint64_t StagingSizes[] = { 1ull << 20, 8ull << 20, 32ull << 20 };
+
+	std::mt19937 rng(61);
+	std::vector<uint32_t> sizes(4096);
+	for (uint32_t &size : sizes)
+		size = rng() % 8 == 0 ? 256 * 1024 + rng() % (768 * 1024) : 256 + rng() % 16384;
+	std::vector<uint8_t> source(1 << 20, 0x5a);
+
+	for (uint64_t stagingSize : StagingSizes) {
+		MallocPageProvider pages;
+		FakeFence fence;
+		NullUploadCopyQueue copyQueue(&fence);
+		UploadQueueDesc desc;
+		desc.StagingByteSize = stagingSize;
+		desc.MaxBatchBytes = stagingSize / 4;
+
+		uint64_t bytes = 0;
+		BenchmarkTimer timer;
+		{
+			UploadQueue uploads(&pages, &copyQueue, &fence, desc);
+			int destination = 0;
+			for (int i = 0; i < Uploads; ++i) {
+				uint32_t size = sizes[i & 4095];
+				uploads.UploadBuffer(&destination, 0, source.data(), size);
+				bytes += size;
+				// The GPU finishes one batch per 64 uploads.
+				if (i % 64 == 63)
+					fence.Retire();
+			}
+			double ms = timer.Milliseconds();
+			const UploadQueueStats &stats = uploads.Stats();
+			printf("%3llu MiB staging: %7.0f MB/s, %6llu batches, %5llu stalls, high water %5.1f MiB\n",
+					(unsigned long long)(stagingSize >> 20), bytes / (ms * 1e3), (unsigned long long)stats.Batches,
+					(unsigned long long)stats.Stalls, stats.StagingHighWaterMark / (1024.0 * 1024.0));
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "ResourceState.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct TrackedBarrier {
+	enum Kind : uint32_t {
+		Transition,
+		Uav,
+		Aliasing,
+	};
+	// Split transitions are issued as a begin and a matching end, so the GPU
+	// can overlap the transition with the work recorded between them.
+	enum SplitFlag : uint32_t {
+		Full,
+		BeginOnly,
+		EndOnly,
+	};
+
+	Kind Type = Transition;
+	SplitFlag Split = Full;
+	const void *Resource = nullptr;
+	uint32_t Subresource = UINT32_MAX;
+	ResourceState Before = ResourceState::Common;
+	ResourceState After = ResourceState::Common;
+};
+
+// Where a tracker sends its barriers: one call per flushed batch.
+class IBarrierCommandList {
+public:
+	virtual ~IBarrierCommandList() = default;
+	virtual void ResourceBarrier(const TrackedBarrier *barriers, uint32_t count) = 0;
+};
+
+// Keeps every batch, for checking what a tracker emitted without a GPU.
+class NullBarrierCommandList : public IBarrierCommandList {
+public:
+	virtual void ResourceBarrier(const TrackedBarrier *barriers, uint32_t count) override {
+		++Calls;
+		Barriers.insert(Barriers.end(), barriers, barriers + count);
+	}
+
+	uint32_t Calls = 0;
+	std::vector<TrackedBarrier> Barriers;
+};
+
+// State of each resource between command lists, in execution order.
+// Resources are identified by any stable pointer (the ID3D12Resource).
+class ResourceStateTable {
+public:
+	// Buffers (and simultaneous-access textures) are promoted out of Common
+	// implicitly on first use and decay back to it when their command list
+	// completes, so they never need a barrier to leave Common.
+	void Register(const void *resource, ResourceState state, uint32_t subresourceCount = 1, bool implicitPromotion = false);
+	void Unregister(const void *resource);
+
+	bool IsRegistered(const void *resource) const { return mEntries.count(resource) != 0; }
+	ResourceState State(const void *resource, uint32_t subresource = 0) const;
+
+private:
+	friend class BarrierTracker;
+
+	struct Entry {
+		std::vector<ResourceState> States;
+		bool ImplicitPromotion = false;
+	};
+
+	std::unordered_map<const void *, Entry> mEntries;
+};
+
+struct BarrierTrackerStats {
+	// Transitions asked for, and what reached the command list.
+	uint32_t Requested = 0;
+	uint32_t Emitted = 0;
+	// Requests that needed no barrier: already in the state, an implicit
+	// promotion, or merged into (or cancelled by) a pending transition.
+	uint32_t Elided = 0;
+	uint32_t Calls = 0;
+};
+
+// Per-command-list barrier tracker. Transition() only records what the next
+// draw or copy needs; Flush(), called right before that draw or copy, sends
+// every pending barrier in one ResourceBarrier call. Pending transitions of
+// the same subresource are merged (A->B then B->C becomes A->C, A->B then
+// B->A disappears). Resources start a list in the state the table has for
+// them, and Finish() writes the list's final states back, so trackers must be
+// finished in the order their lists execute. Not thread safe; use one
+// tracker per list.
+class BarrierTracker {
+public:
+	static constexpr uint32_t AllSubresources = UINT32_MAX;
+
+	explicit BarrierTracker(ResourceStateTable *table);
+
+	void Transition(const void *resource, ResourceState after, uint32_t subresource = AllSubresources);
+	// Starts a split transition that ends at the resource's next Transition()
+	// (or Finish()), letting the GPU overlap it with the work in between.
+	void BeginTransition(const void *resource, ResourceState after, uint32_t subresource = AllSubresources);
+	void UavBarrier(const void *resource);
+	void AliasingBarrier(const void *resource);
+
+	void Flush(IBarrierCommandList &cmdList);
+	// Ends any open split transitions, flushes, and commits the final states.
+	void Finish(IBarrierCommandList &cmdList);
+
+	ResourceStateTable *Table() const { return mTable; }
+	uint32_t PendingCount() const { return static_cast<uint32_t>(mPending.size()); }
+	// Whether a Flush() is needed before a draw or copy that uses resource.
+	bool HasPending(const void *resource) const;
+	const BarrierTrackerStats &Stats() const { return mStats; }
+
+private:
+	struct Local {
+		std::vector<ResourceState> States;
+		bool ImplicitPromotion = false;
+		// Open split transitions: the state they started from and the
+		// subresource index the begin barrier was issued with.
+		std::vector<bool> Splitting;
+		std::vector<ResourceState> SplitFrom;
+		std::vector<uint32_t> SplitKey;
+	};
+
+	Local &Track(const void *resource);
+	void RequestTransition(const void *resource, ResourceState after, uint32_t subresource, bool split);
+	void TransitionSubresource(const void *resource, Local &local, uint32_t subresource, ResourceState after,
+			uint32_t barrierSubresource, bool split);
+	void EndSplit(const void *resource, Local &local, uint32_t subresource);
+	void Queue(const TrackedBarrier &barrier);
+
+	ResourceStateTable *mTable = nullptr;
+	std::unordered_map<const void *, Local> mLocal;
+	std::vector<TrackedBarrier> mPending;
+	BarrierTrackerStats mStats;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Stable handle into the bindless table. Index is what shaders see (through
+// constant data); Generation lets the CPU side detect a handle whose slot
+// has been released, and possibly reused, since it was issued.
+struct BindlessHandle {
+	uint32_t Index = UINT32_MAX;
+	uint32_t Generation = 0;
+
+	bool IsValid() const { return Index != UINT32_MAX; }
+};
+
+// Assigns slots of one large descriptor table to resources. Released slots
+// stop being alive immediately but only become free again once the GPU has
+// retired the frame they were released in, since draws already recorded may
+// still read them: Release() queues the slot on the current frame,
+// FinishFrame() stamps that frame with its fence value and Retire() recycles
+// every frame whose fence has completed.
+class BindlessRegistry {
+public:
+	explicit BindlessRegistry(uint32_t capacity);
+
+	// Returns an invalid handle if every slot is in use or waiting on the GPU.
+	BindlessHandle Register();
+	// Returns false, and does nothing, for a stale or invalid handle.
+	bool Release(BindlessHandle handle);
+
+	void FinishFrame(uint64_t fenceValue);
+	void Retire(uint64_t completedFenceValue);
+
+	bool IsAlive(BindlessHandle handle) const;
+
+	uint32_t Capacity() const { return static_cast<uint32_t>(mGenerations.size()); }
+	uint32_t LiveCount() const { return mLiveCount; }
+	uint32_t PendingCount() const;
+
+private:
+	struct PendingFrame {
+		uint64_t FenceValue;
+		uint32_t SlotCount;
+	};
+
+	// Odd generations are alive, even ones are free or pending.
+	std::vector<uint32_t> mGenerations;
+	std::vector<uint32_t> mFree;
+	uint32_t mLiveCount = 0;
+
+	// Released slots in release order, and how many of them each finished
+	// frame owns. The last mUnfinished slots belong to the current frame.
+	std::deque<uint32_t> mPending;
+	std::deque<PendingFrame> mFrames;
+	uint32_t mUnfinished = 0;
+};
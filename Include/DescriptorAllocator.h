@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <set>
+#include <utility>
+
+// A run of consecutive descriptor slots in a heap.
+struct DescriptorRange {
+	uint32_t Offset = UINT32_MAX;
+	uint32_t Count = 0;
+
+	bool IsValid() const { return Offset != UINT32_MAX; }
+};
+
+// Allocator for long-lived descriptors (render target and depth views,
+// texture SRVs). Free space is kept as ranges indexed both by offset, so
+// freed ranges merge with their neighbours, and by size, so allocation is a
+// best fit in O(log n).
+class DescriptorFreeList {
+public:
+	DescriptorFreeList(uint32_t offset, uint32_t capacity);
+
+	// Returns an invalid range if no free range is large enough.
+	DescriptorRange Allocate(uint32_t count);
+	void Free(DescriptorRange range);
+
+	uint32_t Capacity() const { return mCapacity; }
+	uint32_t FreeCount() const { return mFreeCount; }
+	uint32_t FreeRangeCount() const { return static_cast<uint32_t>(mByOffset.size()); }
+	uint32_t LargestFreeRange() const;
+
+private:
+	void Insert(uint32_t offset, uint32_t count);
+	void Erase(std::map<uint32_t, uint32_t>::iterator it);
+
+	uint32_t mCapacity = 0;
+	uint32_t mFreeCount = 0;
+
+	std::map<uint32_t, uint32_t> mByOffset;           // offset -> count
+	std::set<std::pair<uint32_t, uint32_t>> mBySize; // (count, offset)
+};
+
+// Ring of transient descriptors, for tables that are written during a frame
+// and only needed until the GPU has executed it. Allocation bumps the head;
+// FinishFrame() closes the current frame with the fence value it signals,
+// and Retire() frees every frame whose fence has completed. Allocations are
+// contiguous, so a request that does not fit before the end of the ring
+// skips the rest of it and starts again at the beginning.
+class DescriptorRing {
+public:
+	DescriptorRing(uint32_t offset, uint32_t capacity);
+
+	// Returns an invalid range if the ring is full; the caller has to wait for
+	// the GPU to retire a frame.
+	DescriptorRange Allocate(uint32_t count);
+
+	void FinishFrame(uint64_t fenceValue);
+	void Retire(uint64_t completedFenceValue);
+
+	uint32_t Capacity() const { return mCapacity; }
+	uint32_t UsedCount() const { return static_cast<uint32_t>(mAllocated - mFreed); }
+	uint32_t FramesInFlight() const { return static_cast<uint32_t>(mFrames.size()); }
+
+private:
+	struct Frame {
+		uint64_t FenceValue;
+		uint32_t Head;
+		uint64_t Allocated;
+	};
+
+	uint32_t mOffset = 0;
+	uint32_t mCapacity = 0;
+
+	uint32_t mHead = 0;
+	uint32_t mTail = 0;
+
+	// Running totals of slots consumed (including skipped ones) and released.
+	uint64_t mAllocated = 0;
+	uint64_t mFreed = 0;
+
+	std::deque<Frame> mFrames;
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// 64-bit draw sort key, most significant field first:
+//   pass (4) | pipeline (12) | material (16) | mesh (16) | depth (16)
+// Sorting by key groups draws by pass, then by the most expensive state to
+// change, and orders draws that share all state front to back.
+namespace SortKey {
+	constexpr uint32_t PassBits = 4;
+	constexpr uint32_t PipelineBits = 12;
+	constexpr uint32_t MaterialBits = 16;
+	constexpr uint32_t MeshBits = 16;
+	constexpr uint32_t DepthBits = 16;
+
+	constexpr uint32_t DepthShift = 0;
+	constexpr uint32_t MeshShift = DepthShift + DepthBits;
+	constexpr uint32_t MaterialShift = MeshShift + MeshBits;
+	constexpr uint32_t PipelineShift = MaterialShift + MaterialBits;
+	constexpr uint32_t PassShift = PipelineShift + PipelineBits;
+	static_assert(PassShift + PassBits == 64, "sort key fields must fill 64 bits");
+
+	// Fields wider than their slot are truncated.
+	constexpr uint64_t Make(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t depth) {
+		return (uint64_t(pass & ((1u << PassBits) - 1)) << PassShift) |
+				(uint64_t(pipeline & ((1u << PipelineBits) - 1)) << PipelineShift) |
+				(uint64_t(material & ((1u << MaterialBits) - 1)) << MaterialShift) |
+				(uint64_t(mesh & ((1u << MeshBits) - 1)) << MeshShift) |
+				(uint64_t(depth & ((1u << DepthBits) - 1)) << DepthShift);
+	}
+
+	// Maps a view-space depth in [nearZ, farZ] linearly onto the depth field.
+	uint32_t QuantizeDepth(float viewDepth, float nearZ, float farZ);
+} // namespace SortKey
+
+// One draw, with the state it needs spelled out so submission does not have
+// to decode the (possibly truncated) key fields.
+struct DrawPacket {
+	uint64_t Key = 0;
+
+	uint32_t Pipeline = 0;
+	uint32_t Material = 0;
+	uint32_t Mesh = 0;
+	uint32_t PrimitiveType = 4; // D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+
+	// Per-draw data, e.g. the render item's slot in the object buffer. A
+	// packet with several instances covers objects [Object, Object + InstanceCount).
+	uint32_t Object = 0;
+
+	// DrawIndexedInstanced parameters. FirstInstance is where this draw's
+	// entries start in the per-instance buffer (see InstanceBatcher).
+	uint32_t IndexCount = 0;
+	uint32_t InstanceCount = 1;
+	uint32_t StartIndexLocation = 0;
+	int32_t BaseVertexLocation = 0;
+	uint32_t FirstInstance = 0;
+};
+
+// Receives the state changes and draws of a submitted packet range. The
+// renderer implements this over a command list; the null sink below only
+// counts calls, which is enough to test or time sorting and submission.
+class IDrawCommandSink {
+public:
+	virtual ~IDrawCommandSink() = default;
+
+	virtual void SetPipeline(uint32_t pipeline) = 0;
+	virtual void SetMaterial(uint32_t material) = 0;
+	virtual void SetMesh(uint32_t mesh) = 0;
+	virtual void SetPrimitiveType(uint32_t primitiveType) = 0;
+	virtual void Draw(const DrawPacket &packet) = 0;
+};
+
+class NullDrawSink : public IDrawCommandSink {
+public:
+	void SetPipeline(uint32_t) override { ++Calls; }
+	void SetMaterial(uint32_t) override { ++Calls; }
+	void SetMesh(uint32_t) override { ++Calls; }
+	void SetPrimitiveType(uint32_t) override { ++Calls; }
+	void Draw(const DrawPacket &) override { ++Calls; }
+
+	uint64_t Calls = 0;
+};
+
+struct DrawSubmitStats {
+	uint32_t Draws = 0;
+
+	// State changes that were issued.
+	uint32_t PipelineChanges = 0;
+	uint32_t MaterialChanges = 0;
+	uint32_t MeshChanges = 0;
+	uint32_t PrimitiveTypeChanges = 0;
+
+	// State changes a draw-by-draw submission would have issued but were
+	// skipped because the state was already bound.
+	uint32_t AvoidedChanges = 0;
+
+	DrawSubmitStats &operator+=(const DrawSubmitStats &rhs);
+};
+
+// Collects draw packets for a frame, sorts them by key with an LSD radix sort
+// and submits them while filtering out redundant state changes.
+class DrawQueue {
+public:
+	void Clear();
+	void Reserve(uint32_t count);
+	void Push(const DrawPacket &packet);
+
+	// Stable sort by key. Byte passes where every key has the same digit are
+	// skipped, so keys that only differ in a few fields sort in a few passes.
+	void Sort();
+
+	uint32_t Size() const { return static_cast<uint32_t>(mPackets.size()); }
+
+	// i-th packet in sorted order (insertion order before Sort()).
+	const DrawPacket &Packet(uint32_t i) const { return mPackets[mOrder[i]]; }
+
+	// Submits sorted packets [first, first + count). State is assumed unbound
+	// at the start of the range, so disjoint ranges can be submitted into
+	// separate command lists concurrently.
+	DrawSubmitStats Submit(IDrawCommandSink &sink, uint32_t first, uint32_t count) const;
+
+private:
+	std::vector<DrawPacket> mPackets;
+	std::vector<uint64_t> mKeys;
+	std::vector<uint32_t> mOrder;
+
+	// Ping-pong buffers for the radix sort.
+	std::vector<uint64_t> mTempKeys;
+	std::vector<uint32_t> mTempOrder;
+};
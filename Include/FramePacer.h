@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// The fence operations the frame pacer needs. The D3D12 implementation wraps
+// an ID3D12Fence and its command queue; FakeFence stands in for a GPU so the
+// pacing policy can run headless.
+class IFrameFence {
+public:
+	virtual ~IFrameFence() = default;
+
+	// Last value the GPU has reached.
+	virtual uint64_t CompletedValue() const = 0;
+	// Queue a signal of value behind all previously submitted work.
+	virtual void Signal(uint64_t value) = 0;
+	// Block the calling thread until CompletedValue() >= value.
+	virtual void Wait(uint64_t value) = 0;
+};
+
+// Software fence. Signalled values complete when Retire() is called (one GPU
+// "frame" finishing) or immediately when the CPU waits on them, which is what
+// a blocking wait on a real fence looks like from the CPU's side.
+class FakeFence : public IFrameFence {
+public:
+	virtual uint64_t CompletedValue() const override { return mCompleted; }
+	virtual void Signal(uint64_t value) override;
+	virtual void Wait(uint64_t value) override;
+
+	// Completes the oldest pending signal. Returns false if nothing is pending.
+	bool Retire();
+	void RetireAll();
+
+	uint64_t LastSignaledValue() const { return mSignaled; }
+	uint64_t WaitCount() const { return mWaitCount; }
+
+private:
+	uint64_t mSignaled = 0;
+	uint64_t mCompleted = 0;
+	uint64_t mWaitCount = 0;
+	std::vector<uint64_t> mPending;
+};
+
+struct FramePacerStats {
+	uint64_t FramesSubmitted = 0;
+	// Number of BeginFrame/Flush calls that had to block on the fence.
+	uint64_t Stalls = 0;
+	double StallSeconds = 0.0;
+	// Deepest the CPU has been ahead of the GPU, in frames.
+	uint32_t MaxCpuAheadFrames = 0;
+};
+
+// Owns the fence values for N frames in flight. BeginFrame() hands out the
+// index of the frame resource to record into and only blocks when the CPU is
+// more than MaxLatency frames ahead of the GPU; EndFrame() signals the fence
+// for the frame just submitted.
+class FramePacer {
+public:
+	FramePacer(IFrameFence *fence, uint32_t framesInFlight, uint32_t maxLatency = 0);
+	FramePacer(const FramePacer &rhs) = delete;
+	FramePacer &operator=(const FramePacer &rhs) = delete;
+
+	uint32_t BeginFrame();
+	uint64_t EndFrame();
+
+	// Signals a new fence point and waits until the GPU has reached it.
+	void Flush();
+
+	// Clamped to [1, framesInFlight]. Lower values trade throughput for latency.
+	void SetMaxLatency(uint32_t frames);
+	uint32_t MaxLatency() const { return mMaxLatency; }
+	uint32_t FramesInFlight() const { return static_cast<uint32_t>(mFrameFences.size()); }
+
+	uint32_t CurrentFrameIndex() const { return mFrameIndex; }
+	// Fence value the given frame resource was last submitted with.
+	uint64_t FrameFenceValue(uint32_t frameIndex) const { return mFrameFences[frameIndex]; }
+	uint64_t LastSignaledValue() const { return mNextValue - 1; }
+
+	// How many submitted frames the GPU has not finished yet.
+	uint32_t CpuAheadFrames() const;
+	const FramePacerStats &Stats() const { return mStats; }
+
+private:
+	void WaitFor(uint64_t value);
+
+	IFrameFence *mFence = nullptr;
+	std::vector<uint64_t> mFrameFences;
+	uint32_t mMaxLatency = 0;
+	uint32_t mFrameIndex = 0;
+	uint64_t mFrameNumber = 0;
+	uint64_t mNextValue = 1;
+
+	FramePacerStats mStats;
+};
@@ -19,24 +19,38 @@ struct PassConstants {
 	float DeltaTime = 0.0f;
 };
 
+// Only what changes per object; the camera lives in PassConstants, so moving
+// it does not dirty any object.
 struct ObjectConstants {
-	DirectX::XMFLOAT4X4 WorldViewProj = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4X4 world = MathHelper::Identity4x4();
 	DirectX::XMFLOAT4 color;
-	uint32_t useCustomColor;
-	DirectX::XMFLOAT4X4 world;
 };
 
 struct FrameResource {
 public:
-	FrameResource(ID3D12Device *device, UINT passCount, UINT objectCount);
+	static const UINT64 DefaultUploadPageSize = 1024 * 1024;
+
+	FrameResource(ID3D12Device *device, UINT objectCount, UINT threadCount, UINT64 uploadPageSize = DefaultUploadPageSize);
 	FrameResource(const FrameResource &rhs) = delete;
 	FrameResource &operator=(const FrameResource &rhs) = delete;
 	~FrameResource();
 
 	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CmdListAlloc;
 
-	std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
+	// One allocator/list pair per recording thread.  Draw submission is split
+	// into chunks, chunk i is recorded into ThreadCmdLists[i], and the lists are
+	// executed in index order.
+	std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> ThreadCmdListAllocs;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>> ThreadCmdLists;
+
+	// Per-object data, one tightly packed element per render item.  Bound as a
+	// structured buffer so instanced draws can index it by object.
 	std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
+	// ObjectCB's slot in the bindless table.
+	BindlessHandle ObjectSrv;
 
-	UINT64 Fence = 0;
+	// Transient upload memory for this frame (pass constants, per-draw constants,
+	// dynamic vertex/index data).  Reset once the GPU has finished the frame.
+	std::unique_ptr<D3D12UploadPageProvider> UploadPages = nullptr;
+	std::unique_ptr<LinearAllocator> UploadArena = nullptr;
 };
\ No newline at end of file
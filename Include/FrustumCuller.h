@@ -0,0 +1,60 @@
+#pragma once
+
+#include "MathTypes.h"
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Axis-aligned boxes as center/extents, one array per component so four
+// boxes can be tested against a plane with one set of SIMD loads.
+struct AabbSoA {
+	std::vector<float> CenterX, CenterY, CenterZ;
+	std::vector<float> ExtentX, ExtentY, ExtentZ;
+
+	uint32_t Size() const { return static_cast<uint32_t>(CenterX.size()); }
+	void Resize(uint32_t count);
+	void PushBack(const Float3 &center, const Float3 &extents);
+	void PopBack();
+	void Set(uint32_t index, const Float3 &center, const Float3 &extents);
+	void Copy(uint32_t dst, uint32_t src);
+};
+
+// Transforms a local-space box by an affine world matrix (row-vector
+// convention) and returns the enclosing world-space box.
+void TransformAabb(const Float3 &center, const Float3 &extents, const Float4x4 &world,
+		Float3 &outCenter, Float3 &outExtents);
+
+// Six normalized planes (a, b, c, d) with the inside on the positive side,
+// in left/right/bottom/top/near/far order.
+struct Frustum {
+	Float4 Planes[6];
+
+	// Extracts the planes from a D3D-style view * projection matrix (row
+	// vectors, clip-space z in [0, w]).
+	static Frustum FromViewProj(const Float4x4 &viewProj);
+};
+
+// Tests boxes [first, first + count) and appends the indices of the ones that
+// intersect the frustum to outVisible, which must have room for count
+// entries. Returns how many were written. Uses SSE2 where available.
+uint32_t CullAabbRange(const Frustum &frustum, const AabbSoA &boxes, uint32_t first, uint32_t count,
+		uint32_t *outVisible);
+
+// Culls a whole box set, splitting it into chunks that are tested as jobs on
+// the job system (or inline when there is none). The result is a compact,
+// ascending list of visible indices.
+class FrustumCuller {
+public:
+	explicit FrustumCuller(JobSystem *jobs = nullptr, uint32_t minBoxesPerChunk = 4096);
+
+	void SetJobSystem(JobSystem *jobs) { mJobs = jobs; }
+
+	uint32_t Cull(const Frustum &frustum, const AabbSoA &boxes, std::vector<uint32_t> &outVisible);
+
+private:
+	JobSystem *mJobs = nullptr;
+	uint32_t mMinBoxesPerChunk = 4096;
+
+	std::vector<uint32_t> mChunkCounts;
+};
@@ -2,6 +2,19 @@
 #include "d3dApp.h"
 #include "UploadBuffer.h"
 #include "FreamResource.h"
+#include "DrawQueue.h"
+#include "FrustumCuller.h"
+#include "InstanceBatcher.h"
+#include "JobSystem.h"
+#include "MeshSimplifier.h"
+#include "MeshStreamer.h"
+#include "ParallelCommandRecorder.h"
+#include "PipelineStateCache.h"
+#include "RenderGraph.h"
+#include "RenderItemStore.h"
+#include "ShaderBuildQueue.h"
+#include "ShaderPermutation.h"
+#include "TransformBatch.h"
 
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
@@ -11,36 +24,17 @@ struct Vertex {
 	XMFLOAT4 Color;
 };
 
-struct RenderItem {
-	RenderItem() = default;
+// Attributes of Vertex, in MeshData terms.
+const uint32_t gBoxAttributes = MeshAttributePosition | MeshAttributeColor;
 
-	// World matrix of the shape that describes the object's local space
-	// relative to the world space, which defines the position, orientation,
-	// and scale of the object in the world.
-	XMFLOAT4X4 World = MathHelper::Identity4x4();
-
-	// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-	// Because we have an object cbuffer for each FrameResource, we have to apply the
-	// update to each FrameResource.  Thus, when we modify obect data we should set
-	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
-	int NumFramesDirty = gNumFrameResources;
-
-	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
-	UINT ObjCBIndex = -1;
-
-	MeshGeometry *Geo = nullptr;
-
-	// Primitive topology.
-	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-
-	// DrawIndexedInstanced parameters.
-	UINT IndexCount = 0;
-	UINT StartIndexLocation = 0;
-	int BaseVertexLocation = 0;
-};
+const int gNumFrameResources = 3;
 
+// Upper bound on live render items; sizes the per-frame object constant buffers.
+const UINT gMaxRenderItems = 1024;
 
-const int gNumFrameResources = 3;
+// Camera clip planes; also the range the draw sort key quantizes depth over.
+const float gNearZ = 1.0f;
+const float gFarZ = 1000.0f;
 
 class GameApp : public D3DApp {
 public:
@@ -59,36 +53,137 @@ private:
 	virtual void OnMouseDown(WPARAM btnState, int x, int y) override;
 	virtual void OnMouseUp(WPARAM btnState, int x, int y) override;
 	virtual void OnMouseMove(WPARAM btnState, int x, int y) override;
-	void BuildDescriptorHeaps();
-	void BuildConstantBuffers();
+	virtual void CreateDepthStencilBuffer() override;
 	void BuildRootSignature();
 	void BuildShadersAndInputLayout();
 	void BuildBoxGeometry();
+	void BuildRenderItems();
+	void WaitForShaders();
 	void BuildPSO();
+	uint32_t GetPipeline(uint64_t vsVariant);
 	void BuildFrameResources();
+	void UpdateObjectCBs();
+	void UpdateMainPassCB(const GameTimer &gt);
+	void CullRenderItems();
+	void BuildDrawQueue();
+	void RecordDrawChunk(const RecordChunk &chunk);
+	void BuildFrameGraph(const RenderGraphResourceDesc &depthDesc);
+	void BuildMeshStreaming();
+	void UpdateMeshStreaming();
+	void BuildStreamedRenderItems(MeshHandle handle, const MeshFileView &mesh);
+	void SelectStreamedLods(float projectionScale);
 
 	ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
-	ComPtr<ID3D12DescriptorHeap> mCbvHeap = nullptr;
 
-	std::unique_ptr<UploadBuffer<ObjectConstants>> mObjectCB = nullptr;
 	std::unique_ptr<MeshGeometry> mBoxGeo = nullptr;
 
-	ComPtr<ID3DBlob> mvsByteCode = nullptr;
-	ComPtr<ID3DBlob> mpsByteCode = nullptr;
+	// Meshes under Models/ (cooked from OBJ) load in the background and are
+	// uploaded as they arrive.  Evicted geometry is released once the frames
+	// that could still draw it have completed.
+	//
+	// Each mesh draws its full-detail subsets as render items beside the box.
+	// The items outlive eviction, drawing nothing, so culling still tells when
+	// the mesh comes back into view and must be requested again.  While
+	// resident, each item draws the level of its subset's LOD chain that
+	// SelectStreamedLods picks.
+	struct StreamedItem {
+		RenderItemHandle Item;
+		// Levels of detail, finest first, and the one drawn this frame.
+		std::vector<const SubmeshGeometry *> Lods;
+		std::vector<float> LodErrors;
+		uint32_t Lod = 0;
+	};
+	struct StreamedMeshItems {
+		std::unique_ptr<MeshGeometry> Geo;
+		uint32_t GeoIndex = 0;
+		// Model to world scale, which LOD errors are multiplied by.
+		float WorldScale = 1.0f;
+		std::vector<StreamedItem> Items;
+	};
+	std::unique_ptr<MeshStreamer> mMeshStreamer;
+	std::unordered_map<MeshHandle, StreamedMeshItems> mStreamedMeshes;
+	std::deque<std::pair<uint64_t, std::unique_ptr<MeshGeometry>>> mRetiredGeos;
+
+	// On-disk bytecode cache used by d3dUtil::CompileShader.
+	std::unique_ptr<ShaderCache> mShaderCache;
+
+	// Compiles shaders in the background during Initialize.
+	std::unique_ptr<ShaderBuildQueue> mShaderBuilds;
+	ShaderBuildHandle mVsShader = 0;
+	ShaderBuildHandle mPsShader = 0;
 
 	// std::vector<D3D12_INPUT_LAYOUT_DESC> mInputLayout;
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
-	ComPtr<ID3D12PipelineState> mPSO = nullptr;
+	// Compile-time options of color.hlsl's vertex shader and its variants.
+	ShaderPermutationDesc mColorShaderOptions;
+	uint32_t mCustomColorOption = 0;
+	std::unique_ptr<ShaderVariantCache> mColorVS;
+
+	// One PSO per vertex shader variant in use, looked up on first use.  The
+	// PSOs themselves are owned by the cache, which persists them across runs.
+	std::unique_ptr<PipelineStateCache> mPsoCache;
+	std::vector<ID3D12PipelineState *> mPipelines;
+	std::unordered_map<uint64_t, uint32_t> mPipelineByVariant;
+	bool mPipelinesMsaaState = false;
+	uint32_t mScenePipeline = 0;
+
+	// Worker pool for per-frame CPU work (constant packing, culling, recording).
+	std::unique_ptr<JobSystem> mJobs;
+	std::unique_ptr<ParallelCommandRecorder> mDrawRecorder;
+
+	// Records the UI and the final present transition after the scene chunks.
+	ComPtr<ID3D12GraphicsCommandList> mPostCommandList;
+
+	// Clear, scene and UI passes.  Compiled on every resize; each frame only
+	// rebinds the swap chain buffer in mGraphResources and runs the passes.
+	// The depth buffer is a transient of the graph, placed in mGraphTransients.
+	RenderGraph mFrameGraph;
+	RenderGraphResource mGraphBackBuffer;
+	RenderGraphResource mGraphDepthBuffer;
+	D3D12TransientResources mGraphTransients;
+	std::vector<const void *> mGraphResources;
+	// Graph barriers go through one tracker per command list, which batches
+	// them across passes and drops the ones that cancel out.
+	ResourceStateTable mResourceStates;
+	BarrierTracker mMainBarriers{ &mResourceStates };
+	BarrierTracker mPostBarriers{ &mResourceStates };
+	XMVECTORF32 mClearColor = Colors::LightSteelBlue;
+	UINT mDrawListCount = 0;
 
 	std::vector<std::unique_ptr<FrameResource>> mFrameResources;
 	FrameResource* mCurrFrameResource = nullptr;
 	int mCurrFrameResourceIndex = 0;
-	std::vector<std::unique_ptr<RenderItem>> mAllRitems;
 
+	// Render items are stored as structure-of-arrays and referenced by handle.
+	// Geometry is referenced by index into mGeometries.
+	std::unique_ptr<RenderItemStore> mRitems;
+	std::vector<MeshGeometry *> mGeometries;
+	RenderItemHandle mBoxRitem;
+
+	// Triangles the streamed meshes draw this frame, and at full detail.
+	uint64_t mStreamedTriangles = 0;
+	uint64_t mStreamedFullTriangles = 0;
+
+	// Indices of the render items that survived frustum culling this frame.
+	FrustumCuller mCuller;
+	std::vector<uint32_t> mVisibleRitems;
+
+	// Visible items as sorted draw packets, coalesced into instanced draws, and
+	// what submitting them cost.
+	DrawQueue mItemQueue;
+	DrawQueue mDrawQueue;
+	InstanceBatcher mInstanceBatcher;
+	InstanceBatchStats mInstanceStats;
+	UploadAllocation mInstanceData;
+	std::vector<DrawSubmitStats> mChunkDrawStats;
+	DrawSubmitStats mDrawStats;
+
+	// This frame's PassConstants in the upload arena.
+	D3D12_GPU_VIRTUAL_ADDRESS mPassCBAddress = 0;
 
-	XMFLOAT4X4 mWorld = MathHelper::Identity4x4();
 	XMFLOAT4X4 mView = MathHelper::Identity4x4();
 	XMFLOAT4X4 mProj = MathHelper::Identity4x4();
+	XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
 
 	float mTheta = 1.0f * XM_PI;
 	float mPhi = XM_PIDIV4;
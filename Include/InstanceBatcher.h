@@ -0,0 +1,53 @@
+#pragma once
+
+#include "DrawQueue.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct InstanceBatchStats {
+	uint32_t InputDraws = 0;
+	uint32_t OutputDraws = 0;
+};
+
+// Coalesces draws of the same submesh with the same pipeline and material into
+// instanced draws. Each output packet covers InstanceCount instances starting
+// at FirstInstance in Instances(), which lists the Object of every input
+// packet grouped by batch. The renderer uploads that list as the per-instance
+// buffer and the shader looks up per-object data through it.
+//
+// Batches are emitted in the order their first packet appears in the sorted
+// input, and instances keep their input order, so state grouping and the
+// front-to-back order inside a batch survive.
+class InstanceBatcher {
+public:
+	// Reads the sorted packets of input and pushes the batches to output,
+	// which is cleared first and needs no further sorting.
+	InstanceBatchStats Build(const DrawQueue &input, DrawQueue &output);
+
+	const std::vector<uint32_t> &Instances() const { return mInstances; }
+
+private:
+	// Everything that has to match for two draws to share one instanced draw.
+	struct DrawIdentity {
+		uint32_t Pipeline;
+		uint32_t Material;
+		uint32_t Mesh;
+		uint32_t PrimitiveType;
+		uint32_t IndexCount;
+		uint32_t StartIndexLocation;
+		int32_t BaseVertexLocation;
+
+		bool operator==(const DrawIdentity &rhs) const = default;
+	};
+
+	struct DrawIdentityHash {
+		size_t operator()(const DrawIdentity &id) const;
+	};
+
+	std::unordered_map<DrawIdentity, uint32_t, DrawIdentityHash> mBatchLookup;
+	std::vector<uint32_t> mBatchOfPacket;
+	std::vector<DrawPacket> mBatches;
+	std::vector<uint32_t> mInstances;
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+// Counts outstanding jobs. Jobs submitted with a counter increment it and
+// decrement it when they finish; other jobs can be made to wait for it to hit
+// zero, and threads can Wait() on it while helping to run work.
+class JobCounter {
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter &rhs) = delete;
+	JobCounter &operator=(const JobCounter &rhs) = delete;
+
+	bool IsDone() const { return mPending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> mPending{ 0 };
+
+	// Jobs waiting for this counter to reach zero.
+	std::mutex mMutex;
+	std::vector<std::function<void()>> mContinuations;
+};
+
+// Work-stealing scheduler. Each worker owns a deque: it pushes and pops at the
+// back, idle workers steal from the front of the others. Threads that are not
+// workers (e.g. the main thread) submit into a shared queue and run jobs when
+// they Wait(), so the caller counts as one of the ThreadCount() threads.
+class JobSystem {
+public:
+	// workerCount == 0 starts one worker per hardware thread minus the caller.
+	explicit JobSystem(uint32_t workerCount = 0);
+	JobSystem(const JobSystem &rhs) = delete;
+	JobSystem &operator=(const JobSystem &rhs) = delete;
+	~JobSystem();
+
+	void Run(std::function<void()> job, JobCounter *counter = nullptr);
+
+	// Runs job once dependency has reached zero.
+	void RunAfter(JobCounter &dependency, std::function<void()> job, JobCounter *counter = nullptr);
+
+	// Blocks until counter reaches zero, executing queued jobs meanwhile.
+	void Wait(JobCounter &counter);
+
+	// Calls fn(first, count) over [0, count) in chunks of at least minGrain
+	// items and returns when all chunks are done.
+	template<typename Fn>
+	void ParallelFor(uint32_t count, uint32_t minGrain, Fn &&fn);
+
+	// Worker threads plus the calling thread.
+	uint32_t ThreadCount() const { return static_cast<uint32_t>(mWorkers.size()) + 1; }
+
+	// 0 for threads that are not workers of this job system (including workers
+	// of another one), 1..WorkerCount for its own workers. Stable for the
+	// lifetime of the job system, so it can index per-thread resources.
+	uint32_t ThreadIndex() const;
+
+private:
+	struct Job {
+		std::function<void()> Fn;
+		JobCounter *Counter = nullptr;
+	};
+
+	struct WorkQueue {
+		std::mutex Mutex;
+		std::deque<Job> Jobs;
+	};
+
+	void Push(Job job);
+	bool TryPop(Job &job);
+	bool TrySteal(uint32_t thief, Job &job);
+	bool TryRunOne();
+	void Execute(Job &job);
+	void WorkerMain(uint32_t index);
+
+	// Queue 0 is shared by non-worker threads, queue i belongs to worker i.
+	std::vector<std::unique_ptr<WorkQueue>> mQueues;
+	std::vector<std::thread> mWorkers;
+
+	std::mutex mSleepMutex;
+	std::condition_variable mWake;
+	std::atomic<uint32_t> mQueuedJobs{ 0 };
+	bool mStopping = false;
+};
+
+template<typename Fn>
+void JobSystem::ParallelFor(uint32_t count, uint32_t minGrain, Fn &&fn) {
+	if (count == 0)
+		return;
+
+	uint32_t grain = minGrain == 0 ? 1 : minGrain;
+	uint32_t chunks = (count + grain - 1) / grain;
+	// A few chunks per thread so stealing can even out uneven work.
+	uint32_t maxChunks = ThreadCount() * 4;
+	if (chunks > maxChunks)
+		chunks = maxChunks;
+	uint32_t chunkSize = (count + chunks - 1) / chunks;
+
+	if (chunks == 1) {
+		fn(0u, count);
+		return;
+	}
+
+	JobCounter counter;
+	for (uint32_t first = chunkSize; first < count; first += chunkSize) {
+		uint32_t n = count - first < chunkSize ? count - first : chunkSize;
+		Run([&fn, first, n]() { fn(first, n); }, &counter);
+	}
+	fn(0u, chunkSize);
+	Wait(counter);
+}
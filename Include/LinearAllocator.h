@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// One chunk of persistently-mapped upload memory. CpuBase is where the CPU
+// writes, GpuBase is the matching address the GPU reads from. Handle is owned
+// by the page provider (an ID3D12Resource* for D3D12, nothing for malloc).
+struct UploadPage {
+	uint8_t *CpuBase = nullptr;
+	uint64_t GpuBase = 0;
+	uint64_t ByteSize = 0;
+	void *Handle = nullptr;
+};
+
+// A sub-allocation handed out by LinearAllocator. Valid until the allocator
+// is Reset(), which must only happen after the GPU is done with the frame.
+struct UploadAllocation {
+	uint8_t *Cpu = nullptr;
+	uint64_t Gpu = 0;
+	uint64_t ByteSize = 0;
+	void *PageHandle = nullptr;
+	uint64_t PageOffset = 0;
+};
+
+// Creates and destroys pages for a LinearAllocator. This is the only part that
+// knows about the graphics API, so the allocator itself can run on top of
+// plain heap memory.
+class IUploadPageProvider {
+public:
+	virtual ~IUploadPageProvider() = default;
+
+	virtual UploadPage CreatePage(uint64_t byteSize) = 0;
+	virtual void DestroyPage(UploadPage &page) = 0;
+};
+
+// Page provider backed by aligned heap memory. GpuBase mirrors the CPU
+// address so offsets and alignment can be checked without a device.
+class MallocPageProvider : public IUploadPageProvider {
+public:
+	virtual UploadPage CreatePage(uint64_t byteSize) override;
+	virtual void DestroyPage(UploadPage &page) override;
+};
+
+// Bump allocator over a chain of upload pages. Each frame in flight owns one;
+// it is reset once the fence for that frame has retired. When the current page
+// runs out we move on to the next page in the chain, creating it if needed, so
+// the arena grows to the high-water mark and then stops allocating.
+class LinearAllocator {
+public:
+	static const uint64_t DefaultAlignment = 256;
+
+	LinearAllocator(IUploadPageProvider *provider, uint64_t pageByteSize);
+	LinearAllocator(const LinearAllocator &rhs) = delete;
+	LinearAllocator &operator=(const LinearAllocator &rhs) = delete;
+	~LinearAllocator();
+
+	// Alignment must be a power of two. Requests larger than the page size get
+	// a dedicated page that is released on the next Reset().
+	UploadAllocation Allocate(uint64_t byteSize, uint64_t alignment = DefaultAlignment);
+
+	// Copies data into a fresh allocation. Convenience for constant buffers.
+	UploadAllocation Upload(const void *data, uint64_t byteSize, uint64_t alignment = DefaultAlignment);
+
+	// Rewinds to the first page. Pages are kept for reuse, oversized ones are
+	// freed, and pages beyond maxRetainedPages are trimmed.
+	void Reset(size_t maxRetainedPages = SIZE_MAX);
+
+	uint64_t PageByteSize() const { return mPageByteSize; }
+	size_t PageCount() const { return mPages.size(); }
+	uint64_t BytesAllocated() const { return mBytesAllocated; }
+	uint64_t HighWaterMark() const { return mHighWaterMark; }
+
+	static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+private:
+	bool TryAllocateFromCurrent(uint64_t byteSize, uint64_t alignment, UploadAllocation &out);
+	UploadAllocation AllocateDedicated(uint64_t byteSize);
+
+	IUploadPageProvider *mProvider = nullptr;
+	uint64_t mPageByteSize = 0;
+
+	std::vector<UploadPage> mPages;
+	std::vector<UploadPage> mDedicatedPages;
+	size_t mCurrPage = 0;
+	uint64_t mCurrOffset = 0;
+
+	uint64_t mBytesAllocated = 0;
+	uint64_t mHighWaterMark = 0;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Bounded multi-producer multi-consumer queue. Every cell carries a sequence
+// number saying whose turn it is: a producer may fill cell i when its sequence
+// equals the enqueue position, a consumer may empty it once the sequence is
+// one past. Push and pop each claim a position with a single compare-exchange
+// and never block; a full or empty queue just fails.
+template<typename T>
+class LockFreeQueue {
+public:
+	// Capacity is rounded up to a power of two.
+	explicit LockFreeQueue(uint32_t capacity);
+	LockFreeQueue(const LockFreeQueue &rhs) = delete;
+	LockFreeQueue &operator=(const LockFreeQueue &rhs) = delete;
+
+	// Moves from value only on success.
+	bool TryPush(T &&value);
+	bool TryPop(T &value);
+
+	uint32_t Capacity() const { return static_cast<uint32_t>(mMask + 1); }
+
+private:
+	struct Cell {
+		std::atomic<uint64_t> Sequence;
+		T Value;
+	};
+
+	std::unique_ptr<Cell[]> mCells;
+	uint64_t mMask = 0;
+
+	// Apart so producers and consumers do not share a cache line.
+	alignas(64) std::atomic<uint64_t> mEnqueuePos{ 0 };
+	alignas(64) std::atomic<uint64_t> mDequeuePos{ 0 };
+};
+
+template<typename T>
+LockFreeQueue<T>::LockFreeQueue(uint32_t capacity) {
+	uint64_t size = 1;
+	while (size < capacity)
+		size <<= 1;
+	mMask = size - 1;
+	mCells = std::make_unique<Cell[]>(size);
+	for (uint64_t i = 0; i < size; ++i)
+		mCells[i].Sequence.store(i, std::memory_order_relaxed);
+}
+
+template<typename T>
+bool LockFreeQueue<T>::TryPush(T &&value) {
+	uint64_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+	for (;;) {
+		Cell &cell = mCells[pos & mMask];
+		uint64_t sequence = cell.Sequence.load(std::memory_order_acquire);
+		int64_t diff = static_cast<int64_t>(sequence - pos);
+		if (diff == 0) {
+			if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				cell.Value = std::move(value);
+				cell.Sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		} else if (diff < 0) {
+			return false; // Full: the cell still holds last lap's value.
+		} else {
+			pos = mEnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+template<typename T>
+bool LockFreeQueue<T>::TryPop(T &value) {
+	uint64_t pos = mDequeuePos.load(std::memory_order_relaxed);
+	for (;;) {
+		Cell &cell = mCells[pos & mMask];
+		uint64_t sequence = cell.Sequence.load(std::memory_order_acquire);
+		int64_t diff = static_cast<int64_t>(sequence - (pos + 1));
+		if (diff == 0) {
+			if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				value = std::move(cell.Value);
+				cell.Sequence.store(pos + mMask + 1, std::memory_order_release);
+				return true;
+			}
+		} else if (diff < 0) {
+			return false; // Empty.
+		} else {
+			pos = mDequeuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
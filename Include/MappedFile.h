@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file. Pages are read in on first touch,
+// so opening is cheap and only what is used gets loaded.
+class MappedFile {
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile &rhs) = delete;
+	MappedFile &operator=(const MappedFile &rhs) = delete;
+	~MappedFile() { Close(); }
+
+	// An empty file opens with no data.
+	bool Open(const std::string &path);
+	void Close();
+
+	bool IsOpen() const { return mOpen; }
+	const uint8_t *Data() const { return mData; }
+	size_t Size() const { return mSize; }
+
+private:
+	const uint8_t *mData = nullptr;
+	size_t mSize = 0;
+	bool mOpen = false;
+#if defined(_WIN32)
+	void *mFile = nullptr;
+	void *mMapping = nullptr;
+#else
+	int mFd = -1;
+#endif
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+// Plain storage types with the same memory layout as DirectX::XMFLOAT3,
+// XMFLOAT4 and XMFLOAT4X4.  CPU-side systems that must also build without
+// DirectXMath (and so without Windows) keep their data in these; renderer code
+// can reinterpret between the two.
+struct Float3 {
+	float x = 0.0f;
+	float y = 0.0f;
+	float z = 0.0f;
+};
+
+struct Float4 {
+	float x = 0.0f;
+	float y = 0.0f;
+	float z = 0.0f;
+	float w = 0.0f;
+};
+
+struct Float4x4 {
+	float m[4][4] = {
+		{ 1.0f, 0.0f, 0.0f, 0.0f },
+		{ 0.0f, 1.0f, 0.0f, 0.0f },
+		{ 0.0f, 0.0f, 1.0f, 0.0f },
+		{ 0.0f, 0.0f, 0.0f, 1.0f }
+	};
+};
+
+static_assert(sizeof(Float3) == 12, "Float3 must match XMFLOAT3.");
+static_assert(sizeof(Float4) == 16, "Float4 must match XMFLOAT4.");
+static_assert(sizeof(Float4x4) == 64, "Float4x4 must match XMFLOAT4X4.");
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Vertex attributes a mesh can carry. Vertices store the attributes present,
+// in this order, as 32-bit floats: Position float3, Normal float3, TexCoord
+// float2, Color float4, Tangent float4 (w is the bitangent sign).
+enum MeshAttribute : uint32_t {
+	MeshAttributePosition = 1 << 0,
+	MeshAttributeNormal = 1 << 1,
+	MeshAttributeTexCoord = 1 << 2,
+	MeshAttributeColor = 1 << 3,
+	MeshAttributeTangent = 1 << 4,
+};
+
+uint32_t MeshVertexStride(uint32_t attributes);
+// Byte offset of attribute within a vertex, or UINT32_MAX if not present.
+uint32_t MeshAttributeOffset(uint32_t attributes, MeshAttribute attribute);
+
+// A range of the index buffer drawn on its own, with its local-space bounds.
+struct MeshSubset {
+	std::string Name;
+	uint32_t IndexCount = 0;
+	uint32_t StartIndex = 0;
+	int32_t BaseVertex = 0;
+	float BoundsMin[3] = {};
+	float BoundsMax[3] = {};
+	// Level of detail: 0 for full detail, otherwise a simplified copy of the
+	// level 0 subset before it, off by at most LodError model units.
+	uint32_t LodLevel = 0;
+	float LodError = 0.0f;
+};
+
+// Mesh in system memory, independent of the graphics API. Indices are 16-bit
+// when every vertex fits, 32-bit otherwise.
+struct MeshData {
+	std::string Name;
+	uint32_t Attributes = 0;
+	uint32_t VertexStride = 0;
+	uint32_t VertexCount = 0;
+	uint32_t IndexByteSize = 4;
+	uint32_t IndexCount = 0;
+	std::vector<uint8_t> Vertices;
+	std::vector<uint8_t> Indices;
+	std::vector<MeshSubset> Subsets;
+
+	uint64_t ByteSize() const { return Vertices.size() + Indices.size(); }
+	uint32_t Index(uint32_t i) const;
+};
+
+// Parses Wavefront OBJ text: v/vt/vn/f, with polygons fanned into triangles
+// and negative (relative) indices resolved. Each o or g statement starts a
+// subset. Normals and texture coordinates are kept if the file has any.
+bool DecodeObjMesh(const uint8_t *data, size_t size, MeshData &mesh, std::string &error);
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "MeshData.h"
+#include "VertexPacking.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary mesh container, laid out so a memory-mapped file can be used in
+// place:
+//
+//   MeshFileHeader
+//   MeshFileSubset[SubsetCount]
+//   subset names (not terminated)
+//   vertices   (16-byte aligned, VertexCount * VertexStride bytes)
+//   indices    (16-byte aligned, IndexCount * IndexByteSize bytes)
+//
+// Vertices are either MeshData's float layout or, with MeshFilePacked, the
+// packed layout of VertexPacking.h with positions quantized per subset, which
+// a renderer using that layout can upload as they are.
+//
+// All fields are little-endian. Readers reject other versions; bump
+// MeshFileVersion whenever the layout changes, or what the converter writes
+// into it (version 2 meshes are optimized for the vertex cache, version 3 adds
+// LOD chains, version 4 packed vertices).
+const uint32_t MeshFileMagic = 0x4853454D; // "MESH"
+const uint32_t MeshFileVersion = 4;
+const uint32_t MeshFileStreamAlignment = 16;
+
+// MeshFileHeader::Flags.
+const uint32_t MeshFilePacked = 1 << 0;
+
+struct MeshFileHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t Attributes;
+	uint32_t Flags;
+	uint32_t VertexStride;
+	uint32_t VertexCount;
+	uint32_t IndexByteSize;
+	uint32_t IndexCount;
+	uint32_t SubsetCount;
+	uint32_t Reserved;
+	uint64_t SubsetOffset;
+	uint64_t NameOffset;
+	uint64_t NameByteSize;
+	uint64_t VertexOffset;
+	uint64_t IndexOffset;
+	uint64_t FileSize;
+};
+static_assert(sizeof(MeshFileHeader) == 88, "MeshFileHeader layout is part of the file format");
+
+// A SubmeshGeometry range and its local-space bounds. NameOffset is relative
+// to the header's NameOffset. In packed files PositionScale and
+// PositionOffset take the subset's quantized positions to model space
+// (PackedSubset); otherwise they are 1 and 0.
+struct MeshFileSubset {
+	uint32_t IndexCount;
+	uint32_t StartIndex;
+	int32_t BaseVertex;
+	uint32_t NameOffset;
+	uint32_t NameLength;
+	float BoundsMin[3];
+	float BoundsMax[3];
+	uint32_t LodLevel;
+	float LodError;
+	float PositionScale[3];
+	float PositionOffset[3];
+};
+static_assert(sizeof(MeshFileSubset) == 76, "MeshFileSubset layout is part of the file format");
+
+// Pointers into a validated mesh file. Valid as long as the bytes it was
+// parsed from.
+struct MeshFileView {
+	const MeshFileHeader *Header = nullptr;
+	const MeshFileSubset *Subsets = nullptr;
+	const char *Names = nullptr;
+	const uint8_t *Vertices = nullptr;
+	const uint8_t *Indices = nullptr;
+
+	bool IsPacked() const { return (Header->Flags & MeshFilePacked) != 0; }
+	uint64_t VertexByteSize() const { return uint64_t(Header->VertexCount) * Header->VertexStride; }
+	uint64_t IndexByteSize() const { return uint64_t(Header->IndexCount) * Header->IndexByteSize; }
+	std::string_view SubsetName(uint32_t subset) const {
+		return std::string_view(Names + Subsets[subset].NameOffset, Subsets[subset].NameLength);
+	}
+};
+
+// How ConvertObjToMeshFile cooks a mesh for the renderer that loads it.
+struct MeshCookDesc {
+	// Vertex attributes to store, or 0 for whatever the OBJ has. Missing ones
+	// are filled in: colors from the normals (grey without any), so the mesh
+	// shows its shape under a vertex color shader, the rest with zeros.
+	uint32_t Attributes = 0;
+	// Store vertices in the packed layout, ready to upload from the file.
+	bool Packed = false;
+};
+
+bool IsMeshFile(const uint8_t *data, size_t size);
+// True if the file at path parses as a mesh file of the current version,
+// cooked as desc asks.
+bool IsCurrentMeshFile(const std::string &path, const MeshCookDesc &desc = MeshCookDesc());
+
+// Checks the header and that every table and range lies inside the data.
+bool ParseMeshFile(const uint8_t *data, size_t size, MeshFileView &view, std::string &error);
+
+void SerializeMeshFile(const MeshData &mesh, std::vector<uint8_t> &bytes);
+void SerializeMeshFile(const PackedMesh &mesh, std::vector<uint8_t> &bytes);
+bool WriteMeshFile(const std::string &path, const MeshData &mesh, std::string &error);
+bool WriteMeshFile(const std::string &path, const PackedMesh &mesh, std::string &error);
+
+// MeshDecodeFn for mesh files. Copies the streams into mesh; packed files are
+// rejected, as MeshData only holds floats.
+bool DecodeMeshFile(const uint8_t *data, size_t size, MeshData &mesh, std::string &error);
+
+// Reads an OBJ file, converts it to the attributes desc asks for, optimizes
+// it with OptimizeMesh, adds LOD chains, packs it if asked and writes it out
+// as a mesh file.
+bool ConvertObjToMeshFile(const std::string &objPath, const std::string &meshPath, const MeshCookDesc &desc,
+		std::string &error);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "MeshData.h"
+#include <cstddef>
+#include <cstdint>
+
+// Post-transform vertex cache behaviour of an index buffer, simulated with a
+// FIFO cache like the hardware's. ACMR is vertices transformed per triangle
+// (0.5 at best on a regular grid, 3 at worst); ATVR is vertices transformed
+// per unique vertex (1 at best).
+struct VertexCacheStats {
+	uint32_t Triangles = 0;
+	uint32_t VerticesTransformed = 0;
+	float Acmr = 0.0f;
+	float Atvr = 0.0f;
+};
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t *indices, size_t indexCount, size_t vertexCount,
+		uint32_t cacheSize = 16);
+
+// Bytes read from the vertex buffer per byte of vertex data, through a small
+// cache of 64-byte lines. 1 means every vertex was fetched exactly once.
+float AnalyzeVertexFetch(const uint32_t *indices, size_t indexCount, size_t vertexCount, size_t vertexStride);
+
+// Reorders triangles for the post-transform cache (Forsyth's linear-speed
+// algorithm). destination may not alias indices.
+void OptimizeVertexCache(uint32_t *destination, const uint32_t *indices, size_t indexCount, size_t vertexCount);
+
+// Reorders cache-optimized triangles so outward-facing clusters come first,
+// letting early depth rejection cull more of what is behind them (Sander et
+// al., "Fast triangle reordering for vertex locality and reduced overdraw").
+// Clusters are cut where the cache is cold anyway, or where a cluster's ACMR
+// stays within threshold times what it was, so ACMR grows by at most that
+// factor. positions is float3 at positionStride bytes apart.
+void OptimizeOverdraw(uint32_t *destination, const uint32_t *indices, size_t indexCount, const float *positions,
+		size_t positionStride, size_t vertexCount, float threshold = 1.05f);
+
+// Renumbers vertices in first-use order, in place on indices. remap[old]
+// gets the new index (UINT32_MAX for unused vertices). Returns the number of
+// vertices in use.
+uint32_t OptimizeVertexFetchRemap(uint32_t *remap, uint32_t *indices, size_t indexCount, size_t vertexCount);
+
+struct MeshOptimizeOptions {
+	bool Overdraw = true;
+	float OverdrawThreshold = 1.05f;
+	// Cache size the stats are measured with.
+	uint32_t CacheSize = 16;
+};
+
+struct MeshOptimizeStats {
+	VertexCacheStats Before;
+	VertexCacheStats After;
+	float FetchBefore = 0.0f;
+	float FetchAfter = 0.0f;
+};
+
+// Optimizes each subset for the vertex cache and then overdraw, keeping the
+// subset's own order if that transforms fewer vertices, reorders the
+// vertices for fetch locality (dropping unused ones), and stores indices as
+// 16-bit whenever the vertex count allows. Subsets keep their ranges and
+// bounds; their base vertex becomes 0.
+MeshOptimizeStats OptimizeMesh(MeshData &mesh, const MeshOptimizeOptions &options = MeshOptimizeOptions());
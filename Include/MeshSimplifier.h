@@ -0,0 +1,44 @@
+#pragma once
+
+#include "MeshData.h"
+#include <cstddef>
+#include <cstdint>
+
+// Quadric error metric simplification (Garland & Heckbert). Edges are
+// collapsed cheapest first until the index count drops to targetIndexCount
+// or the next collapse would exceed targetError. Vertices only ever collapse
+// onto one of their neighbours and never move, so the result indexes the
+// same vertex buffer.
+//
+// Vertices that share a position are treated as one; those on attribute
+// seams or non-manifold edges stay put, and open borders only collapse along
+// themselves. Errors are distances in model units. Returns the new index
+// count; resultError, if given, receives the largest error introduced.
+size_t SimplifyMesh(uint32_t *destination, const uint32_t *indices, size_t indexCount, const float *positions,
+		size_t positionStride, size_t vertexCount, size_t targetIndexCount, float targetError,
+		float *resultError = nullptr);
+
+struct LodChainDesc {
+	// Levels to add below the full-detail one.
+	uint32_t MaxLevels = 4;
+	// Each level aims for this fraction of the previous level's triangles.
+	float Reduction = 0.5f;
+	// Error limit, as a fraction of the subset's bounding box diagonal.
+	float MaxRelativeError = 0.02f;
+	// Levels stop once one would have fewer triangles than this, or would
+	// not remove at least a tenth of the previous level's.
+	uint32_t MinTriangles = 64;
+};
+
+// Appends a LOD chain after each subset of mesh: subsets named
+// "<name>_lod<level>" with LodLevel and LodError set, drawing the same
+// vertices as their full-detail subset. Each level is simplified from the
+// full-detail indices and optimized for the vertex cache.
+void BuildLodChain(MeshData &mesh, const LodChainDesc &desc = LodChainDesc());
+
+// Picks the coarsest level whose error, seen from distance, covers at most
+// pixelThreshold pixels. errors are the levels' errors in model units,
+// finest first; worldScale scales them to world units. projectionScale is
+// viewportHeight / (2 * tan(fovY / 2)).
+uint32_t SelectLod(const float *errors, uint32_t levelCount, float distance, float worldScale,
+		float projectionScale, float pixelThreshold = 1.0f);
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "JobSystem.h"
+#include "LockFreeQueue.h"
+#include "MappedFile.h"
+#include "MeshFile.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using MeshHandle = uint32_t;
+
+// Turns a file's bytes into a mesh. Returns false with a message on failure.
+using MeshDecodeFn = std::function<bool(const uint8_t *data, size_t size, MeshData &mesh, std::string &error)>;
+
+enum class MeshResidency : uint32_t {
+	// Never requested, or evicted.
+	Unloaded,
+	// Being read, mapped or decoded, or loaded and waiting for Poll().
+	Loading,
+	Resident,
+	Failed,
+};
+
+struct MeshStreamerDesc {
+	uint32_t IoThreads = 2;
+	// Resident bytes Evict() trims down to.
+	uint64_t BudgetBytes = 256ull << 20;
+	// Most meshes loaded but not yet polled; further reads wait for Poll().
+	uint32_t MaxReadyMeshes = 64;
+};
+
+struct MeshStreamerStats {
+	uint64_t Requested = 0;
+	uint64_t Loaded = 0;
+	uint64_t Failed = 0;
+	uint64_t Evicted = 0;
+	uint64_t ResidentBytes = 0;
+	// Summed over threads, so BytesRead / ReadSeconds is per-thread speed.
+	// Mapped files count as read once their streams are paged in.
+	uint64_t BytesRead = 0;
+	double ReadSeconds = 0.0;
+	double DecodeSeconds = 0.0;
+};
+
+// A loaded mesh handed to the render thread, or why it could not be loaded.
+// Decoded meshes are in Data; mapped ones are File, parsed into View, which
+// is valid as long as File is.
+struct StreamedMesh {
+	MeshHandle Handle = 0;
+	std::unique_ptr<MeshData> Data;
+	std::unique_ptr<MappedFile> File;
+	MeshFileView View;
+	std::string Error;
+
+	bool IsLoaded() const { return Data != nullptr || File != nullptr; }
+	uint64_t ByteSize() const {
+		if (Data != nullptr)
+			return Data->ByteSize();
+		return File != nullptr ? View.VertexByteSize() + View.IndexByteSize() : 0;
+	}
+};
+
+// Loads mesh files in the background. I/O threads read whole files and decode
+// them on the job system (or in place without one); decoded meshes come back
+// through a lock-free queue, so the render thread never takes a lock to pick
+// them up. Poll() makes them resident, at most a byte budget per call so
+// uploads can be spread over frames.
+//
+// Without a decode function, I/O threads instead map mesh files, parse them
+// in place with ParseMeshFile and page in their streams, and the render
+// thread uploads straight from the mapping: nothing is copied on the way.
+//
+// Residency is tracked against a memory budget: the render thread Touch()es
+// the meshes a frame uses, and Evict() hands back the least recently used
+// ones until the resident bytes fit, never one touched since the last Evict().
+// Evicted meshes can be requested again.
+//
+// Everything except the loading itself happens on one thread.
+class MeshStreamer {
+public:
+	MeshStreamer(MeshDecodeFn decode, JobSystem *jobs, const MeshStreamerDesc &desc = MeshStreamerDesc());
+	MeshStreamer(const MeshStreamer &rhs) = delete;
+	MeshStreamer &operator=(const MeshStreamer &rhs) = delete;
+	// Abandons reads that have not started and waits for the rest.
+	~MeshStreamer();
+
+	// Requesting a path again returns the same handle, and reloads the mesh if
+	// it was evicted or failed.
+	MeshHandle Request(const std::string &path);
+
+	// Moves decoded meshes into loaded, stopping once maxBytes have been taken
+	// (at least one mesh is taken if any is ready). Returns how many.
+	uint32_t Poll(std::vector<StreamedMesh> &loaded, uint64_t maxBytes = UINT64_MAX);
+
+	void Touch(MeshHandle handle);
+	// Appends the meshes that must be released to evicted. Call once per frame,
+	// after touching what the frame draws.
+	void Evict(std::vector<MeshHandle> &evicted);
+
+	MeshResidency Residency(MeshHandle handle) const { return mEntries[handle].Residency; }
+	const std::string &Path(MeshHandle handle) const { return mEntries[handle].Path; }
+	uint64_t ResidentBytes() const { return mResidentBytes; }
+	uint64_t BudgetBytes() const { return mDesc.BudgetBytes; }
+	void SetBudgetBytes(uint64_t bytes) { mDesc.BudgetBytes = bytes; }
+	// Requests not yet returned by Poll().
+	uint32_t LoadsInFlight() const { return mLoadsInFlight; }
+	MeshStreamerStats Stats() const;
+
+private:
+	struct ReadRequest {
+		MeshHandle Handle = 0;
+		std::string Path;
+	};
+
+	struct Entry {
+		std::string Path;
+		MeshResidency Residency = MeshResidency::Unloaded;
+		uint64_t ByteSize = 0;
+		uint64_t LastUsedFrame = 0;
+		std::list<MeshHandle>::iterator LruPosition;
+	};
+
+	void IoThreadMain();
+	void Decode(MeshHandle handle, std::vector<uint8_t> bytes);
+	void Map(const ReadRequest &request);
+	void Publish(StreamedMesh *mesh);
+
+	MeshDecodeFn mDecode;
+	JobSystem *mJobs = nullptr;
+	MeshStreamerDesc mDesc;
+
+	// Render thread state.
+	std::deque<Entry> mEntries;
+	std::unordered_map<std::string, MeshHandle> mHandleByPath;
+	// Resident meshes, most recently used first.
+	std::list<MeshHandle> mLru;
+	uint64_t mResidentBytes = 0;
+	uint64_t mFrame = 1;
+	uint32_t mLoadsInFlight = 0;
+	MeshStreamerStats mStats;
+
+	// Reads waiting for an I/O thread.
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::deque<ReadRequest> mReads;
+	bool mStopping = false;
+	// Read or decoded but not yet polled, bounded by MaxReadyMeshes so the
+	// ready queue can never fill up.
+	std::atomic<uint32_t> mUnpolled{ 0 };
+	std::vector<std::thread> mIoThreads;
+	JobCounter mDecodes;
+
+	LockFreeQueue<StreamedMesh *> mReady;
+
+	std::atomic<uint64_t> mBytesRead{ 0 };
+	std::atomic<uint64_t> mReadNanoseconds{ 0 };
+	std::atomic<uint64_t> mDecodeNanoseconds{ 0 };
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "FrustumCuller.h"
+#include "MathTypes.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Size limits of one meshlet. The defaults fit a mesh shader thread group:
+// 124 triangles keep the primitive indices within 128 * 3 bytes.
+struct MeshletLimits {
+	uint32_t MaxVertices = 64;
+	uint32_t MaxTriangles = 124;
+};
+
+struct Meshlet {
+	// Unique vertices, in MeshletMesh::Vertices.
+	uint32_t VertexOffset = 0;
+	uint32_t VertexCount = 0;
+	// Triangles, in MeshletMesh::Indices (so the first index is 3 * TriangleOffset).
+	uint32_t TriangleOffset = 0;
+	uint32_t TriangleCount = 0;
+};
+
+// Bounding sphere of a meshlet, and the cone bounding its triangle normals.
+// Every triangle of the meshlet faces away from a camera at c when
+//   dot(Center - c, ConeAxis) >= ConeCutoff * |Center - c| + Radius
+// ConeCutoff is the sine of the cone's half-angle, or 1 when the normals are
+// spread too wide for the test to ever pass.
+struct MeshletBounds {
+	Float3 Center;
+	float Radius = 0.0f;
+	Float3 ConeAxis;
+	float ConeCutoff = 1.0f;
+};
+
+// A mesh split into meshlets. Indices holds the source triangles reordered
+// meshlet by meshlet, so any run of meshlets is one contiguous index range.
+struct MeshletMesh {
+	std::vector<Meshlet> Meshlets;
+	std::vector<MeshletBounds> Bounds;
+	std::vector<uint32_t> Vertices;
+	std::vector<uint32_t> Indices;
+};
+
+// Greedily grows meshlets over shared edges, starting each one from the next
+// unused triangle in index order; run OptimizeVertexCache first for compact
+// meshlets. Triangles are front-facing when clockwise, as in D3D12's default
+// rasterizer state. positions is float3 at positionStride bytes apart.
+void BuildMeshlets(MeshletMesh &out, const uint32_t *indices, size_t indexCount, const float *positions,
+		size_t positionStride, size_t vertexCount, const MeshletLimits &limits = MeshletLimits());
+
+// Culling inputs, in the mesh's model space: the frustum from world * view *
+// projection, and the camera position transformed by the inverse world.
+struct MeshletCullView {
+	Frustum ViewFrustum;
+	Float3 CameraPosition;
+	bool Backface = true;
+};
+
+// Indices [StartIndex, StartIndex + IndexCount) of MeshletMesh::Indices.
+struct MeshletDrawRange {
+	uint32_t StartIndex = 0;
+	uint32_t IndexCount = 0;
+};
+
+struct MeshletCullStats {
+	uint32_t Meshlets = 0;
+	uint32_t FrustumCulled = 0;
+	uint32_t BackfaceCulled = 0;
+	uint32_t Triangles = 0;
+	uint32_t VisibleTriangles = 0;
+};
+
+// Tests meshlets [first, first + count) and appends the index ranges of the
+// visible ones to outRanges, merging meshlets that are adjacent in the index
+// buffer into one range. Returns how many ranges were appended; stats, if
+// given, is accumulated into.
+uint32_t CullMeshlets(const MeshletMesh &mesh, const MeshletCullView &view, uint32_t first, uint32_t count,
+		std::vector<MeshletDrawRange> &outRanges, MeshletCullStats *stats = nullptr);
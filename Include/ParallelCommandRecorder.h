@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class JobSystem;
+
+// A contiguous run of draw items recorded into one command list.
+struct RecordChunk {
+	uint32_t First = 0;
+	uint32_t Count = 0;
+	uint32_t ListIndex = 0;
+};
+
+// Splits draw submission into ordered chunks and records them in parallel.
+// Chunk i always covers items before chunk i + 1 and is recorded into list i,
+// so executing lists 0..n-1 in order reproduces the serial draw order no
+// matter which thread recorded which chunk. The recording itself is a
+// callback, which keeps this independent of D3D12.
+class ParallelCommandRecorder {
+public:
+	using RecordFn = std::function<void(const RecordChunk &chunk)>;
+
+	ParallelCommandRecorder(JobSystem *jobs, uint32_t maxLists, uint32_t minItemsPerChunk = 64);
+
+	// Fills chunks with at most maxLists balanced ranges over [0, itemCount),
+	// each at least minItemsPerChunk long where possible.
+	static void PlanChunks(uint32_t itemCount, uint32_t maxLists, uint32_t minItemsPerChunk,
+			std::vector<RecordChunk> &chunks);
+
+	// Records all chunks (on the job system if there is one) and returns the
+	// number of lists used. Always at least one, even with no items, so the
+	// caller has a list to put per-pass state into.
+	uint32_t Record(uint32_t itemCount, const RecordFn &recordChunk);
+
+	const std::vector<RecordChunk> &Chunks() const { return mChunks; }
+	uint32_t MaxLists() const { return mMaxLists; }
+
+private:
+	JobSystem *mJobs = nullptr;
+	uint32_t mMaxLists = 1;
+	uint32_t mMinItemsPerChunk = 64;
+
+	std::vector<RecordChunk> mChunks;
+};
+
+// Stands in for the per-thread command lists when there is no device. Each
+// list keeps the items recorded into it, and every draw spins for a fixed
+// amount of work to model what recording a real one costs.
+class StubCommandLists {
+public:
+	StubCommandLists(uint32_t listCount, uint32_t workPerDraw = 0);
+
+	// Clears the lists for the next frame.
+	void Reset();
+
+	// A ParallelCommandRecorder::RecordFn: records chunk.Count draws into
+	// list chunk.ListIndex.
+	void Record(const RecordChunk &chunk);
+
+	const std::vector<uint32_t> &List(uint32_t index) const { return mLists[index].Items; }
+	// Times list index was recorded into since Reset(); should be 0 or 1.
+	uint32_t RecordCount(uint32_t index) const { return mLists[index].RecordCount; }
+	// The items in the order the GPU would see them, lists executed 0..n-1.
+	std::vector<uint32_t> ExecutionOrder() const;
+	uint64_t Checksum() const;
+
+private:
+	// Padded so lists recorded on different threads do not share cache lines.
+	struct alignas(64) StubList {
+		std::vector<uint32_t> Items;
+		uint32_t RecordCount = 0;
+		uint64_t Checksum = 0;
+	};
+
+	std::vector<StubList> mLists;
+	uint32_t mWorkPerDraw = 0;
+};
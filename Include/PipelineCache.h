@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Canonical byte form of a pipeline description. Callers write only the
+// fields that affect the pipeline, in a fixed order, with pointers replaced
+// by what they point to, so equal pipelines produce equal keys no matter how
+// the description was filled in.
+class PipelineKey {
+public:
+	void U32(uint32_t value) { Bytes(&value, sizeof(value)); }
+	void U64(uint64_t value) { Bytes(&value, sizeof(value)); }
+	void F32(float value) { Bytes(&value, sizeof(value)); }
+	void String(const char *s);
+	// Blobs (shader bytecode, serialized root signatures) go in whole, so
+	// keys with equal data were built from identical bytecode.
+	void Blob(const void *data, size_t size);
+
+	// False if something that does not survive a restart (e.g. an object's
+	// address) went into the key; such keys are not persisted.
+	void MarkTransient() { mPersistent = false; }
+	bool IsPersistent() const { return mPersistent; }
+
+	uint64_t Hash() const { return mHash; }
+	const std::vector<uint8_t> &Data() const { return mData; }
+
+	// Hex form of the hash, usable as a name in a pipeline library.
+	std::wstring Name() const;
+
+	static uint64_t HashBytes(const void *data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+	bool operator==(const PipelineKey &rhs) const { return mHash == rhs.mHash && mData == rhs.mData; }
+
+private:
+	void Bytes(const void *data, size_t size);
+
+	std::vector<uint8_t> mData;
+	uint64_t mHash = 14695981039346656037ull;
+	bool mPersistent = true;
+};
+
+struct PipelineCacheStats {
+	uint32_t Hits = 0;
+	uint32_t Misses = 0;
+};
+
+// Pipeline objects by canonical key. The create function runs only on a
+// miss; T is whatever handle the backend uses (a ComPtr for D3D12, anything
+// for a mock). Keys are compared in full, so a hash collision cannot return
+// the wrong pipeline.
+template<typename T>
+class PipelineCache {
+public:
+	T GetOrCreate(const PipelineKey &key, const std::function<T()> &create) {
+		std::vector<Entry> &bucket = mEntries[key.Hash()];
+		for (Entry &entry : bucket) {
+			if (entry.Data == key.Data()) {
+				++mStats.Hits;
+				return entry.Value;
+			}
+		}
+
+		++mStats.Misses;
+		T value = create();
+		bucket.push_back({ key.Data(), value });
+		return value;
+	}
+
+	size_t Size() const {
+		size_t size = 0;
+		for (const auto &[hash, bucket] : mEntries)
+			size += bucket.size();
+		return size;
+	}
+
+	void Clear() { mEntries.clear(); }
+
+	const PipelineCacheStats &Stats() const { return mStats; }
+
+private:
+	struct Entry {
+		std::vector<uint8_t> Data;
+		T Value;
+	};
+
+	std::unordered_map<uint64_t, std::vector<Entry>> mEntries;
+	PipelineCacheStats mStats;
+};
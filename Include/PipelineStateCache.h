@@ -0,0 +1,44 @@
+#pragma once
+
+#include "d3dUtil.h"
+#include "PipelineCache.h"
+#include "PipelineStateKey.h"
+#include <filesystem>
+
+// PSO cache over PipelineCache, backed by an ID3D12PipelineLibrary that is
+// loaded from and saved to disk, so pipelines created in an earlier run are
+// loaded instead of compiled. Without library support it is just an
+// in-memory cache.
+class PipelineStateCache {
+public:
+	PipelineStateCache(ID3D12Device *device, std::filesystem::path libraryPath);
+	PipelineStateCache(const PipelineStateCache &rhs) = delete;
+	PipelineStateCache &operator=(const PipelineStateCache &rhs) = delete;
+
+	// Lets pipelines using this root signature be persisted. serialized is
+	// the blob the root signature was created from.
+	void RegisterRootSignature(ID3D12RootSignature *rootSignature, const void *serialized, size_t byteSize);
+
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> GetOrCreate(const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc);
+
+	// Writes the library back if new pipelines were stored in it.
+	bool SaveLibrary();
+
+	const PipelineCacheStats &Stats() const { return mCache.Stats(); }
+	uint32_t LibraryLoads() const { return mLibraryLoads; }
+
+private:
+	void OpenLibrary();
+
+	ID3D12Device *mDevice = nullptr;
+	Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> mLibrary;
+	std::filesystem::path mLibraryPath;
+	// The library reads from this memory for as long as it lives.
+	std::vector<char> mLibraryData;
+	bool mLibraryDirty = false;
+	uint32_t mLibraryLoads = 0;
+
+	// Serialized form of each registered root signature.
+	std::unordered_map<ID3D12RootSignature *, std::vector<uint8_t>> mRootSignatures;
+	PipelineCache<Microsoft::WRL::ComPtr<ID3D12PipelineState>> mCache;
+};
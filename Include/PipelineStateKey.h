@@ -0,0 +1,18 @@
+#pragma once
+
+#include <d3d12.h>
+#include "PipelineCache.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Writes the parts of a graphics pipeline description that matter into key:
+// shader bytecode by content, input layout by value, only the render target
+// formats and blend states that are in use, and stencil state only when
+// stencil is enabled. Root signatures registered with the cache are keyed by
+// their serialized form; any other root signature makes the key transient.
+//
+// Only reads the description's structs, so it needs nothing but d3d12.h; the
+// headless build tests it against stand-ins for that header (Tests/Stubs).
+void CanonicalizePipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc,
+		const std::unordered_map<ID3D12RootSignature *, std::vector<uint8_t>> &rootSignatures, PipelineKey &key);
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "ResourceState.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class BarrierTracker;
+
+struct RenderGraphResource {
+	uint32_t Index = UINT32_MAX;
+
+	bool IsValid() const { return Index != UINT32_MAX; }
+};
+
+// Size of a transient resource, for placing it in a heap.
+struct RenderGraphResourceDesc {
+	uint64_t ByteSize = 0;
+	uint64_t Alignment = 65536;
+};
+
+struct RenderGraphBarrier {
+	enum Kind : uint32_t {
+		Transition,
+		// UnorderedAccess -> UnorderedAccess between two passes.
+		UavFlush,
+		// Resource is taking over heap memory that other transient resources
+		// also use. Its contents are undefined until the pass initializes them.
+		Aliasing,
+	};
+
+	Kind Type = Transition;
+	RenderGraphResource Resource;
+	ResourceState Before = ResourceState::Common;
+	ResourceState After = ResourceState::Common;
+};
+
+// What a pass gets when it runs. Before must be recorded ahead of the pass's
+// work; After returns resources to their final (imported) or creation
+// (transient) state and is non-empty only for the last pass that uses them.
+struct RenderGraphPassContext {
+	uint32_t Pass = 0;
+	const RenderGraphBarrier *Before = nullptr;
+	uint32_t BeforeCount = 0;
+	const RenderGraphBarrier *After = nullptr;
+	uint32_t AfterCount = 0;
+};
+
+// First and last live pass that uses a resource, in execution order.
+struct RenderGraphLifetime {
+	uint32_t FirstPass = UINT32_MAX;
+	uint32_t LastPass = 0;
+
+	bool IsUsed() const { return FirstPass != UINT32_MAX; }
+};
+
+struct RenderGraphStats {
+	uint32_t Passes = 0;
+	uint32_t CulledPasses = 0;
+	uint32_t Barriers = 0;
+	// Heap holding every live transient resource, and what they would take
+	// as committed resources.
+	uint64_t TransientHeapSize = 0;
+	uint64_t TransientCommittedSize = 0;
+	double CompileSeconds = 0.0;
+};
+
+// Declarative frame graph. Passes declare what they read and write; Compile()
+// culls passes whose results nobody observes, works out the lifetime of every
+// transient resource and packs them into one heap (resources that are never
+// alive at the same time share memory), and derives the barriers each pass
+// needs, merging consecutive reads into one combined read state. It knows
+// nothing about the GPU API: barriers are handed to the passes, which record
+// them.
+//
+// Observable results are imported resources (their contents outlive the
+// frame) and passes marked with side effects.
+class RenderGraph {
+public:
+	using ExecuteFn = std::function<void(const RenderGraphPassContext &context)>;
+
+	// Drops all passes and resources.
+	void Reset();
+
+	RenderGraphResource Import(std::string name, ResourceState initialState, ResourceState finalState);
+	// Transient resources are placed in one heap (see TransientHeapOffset)
+	// and created in the state of their first use; they are returned to it
+	// after their last use, so the compiled graph can run every frame. A
+	// transient resource's first pass must fully initialize it (clear,
+	// discard or overwrite), since its memory may be shared.
+	RenderGraphResource CreateTransient(std::string name, const RenderGraphResourceDesc &desc);
+
+	uint32_t AddPass(std::string name, ExecuteFn execute);
+	void Read(uint32_t pass, RenderGraphResource resource, ResourceState state);
+	// Replaces the resource's contents.
+	void Write(uint32_t pass, RenderGraphResource resource, ResourceState state);
+	// Updates the contents in place (blending, depth testing, UAV read-modify-write).
+	void ReadWrite(uint32_t pass, RenderGraphResource resource, ResourceState state);
+	void SetSideEffects(uint32_t pass);
+
+	void Compile();
+	// Runs the live passes in declaration order.
+	void Execute() const;
+
+	// Human-readable compile result, stable enough to diff against a golden file.
+	std::string Dump() const;
+
+	uint32_t PassCount() const { return static_cast<uint32_t>(mPasses.size()); }
+	uint32_t ResourceCount() const { return static_cast<uint32_t>(mResources.size()); }
+	bool IsCulled(uint32_t pass) const { return mPasses[pass].Culled; }
+	const std::string &PassName(uint32_t pass) const { return mPasses[pass].Name; }
+	const std::string &ResourceName(RenderGraphResource resource) const { return mResources[resource.Index].Name; }
+	bool IsTransient(RenderGraphResource resource) const { return !mResources[resource.Index].Imported; }
+	const RenderGraphResourceDesc &ResourceDesc(RenderGraphResource resource) const { return mResources[resource.Index].Desc; }
+	// For transient resources, the state to create them in.
+	ResourceState InitialState(RenderGraphResource resource) const { return mResources[resource.Index].InitialState; }
+	const RenderGraphLifetime &Lifetime(RenderGraphResource resource) const { return mResources[resource.Index].Lifetime; }
+	uint64_t TransientHeapOffset(RenderGraphResource resource) const { return mResources[resource.Index].HeapOffset; }
+	uint64_t TransientHeapSize() const { return mStats.TransientHeapSize; }
+	RenderGraphPassContext PassContext(uint32_t pass) const;
+	const RenderGraphStats &Stats() const { return mStats; }
+
+private:
+	struct Use {
+		uint32_t Resource;
+		ResourceState State;
+		bool Reads;
+		bool Writes;
+	};
+
+	struct Pass {
+		std::string Name;
+		ExecuteFn Execute;
+		std::vector<Use> Uses;
+		bool SideEffects = false;
+		bool Culled = false;
+		uint32_t BarrierBegin = 0;
+		uint32_t BarrierCount = 0;
+		uint32_t FinalBegin = 0;
+		uint32_t FinalCount = 0;
+	};
+
+	struct Resource {
+		std::string Name;
+		bool Imported = false;
+		ResourceState InitialState = ResourceState::Common;
+		ResourceState FinalState = ResourceState::Common;
+		RenderGraphResourceDesc Desc;
+		RenderGraphLifetime Lifetime;
+		uint64_t HeapOffset = 0;
+		bool Aliased = false;
+	};
+
+	void AddUse(uint32_t pass, RenderGraphResource resource, ResourceState state, bool reads, bool writes);
+	void CullPasses();
+	void ComputeLifetimes();
+	void PlaceTransients();
+	void ComputeBarriers();
+
+	std::vector<Pass> mPasses;
+	std::vector<Resource> mResources;
+	std::vector<RenderGraphBarrier> mBarriers;
+	std::vector<RenderGraphBarrier> mFinalBarriers;
+	RenderGraphStats mStats;
+};
+
+// Requests a pass's barriers from the tracker of the command list it records
+// into, rather than recording them on the spot: the tracker batches them with
+// the neighbouring passes' barriers up to its next Flush() and drops the ones
+// that cancel out. resources maps graph resource indices to the pointers the
+// resources are registered under in the tracker's state table.
+void TrackBarriers(BarrierTracker &tracker, const RenderGraphBarrier *barriers, uint32_t count,
+		const void *const *resources);
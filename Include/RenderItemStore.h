@@ -0,0 +1,129 @@
+#pragma once
+
+#include "FrustumCuller.h"
+#include "MathTypes.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Stable reference to a render item. The slot is reused after Destroy(), the
+// generation tells a stale handle from a live one.
+struct RenderItemHandle {
+	uint32_t Slot = UINT32_MAX;
+	uint32_t Generation = 0;
+
+	bool IsValid() const { return Slot != UINT32_MAX; }
+};
+
+// Everything needed to create a render item. Geometry and materials are
+// referenced by index into tables owned by the renderer.
+struct RenderItemDesc {
+	Float4x4 World;
+	Float4 Color = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	// Local-space bounds of the geometry (SubmeshGeometry::Bounds).
+	Float3 BoundsCenter;
+	Float3 BoundsExtents;
+
+	uint32_t GeoIndex = 0;
+	uint32_t MaterialIndex = 0;
+	uint32_t PrimitiveType = 4; // D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+
+	// DrawIndexedInstanced parameters.
+	uint32_t IndexCount = 0;
+	uint32_t StartIndexLocation = 0;
+	int32_t BaseVertexLocation = 0;
+};
+
+// Structure-of-arrays render item storage. Live items are kept densely packed
+// so per-item data for item i sits at index i of every array, and i is also
+// the item's slot in FrameResource::ObjectCB. Removing an item moves the last
+// one into the hole.
+//
+// Each frame resource has its own dirty bitset. Changing an item marks it in
+// all of them (the equivalent of NumFramesDirty = gNumFrameResources), and
+// ForEachDirtyRange() hands back runs of consecutive dirty items so only
+// those are repacked into that frame's constant buffer.
+//
+// World-space bounds are kept up to date as worlds change, in a layout the
+// frustum culler can consume directly.
+class RenderItemStore {
+public:
+	RenderItemStore(uint32_t maxItems, uint32_t framesInFlight);
+
+	RenderItemHandle Create(const RenderItemDesc &desc);
+	void Destroy(RenderItemHandle handle);
+	bool IsAlive(RenderItemHandle handle) const;
+
+	// Dense index of a live item. Only valid until the next Destroy().
+	uint32_t IndexOf(RenderItemHandle handle) const;
+
+	void SetWorld(RenderItemHandle handle, const Float4x4 &world);
+	void SetColor(RenderItemHandle handle, const Float4 &color);
+	// Switches the index range drawn, e.g. to another level of detail. Draw
+	// arguments are not constants, so this does not mark the item dirty.
+	void SetDrawArgs(RenderItemHandle handle, uint32_t indexCount, uint32_t startIndexLocation);
+	void MarkDirty(uint32_t index);
+	// For changes that affect every item's constants (global toggles).
+	void MarkAllDirty();
+
+	// Calls fn(first, count) for each run of items dirty in the given frame
+	// resource and clears them. Returns the number of items visited.
+	template<typename Fn>
+	uint32_t ForEachDirtyRange(uint32_t frameIndex, Fn &&fn);
+
+	uint32_t Size() const { return static_cast<uint32_t>(mWorld.size()); }
+	uint32_t Capacity() const { return mMaxItems; }
+
+	const Float4x4 *World() const { return mWorld.data(); }
+	const Float4 *Color() const { return mColor.data(); }
+	const uint32_t *GeoIndex() const { return mGeoIndex.data(); }
+	const uint32_t *MaterialIndex() const { return mMaterialIndex.data(); }
+	const uint32_t *PrimitiveType() const { return mPrimitiveType.data(); }
+	const uint32_t *IndexCount() const { return mIndexCount.data(); }
+	const uint32_t *StartIndexLocation() const { return mStartIndexLocation.data(); }
+	const int32_t *BaseVertexLocation() const { return mBaseVertexLocation.data(); }
+	const AabbSoA &WorldBounds() const { return mWorldBounds; }
+
+private:
+	void ClearDirty(uint32_t index);
+	void UpdateWorldBounds(uint32_t index);
+	size_t TakeDirtyRun(std::vector<uint64_t> &bits, size_t &word, uint32_t &first);
+
+	uint32_t mMaxItems = 0;
+
+	// Dense per-item data.
+	std::vector<Float4x4> mWorld;
+	std::vector<Float4> mColor;
+	std::vector<uint32_t> mGeoIndex;
+	std::vector<uint32_t> mMaterialIndex;
+	std::vector<uint32_t> mPrimitiveType;
+	std::vector<uint32_t> mIndexCount;
+	std::vector<uint32_t> mStartIndexLocation;
+	std::vector<int32_t> mBaseVertexLocation;
+	std::vector<uint32_t> mDenseToSlot;
+	std::vector<Float3> mLocalCenter;
+	std::vector<Float3> mLocalExtents;
+	AabbSoA mWorldBounds;
+
+	// Handle indirection.
+	std::vector<uint32_t> mSlotToDense;
+	std::vector<uint32_t> mSlotGeneration;
+	std::vector<uint32_t> mFreeSlots;
+
+	// One bit per dense index, one bitset per frame resource.
+	std::vector<std::vector<uint64_t>> mDirtyBits;
+};
+
+template<typename Fn>
+uint32_t RenderItemStore::ForEachDirtyRange(uint32_t frameIndex, Fn &&fn) {
+	std::vector<uint64_t> &bits = mDirtyBits[frameIndex];
+	uint32_t visited = 0;
+	size_t word = 0;
+	uint32_t first = 0;
+	while (size_t count = TakeDirtyRun(bits, word, first)) {
+		fn(first, static_cast<uint32_t>(count));
+		visited += static_cast<uint32_t>(count);
+	}
+	return visited;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Backend-neutral resource states. Read states are bits that can be combined,
+// so a resource read in several ways by consecutive passes needs only one
+// transition; write states are exclusive.
+enum class ResourceState : uint32_t {
+	Common = 0,
+	VertexAndConstantBuffer = 1u << 0,
+	IndexBuffer = 1u << 1,
+	ShaderResource = 1u << 2,
+	IndirectArgument = 1u << 3,
+	CopySource = 1u << 4,
+	DepthRead = 1u << 5,
+	Present = 1u << 6,
+	RenderTarget = 1u << 7,
+	DepthWrite = 1u << 8,
+	UnorderedAccess = 1u << 9,
+	CopyDest = 1u << 10,
+
+	// Every read state a buffer can be used in, like D3D12's GENERIC_READ.
+	GenericRead = VertexAndConstantBuffer | IndexBuffer | ShaderResource | IndirectArgument | CopySource,
+};
+
+inline ResourceState operator|(ResourceState a, ResourceState b) {
+	return static_cast<ResourceState>(static_cast<uint32_t>(a) | static_cast<uint32_t>(b));
+}
+
+inline bool IsReadOnlyState(ResourceState state) {
+	return static_cast<uint32_t>(state) < static_cast<uint32_t>(ResourceState::RenderTarget);
+}
+
+// Read states that can be merged with each other into one combined state.
+inline bool IsCombinableRead(ResourceState state) {
+	return IsReadOnlyState(state) && state != ResourceState::Common && state != ResourceState::Present;
+}
+
+inline bool ContainsStates(ResourceState state, ResourceState subset) {
+	return (static_cast<uint32_t>(state) & static_cast<uint32_t>(subset)) == static_cast<uint32_t>(subset);
+}
+
+// "RenderTarget", "ShaderResource|CopySource", ...
+std::string ResourceStateName(ResourceState state);
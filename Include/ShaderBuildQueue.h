@@ -0,0 +1,104 @@
+#pragma once
+
+#include "JobSystem.h"
+#include "ShaderCache.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using ShaderBuildHandle = uint32_t;
+
+struct ShaderBuildStats {
+	uint32_t Requested = 0;
+	uint32_t Deduplicated = 0;
+	uint32_t Built = 0;
+
+	// Summed per-shader build time vs. time from the first Enqueue() to the
+	// end of WaitAll(); their ratio is the speedup over building serially.
+	// Build times are wall clock, so with more threads than cores the ratio
+	// overstates it.
+	double SerialSeconds = 0.0;
+	double WallSeconds = 0.0;
+};
+
+// Builds shaders concurrently on the job system, through a ShaderCache.
+// Identical requests (same content hash) are built once and share a handle.
+// Compiles run in the background, so the caller can keep initializing and
+// only wait when it needs the bytecode; Counter() lets jobs be scheduled to
+// run once everything queued so far has finished.
+//
+// Enqueue() and WaitAll() are meant to be called from one thread.
+class ShaderBuildQueue {
+public:
+	ShaderBuildQueue(JobSystem *jobs, ShaderCache *cache);
+	ShaderBuildQueue(const ShaderBuildQueue &rhs) = delete;
+	ShaderBuildQueue &operator=(const ShaderBuildQueue &rhs) = delete;
+	~ShaderBuildQueue();
+
+	ShaderBuildHandle Enqueue(const ShaderCompileRequest &request);
+
+	// Blocks until every queued build is done, helping with the work.
+	void WaitAll();
+
+	JobCounter &Counter() { return mCounter; }
+
+	// Only valid once the build has finished (after WaitAll() or from a job
+	// that ran after Counter()).
+	bool Succeeded(ShaderBuildHandle handle) const { return mBuilds[handle].Succeeded; }
+	const std::vector<uint8_t> &ByteCode(ShaderBuildHandle handle) const { return mBuilds[handle].ByteCode; }
+	const std::string &Errors(ShaderBuildHandle handle) const { return mBuilds[handle].Errors; }
+
+	const ShaderBuildStats &Stats() const { return mStats; }
+
+private:
+	struct Build {
+		ShaderCompileRequest Request;
+		uint64_t Key = 0;
+		bool Succeeded = false;
+		std::vector<uint8_t> ByteCode;
+		std::string Errors;
+		double Seconds = 0.0;
+	};
+
+	JobSystem *mJobs = nullptr;
+	ShaderCache *mCache = nullptr;
+
+	// A deque so builds already handed to jobs never move.
+	std::deque<Build> mBuilds;
+	std::unordered_map<uint64_t, ShaderBuildHandle> mHandleByKey;
+	JobCounter mCounter;
+
+	std::chrono::steady_clock::time_point mStartTime;
+	ShaderBuildStats mStats;
+};
+
+// Compiler backend for tests and measurements. Each request takes a fixed
+// time, either spinning (CPU-bound, like D3DCompiler) or sleeping, and
+// produces bytecode derived from the entry point. Requests whose entry point
+// starts with "Broken" fail.
+class FakeShaderCompiler {
+public:
+	explicit FakeShaderCompiler(double millisecondsPerShader = 0.0, bool spin = true);
+
+	// The ShaderCompileFn; must not outlive this object.
+	ShaderCompileFn Fn();
+
+	uint32_t Calls() const { return mCalls.load(); }
+	// Most compiles that were running at the same time.
+	uint32_t PeakConcurrency() const { return mPeak.load(); }
+
+private:
+	bool Compile(const ShaderCompileRequest &request, std::vector<uint8_t> &byteCode, std::string &errors);
+
+	double mMilliseconds = 0.0;
+	bool mSpin = true;
+	uint64_t mSpinIterations = 0;
+	std::atomic<uint32_t> mSink{ 0 };
+	std::atomic<uint32_t> mCalls{ 0 };
+	std::atomic<uint32_t> mRunning{ 0 };
+	std::atomic<uint32_t> mPeak{ 0 };
+};
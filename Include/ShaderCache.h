@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Everything that determines the bytecode of a shader compile.
+struct ShaderCompileRequest {
+	std::filesystem::path SourcePath;
+	std::vector<std::pair<std::string, std::string>> Defines;
+	std::string EntryPoint;
+	std::string Target;
+	uint32_t Flags = 0;
+};
+
+// Compiles a request into byteCode. Returns false on failure, with the
+// compiler output in errors.
+using ShaderCompileFn = std::function<bool(const ShaderCompileRequest &request,
+		std::vector<uint8_t> &byteCode, std::string &errors)>;
+
+struct ShaderCacheStats {
+	uint32_t Hits = 0;
+	uint32_t Misses = 0;
+	uint32_t Failures = 0;
+};
+
+// Shader bytecode cache keyed by a content hash of the request: the source
+// file, every file it #includes (resolved relative to the including file),
+// the defines, entry point, target and flags, plus the compiler version.
+// Editing any of them or updating the compiler changes the key, so stale
+// bytecode is never returned.
+//
+// All entries live in a single file: a header, an index of (key, offset,
+// size) records, then the blobs back to back. The final Save() of a run keeps
+// only the entries used since Load(), so keys orphaned by edits do not pile
+// up. The compiler
+// is a callback, so the cache does not depend on D3DCompiler and can be
+// driven by a fake.
+//
+// GetOrCompile() may be called from several threads; the compiler runs
+// outside the lock, so independent requests compile concurrently.
+class ShaderCache {
+public:
+	// compilerVersion identifies the compiler build behind compiler, e.g. the
+	// DLL name and file version; it is part of every key.
+	ShaderCache(std::filesystem::path cachePath, ShaderCompileFn compiler, std::string compilerVersion);
+
+	// Reads the cache file. A missing or malformed file leaves the cache empty
+	// and returns false.
+	bool Load();
+
+	// Writes the cache file if anything changed since it was last loaded or
+	// saved. With pruneUnused, entries not used since Load() are dropped
+	// first; only do that once nothing else will be requested this run.
+	bool Save(bool pruneUnused = true);
+
+	// Returns the cached bytecode for the request, compiling and storing it on
+	// a miss. Returns false if the compiler fails; errors gets its output.
+	bool GetOrCompile(const ShaderCompileRequest &request, std::vector<uint8_t> &byteCode,
+			std::string *errors = nullptr);
+
+	// Same, with the key already computed by HashRequest().
+	bool GetOrCompile(uint64_t key, const ShaderCompileRequest &request, std::vector<uint8_t> &byteCode,
+			std::string *errors = nullptr);
+
+	// Key for a request; reads the source and its includes from disk.
+	uint64_t HashRequest(const ShaderCompileRequest &request) const;
+
+	const std::string &CompilerVersion() const { return mCompilerVersion; }
+	size_t EntryCount() const;
+	ShaderCacheStats Stats() const;
+
+private:
+	std::filesystem::path mCachePath;
+	ShaderCompileFn mCompiler;
+	std::string mCompilerVersion;
+
+	struct Entry {
+		std::vector<uint8_t> ByteCode;
+		// Hit or compiled since Load().
+		bool Used = false;
+	};
+
+	mutable std::mutex mMutex;
+	std::unordered_map<uint64_t, Entry> mEntries;
+	bool mDirty = false;
+
+	ShaderCacheStats mStats;
+};
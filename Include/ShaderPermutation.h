@@ -0,0 +1,98 @@
+#pragma once
+
+#include "ShaderCache.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// The compile-time options of a shader, packed into a 64-bit variant key.
+// A bool option takes one bit and is passed to the compiler as DEFINE=0/1; an
+// enum option takes enough bits for its value count and is passed as
+// DEFINE=<value name>. Option 0 starts at bit 0, so key 0 is the variant with
+// every option at its first value.
+class ShaderPermutationDesc {
+public:
+	uint32_t AddBool(const std::string &define);
+	uint32_t AddEnum(const std::string &define, std::vector<std::string> values);
+
+	// Returns key with option set to value. A value the option does not have
+	// is rejected: key comes back unchanged.
+	uint64_t Set(uint64_t key, uint32_t option, uint32_t value) const;
+	uint32_t Get(uint64_t key, uint32_t option) const;
+	// False if any option holds a value it does not have, or bits above
+	// KeyBits() are set.
+	bool IsValid(uint64_t key) const;
+
+	// Appends the defines for a key, one per option.
+	void AppendDefines(uint64_t key, std::vector<std::pair<std::string, std::string>> &defines) const;
+
+	uint32_t OptionCount() const { return static_cast<uint32_t>(mOptions.size()); }
+	uint32_t KeyBits() const { return mKeyBits; }
+
+private:
+	struct Option {
+		std::string Define;
+		std::vector<std::string> Values; // Empty for bool options.
+		uint32_t ValueCount = 2;
+		uint32_t Shift = 0;
+		uint32_t Bits = 1;
+	};
+
+	uint32_t AddOption(Option option);
+
+	std::vector<Option> mOptions;
+	uint32_t mKeyBits = 0;
+};
+
+struct ShaderVariantStats {
+	uint32_t Hits = 0;
+	uint32_t Misses = 0;
+	uint32_t Evictions = 0;
+	uint32_t Failures = 0;
+};
+
+// Variants of one shader entry point, compiled on first use. Bytecode comes
+// from the ShaderCache, so a variant compiled in an earlier run (or evicted
+// here) is still a disk/memory hit there. At most capacity variants are kept,
+// dropping the least recently used; callers that keep bytecode beyond that
+// (e.g. to create a PSO) hold on to the shared_ptr.
+//
+// Not thread-safe; use from one thread.
+class ShaderVariantCache {
+public:
+	using ByteCode = std::shared_ptr<const std::vector<uint8_t>>;
+
+	ShaderVariantCache(const ShaderPermutationDesc *desc, ShaderCompileRequest baseRequest,
+			ShaderCache *cache, size_t capacity);
+
+	// Bytecode of a variant, or nullptr if it fails to compile (errors gets
+	// the compiler output) or the key is not valid for the permutation.
+	ByteCode Get(uint64_t key, std::string *errors = nullptr);
+
+	// The compile request for a variant: the base request plus its defines.
+	ShaderCompileRequest MakeRequest(uint64_t key) const;
+
+	size_t Size() const { return mVariants.size(); }
+	const ShaderVariantStats &Stats() const { return mStats; }
+
+private:
+	struct Variant {
+		uint64_t Key;
+		ByteCode Code;
+	};
+
+	const ShaderPermutationDesc *mDesc = nullptr;
+	ShaderCompileRequest mBaseRequest;
+	ShaderCache *mCache = nullptr;
+	size_t mCapacity = 0;
+
+	// Most recently used at the front.
+	std::list<Variant> mLru;
+	std::unordered_map<uint64_t, std::list<Variant>::iterator> mVariants;
+
+	ShaderVariantStats mStats;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "MathTypes.h"
+#include <cstddef>
+#include <cstdint>
+
+// Instruction set used by the batched transform kernels.
+enum class SimdPath {
+	Scalar,
+	SSE2,
+	AVX2,
+};
+
+// Best path the running CPU (and OS) supports. Detected once.
+SimdPath DetectSimdPath();
+const char *SimdPathName(SimdPath path);
+
+// Where the transform outputs go inside one element of a constant stream,
+// e.g. ObjectConstants in a 256-byte aligned upload buffer.
+struct TransformStreamLayout {
+	size_t Stride = 0;
+	size_t WorldViewProjOffset = 0;
+	size_t WorldOffset = 0;
+};
+
+// For each i in [0, count) writes transpose(worlds[i] * viewProj) and
+// transpose(worlds[i]) into out + i * layout.Stride, ready for HLSL's
+// column-major constant packing. Matrices use the row-vector convention of
+// DirectXMath. The output does not need to be aligned.
+void BatchWorldViewProj(const Float4x4 *worlds, uint32_t count, const Float4x4 &viewProj,
+		uint8_t *out, const TransformStreamLayout &layout);
+
+// Same, forcing a specific path. The path must be supported by the CPU.
+void BatchWorldViewProj(const Float4x4 *worlds, uint32_t count, const Float4x4 &viewProj,
+		uint8_t *out, const TransformStreamLayout &layout, SimdPath path);
+
+// Writes only transpose(worlds[i]) to out + i * layout.Stride +
+// layout.WorldOffset, for shaders that apply the view-projection from a
+// per-pass constant. WorldViewProjOffset is ignored.
+void BatchTransposeWorlds(const Float4x4 *worlds, uint32_t count, uint8_t *out, const TransformStreamLayout &layout);
+void BatchTransposeWorlds(const Float4x4 *worlds, uint32_t count, uint8_t *out, const TransformStreamLayout &layout,
+		SimdPath path);
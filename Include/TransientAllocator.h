@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// A transient resource as the packer sees it: its size and placement
+// alignment in the heap, and the passes it is alive for (inclusive).
+struct TransientAllocationRequest {
+	uint64_t ByteSize = 0;
+	uint64_t Alignment = 65536;
+	uint32_t FirstPass = 0;
+	uint32_t LastPass = 0;
+};
+
+struct TransientAllocationResult {
+	// Heap offset of each request, in request order.
+	std::vector<uint64_t> Offsets;
+	uint64_t HeapSize = 0;
+	// What the same resources take as separate committed allocations.
+	uint64_t CommittedSize = 0;
+};
+
+// Places requests in one heap so that two requests share memory only if
+// their lifetimes do not overlap. Greedy: largest first, each at the lowest
+// aligned offset that does not collide with an already placed request alive
+// at the same time.
+void PackTransientAllocations(const std::vector<TransientAllocationRequest> &requests, TransientAllocationResult &result);
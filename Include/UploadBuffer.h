@@ -1,6 +1,7 @@
 #pragma once
 
 #include "d3dUtil.h"
+#include "LinearAllocator.h"
 
 template<typename T>
 class UploadBuffer
@@ -55,10 +56,66 @@ public:
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
     }
 
+    // Raw access for code that fills many elements at once.  Element i starts
+    // at MappedData() + i*ElementByteSize().
+    BYTE* MappedData()const
+    {
+        return mMappedData;
+    }
+
+    UINT ElementByteSize()const
+    {
+        return mElementByteSize;
+    }
+
 private:
     Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
     BYTE* mMappedData = nullptr;
 
     UINT mElementByteSize = 0;
     bool mIsConstantBuffer = false;
-};
\ No newline at end of file
+};
+
+// Upload-heap pages for LinearAllocator.  Each page is one committed buffer
+// that stays mapped for its whole lifetime.
+class D3D12UploadPageProvider : public IUploadPageProvider
+{
+public:
+    D3D12UploadPageProvider(ID3D12Device* device) :
+        mDevice(device)
+    {
+    }
+
+    virtual UploadPage CreatePage(uint64_t byteSize) override
+    {
+        ID3D12Resource* resource = nullptr;
+        ThrowIfFailed(mDevice->CreateCommittedResource(
+            get_rvalue_ptr(CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD)),
+            D3D12_HEAP_FLAG_NONE,
+            get_rvalue_ptr(CD3DX12_RESOURCE_DESC::Buffer(byteSize)),
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            nullptr,
+            IID_PPV_ARGS(&resource)));
+
+        UploadPage page;
+        ThrowIfFailed(resource->Map(0, nullptr, reinterpret_cast<void**>(&page.CpuBase)));
+        page.GpuBase = resource->GetGPUVirtualAddress();
+        page.ByteSize = byteSize;
+        page.Handle = resource;
+        return page;
+    }
+
+    virtual void DestroyPage(UploadPage& page) override
+    {
+        ID3D12Resource* resource = static_cast<ID3D12Resource*>(page.Handle);
+        if(resource != nullptr)
+        {
+            resource->Unmap(0, nullptr);
+            resource->Release();
+        }
+        page = UploadPage();
+    }
+
+private:
+    ID3D12Device* mDevice = nullptr;
+};
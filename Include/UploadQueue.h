@@ -0,0 +1,178 @@
+#pragma once
+
+#include "FramePacer.h"
+#include "LinearAllocator.h"
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Layout of one texture subresource in staging memory, as the graphics API
+// wants it (D3D12 gets this from GetCopyableFootprints). RowPitch is the
+// padded staging pitch; RowSizeInBytes is how much of each row holds data.
+struct UploadTextureFootprint {
+	uint32_t Subresource = 0;
+	uint32_t Format = 0;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t Depth = 1;
+	uint32_t RowPitch = 0;
+	uint32_t RowCount = 0;
+	uint64_t RowSizeInBytes = 0;
+};
+
+// Source data of one subresource, tightly packed or not.
+struct UploadSubresourceData {
+	const void *Data = nullptr;
+	uint64_t RowPitch = 0;
+	uint64_t SlicePitch = 0;
+};
+
+// One copy out of staging memory. Destination is the API resource, Source the
+// page handle of the staging memory (see UploadPage::Handle).
+struct UploadCopy {
+	enum Kind : uint32_t {
+		Buffer,
+		Texture,
+	};
+
+	Kind Type = Buffer;
+	void *Destination = nullptr;
+	uint64_t DestinationOffset = 0;
+	void *Source = nullptr;
+	uint64_t SourceOffset = 0;
+	uint64_t ByteSize = 0;
+	// Texture copies only.
+	UploadTextureFootprint Footprint;
+};
+
+// The queue that runs upload batches. Submit() records the copies, executes
+// them, and signals fenceValue on the upload fence behind them.
+class IUploadCopyQueue {
+public:
+	virtual ~IUploadCopyQueue() = default;
+	virtual void Submit(const UploadCopy *copies, uint32_t count, uint64_t fenceValue) = 0;
+};
+
+// Keeps every batch and signals the fence, for running an UploadQueue without
+// a GPU.
+class NullUploadCopyQueue : public IUploadCopyQueue {
+public:
+	explicit NullUploadCopyQueue(IFrameFence *fence) :
+			mFence(fence) {}
+
+	virtual void Submit(const UploadCopy *copies, uint32_t count, uint64_t fenceValue) override {
+		++Batches;
+		Copies.insert(Copies.end(), copies, copies + count);
+		mFence->Signal(fenceValue);
+	}
+
+	uint32_t Batches = 0;
+	std::vector<UploadCopy> Copies;
+
+private:
+	IFrameFence *mFence = nullptr;
+};
+
+struct UploadQueueDesc {
+	// Size of the staging ring. Uploads larger than this get a staging page
+	// of their own, released with their batch.
+	uint64_t StagingByteSize = 32ull << 20;
+	// A batch is submitted once it holds this much data or this many copies.
+	uint64_t MaxBatchBytes = 8ull << 20;
+	uint32_t MaxBatchCopies = 256;
+};
+
+struct UploadQueueStats {
+	uint64_t Uploads = 0;
+	uint64_t Batches = 0;
+	uint64_t BytesUploaded = 0;
+	// Uploads that had to wait for a batch to retire before staging memory
+	// was available.
+	uint64_t Stalls = 0;
+	uint64_t DedicatedPages = 0;
+	uint64_t StagingHighWaterMark = 0;
+};
+
+// Uploads to GPU-local resources through a dedicated copy queue. Data is
+// copied into a persistently mapped staging ring and the copies are batched;
+// each batch is submitted with the next value of the upload fence, and its
+// staging memory is reused once that value completes, so callers never keep
+// upload buffers alive themselves. The returned fence values tell when the
+// data is there: other queues wait on them before reading the destination.
+//
+// The queue only does bookkeeping; staging pages come from an
+// IUploadPageProvider and copies run on an IUploadCopyQueue. Not thread safe.
+class UploadQueue {
+public:
+	static const uint64_t BufferAlignment = 16;
+	// D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT.
+	static const uint64_t TextureAlignment = 512;
+
+	UploadQueue(IUploadPageProvider *pages, IUploadCopyQueue *copyQueue, IFrameFence *fence,
+			const UploadQueueDesc &desc = UploadQueueDesc());
+	UploadQueue(const UploadQueue &rhs) = delete;
+	UploadQueue &operator=(const UploadQueue &rhs) = delete;
+	// Waits for every batch to complete.
+	~UploadQueue();
+
+	// Both return the fence value the data is ready at. The source data is
+	// copied before they return.
+	uint64_t UploadBuffer(void *destination, uint64_t destinationOffset, const void *data, uint64_t byteSize);
+	uint64_t UploadTexture(void *destination, const UploadTextureFootprint *footprints,
+			const UploadSubresourceData *data, uint32_t count);
+
+	// Submits the open batch. Returns the fence value everything queued so
+	// far is ready at.
+	uint64_t Flush();
+	// Recycles staging memory of completed batches.
+	void Retire();
+	bool IsComplete(uint64_t fenceValue) const { return mFence->CompletedValue() >= fenceValue; }
+	// Blocks until fenceValue completes, submitting it first if it is open.
+	void Wait(uint64_t fenceValue);
+
+	// Fence value of the batch new uploads go into.
+	uint64_t PendingFenceValue() const { return mLastSubmitted + 1; }
+	uint64_t LastSubmittedFenceValue() const { return mLastSubmitted; }
+	uint32_t BatchesInFlight() const { return static_cast<uint32_t>(mBatches.size()); }
+	uint64_t StagingUsed() const { return mAllocated - mFreed; }
+	uint64_t StagingCapacity() const { return mStaging.ByteSize; }
+	const UploadQueueStats &Stats() const { return mStats; }
+
+private:
+	struct Staging {
+		uint8_t *Cpu = nullptr;
+		void *Handle = nullptr;
+		uint64_t Offset = 0;
+	};
+
+	struct Batch {
+		uint64_t FenceValue = 0;
+		// Ring position when the batch was submitted; its memory is free up to
+		// there once it completes.
+		uint64_t Allocated = 0;
+		std::vector<UploadPage> DedicatedPages;
+	};
+
+	Staging AllocateStaging(uint64_t byteSize, uint64_t alignment);
+	bool TryAllocateRing(uint64_t byteSize, uint64_t alignment, uint64_t &offset);
+	void Queue(const UploadCopy &copy);
+	void RetireBatch();
+
+	IUploadPageProvider *mPages = nullptr;
+	IUploadCopyQueue *mCopyQueue = nullptr;
+	IFrameFence *mFence = nullptr;
+	UploadQueueDesc mDesc;
+
+	// Ring positions only grow; the offset in the page is modulo its size.
+	UploadPage mStaging;
+	uint64_t mAllocated = 0;
+	uint64_t mFreed = 0;
+
+	std::vector<UploadCopy> mPendingCopies;
+	std::vector<UploadPage> mPendingPages;
+	uint64_t mPendingBytes = 0;
+	uint64_t mLastSubmitted = 0;
+	std::deque<Batch> mBatches;
+
+	UploadQueueStats mStats;
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <d3d12.h>
+#include "VertexPacking.h"
+#include <vector>
+
+// Translation of VertexLayout to D3D12. Needs nothing but d3d12.h, so the
+// headless build tests it against the stand-ins in Tests/Stubs.
+
+DXGI_FORMAT ToDxgiFormat(VertexFormat format);
+
+// Input layout of one interleaved vertex buffer in slot 0. Semantic names
+// point at static strings.
+std::vector<D3D12_INPUT_ELEMENT_DESC> MakeInputLayout(const VertexLayout &layout);
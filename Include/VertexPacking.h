@@ -0,0 +1,102 @@
+#pragma once
+
+#include "MeshData.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Storage formats of vertex elements. The normalized ones are expanded to
+// floats by the input assembler, so shaders read them like full floats.
+enum class VertexFormat : uint32_t {
+	Float2,
+	Float3,
+	Float4,
+	Half2,
+	Unorm16x4,
+	Snorm16x2,
+	Snorm8x4,
+	Unorm8x4,
+};
+
+uint32_t VertexFormatSize(VertexFormat format);
+
+struct VertexElement {
+	MeshAttribute Attribute;
+	const char *Semantic;
+	VertexFormat Format;
+	uint32_t Offset;
+};
+
+// Interleaved vertex layout; the graphics backend turns it into its input
+// layout description.
+struct VertexLayout {
+	std::vector<VertexElement> Elements;
+	uint32_t Stride = 0;
+
+	const VertexElement *Find(MeshAttribute attribute) const;
+};
+
+// Layout of the attributes, either as MeshData stores them (all floats) or
+// packed:
+//   POSITION  Unorm16x4  quantized to the subset's bounds, w unused
+//   NORMAL    Snorm16x2  octahedral
+//   TEXCOORD  Half2
+//   COLOR     Unorm8x4
+//   TANGENT   Snorm8x4   octahedral in xy, bitangent sign in z
+VertexLayout MakeVertexLayout(uint32_t attributes, bool packed);
+
+// Octahedral mapping of a unit vector onto [-1, 1]^2 and back.
+void OctahedralEncode(const float *n, float &u, float &v);
+void OctahedralDecode(float u, float v, float *n);
+
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+
+// A mesh in a packed layout. Positions are quantized per subset, so each
+// subset owns a vertex range starting at its BaseVertex and indices are
+// relative to it; shared vertices are duplicated. PositionScale and
+// PositionOffset map a subset's unorm positions back to model space:
+// p = offset + q * scale.
+struct PackedSubset {
+	float PositionScale[3] = {};
+	float PositionOffset[3] = {};
+};
+
+struct PackedMesh {
+	std::string Name;
+	VertexLayout Layout;
+	uint32_t VertexCount = 0;
+	uint32_t IndexByteSize = 2;
+	uint32_t IndexCount = 0;
+	std::vector<uint8_t> Vertices;
+	std::vector<uint8_t> Indices;
+	// Ranges and model-space bounds, as in the source mesh.
+	std::vector<MeshSubset> Subsets;
+	std::vector<PackedSubset> Quantization;
+
+	uint64_t ByteSize() const { return Vertices.size() + Indices.size(); }
+};
+
+// Packs mesh into the packed layout of its attributes. Indices are 16-bit
+// when every subset has at most 65536 vertices.
+void PackMesh(const MeshData &mesh, PackedMesh &packed);
+
+// Worst and average error of each attribute after a round trip through the
+// packed layout. Positions are in model units, normals and tangents in
+// degrees, texture coordinates in UV units and colors in [0, 1] units.
+struct AttributeError {
+	double Max = 0.0;
+	double Mean = 0.0;
+};
+
+struct VertexPackingError {
+	AttributeError Position;
+	AttributeError Normal;
+	AttributeError TexCoord;
+	AttributeError Color;
+	AttributeError Tangent;
+	uint32_t TangentSignFlips = 0;
+};
+
+VertexPackingError MeasurePackingError(const MeshData &mesh, const PackedMesh &packed);
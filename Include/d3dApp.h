@@ -10,6 +10,7 @@
 #endif
 
 #include "d3dUtil.h"
+#include "UploadBuffer.h"
 #include "GameTimer.h"
 #include "imgui/imgui.h"
 #include "imgui/imgui_impl_dx12.h"
@@ -66,6 +67,9 @@ public:
 protected:
 	virtual void CreateRtvAndDsvDescriptorHeaps();
 	virtual void OnResize(); 
+	// Called by OnResize with mCommandList open; creates the depth/stencil
+	// buffer for the new size and its view.
+	virtual void CreateDepthStencilBuffer();
 	virtual void Update(const GameTimer& gt)=0;
 	virtual void Draw(const GameTimer& gt)=0;
 
@@ -87,6 +91,9 @@ protected:
 	ID3D12Resource* CurrentBackBuffer()const;
 	D3D12_CPU_DESCRIPTOR_HANDLE CurrentBackBufferView()const;
 	D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView()const;
+	D3D12_RESOURCE_DESC DepthStencilDesc()const;
+	D3D12_CLEAR_VALUE DepthStencilClearValue()const;
+	void CreateDepthStencilView(ID3D12Resource* buffer);
 
 	void CalculateFrameStats();
 
@@ -120,8 +127,16 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D12Device> md3dDevice;
 
 
-	Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
-	UINT64 mCurrentFence = 0;
+	// Fence values for the frames in flight live in the pacer.  Frames wait on it
+	// in Update, and FlushCommandQueue drains it completely.
+	std::unique_ptr<D3D12FrameFence> mFrameFence;
+	std::unique_ptr<FramePacer> mFramePacer;
+
+	// Static data is uploaded on its own copy queue.  Staging memory is
+	// recycled as batches complete, so there are no uploaders to keep alive.
+	std::unique_ptr<D3D12UploadPageProvider> mStagingPages;
+	std::unique_ptr<D3D12CopyQueue> mCopyQueue;
+	std::unique_ptr<UploadQueue> mUploads;
 	
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue> mCommandQueue;
 	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> mDirectCmdListAlloc;
@@ -132,9 +147,16 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D12Resource> mSwapChainBuffer[SwapChainBufferCount];
 	Microsoft::WRL::ComPtr<ID3D12Resource> mDepthStencilBuffer;
 
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mRtvHeap;
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mDsvHeap;
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mImguiHeap;
+	std::unique_ptr<D3D12DescriptorHeap> mRtvHeap;
+	std::unique_ptr<D3D12DescriptorHeap> mDsvHeap;
+	// The only shader-visible CBV/SRV/UAV heap; ImGui's font SRV lives in it
+	// too, so it is bound once per frame.
+	std::unique_ptr<D3D12DescriptorHeap> mSrvHeap;
+	DescriptorRange mBackBufferRtvs;
+	DescriptorRange mDepthStencilDsv;
+	DescriptorRange mImguiFontSrv;
+	// SRV table in mSrvHeap that shaders index by bindless handle.
+	std::unique_ptr<D3D12BindlessTable> mBindless;
 
 
 	D3D12_VIEWPORT mScreenViewport; 
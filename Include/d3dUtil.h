@@ -25,9 +25,19 @@
 #include <fstream>
 #include <sstream>
 #include <cassert>
+#include <deque>
 #include "d3dx12.h"
 #include "DDSTextureLoader.h"
 #include "MathHelper.h"
+#include "FramePacer.h"
+#include "DescriptorAllocator.h"
+#include "BindlessRegistry.h"
+#include "RenderGraph.h"
+#include "BarrierTracker.h"
+#include "UploadQueue.h"
+#include "MeshFile.h"
+#include "VertexInputLayout.h"
+#include "ShaderCache.h"
 
 extern const int gNumFrameResources;
 
@@ -94,6 +104,8 @@ inline std::wstring AnsiToWString(const std::string& str)
 #endif 		
     */
 
+struct MeshGeometry;
+
 class d3dUtil
 {
 public:
@@ -120,18 +132,82 @@ public:
 
     static Microsoft::WRL::ComPtr<ID3DBlob> LoadBinary(const std::wstring& filename);
 
+    // Creates the buffer in COMMON and uploads it through the copy queue.  It
+    // decays back to COMMON after the copy and is promoted to whatever read
+    // state a later draw uses, so it needs no barriers; the direct queue only
+    // has to wait for readyFenceValue (D3D12CopyQueue::WaitOnQueue).
     static Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
         ID3D12Device* device,
-        ID3D12GraphicsCommandList* cmdList,
+        UploadQueue& uploads,
         const void* initData,
         UINT64 byteSize,
-        Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
+        uint64_t* readyFenceValue = nullptr);
 
+    // GPU copy of a mesh, uploaded through the copy queue.  Each subset becomes
+    // a DrawArgs entry named after it ("subset<i>" if it has no name).
+    static std::unique_ptr<MeshGeometry> CreateMeshGeometry(
+        ID3D12Device* device,
+        UploadQueue& uploads,
+        const MeshData& mesh,
+        uint64_t* readyFenceValue = nullptr);
+
+    // Same for a parsed mesh file; the streams are uploaded straight from the
+    // view (e.g. a memory-mapped file) without an intermediate copy.  Packed
+    // files get submeshes as the PackedMesh overload makes them.
+    static std::unique_ptr<MeshGeometry> CreateMeshGeometry(
+        ID3D12Device* device,
+        UploadQueue& uploads,
+        const MeshFileView& mesh,
+        uint64_t* readyFenceValue = nullptr);
+
+    // Same for a packed mesh.  Submesh bounds are in the packed (unit cube)
+    // position space; PositionTransform takes them and the vertices to model
+    // space.
+    static std::unique_ptr<MeshGeometry> CreateMeshGeometry(
+        ID3D12Device* device,
+        UploadQueue& uploads,
+        const PackedMesh& mesh,
+        uint64_t* readyFenceValue = nullptr);
+
+    // Uploads subresources [firstSubresource, firstSubresource + count) of a
+    // texture created in COMMON.  Returns the fence value it is ready at.
+    static uint64_t UploadTexture(
+        ID3D12Device* device,
+        UploadQueue& uploads,
+        ID3D12Resource* texture,
+        const D3D12_SUBRESOURCE_DATA* subresources,
+        UINT firstSubresource,
+        UINT count);
+
+	// Compiles through the shader cache when one is set, otherwise calls the
+	// compiler directly.
 	static Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(
 		const std::wstring& filename,
 		const D3D_SHADER_MACRO* defines,
 		const std::string& entrypoint,
 		const std::string& target);
+
+    // Request for the same compile CompileShader would do, with the default
+    // flags for this build configuration.
+    static ShaderCompileRequest MakeShaderCompileRequest(
+        const std::wstring& filename,
+        const D3D_SHADER_MACRO* defines,
+        const std::string& entrypoint,
+        const std::string& target);
+
+    // D3DCompiler backend with the ShaderCompileFn signature.
+    static bool CompileShaderBytecode(
+        const ShaderCompileRequest& request,
+        std::vector<uint8_t>& byteCode,
+        std::string& errors);
+
+    // Name and file version of the loaded D3DCompiler DLL, for cache keys.
+    static std::string ShaderCompilerVersion();
+
+    // Cache used by CompileShader; nullptr disables caching.  Not owned.
+    static void SetShaderCache(ShaderCache* cache);
+
+    static D3D12_RESOURCE_STATES ToD3D12States(ResourceState state);
 };
 
 class DxException
@@ -148,6 +224,172 @@ public:
     int LineNumber = -1;
 };
 
+// IFrameFence over an ID3D12Fence signalled from a command queue.  The wait
+// event is created once and reused, instead of one event per wait.
+class D3D12FrameFence : public IFrameFence
+{
+public:
+    D3D12FrameFence(ID3D12Device* device, ID3D12CommandQueue* queue);
+    D3D12FrameFence(const D3D12FrameFence& rhs) = delete;
+    D3D12FrameFence& operator=(const D3D12FrameFence& rhs) = delete;
+    ~D3D12FrameFence();
+
+    virtual uint64_t CompletedValue()const override;
+    virtual void Signal(uint64_t value) override;
+    virtual void Wait(uint64_t value) override;
+
+    ID3D12Fence* Fence()const { return mFence.Get(); }
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
+    ID3D12CommandQueue* mQueue = nullptr;
+    HANDLE mEvent = nullptr;
+};
+
+// Descriptor heap carved into a free-list region for long-lived views and a
+// ring region for descriptors that only live for one frame.  CBV/SRV/UAV and
+// sampler heaps are created shader visible, so one heap of each can stay
+// bound for the whole frame.  Not thread safe.
+class D3D12DescriptorHeap
+{
+public:
+    D3D12DescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type,
+        UINT persistentCount, UINT transientCount = 0);
+    D3D12DescriptorHeap(const D3D12DescriptorHeap& rhs) = delete;
+    D3D12DescriptorHeap& operator=(const D3D12DescriptorHeap& rhs) = delete;
+
+    // Both throw if their region is exhausted.
+    DescriptorRange Allocate(UINT count = 1);
+    DescriptorRange AllocateTransient(UINT count);
+    void Free(DescriptorRange range);
+
+    // Transient descriptors allocated since the last FinishFrame() are
+    // recycled once the fence reaches fenceValue and Retire() sees it.
+    void FinishFrame(uint64_t fenceValue);
+    void Retire(uint64_t completedFenceValue);
+
+    D3D12_CPU_DESCRIPTOR_HANDLE CpuHandle(DescriptorRange range, UINT index = 0)const;
+    D3D12_GPU_DESCRIPTOR_HANDLE GpuHandle(DescriptorRange range, UINT index = 0)const;
+
+    ID3D12DescriptorHeap* Heap()const { return mHeap.Get(); }
+    const DescriptorFreeList& Persistent()const { return mPersistent; }
+    const DescriptorRing& Transient()const { return mTransient; }
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mHeap;
+    D3D12_CPU_DESCRIPTOR_HANDLE mCpuStart = {};
+    D3D12_GPU_DESCRIPTOR_HANDLE mGpuStart = {};
+    UINT mDescriptorSize = 0;
+
+    DescriptorFreeList mPersistent;
+    DescriptorRing mTransient;
+};
+
+// One contiguous SRV table in a shader-visible heap whose slots are handed
+// out by a BindlessRegistry.  Shaders index the table with the handle's Index,
+// so it is bound once per command list and draws never switch tables.
+class D3D12BindlessTable
+{
+public:
+    D3D12BindlessTable(ID3D12Device* device, D3D12DescriptorHeap* heap, UINT capacity);
+    D3D12BindlessTable(const D3D12BindlessTable& rhs) = delete;
+    D3D12BindlessTable& operator=(const D3D12BindlessTable& rhs) = delete;
+
+    // Both throw if the table is full.  A null desc uses the resource's format
+    // and full mip chain.
+    BindlessHandle RegisterTexture(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc = nullptr);
+    BindlessHandle RegisterStructuredBuffer(ID3D12Resource* resource, UINT elementCount, UINT elementByteSize);
+
+    // The slot is recycled once the frame it was released in has retired.
+    void Release(BindlessHandle handle);
+    void FinishFrame(uint64_t fenceValue);
+    void Retire(uint64_t completedFenceValue);
+
+    D3D12_GPU_DESCRIPTOR_HANDLE TableStart()const;
+    UINT Capacity()const { return mRange.Count; }
+    const BindlessRegistry& Registry()const { return mRegistry; }
+
+private:
+    BindlessHandle Register(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc);
+
+    ID3D12Device* mDevice = nullptr;
+    D3D12DescriptorHeap* mHeap = nullptr;
+    DescriptorRange mRange;
+    BindlessRegistry mRegistry;
+};
+
+// Sends BarrierTracker batches to a D3D12 command list.
+class D3D12BarrierCommandList : public IBarrierCommandList
+{
+public:
+    explicit D3D12BarrierCommandList(ID3D12GraphicsCommandList* cmdList) : mCmdList(cmdList) {}
+
+    virtual void ResourceBarrier(const TrackedBarrier* barriers, uint32_t count) override;
+
+private:
+    ID3D12GraphicsCommandList* mCmdList = nullptr;
+    std::vector<D3D12_RESOURCE_BARRIER> mBarriers;
+};
+
+// D3D12_COMMAND_LIST_TYPE_COPY queue that runs UploadQueue batches, with its
+// own fence.  Command allocators are recycled once the batch that used them
+// has completed.
+class D3D12CopyQueue : public IUploadCopyQueue
+{
+public:
+    explicit D3D12CopyQueue(ID3D12Device* device);
+    D3D12CopyQueue(const D3D12CopyQueue& rhs) = delete;
+    D3D12CopyQueue& operator=(const D3D12CopyQueue& rhs) = delete;
+
+    virtual void Submit(const UploadCopy* copies, uint32_t count, uint64_t fenceValue) override;
+
+    // Makes work submitted to queue after this call wait, on the GPU, for the
+    // upload batch with fenceValue.
+    void WaitOnQueue(ID3D12CommandQueue* queue, uint64_t fenceValue)const;
+
+    ID3D12CommandQueue* Queue()const { return mQueue.Get(); }
+    D3D12FrameFence* Fence()const { return mFence.get(); }
+
+private:
+    struct Allocator
+    {
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CmdListAlloc;
+        uint64_t FenceValue = 0;
+    };
+
+    ID3D12Device* mDevice = nullptr;
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> mQueue;
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> mCmdList;
+    std::unique_ptr<D3D12FrameFence> mFence;
+    std::deque<Allocator> mAllocators;
+};
+
+// Placed resources for the transient resources of a compiled RenderGraph, all
+// in one heap laid out by the graph, so resources that are never alive at the
+// same time share memory.  Describe() gives the size and alignment to declare
+// a transient resource with.
+class D3D12TransientResources
+{
+public:
+    static RenderGraphResourceDesc Describe(ID3D12Device* device, const D3D12_RESOURCE_DESC& desc);
+
+    // descs and clearValues are indexed by graph resource; entries for
+    // imported resources are ignored, and a clear value with an unknown
+    // format means none.  Releases whatever was created before.
+    void Create(ID3D12Device* device, const RenderGraph& graph,
+        const std::vector<D3D12_RESOURCE_DESC>& descs,
+        const std::vector<D3D12_CLEAR_VALUE>& clearValues);
+
+    // Null for imported and unused resources.
+    ID3D12Resource* Resource(RenderGraphResource resource)const { return mResources[resource.Index].Get(); }
+    UINT64 HeapSize()const { return mHeapSize; }
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Heap> mHeap;
+    std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> mResources;
+    UINT64 mHeapSize = 0;
+};
+
 // Defines a subrange of geometry in a MeshGeometry.  This is for when multiple
 // geometries are stored in one vertex and index buffer.  It provides the offsets
 // and data needed to draw a subset of geometry stores in the vertex and index 
@@ -158,9 +400,18 @@ struct SubmeshGeometry
 	UINT StartIndexLocation = 0;
 	INT BaseVertexLocation = 0;
 
-    // Bounding box of the geometry defined by this submesh. 
-    // This is used in later chapters of the book.
+    // Bounding box of the geometry defined by this submesh, in local space.
+    // Render items transform it to world space for frustum culling.
 	DirectX::BoundingBox Bounds;
+
+    // Maps vertex positions (and Bounds) to model space.  Identity unless the
+    // positions are quantized; render items premultiply their world by it.
+	DirectX::XMFLOAT4X4 PositionTransform = MathHelper::Identity4x4();
+
+    // Level of detail, 0 for full detail.  LodError bounds how far (in model
+    // units) this level strays from level 0, for screen-space LOD selection.
+	UINT LodLevel = 0;
+	float LodError = 0.0f;
 };
 
 struct MeshGeometry
@@ -210,7 +461,9 @@ struct MeshGeometry
 		return ibv;
 	}
 
-	// We can free this memory after we finish upload to the GPU.
+	// We can free this memory after we finish upload to the GPU.  Not needed
+	// for buffers uploaded through an UploadQueue, which recycles its staging
+	// memory itself.
 	void DisposeUploaders()
 	{
 		VertexBufferUploader = nullptr;
@@ -238,6 +491,12 @@ struct MaterialConstants
 
 	// Used in texture mapping.
 	DirectX::XMFLOAT4X4 MatTransform = MathHelper::Identity4x4();
+
+	// Bindless table indices of the material's textures.
+	UINT DiffuseMapIndex = UINT32_MAX;
+	UINT NormalMapIndex = UINT32_MAX;
+	UINT MatPad0 = 0;
+	UINT MatPad1 = 0;
 };
 
 // Simple struct to represent a material for our demos.  A production 3D engine
@@ -250,11 +509,11 @@ struct Material
 	// Index into constant buffer corresponding to this material.
 	int MatCBIndex = -1;
 
-	// Index into SRV heap for diffuse texture.
-	int DiffuseSrvHeapIndex = -1;
-
-	// Index into SRV heap for normal texture.
-	int NormalSrvHeapIndex = -1;
+	// Bindless table slots of the diffuse and normal textures.  Their indices
+	// go into the material constants, so drawing with this material does not
+	// bind a descriptor table.
+	BindlessHandle DiffuseSrv;
+	BindlessHandle NormalSrv;
 
 	// Dirty flag indicating the material has changed and we need to update the constant buffer.
 	// Because we have a material constant buffer for each FrameResource, we have to apply the
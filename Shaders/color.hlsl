@@ -10,13 +10,47 @@
 // 	float4 g_Color;
 // 	uint g_UseCustomColor;
 // };
+// Compile-time options (see ShaderPermutationDesc in the app).
+#ifndef USE_CUSTOM_COLOR
+#define USE_CUSTOM_COLOR 0
+#endif
+
+// Matches ObjectConstants in FreamResource.h; structured buffers are tightly
+// packed, so the layout lines up with the C++ struct.
 struct ObjectConstants
 {
-	float4x4 gWorldViewProj;
+	float4x4 gWorld;
 	float4 g_Color;
-	uint g_UseCustomColor;
 };
-ConstantBuffer<ObjectConstants> gObjConstants : register(b0);
+
+// Every bindless buffer of object data; the root constant picks the frame's.
+StructuredBuffer<ObjectConstants> gObjectBuffers[] : register(t0, space1);
+cbuffer cbObjects : register(b0)
+{
+	uint gObjectBufferIndex;
+};
+
+// Object index of each instance of the current draw.
+StructuredBuffer<uint> gInstanceObjects : register(t1);
+
+// Matches PassConstants in FreamResource.h.
+cbuffer cbPass : register(b1)
+{
+	float4x4 gView;
+	float4x4 gInvView;
+	float4x4 gProj;
+	float4x4 gInvProj;
+	float4x4 gViewProj;
+	float4x4 gInvViewProj;
+	float3 gEyePosW;
+	float cbPerObjectPad1;
+	float2 gRenderTargetSize;
+	float2 gInvRenderTargetSize;
+	float gNearZ;
+	float gFarZ;
+	float gTotalTime;
+	float gDeltaTime;
+};
 
 struct VertexIn
 {
@@ -30,22 +64,29 @@ struct VertexOut
     float4 Color : COLOR;
 };
 
-VertexOut VS(VertexIn vin)
+VertexOut VS(VertexIn vin, uint instanceID : SV_InstanceID)
 {
 	VertexOut vout;
+
+	ObjectConstants obj = gObjectBuffers[gObjectBufferIndex][gInstanceObjects[instanceID]];
 	
-	// Transform to homogeneous clip space.
-	vout.PosH = mul(float4(vin.PosL, 1.0f), gObjConstants.gWorldViewProj);
+	// Transform to world space, then to homogeneous clip space.
+	float4 posW = mul(float4(vin.PosL, 1.0f), obj.gWorld);
+	vout.PosH = mul(posW, gViewProj);
 	
-	// Just pass vertex color into the pixel shader.
+	// Pass the object's color, or the vertex color, into the pixel shader.
+#if USE_CUSTOM_COLOR
+    vout.Color = obj.g_Color;
+#else
     vout.Color = vin.Color;
+#endif
     
     return vout;
 }
 
 float4 PS(VertexOut pin) : SV_Target
 {
-	return gObjConstants.g_UseCustomColor ? gObjConstants.g_Color : pin.Color;
+	return pin.Color;
 }
 
 
@@ -0,0 +1,193 @@
+#include "BarrierTracker.h"
+#include <cassert>
+
+void ResourceStateTable::Register(const void *resource, ResourceState state, uint32_t subresourceCount, bool implicitPromotion) {
+	Entry &entry = mEntries[resource];
+	entry.States.assign(subresourceCount != 0 ? subresourceCount : 1, state);
+	entry.ImplicitPromotion = implicitPromotion;
+}
+
+void ResourceStateTable::Unregister(const void *resource) {
+	mEntries.erase(resource);
+}
+
+ResourceState ResourceStateTable::State(const void *resource, uint32_t subresource) const {
+	auto it = mEntries.find(resource);
+	assert(it != mEntries.end() && subresource < it->second.States.size());
+	return it->second.States[subresource];
+}
+
+BarrierTracker::BarrierTracker(ResourceStateTable *table) :
+		mTable(table) {
+}
+
+BarrierTracker::Local &BarrierTracker::Track(const void *resource) {
+	auto it = mLocal.find(resource);
+	if (it != mLocal.end())
+		return it->second;
+
+	auto entry = mTable->mEntries.find(resource);
+	assert(entry != mTable->mEntries.end() && "resource not registered with the state table");
+
+	Local &local = mLocal[resource];
+	local.States = entry->second.States;
+	local.ImplicitPromotion = entry->second.ImplicitPromotion;
+	local.Splitting.assign(local.States.size(), false);
+	local.SplitFrom.assign(local.States.size(), ResourceState::Common);
+	local.SplitKey.assign(local.States.size(), AllSubresources);
+	return local;
+}
+
+void BarrierTracker::Queue(const TrackedBarrier &barrier) {
+	if (barrier.Type == TrackedBarrier::Transition && barrier.Split == TrackedBarrier::Full) {
+		// Merge with the last pending barrier on the same resource, if it is a
+		// plain transition of the same subresources.
+		for (size_t i = mPending.size(); i-- > 0;) {
+			TrackedBarrier &pending = mPending[i];
+			if (pending.Resource != barrier.Resource)
+				continue;
+			if (pending.Type != TrackedBarrier::Transition || pending.Split != TrackedBarrier::Full ||
+					pending.Subresource != barrier.Subresource)
+				break;
+
+			assert(pending.After == barrier.Before);
+			++mStats.Elided;
+			pending.After = barrier.After;
+			if (pending.Before == pending.After)
+				mPending.erase(mPending.begin() + i);
+			return;
+		}
+	}
+	mPending.push_back(barrier);
+}
+
+void BarrierTracker::EndSplit(const void *resource, Local &local, uint32_t subresource) {
+	uint32_t key = local.SplitKey[subresource];
+	ResourceState before = local.SplitFrom[subresource];
+	ResourceState after = local.States[subresource];
+
+	for (uint32_t i = 0; i < local.States.size(); ++i) {
+		if (local.Splitting[i] && local.SplitKey[i] == key)
+			local.Splitting[i] = false;
+	}
+
+	// Nothing was recorded since the begin: issue it as a plain transition.
+	for (TrackedBarrier &pending : mPending) {
+		if (pending.Resource == resource && pending.Subresource == key && pending.Split == TrackedBarrier::BeginOnly) {
+			pending.Split = TrackedBarrier::Full;
+			return;
+		}
+	}
+	Queue({ TrackedBarrier::Transition, TrackedBarrier::EndOnly, resource, key, before, after });
+}
+
+void BarrierTracker::TransitionSubresource(const void *resource, Local &local, uint32_t subresource, ResourceState after,
+		uint32_t barrierSubresource, bool split) {
+	ResourceState before = local.States[subresource];
+	bool readable = IsCombinableRead(after) && IsCombinableRead(before) && ContainsStates(before, after);
+	bool elide = before == after || readable;
+
+	// Buffers leave Common on their own.
+	if (!elide && !split && before == ResourceState::Common && local.ImplicitPromotion)
+		elide = true;
+
+	if (elide)
+		++mStats.Elided;
+	else
+		Queue({ TrackedBarrier::Transition, split ? TrackedBarrier::BeginOnly : TrackedBarrier::Full, resource,
+				barrierSubresource, before, after });
+
+	ResourceState state = readable ? before : after;
+	uint32_t first = barrierSubresource == AllSubresources ? 0 : subresource;
+	uint32_t last = barrierSubresource == AllSubresources ? static_cast<uint32_t>(local.States.size()) : subresource + 1;
+	for (uint32_t i = first; i < last; ++i) {
+		local.States[i] = state;
+		if (split && !elide) {
+			local.Splitting[i] = true;
+			local.SplitFrom[i] = before;
+			local.SplitKey[i] = barrierSubresource;
+		}
+	}
+}
+
+void BarrierTracker::RequestTransition(const void *resource, ResourceState after, uint32_t subresource, bool split) {
+	++mStats.Requested;
+	Local &local = Track(resource);
+
+	if (subresource != AllSubresources) {
+		assert(subresource < local.States.size());
+		if (local.Splitting[subresource])
+			EndSplit(resource, local, subresource);
+		TransitionSubresource(resource, local, subresource, after, subresource, split);
+		return;
+	}
+
+	bool uniform = true;
+	for (uint32_t i = 0; i < local.States.size(); ++i) {
+		if (local.Splitting[i])
+			EndSplit(resource, local, i);
+		uniform = uniform && local.States[i] == local.States[0];
+	}
+
+	// One barrier for the whole resource when every subresource agrees.
+	if (uniform) {
+		TransitionSubresource(resource, local, 0, after, AllSubresources, split);
+	} else {
+		for (uint32_t i = 0; i < local.States.size(); ++i)
+			TransitionSubresource(resource, local, i, after, i, split);
+	}
+}
+
+void BarrierTracker::Transition(const void *resource, ResourceState after, uint32_t subresource) {
+	RequestTransition(resource, after, subresource, false);
+}
+
+void BarrierTracker::BeginTransition(const void *resource, ResourceState after, uint32_t subresource) {
+	RequestTransition(resource, after, subresource, true);
+}
+
+void BarrierTracker::UavBarrier(const void *resource) {
+	Queue({ TrackedBarrier::Uav, TrackedBarrier::Full, resource, AllSubresources });
+}
+
+void BarrierTracker::AliasingBarrier(const void *resource) {
+	Queue({ TrackedBarrier::Aliasing, TrackedBarrier::Full, resource, AllSubresources });
+}
+
+bool BarrierTracker::HasPending(const void *resource) const {
+	for (const TrackedBarrier &barrier : mPending) {
+		if (barrier.Resource == resource)
+			return true;
+	}
+	return false;
+}
+
+void BarrierTracker::Flush(IBarrierCommandList &cmdList) {
+	if (mPending.empty())
+		return;
+
+	cmdList.ResourceBarrier(mPending.data(), static_cast<uint32_t>(mPending.size()));
+	mStats.Emitted += static_cast<uint32_t>(mPending.size());
+	++mStats.Calls;
+	mPending.clear();
+}
+
+void BarrierTracker::Finish(IBarrierCommandList &cmdList) {
+	for (auto &[resource, local] : mLocal) {
+		for (uint32_t i = 0; i < local.States.size(); ++i) {
+			if (local.Splitting[i])
+				EndSplit(resource, local, i);
+		}
+	}
+	Flush(cmdList);
+
+	// Promoted resources decay back to Common once the list has executed.
+	for (auto &[resource, local] : mLocal) {
+		ResourceStateTable::Entry &entry = mTable->mEntries[resource];
+		if (local.ImplicitPromotion)
+			entry.States.assign(local.States.size(), ResourceState::Common);
+		else
+			entry.States = local.States;
+	}
+	mLocal.clear();
+}
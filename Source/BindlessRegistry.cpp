@@ -0,0 +1,56 @@
+#include "BindlessRegistry.h"
+
+BindlessRegistry::BindlessRegistry(uint32_t capacity) :
+		mGenerations(capacity, 0) {
+	// Hand out low indices first.
+	mFree.reserve(capacity);
+	for (uint32_t i = capacity; i > 0; --i)
+		mFree.push_back(i - 1);
+}
+
+BindlessHandle BindlessRegistry::Register() {
+	BindlessHandle handle;
+	if (mFree.empty())
+		return handle;
+
+	handle.Index = mFree.back();
+	mFree.pop_back();
+	handle.Generation = ++mGenerations[handle.Index];
+	++mLiveCount;
+	return handle;
+}
+
+bool BindlessRegistry::Release(BindlessHandle handle) {
+	if (!IsAlive(handle))
+		return false;
+
+	++mGenerations[handle.Index];
+	--mLiveCount;
+	mPending.push_back(handle.Index);
+	++mUnfinished;
+	return true;
+}
+
+bool BindlessRegistry::IsAlive(BindlessHandle handle) const {
+	return handle.Index < mGenerations.size() && (handle.Generation & 1) != 0 &&
+			mGenerations[handle.Index] == handle.Generation;
+}
+
+uint32_t BindlessRegistry::PendingCount() const {
+	return static_cast<uint32_t>(mPending.size());
+}
+
+void BindlessRegistry::FinishFrame(uint64_t fenceValue) {
+	mFrames.push_back({ fenceValue, mUnfinished });
+	mUnfinished = 0;
+}
+
+void BindlessRegistry::Retire(uint64_t completedFenceValue) {
+	while (!mFrames.empty() && mFrames.front().FenceValue <= completedFenceValue) {
+		for (uint32_t i = 0; i < mFrames.front().SlotCount; ++i) {
+			mFree.push_back(mPending.front());
+			mPending.pop_front();
+		}
+		mFrames.pop_front();
+	}
+}
@@ -0,0 +1,130 @@
+#include "DescriptorAllocator.h"
+#include <cassert>
+
+DescriptorFreeList::DescriptorFreeList(uint32_t offset, uint32_t capacity) :
+		mCapacity(capacity) {
+	if (capacity != 0)
+		Insert(offset, capacity);
+}
+
+uint32_t DescriptorFreeList::LargestFreeRange() const {
+	return mBySize.empty() ? 0 : mBySize.rbegin()->first;
+}
+
+void DescriptorFreeList::Insert(uint32_t offset, uint32_t count) {
+	mByOffset.emplace(offset, count);
+	mBySize.emplace(count, offset);
+	mFreeCount += count;
+}
+
+void DescriptorFreeList::Erase(std::map<uint32_t, uint32_t>::iterator it) {
+	mBySize.erase({ it->second, it->first });
+	mFreeCount -= it->second;
+	mByOffset.erase(it);
+}
+
+DescriptorRange DescriptorFreeList::Allocate(uint32_t count) {
+	DescriptorRange range;
+	if (count == 0)
+		return range;
+
+	// Smallest free range that fits, lowest offset among equals.
+	auto fit = mBySize.lower_bound({ count, 0 });
+	if (fit == mBySize.end())
+		return range;
+
+	uint32_t freeOffset = fit->second;
+	uint32_t freeCount = fit->first;
+	Erase(mByOffset.find(freeOffset));
+	if (freeCount > count)
+		Insert(freeOffset + count, freeCount - count);
+
+	range.Offset = freeOffset;
+	range.Count = count;
+	return range;
+}
+
+void DescriptorFreeList::Free(DescriptorRange range) {
+	if (!range.IsValid() || range.Count == 0)
+		return;
+
+	uint32_t offset = range.Offset;
+	uint32_t count = range.Count;
+
+	// Merge with the free range after this one...
+	auto next = mByOffset.lower_bound(offset);
+	assert(next == mByOffset.end() || next->first >= offset + count);
+	if (next != mByOffset.end() && next->first == offset + count) {
+		count += next->second;
+		Erase(next);
+	}
+
+	// ...and the one before it.
+	auto prev = mByOffset.lower_bound(offset);
+	if (prev != mByOffset.begin()) {
+		--prev;
+		assert(prev->first + prev->second <= offset);
+		if (prev->first + prev->second == offset) {
+			offset = prev->first;
+			count += prev->second;
+			Erase(prev);
+		}
+	}
+
+	Insert(offset, count);
+}
+
+DescriptorRing::DescriptorRing(uint32_t offset, uint32_t capacity) :
+		mOffset(offset),
+		mCapacity(capacity) {
+}
+
+DescriptorRange DescriptorRing::Allocate(uint32_t count) {
+	DescriptorRange range;
+	if (count == 0 || count > mCapacity)
+		return range;
+
+	uint32_t used = UsedCount();
+	uint32_t start = mHead;
+	uint32_t skipped = 0;
+	if (used == 0) {
+		// Empty: restart at the beginning so the whole ring is available.
+		// Frames still in flight allocated nothing, so they end there too.
+		mHead = mTail = start = 0;
+		for (Frame &frame : mFrames)
+			frame.Head = 0;
+	} else if (mTail < mHead || (mTail == mHead && used < mCapacity)) {
+		// Free space is [head, capacity) and [0, tail).
+		if (mHead + count > mCapacity) {
+			if (count > mTail)
+				return range;
+			skipped = mCapacity - mHead;
+			start = 0;
+		}
+	} else {
+		// Free space is [head, tail).
+		if (mHead + count > mTail || used == mCapacity)
+			return range;
+	}
+
+	mHead = start + count;
+	if (mHead == mCapacity)
+		mHead = 0;
+	mAllocated += skipped + count;
+
+	range.Offset = mOffset + start;
+	range.Count = count;
+	return range;
+}
+
+void DescriptorRing::FinishFrame(uint64_t fenceValue) {
+	mFrames.push_back({ fenceValue, mHead, mAllocated });
+}
+
+void DescriptorRing::Retire(uint64_t completedFenceValue) {
+	while (!mFrames.empty() && mFrames.front().FenceValue <= completedFenceValue) {
+		mTail = mFrames.front().Head;
+		mFreed = mFrames.front().Allocated;
+		mFrames.pop_front();
+	}
+}
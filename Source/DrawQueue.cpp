@@ -0,0 +1,137 @@
+#include "DrawQueue.h"
+#include <algorithm>
+
+uint32_t SortKey::QuantizeDepth(float viewDepth, float nearZ, float farZ) {
+	constexpr uint32_t maxDepth = (1u << DepthBits) - 1;
+	float t = (viewDepth - nearZ) / (farZ - nearZ);
+	t = std::clamp(t, 0.0f, 1.0f);
+	return static_cast<uint32_t>(t * static_cast<float>(maxDepth) + 0.5f);
+}
+
+DrawSubmitStats &DrawSubmitStats::operator+=(const DrawSubmitStats &rhs) {
+	Draws += rhs.Draws;
+	PipelineChanges += rhs.PipelineChanges;
+	MaterialChanges += rhs.MaterialChanges;
+	MeshChanges += rhs.MeshChanges;
+	PrimitiveTypeChanges += rhs.PrimitiveTypeChanges;
+	AvoidedChanges += rhs.AvoidedChanges;
+	return *this;
+}
+
+void DrawQueue::Clear() {
+	mPackets.clear();
+	mKeys.clear();
+	mOrder.clear();
+}
+
+void DrawQueue::Reserve(uint32_t count) {
+	mPackets.reserve(count);
+	mKeys.reserve(count);
+	mOrder.reserve(count);
+}
+
+void DrawQueue::Push(const DrawPacket &packet) {
+	mOrder.push_back(static_cast<uint32_t>(mPackets.size()));
+	mPackets.push_back(packet);
+	mKeys.push_back(packet.Key);
+}
+
+void DrawQueue::Sort() {
+	uint32_t count = Size();
+	if (count < 2)
+		return;
+
+	// One sweep builds the histograms of all eight bytes.
+	uint32_t histograms[8][256] = {};
+	for (uint32_t i = 0; i < count; ++i) {
+		uint64_t key = mKeys[i];
+		for (uint32_t b = 0; b < 8; ++b)
+			++histograms[b][(key >> (b * 8)) & 0xff];
+	}
+
+	mTempKeys.resize(count);
+	mTempOrder.resize(count);
+	uint64_t *srcKeys = mKeys.data();
+	uint32_t *srcOrder = mOrder.data();
+	uint64_t *dstKeys = mTempKeys.data();
+	uint32_t *dstOrder = mTempOrder.data();
+
+	for (uint32_t b = 0; b < 8; ++b) {
+		uint32_t *histogram = histograms[b];
+
+		// All keys share this byte: the pass would not move anything.
+		uint32_t firstDigit = (srcKeys[0] >> (b * 8)) & 0xff;
+		if (histogram[firstDigit] == count)
+			continue;
+
+		uint32_t offset = 0;
+		for (uint32_t d = 0; d < 256; ++d) {
+			uint32_t n = histogram[d];
+			histogram[d] = offset;
+			offset += n;
+		}
+
+		uint32_t shift = b * 8;
+		for (uint32_t i = 0; i < count; ++i) {
+			uint64_t key = srcKeys[i];
+			uint32_t dst = histogram[(key >> shift) & 0xff]++;
+			dstKeys[dst] = key;
+			dstOrder[dst] = srcOrder[i];
+		}
+		std::swap(srcKeys, dstKeys);
+		std::swap(srcOrder, dstOrder);
+	}
+
+	// After an odd number of passes the result sits in the temp buffers.
+	if (srcKeys != mKeys.data()) {
+		mKeys.swap(mTempKeys);
+		mOrder.swap(mTempOrder);
+	}
+}
+
+DrawSubmitStats DrawQueue::Submit(IDrawCommandSink &sink, uint32_t first, uint32_t count) const {
+	DrawSubmitStats stats;
+
+	// Nothing is bound at the start of a range.
+	bool bound = false;
+	uint32_t pipeline = 0, material = 0, mesh = 0, primitiveType = 0;
+
+	uint32_t last = std::min(first + count, Size());
+	for (uint32_t i = first; i < last; ++i) {
+		const DrawPacket &packet = Packet(i);
+
+		if (!bound || packet.Pipeline != pipeline) {
+			pipeline = packet.Pipeline;
+			sink.SetPipeline(pipeline);
+			++stats.PipelineChanges;
+		} else {
+			++stats.AvoidedChanges;
+		}
+		if (!bound || packet.Material != material) {
+			material = packet.Material;
+			sink.SetMaterial(material);
+			++stats.MaterialChanges;
+		} else {
+			++stats.AvoidedChanges;
+		}
+		if (!bound || packet.Mesh != mesh) {
+			mesh = packet.Mesh;
+			sink.SetMesh(mesh);
+			++stats.MeshChanges;
+		} else {
+			++stats.AvoidedChanges;
+		}
+		if (!bound || packet.PrimitiveType != primitiveType) {
+			primitiveType = packet.PrimitiveType;
+			sink.SetPrimitiveType(primitiveType);
+			++stats.PrimitiveTypeChanges;
+		} else {
+			++stats.AvoidedChanges;
+		}
+		bound = true;
+
+		sink.Draw(packet);
+		++stats.Draws;
+	}
+	return stats;
+}
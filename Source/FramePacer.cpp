@@ -0,0 +1,97 @@
+#include "FramePacer.h"
+#include <cassert>
+#include <chrono>
+
+void FakeFence::Signal(uint64_t value) {
+	assert(value > mSignaled);
+	mSignaled = value;
+	mPending.push_back(value);
+}
+
+void FakeFence::Wait(uint64_t value) {
+	++mWaitCount;
+	while (mCompleted < value && Retire()) {
+	}
+	assert(mCompleted >= value && "Waiting on a value that was never signalled.");
+}
+
+bool FakeFence::Retire() {
+	if (mPending.empty())
+		return false;
+	mCompleted = mPending.front();
+	mPending.erase(mPending.begin());
+	return true;
+}
+
+void FakeFence::RetireAll() {
+	while (Retire()) {
+	}
+}
+
+FramePacer::FramePacer(IFrameFence *fence, uint32_t framesInFlight, uint32_t maxLatency) :
+		mFence(fence),
+		mFrameFences(framesInFlight, 0) {
+	assert(mFence != nullptr);
+	assert(framesInFlight > 0);
+	SetMaxLatency(maxLatency == 0 ? framesInFlight : maxLatency);
+}
+
+uint32_t FramePacer::BeginFrame() {
+	mFrameIndex = static_cast<uint32_t>(mFrameNumber % mFrameFences.size());
+
+	// The CPU may run at most MaxLatency frames ahead, so frame (n - MaxLatency)
+	// has to be finished before we start recording frame n. Since MaxLatency is
+	// never above the ring size this also covers the frame resource we are about
+	// to reuse.
+	if (mFrameNumber >= mMaxLatency) {
+		uint64_t oldest = (mFrameNumber - mMaxLatency) % mFrameFences.size();
+		WaitFor(mFrameFences[oldest]);
+	}
+	return mFrameIndex;
+}
+
+uint64_t FramePacer::EndFrame() {
+	uint64_t value = mNextValue++;
+	mFence->Signal(value);
+	mFrameFences[mFrameIndex] = value;
+	++mFrameNumber;
+
+	++mStats.FramesSubmitted;
+	uint32_t ahead = CpuAheadFrames();
+	if (ahead > mStats.MaxCpuAheadFrames)
+		mStats.MaxCpuAheadFrames = ahead;
+	return value;
+}
+
+void FramePacer::Flush() {
+	uint64_t value = mNextValue++;
+	mFence->Signal(value);
+	WaitFor(value);
+}
+
+void FramePacer::SetMaxLatency(uint32_t frames) {
+	uint32_t framesInFlight = FramesInFlight();
+	mMaxLatency = frames < 1 ? 1 : (frames > framesInFlight ? framesInFlight : frames);
+}
+
+uint32_t FramePacer::CpuAheadFrames() const {
+	uint64_t completed = mFence->CompletedValue();
+	uint32_t ahead = 0;
+	for (uint64_t value : mFrameFences) {
+		if (value > completed)
+			++ahead;
+	}
+	return ahead;
+}
+
+void FramePacer::WaitFor(uint64_t value) {
+	if (value == 0 || mFence->CompletedValue() >= value)
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+	mFence->Wait(value);
+	std::chrono::duration<double> stalled = std::chrono::steady_clock::now() - start;
+
+	++mStats.Stalls;
+	mStats.StallSeconds += stalled.count();
+}
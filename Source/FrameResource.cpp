@@ -1,12 +1,31 @@
 ﻿#include "FreamResource.h"
 
-FrameResource::FrameResource(ID3D12Device *device, UINT passCount, UINT objectCount) {
+FrameResource::FrameResource(ID3D12Device *device, UINT objectCount, UINT threadCount, UINT64 uploadPageSize) {
 	ThrowIfFailed(device->CreateCommandAllocator(
 			D3D12_COMMAND_LIST_TYPE_DIRECT,
 			IID_PPV_ARGS(CmdListAlloc.GetAddressOf())));
 
-	PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
-	ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true);
+	ThreadCmdListAllocs.resize(threadCount);
+	ThreadCmdLists.resize(threadCount);
+	for (UINT i = 0; i < threadCount; ++i) {
+		ThrowIfFailed(device->CreateCommandAllocator(
+				D3D12_COMMAND_LIST_TYPE_DIRECT,
+				IID_PPV_ARGS(ThreadCmdListAllocs[i].GetAddressOf())));
+		ThrowIfFailed(device->CreateCommandList(
+				0,
+				D3D12_COMMAND_LIST_TYPE_DIRECT,
+				ThreadCmdListAllocs[i].Get(),
+				nullptr,
+				IID_PPV_ARGS(ThreadCmdLists[i].GetAddressOf())));
+
+		// Lists start closed; they are reset when the frame records into them.
+		ThreadCmdLists[i]->Close();
+	}
+
+	ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, false);
+
+	UploadPages = std::make_unique<D3D12UploadPageProvider>(device);
+	UploadArena = std::make_unique<LinearAllocator>(UploadPages.get(), uploadPageSize);
 }
 
 FrameResource::~FrameResource() {
@@ -0,0 +1,210 @@
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FRUSTUM_CULLER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+void AabbSoA::Resize(uint32_t count) {
+	CenterX.resize(count);
+	CenterY.resize(count);
+	CenterZ.resize(count);
+	ExtentX.resize(count);
+	ExtentY.resize(count);
+	ExtentZ.resize(count);
+}
+
+void AabbSoA::PushBack(const Float3 &center, const Float3 &extents) {
+	CenterX.push_back(center.x);
+	CenterY.push_back(center.y);
+	CenterZ.push_back(center.z);
+	ExtentX.push_back(extents.x);
+	ExtentY.push_back(extents.y);
+	ExtentZ.push_back(extents.z);
+}
+
+void AabbSoA::PopBack() {
+	CenterX.pop_back();
+	CenterY.pop_back();
+	CenterZ.pop_back();
+	ExtentX.pop_back();
+	ExtentY.pop_back();
+	ExtentZ.pop_back();
+}
+
+void AabbSoA::Set(uint32_t index, const Float3 &center, const Float3 &extents) {
+	CenterX[index] = center.x;
+	CenterY[index] = center.y;
+	CenterZ[index] = center.z;
+	ExtentX[index] = extents.x;
+	ExtentY[index] = extents.y;
+	ExtentZ[index] = extents.z;
+}
+
+void AabbSoA::Copy(uint32_t dst, uint32_t src) {
+	CenterX[dst] = CenterX[src];
+	CenterY[dst] = CenterY[src];
+	CenterZ[dst] = CenterZ[src];
+	ExtentX[dst] = ExtentX[src];
+	ExtentY[dst] = ExtentY[src];
+	ExtentZ[dst] = ExtentZ[src];
+}
+
+void TransformAabb(const Float3 &center, const Float3 &extents, const Float4x4 &world,
+		Float3 &outCenter, Float3 &outExtents) {
+	// New center is the transformed center; new extents are the old extents
+	// projected onto each world axis through |M| (Arvo).
+	const float(*m)[4] = world.m;
+	outCenter.x = center.x * m[0][0] + center.y * m[1][0] + center.z * m[2][0] + m[3][0];
+	outCenter.y = center.x * m[0][1] + center.y * m[1][1] + center.z * m[2][1] + m[3][1];
+	outCenter.z = center.x * m[0][2] + center.y * m[1][2] + center.z * m[2][2] + m[3][2];
+	outExtents.x = extents.x * std::fabs(m[0][0]) + extents.y * std::fabs(m[1][0]) + extents.z * std::fabs(m[2][0]);
+	outExtents.y = extents.x * std::fabs(m[0][1]) + extents.y * std::fabs(m[1][1]) + extents.z * std::fabs(m[2][1]);
+	outExtents.z = extents.x * std::fabs(m[0][2]) + extents.y * std::fabs(m[1][2]) + extents.z * std::fabs(m[2][2]);
+}
+
+static Float4 MakePlane(const Float4x4 &m, int col, float sign) {
+	// column 3 + sign * column col
+	Float4 p;
+	p.x = m.m[0][3] + sign * m.m[0][col];
+	p.y = m.m[1][3] + sign * m.m[1][col];
+	p.z = m.m[2][3] + sign * m.m[2][col];
+	p.w = m.m[3][3] + sign * m.m[3][col];
+	return p;
+}
+
+Frustum Frustum::FromViewProj(const Float4x4 &viewProj) {
+	// Gribb/Hartmann: with row vectors, clip = v * M, so each clip coordinate
+	// is a dot product with one column of M.
+	Frustum f;
+	f.Planes[0] = MakePlane(viewProj, 0, 1.0f);  // left:   w + x >= 0
+	f.Planes[1] = MakePlane(viewProj, 0, -1.0f); // right:  w - x >= 0
+	f.Planes[2] = MakePlane(viewProj, 1, 1.0f);  // bottom: w + y >= 0
+	f.Planes[3] = MakePlane(viewProj, 1, -1.0f); // top:    w - y >= 0
+	f.Planes[4] = { viewProj.m[0][2], viewProj.m[1][2], viewProj.m[2][2], viewProj.m[3][2] }; // near: z >= 0
+	f.Planes[5] = MakePlane(viewProj, 2, -1.0f); // far:    w - z >= 0
+
+	for (Float4 &p : f.Planes) {
+		float len = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+		if (len > 0.0f) {
+			p.x /= len;
+			p.y /= len;
+			p.z /= len;
+			p.w /= len;
+		}
+	}
+	return f;
+}
+
+static bool BoxVisible(const Frustum &frustum, const AabbSoA &boxes, uint32_t i) {
+	for (const Float4 &p : frustum.Planes) {
+		float dist = p.x * boxes.CenterX[i] + p.y * boxes.CenterY[i] + p.z * boxes.CenterZ[i] + p.w;
+		float radius = std::fabs(p.x) * boxes.ExtentX[i] + std::fabs(p.y) * boxes.ExtentY[i] + std::fabs(p.z) * boxes.ExtentZ[i];
+		if (dist + radius < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+uint32_t CullAabbRange(const Frustum &frustum, const AabbSoA &boxes, uint32_t first, uint32_t count,
+		uint32_t *outVisible) {
+	uint32_t written = 0;
+	uint32_t i = first;
+	uint32_t end = first + count;
+
+#if defined(FRUSTUM_CULLER_SSE2)
+	__m128 nx[6], ny[6], nz[6], ax[6], ay[6], az[6], nd[6];
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	for (int p = 0; p < 6; ++p) {
+		const Float4 &plane = frustum.Planes[p];
+		nx[p] = _mm_set1_ps(plane.x);
+		ny[p] = _mm_set1_ps(plane.y);
+		nz[p] = _mm_set1_ps(plane.z);
+		nd[p] = _mm_set1_ps(plane.w);
+		ax[p] = _mm_and_ps(nx[p], absMask);
+		ay[p] = _mm_and_ps(ny[p], absMask);
+		az[p] = _mm_and_ps(nz[p], absMask);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	for (; i + 4 <= end; i += 4) {
+		__m128 cx = _mm_loadu_ps(&boxes.CenterX[i]);
+		__m128 cy = _mm_loadu_ps(&boxes.CenterY[i]);
+		__m128 cz = _mm_loadu_ps(&boxes.CenterZ[i]);
+		__m128 ex = _mm_loadu_ps(&boxes.ExtentX[i]);
+		__m128 ey = _mm_loadu_ps(&boxes.ExtentY[i]);
+		__m128 ez = _mm_loadu_ps(&boxes.ExtentZ[i]);
+
+		// A box is outside if it is entirely behind any one plane.
+		__m128 outside = zero;
+		for (int p = 0; p < 6; ++p) {
+			__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)),
+					_mm_add_ps(_mm_mul_ps(nz[p], cz), nd[p]));
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dist, radius), zero));
+		}
+
+		int visibleMask = ~_mm_movemask_ps(outside) & 0xf;
+		while (visibleMask != 0) {
+			int bit = 0;
+			while ((visibleMask & (1 << bit)) == 0)
+				++bit;
+			outVisible[written++] = i + bit;
+			visibleMask &= visibleMask - 1;
+		}
+	}
+#endif
+
+	for (; i < end; ++i) {
+		if (BoxVisible(frustum, boxes, i))
+			outVisible[written++] = i;
+	}
+	return written;
+}
+
+FrustumCuller::FrustumCuller(JobSystem *jobs, uint32_t minBoxesPerChunk) :
+		mJobs(jobs),
+		mMinBoxesPerChunk(std::max<uint32_t>(minBoxesPerChunk, 4)) {
+}
+
+uint32_t FrustumCuller::Cull(const Frustum &frustum, const AabbSoA &boxes, std::vector<uint32_t> &outVisible) {
+	uint32_t total = boxes.Size();
+	outVisible.resize(total);
+	if (total == 0)
+		return 0;
+
+	// Every chunk writes its survivors at the start of its own slice of the
+	// output, then the slices are packed together in order.
+	uint32_t threads = mJobs != nullptr ? mJobs->ThreadCount() : 1;
+	uint32_t chunkCount = std::min(threads, (total + mMinBoxesPerChunk - 1) / mMinBoxesPerChunk);
+	chunkCount = std::max(chunkCount, 1u);
+	uint32_t chunkSize = ((total + chunkCount - 1) / chunkCount + 3) & ~3u;
+	chunkCount = (total + chunkSize - 1) / chunkSize;
+	mChunkCounts.assign(chunkCount, 0);
+
+	auto cullChunks = [&](uint32_t firstChunk, uint32_t count) {
+		for (uint32_t chunk = firstChunk; chunk < firstChunk + count; ++chunk) {
+			uint32_t first = chunk * chunkSize;
+			uint32_t boxCount = std::min(chunkSize, total - first);
+			mChunkCounts[chunk] = CullAabbRange(frustum, boxes, first, boxCount, outVisible.data() + first);
+		}
+	};
+
+	if (mJobs != nullptr && chunkCount > 1)
+		mJobs->ParallelFor(chunkCount, 1, cullChunks);
+	else
+		cullChunks(0, chunkCount);
+
+	uint32_t visible = mChunkCounts[0];
+	for (uint32_t chunk = 1; chunk < chunkCount; ++chunk) {
+		uint32_t count = mChunkCounts[chunk];
+		memmove(outVisible.data() + visible, outVisible.data() + chunk * chunkSize, count * sizeof(uint32_t));
+		visible += count;
+	}
+	outVisible.resize(visible);
+	return visible;
+}
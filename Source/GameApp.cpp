@@ -1,25 +1,78 @@
 ﻿#include "GameApp.h"
 
+// Forwards sorted draw packets to a D3D12 command list.  Packet state indices
+// refer to the app's pipeline and geometry tables.  Each draw points the
+// instance root SRV at its slice of the frame's instance list.
+class CommandListDrawSink : public IDrawCommandSink {
+public:
+	CommandListDrawSink(ID3D12GraphicsCommandList *cmdList, ID3D12PipelineState *const *pipelines,
+			MeshGeometry *const *geometries, D3D12_GPU_VIRTUAL_ADDRESS instanceAddress) :
+			mCmdList(cmdList), mPipelines(pipelines), mGeometries(geometries),
+			mInstanceAddress(instanceAddress) {}
+
+	void SetPipeline(uint32_t pipeline) override {
+		mCmdList->SetPipelineState(mPipelines[pipeline]);
+	}
+	void SetMaterial(uint32_t material) override {
+		// Materials have no root parameters yet; nothing to bind.
+	}
+	void SetMesh(uint32_t mesh) override {
+		MeshGeometry *geo = mGeometries[mesh];
+		mCmdList->IASetVertexBuffers(0, 1, get_rvalue_ptr(geo->VertexBufferView()));
+		mCmdList->IASetIndexBuffer(get_rvalue_ptr(geo->IndexBufferView()));
+	}
+	void SetPrimitiveType(uint32_t primitiveType) override {
+		mCmdList->IASetPrimitiveTopology(static_cast<D3D12_PRIMITIVE_TOPOLOGY>(primitiveType));
+	}
+	void Draw(const DrawPacket &packet) override {
+		mCmdList->SetGraphicsRootShaderResourceView(1, mInstanceAddress + packet.FirstInstance * sizeof(uint32_t));
+		mCmdList->DrawIndexedInstanced(packet.IndexCount, packet.InstanceCount, packet.StartIndexLocation, packet.BaseVertexLocation, 0);
+	}
+
+private:
+	ID3D12GraphicsCommandList *mCmdList;
+	ID3D12PipelineState *const *mPipelines;
+	MeshGeometry *const *mGeometries;
+	D3D12_GPU_VIRTUAL_ADDRESS mInstanceAddress;
+};
+
+
 GameApp::GameApp(HINSTANCE hInstance) :
 		D3DApp(hInstance) {
+	mJobs = std::make_unique<JobSystem>();
+	mCuller.SetJobSystem(mJobs.get());
 }
 
 GameApp::~GameApp() {
+	if (mPsoCache != nullptr)
+		mPsoCache->SaveLibrary();
+
+	// Shader builds and mesh decodes run on mJobs.
+	mShaderBuilds.reset();
+	mMeshStreamer.reset();
+	d3dUtil::SetShaderCache(nullptr);
+
+	// Every variant this run drew with has been requested by now, so what
+	// was not is stale.
+	if (mShaderCache != nullptr)
+		mShaderCache->Save();
 }
 
 bool GameApp::Initialize() {
 	if (!D3DApp::Initialize())
 		return false;
 	ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
-	BuildDescriptorHeaps();
-	BuildConstantBuffers();
+	mPsoCache = std::make_unique<PipelineStateCache>(md3dDevice.Get(), L"PipelineCache.bin");
 	BuildRootSignature();
 	BuildShadersAndInputLayout();
-	BuildFrameResources();
 	BuildBoxGeometry();
+	BuildRenderItems();
+	BuildMeshStreaming();
+	BuildFrameResources();
 	BuildPSO();
 
 	ThrowIfFailed(mCommandList->Close());
+	mCopyQueue->WaitOnQueue(mCommandQueue.Get(), mUploads->Flush());
 	ID3D12CommandList *cmdLists[] = { mCommandList.Get() };
 	mCommandQueue->ExecuteCommandLists(_countof(cmdLists), cmdLists);
 
@@ -29,7 +82,25 @@ bool GameApp::Initialize() {
 
 void GameApp::OnResize() {
 	D3DApp::OnResize();
-	XMMATRIX p = XMMatrixPerspectiveFovLH(0.25f * MathHelper::Pi, AspectRatio(), 1.0, 1000.0f);
+
+	// Pipelines bake in the sample count.  Forget the ones built for the old
+	// MSAA state; GetPipeline finds them in the PSO cache if it comes back.
+	if (mPipelinesMsaaState != m4xMsaaState) {
+		mPipelinesMsaaState = m4xMsaaState;
+		mPipelines.clear();
+		mPipelineByVariant.clear();
+	}
+
+	// The swap chain buffers and the graph's transients were all recreated.
+	mResourceStates = ResourceStateTable();
+	for (int i = 0; i < SwapChainBufferCount; ++i)
+		mResourceStates.Register(mSwapChainBuffer[i].Get(), ResourceState::Present);
+	for (uint32_t i = 0; i < mFrameGraph.ResourceCount(); ++i) {
+		if (mGraphResources[i] != nullptr)
+			mResourceStates.Register(mGraphResources[i], mFrameGraph.InitialState({ i }));
+	}
+
+	XMMATRIX p = XMMatrixPerspectiveFovLH(0.25f * MathHelper::Pi, AspectRatio(), gNearZ, gFarZ);
 	XMStoreFloat4x4(&mProj, p);
 }
 
@@ -38,51 +109,228 @@ void GameApp::Update(const GameTimer &gt) {
 	float z = mRadius * sin(mPhi) * sin(mTheta);
 	float y = mRadius * cos(mPhi);
 
+	mEyePos = XMFLOAT3(x, y, z);
 	XMVECTOR pos = XMVectorSet(x, y, z, 1.0f);
 	XMVECTOR target = XMVectorZero();
 	XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
 
 	XMMATRIX view = XMMatrixLookAtLH(pos, target, up);
 	XMStoreFloat4x4(&mView, view);
-	XMMATRIX world = XMLoadFloat4x4(&mWorld);
-	XMMATRIX proj = XMLoadFloat4x4(&mProj);
-	XMMATRIX worldViewProj = world * view * proj;
 
-	mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
+	// Blocks only if the CPU is more than the latency target ahead of the GPU.
+	mCurrFrameResourceIndex = mFramePacer->BeginFrame();
 	mCurrFrameResource = mFrameResources[mCurrFrameResourceIndex].get();
 
-	if (mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence) {
-		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-		ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-		WaitForSingleObject(eventHandle, INFINITE);
-		CloseHandle(eventHandle);
+	// The GPU is done with this frame resource, so its upload memory can be reused.
+	mCurrFrameResource->UploadArena->Reset();
+	mSrvHeap->Retire(mFrameFence->CompletedValue());
+	mUploads->Retire();
+	mBindless->Retire(mFrameFence->CompletedValue());
+
+	UpdateMeshStreaming();
+}
+
+void GameApp::BuildMeshStreaming() {
+	// Mesh files are mapped and uploaded from the mapping, with no decoding.
+	mMeshStreamer = std::make_unique<MeshStreamer>(nullptr, mJobs.get());
+
+	// OBJ files are converted to binary meshes the first time they are seen,
+	// and again whenever they or the mesh format change; only the binary
+	// meshes are streamed.  They are cooked for the box's pipeline: packed
+	// positions, colored by their normals.
+	MeshCookDesc cook;
+	cook.Attributes = gBoxAttributes;
+	cook.Packed = true;
+	std::error_code ec;
+	std::vector<std::filesystem::path> meshes;
+	for (const auto &file : std::filesystem::directory_iterator("Models", ec)) {
+		if (file.path().extension() != ".obj")
+			continue;
+
+		std::filesystem::path meshPath = file.path();
+		meshPath.replace_extension(".mesh");
+		std::error_code timeError;
+		auto meshTime = std::filesystem::last_write_time(meshPath, timeError);
+		if (timeError || meshTime < file.last_write_time(timeError) || !IsCurrentMeshFile(meshPath.string(), cook)) {
+			std::string error;
+			if (!ConvertObjToMeshFile(file.path().string(), meshPath.string(), cook, error)) {
+				OutputDebugStringA((error + "\n").c_str());
+				continue;
+			}
+		}
+		meshes.push_back(meshPath);
+	}
+	for (const std::filesystem::path &path : meshes)
+		mMeshStreamer->Request(path.string());
+}
+
+void GameApp::UpdateMeshStreaming() {
+	// Last frame's culling result still indexes the items: they are only
+	// created and destroyed below.  Visible meshes are touched so they stay
+	// resident, and visible evicted ones are requested again.
+	std::vector<uint8_t> visible(mRitems->Size(), 0);
+	for (uint32_t i : mVisibleRitems)
+		visible[i] = 1;
+	for (auto &[handle, streamed] : mStreamedMeshes) {
+		bool inView = std::any_of(streamed.Items.begin(), streamed.Items.end(),
+				[&](const StreamedItem &item) { return visible[mRitems->IndexOf(item.Item)] != 0; });
+		if (!inView)
+			continue;
+		if (streamed.Geo != nullptr)
+			mMeshStreamer->Touch(handle);
+		else if (mMeshStreamer->Residency(handle) == MeshResidency::Unloaded)
+			mMeshStreamer->Request(mMeshStreamer->Path(handle));
 	}
 
-	ObjectConstants objConstants;
-	XMStoreFloat4x4(&objConstants.WorldViewProj, XMMatrixTranspose(worldViewProj));
-	objConstants.color = XMFLOAT4(0.0, 1.0, 0.0, 1.0);
-	mObjectCB->CopyData(0, objConstants);
+	// Cap what is uploaded per frame so a burst of loads does not hitch.
+	const uint64_t maxUploadBytesPerFrame = 16ull << 20;
+	std::vector<StreamedMesh> loaded;
+	if (mMeshStreamer->Poll(loaded, maxUploadBytesPerFrame) != 0) {
+		for (StreamedMesh &mesh : loaded) {
+			if (mesh.IsLoaded() && (mesh.View.Header->Attributes != gBoxAttributes || !mesh.View.IsPacked()))
+				mesh.Error = "not cooked for the scene pipeline";
+			if (!mesh.Error.empty()) {
+				std::string msg = mMeshStreamer->Path(mesh.Handle) + ": " + mesh.Error + "\n";
+				OutputDebugStringA(msg.c_str());
+				continue;
+			}
+			// The upload copies out of the mapping, which is closed after.
+			BuildStreamedRenderItems(mesh.Handle, mesh.View);
+		}
+		// This frame's draws run after the uploads.
+		mCopyQueue->WaitOnQueue(mCommandQueue.Get(), mUploads->Flush());
+	}
+
+	std::vector<MeshHandle> evicted;
+	mMeshStreamer->Evict(evicted);
+	for (MeshHandle handle : evicted) {
+		StreamedMeshItems &streamed = mStreamedMeshes[handle];
+		for (StreamedItem &item : streamed.Items) {
+			mRitems->SetDrawArgs(item.Item, 0, 0);
+			item.Lods.clear();
+		}
+		mGeometries[streamed.GeoIndex] = nullptr;
+		mRetiredGeos.emplace_back(mFramePacer->LastSignaledValue(), std::move(streamed.Geo));
+	}
+	while (!mRetiredGeos.empty() && mRetiredGeos.front().first <= mFrameFence->CompletedValue())
+		mRetiredGeos.pop_front();
+}
+
+void GameApp::BuildStreamedRenderItems(MeshHandle handle, const MeshFileView &mesh) {
+	StreamedMeshItems &streamed = mStreamedMeshes[handle];
+	if (streamed.Geo == nullptr && streamed.Items.empty()) {
+		streamed.GeoIndex = static_cast<uint32_t>(mGeometries.size());
+		mGeometries.push_back(nullptr);
+	}
+	streamed.Geo = d3dUtil::CreateMeshGeometry(md3dDevice.Get(), *mUploads, mesh);
+	streamed.Geo->Name = mMeshStreamer->Path(handle);
+	mGeometries[streamed.GeoIndex] = streamed.Geo.get();
+
+	// A reload may come from a changed file, so its items are made afresh.
+	for (const StreamedItem &item : streamed.Items)
+		mRitems->Destroy(item.Item);
+	streamed.Items.clear();
+
+	// Scaled into a 2 unit cube and placed in a row through the box,
+	// alternating between its sides.
+	XMVECTOR lo = XMVectorReplicate(FLT_MAX), hi = XMVectorReplicate(-FLT_MAX);
+	uint32_t subsetCount = mesh.Header->SubsetCount;
+	for (uint32_t i = 0; i < subsetCount; ++i) {
+		const MeshFileSubset &subset = mesh.Subsets[i];
+		if (subset.LodLevel != 0)
+			continue;
+		lo = XMVectorMin(lo, XMLoadFloat3(reinterpret_cast<const XMFLOAT3 *>(subset.BoundsMin)));
+		hi = XMVectorMax(hi, XMLoadFloat3(reinterpret_cast<const XMFLOAT3 *>(subset.BoundsMax)));
+	}
+	XMVECTOR size = hi - lo;
+	float extent = std::max({ XMVectorGetX(size), XMVectorGetY(size), XMVectorGetZ(size) });
+	streamed.WorldScale = extent > 0.0f ? 2.0f / extent : 1.0f;
+	float side = handle % 2 == 0 ? 1.0f : -1.0f;
+	XMMATRIX place = XMMatrixTranslationFromVector(-0.5f * (lo + hi)) *
+			XMMatrixScalingFromVector(XMVectorReplicate(streamed.WorldScale)) *
+			XMMatrixTranslation(side * 3.0f * (handle / 2 + 1), 0.0f, 0.0f);
+
+	auto submeshOf = [&](uint32_t i) -> const SubmeshGeometry & {
+		std::string name(mesh.SubsetName(i));
+		return streamed.Geo->DrawArgs[name.empty() ? "subset" + std::to_string(i) : name];
+	};
+	for (uint32_t i = 0; i < subsetCount; ++i) {
+		const MeshFileSubset &subset = mesh.Subsets[i];
+		if (subset.LodLevel != 0 || subset.IndexCount == 0)
+			continue;
+		const SubmeshGeometry &submesh = submeshOf(i);
+		// Positions are quantized per subset; dequantize in the world matrix.
+		RenderItemDesc desc;
+		XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4 *>(&desc.World),
+				XMLoadFloat4x4(&submesh.PositionTransform) * place);
+		desc.GeoIndex = streamed.GeoIndex;
+		desc.PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		desc.IndexCount = submesh.IndexCount;
+		desc.StartIndexLocation = submesh.StartIndexLocation;
+		desc.BaseVertexLocation = submesh.BaseVertexLocation;
+		desc.BoundsCenter = *reinterpret_cast<const Float3 *>(&submesh.Bounds.Center);
+		desc.BoundsExtents = *reinterpret_cast<const Float3 *>(&submesh.Bounds.Extents);
+		StreamedItem item;
+		item.Item = mRitems->Create(desc);
+		if (!item.Item.IsValid())
+			break;
+
+		// The subset's chain follows it (BuildLodChain).
+		item.Lods.push_back(&submesh);
+		item.LodErrors.push_back(0.0f);
+		for (uint32_t lod = i + 1; lod < subsetCount && mesh.Subsets[lod].LodLevel != 0; ++lod) {
+			item.Lods.push_back(&submeshOf(lod));
+			item.LodErrors.push_back(mesh.Subsets[lod].LodError);
+		}
+		streamed.Items.push_back(std::move(item));
+	}
+}
+
+void GameApp::SelectStreamedLods(float projectionScale) {
+	// Coarsest level whose error stays under a pixel, measured from the
+	// nearest point of the item's bounding sphere.
+	const AabbSoA &bounds = mRitems->WorldBounds();
+	XMVECTOR eye = XMLoadFloat3(&mEyePos);
+	mStreamedTriangles = 0;
+	mStreamedFullTriangles = 0;
+	for (auto &[handle, streamed] : mStreamedMeshes) {
+		if (streamed.Geo == nullptr)
+			continue;
+		for (StreamedItem &item : streamed.Items) {
+			uint32_t i = mRitems->IndexOf(item.Item);
+			XMVECTOR center = XMVectorSet(bounds.CenterX[i], bounds.CenterY[i], bounds.CenterZ[i], 0.0f);
+			XMVECTOR extents = XMVectorSet(bounds.ExtentX[i], bounds.ExtentY[i], bounds.ExtentZ[i], 0.0f);
+			float distance = XMVectorGetX(XMVector3Length(center - eye)) - XMVectorGetX(XMVector3Length(extents));
+			item.Lod = SelectLod(item.LodErrors.data(), static_cast<uint32_t>(item.LodErrors.size()), distance,
+					streamed.WorldScale, projectionScale);
+			const SubmeshGeometry *lod = item.Lods[item.Lod];
+			mRitems->SetDrawArgs(item.Item, lod->IndexCount, lod->StartIndexLocation);
+			mStreamedTriangles += lod->IndexCount / 3;
+			mStreamedFullTriangles += item.Lods[0]->IndexCount / 3;
+		}
+	}
 }
 
 void GameApp::Draw(const GameTimer &gt) {
 	// Reuse the memory associated with command recording.
-	// We can only reset when the associated command lists have finished execution on the GPU.
-	ThrowIfFailed(mDirectCmdListAlloc->Reset());
+	// We can only reset when the associated command lists have finished execution on the GPU,
+	// which the frame pacer guaranteed for this frame resource in Update.
+	auto cmdListAlloc = mCurrFrameResource->CmdListAlloc;
+	ThrowIfFailed(cmdListAlloc->Reset());
 
 	// A command list can be reset after it has been added to the command queue via ExecuteCommandList.
 	// Reusing the command list reuses memory.
-	ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), mPSO.Get()));
+	ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), nullptr));
 
 	ImGui_ImplDX12_NewFrame();
 	ImGui_ImplWin32_NewFrame();
 	ImGui::NewFrame();
 
-	XMVECTORF32 clearColor = Colors::LightSteelBlue;
+	mClearColor = Colors::LightSteelBlue;
 	{
 		static float tx = 0.0f, ty = 0.0f, phi = 0.0f, theta = 0.0f, scale = 1.0f, fov = XM_PIDIV2;
 		float dt = gt.DeltaTime();
 		static bool animateCube = true, customColor = false;
-		ObjectConstants objConstants;
 		if (animateCube) {
 			phi += 0.3f * dt, theta += 0.37f * dt;
 			phi = XMScalarModAngle(phi);
@@ -108,13 +356,30 @@ void GameApp::Draw(const GameTimer &gt) {
 			ImGui::Text("FOV: %.2f degrees", XMConvertToDegrees(fov));
 			ImGui::SliderFloat("##3", &fov, XM_PIDIV4, XM_PI / 3 * 2, "");
 
+			int maxLatency = static_cast<int>(mFramePacer->MaxLatency());
+			if (ImGui::SliderInt("Max Frame Latency", &maxLatency, 1, gNumFrameResources)) {
+				mFramePacer->SetMaxLatency(static_cast<uint32_t>(maxLatency));
+			}
+			ImGui::Text("CPU ahead: %u frames (stalls: %llu)", mFramePacer->CpuAheadFrames(),
+					static_cast<unsigned long long>(mFramePacer->Stats().Stalls));
+			ImGui::Text("Visible items: %u / %u", static_cast<UINT>(mVisibleRitems.size()), mRitems->Size());
+			ImGui::Text("Draws: %u (instanced from %u), state changes avoided: %u",
+					mDrawStats.Draws, mInstanceStats.InputDraws, mDrawStats.AvoidedChanges);
+			auto streamedResident = std::count_if(mStreamedMeshes.begin(), mStreamedMeshes.end(),
+					[](const auto &streamed) { return streamed.second.Geo != nullptr; });
+			ImGui::Text("Streamed meshes: %u resident, %u loading, %.1f / %.1f MB",
+					static_cast<UINT>(streamedResident), mMeshStreamer->LoadsInFlight(),
+					mMeshStreamer->ResidentBytes() / 1048576.0, mMeshStreamer->BudgetBytes() / 1048576.0);
+			ImGui::Text("Streamed triangles: %llu (%llu at full detail)",
+					static_cast<unsigned long long>(mStreamedTriangles),
+					static_cast<unsigned long long>(mStreamedFullTriangles));
+
 			if (ImGui::Checkbox("Use Custom Color", &customColor)) {
 				// objConstants.useCustomColor = static_cast<uint32_t>(customColor);
 			}
 			if (customColor) {
 				ImGui::ColorEdit3("ClearColor", reinterpret_cast<float *>(&ccolor));
-				objConstants.color = XMFLOAT4(ccolor.x, ccolor.y, ccolor.z, ccolor.w);
-				clearColor = { ccolor.x, ccolor.y, ccolor.z, ccolor.w };
+				mClearColor = { ccolor.x, ccolor.y, ccolor.z, ccolor.w };
 			}
 		}
 		ImGui::End();
@@ -123,61 +388,50 @@ void GameApp::Draw(const GameTimer &gt) {
 					XMMatrixScalingFromVector(XMVectorReplicate(scale)) *
 					XMMatrixRotationX(phi) * XMMatrixRotationY(theta) *
 					XMMatrixTranslation(tx, ty, 0.0f);
-			XMMATRIX proj = XMMatrixPerspectiveFovLH(fov, AspectRatio(), 1.0f, 1000.0f);
-			XMStoreFloat4x4(&mWorld, world);
+			XMMATRIX proj = XMMatrixPerspectiveFovLH(fov, AspectRatio(), gNearZ, gFarZ);
 			XMStoreFloat4x4(&mProj, proj);
-			XMMATRIX view = XMLoadFloat4x4(&mView);
-			XMMATRIX mvp = world * view * proj;
-			XMStoreFloat4x4(&objConstants.WorldViewProj, XMMatrixTranspose(mvp));
-			objConstants.useCustomColor = static_cast<uint32_t>(customColor);
-			objConstants.color = XMFLOAT4(ccolor.x - 0.5f, ccolor.y, ccolor.z, ccolor.w);
-			mObjectCB->CopyData(0, objConstants);
+
+			// The box's positions are quantized; dequantize in the world matrix.
+			XMMATRIX dequantize = XMLoadFloat4x4(&mBoxGeo->DrawArgs["box"].PositionTransform);
+			Float4x4 boxWorld;
+			XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4 *>(&boxWorld), dequantize * world);
+			mRitems->SetWorld(mBoxRitem, boxWorld);
+			mRitems->SetColor(mBoxRitem, { ccolor.x - 0.5f, ccolor.y, ccolor.z, ccolor.w });
+
+			SelectStreamedLods(mClientHeight / (2.0f * tanf(fov * 0.5f)));
+
+			// Custom color is a shader variant rather than a per-object flag.
+			uint64_t vsVariant = mColorShaderOptions.Set(0, mCustomColorOption, customColor ? 1 : 0);
+			mScenePipeline = GetPipeline(vsVariant);
 		}
 	}
 
+	// Constant packing and culling only read the scene, so they run side by side;
+	// culling splits itself further across the workers.  The draw queue is built
+	// from the culling result as soon as it is ready.
+	UpdateMainPassCB(gt);
+	JobCounter frameJobs, cullJobs;
+	mJobs->Run([this]() { UpdateObjectCBs(); }, &frameJobs);
+	mJobs->Run([this]() { CullRenderItems(); }, &cullJobs);
+	mJobs->RunAfter(cullJobs, [this]() { BuildDrawQueue(); }, &frameJobs);
+	mJobs->Wait(frameJobs);
+
 	bool show_demo_window = true;
 	// ImGui::ShowDemoWindow(&show_demo_window);
 	ImGui::Render();
 
-	mCommandList->RSSetViewports(1, &mScreenViewport);
-	mCommandList->RSSetScissorRects(1, &mScissorRect);
-
-	// Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, get_rvalue_ptr(CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET)));
-
-	// Clear the back buffer and depth buffer.
-	mCommandList->ClearRenderTargetView(CurrentBackBufferView(), clearColor, 0, nullptr);
-	mCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
-
-	// Specify the buffers we are going to render to.
-	mCommandList->OMSetRenderTargets(1, get_rvalue_ptr(CurrentBackBufferView()), true, get_rvalue_ptr(DepthStencilView()));
-
-	ID3D12DescriptorHeap *descriptorHeaps[] = { mCbvHeap.Get() };
-	mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-
-	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
-
-	mCommandList->IASetVertexBuffers(0, 1, get_rvalue_ptr(mBoxGeo->VertexBufferView()));
-	mCommandList->IASetIndexBuffer(get_rvalue_ptr(mBoxGeo->IndexBufferView()));
-	mCommandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-	mCommandList->SetGraphicsRootDescriptorTable(0, mCbvHeap->GetGPUDescriptorHandleForHeapStart());
-
-	mCommandList->DrawIndexedInstanced(
-			mBoxGeo->DrawArgs["box"].IndexCount,
-			1, 0, 0, 0);
-	mCommandList->SetDescriptorHeaps(1, mImguiHeap.GetAddressOf());
-	ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), mCommandList.Get());
-
-	// Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, get_rvalue_ptr(CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT)));
-
-	// Done recording commands.
-	ThrowIfFailed(mCommandList->Close());
-
-	// Add the command list to the queue for execution.
-	ID3D12CommandList *cmdsLists[] = { mCommandList.Get() };
-	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+	// Clear, scene and UI passes; barriers come from the compiled graph.
+	mGraphResources[mGraphBackBuffer.Index] = CurrentBackBuffer();
+	mFrameGraph.Execute();
+
+	// Submit everything in recording order with a single call.
+	std::vector<ID3D12CommandList *> cmdsLists;
+	cmdsLists.reserve(mDrawListCount + 2);
+	cmdsLists.push_back(mCommandList.Get());
+	for (UINT i = 0; i < mDrawListCount; ++i)
+		cmdsLists.push_back(mCurrFrameResource->ThreadCmdLists[i].Get());
+	cmdsLists.push_back(mPostCommandList.Get());
+	mCommandQueue->ExecuteCommandLists(static_cast<UINT>(cmdsLists.size()), cmdsLists.data());
 	// swap the back and front buffers
 	ThrowIfFailed(mSwapChain->Present(0, 0));
 	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
@@ -187,8 +441,97 @@ void GameApp::Draw(const GameTimer &gt) {
 	// so we do not have to wait per frame.
 
 	//FlushCommandQueue();
-	mCurrFrameResource->Fence = ++mCurrentFence;
-	mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+	uint64_t frameFence = mFramePacer->EndFrame();
+	mSrvHeap->FinishFrame(frameFence);
+	mBindless->FinishFrame(frameFence);
+}
+
+void GameApp::CreateDepthStencilBuffer() {
+	// The depth buffer only lives from the clear to the end of the scene, so
+	// it is a transient of the frame graph rather than a committed resource.
+	D3D12_RESOURCE_DESC depthDesc = DepthStencilDesc();
+	BuildFrameGraph(D3D12TransientResources::Describe(md3dDevice.Get(), depthDesc));
+
+	std::vector<D3D12_RESOURCE_DESC> descs(mFrameGraph.ResourceCount());
+	std::vector<D3D12_CLEAR_VALUE> clearValues(mFrameGraph.ResourceCount());
+	descs[mGraphDepthBuffer.Index] = depthDesc;
+	clearValues[mGraphDepthBuffer.Index] = DepthStencilClearValue();
+	mGraphTransients.Create(md3dDevice.Get(), mFrameGraph, descs, clearValues);
+
+	mGraphResources.assign(mFrameGraph.ResourceCount(), nullptr);
+	for (uint32_t i = 0; i < mFrameGraph.ResourceCount(); ++i)
+		mGraphResources[i] = mGraphTransients.Resource({ i });
+	mDepthStencilBuffer = mGraphTransients.Resource(mGraphDepthBuffer);
+	CreateDepthStencilView(mDepthStencilBuffer.Get());
+}
+
+void GameApp::BuildFrameGraph(const RenderGraphResourceDesc &depthDesc) {
+	mFrameGraph.Reset();
+	mGraphBackBuffer = mFrameGraph.Import("BackBuffer", ResourceState::Present, ResourceState::Present);
+	mGraphDepthBuffer = mFrameGraph.CreateTransient("DepthBuffer", depthDesc);
+
+	// Clear the back buffer and depth buffer.
+	uint32_t clearPass = mFrameGraph.AddPass("Clear", [this](const RenderGraphPassContext &context) {
+		D3D12BarrierCommandList barrierList(mCommandList.Get());
+		TrackBarriers(mMainBarriers, context.Before, context.BeforeCount, mGraphResources.data());
+		mMainBarriers.Flush(barrierList);
+		mCommandList->ClearRenderTargetView(CurrentBackBufferView(), mClearColor, 0, nullptr);
+		mCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+		TrackBarriers(mMainBarriers, context.After, context.AfterCount, mGraphResources.data());
+	});
+	mFrameGraph.Write(clearPass, mGraphBackBuffer, ResourceState::RenderTarget);
+	mFrameGraph.Write(clearPass, mGraphDepthBuffer, ResourceState::DepthWrite);
+
+	// Record the scene draws in parallel, one command list per chunk.  Its
+	// barriers go at the end of mCommandList, which executes before the chunks;
+	// the ones after it are batched with the UI pass's.
+	uint32_t scenePass = mFrameGraph.AddPass("Scene", [this](const RenderGraphPassContext &context) {
+		D3D12BarrierCommandList barrierList(mCommandList.Get());
+		TrackBarriers(mMainBarriers, context.Before, context.BeforeCount, mGraphResources.data());
+		mMainBarriers.Finish(barrierList);
+		ThrowIfFailed(mCommandList->Close());
+
+		mDrawListCount = mDrawRecorder->Record(mDrawQueue.Size(),
+				[this](const RecordChunk &chunk) { RecordDrawChunk(chunk); });
+
+		mDrawStats = DrawSubmitStats();
+		for (UINT i = 0; i < mDrawListCount; ++i)
+			mDrawStats += mChunkDrawStats[i];
+
+		// The chunks do no transitions, so the after barriers can move to the
+		// start of the UI pass's list.
+		TrackBarriers(mPostBarriers, context.After, context.AfterCount, mGraphResources.data());
+	});
+	mFrameGraph.ReadWrite(scenePass, mGraphBackBuffer, ResourceState::RenderTarget);
+	mFrameGraph.ReadWrite(scenePass, mGraphDepthBuffer, ResourceState::DepthWrite);
+
+	// The UI goes on top of the scene, so it is recorded into a list that is
+	// executed after all the draw chunks.  The allocator is free again now that
+	// mCommandList is closed.
+	uint32_t uiPass = mFrameGraph.AddPass("UI", [this](const RenderGraphPassContext &context) {
+		ThrowIfFailed(mPostCommandList->Reset(mCurrFrameResource->CmdListAlloc.Get(), nullptr));
+		D3D12BarrierCommandList barrierList(mPostCommandList.Get());
+		TrackBarriers(mPostBarriers, context.Before, context.BeforeCount, mGraphResources.data());
+		mPostBarriers.Flush(barrierList);
+		mPostCommandList->RSSetViewports(1, &mScreenViewport);
+		mPostCommandList->RSSetScissorRects(1, &mScissorRect);
+		// The depth buffer's lifetime ends with the scene pass.
+		mPostCommandList->OMSetRenderTargets(1, get_rvalue_ptr(CurrentBackBufferView()), true, nullptr);
+		ID3D12DescriptorHeap *heaps[] = { mSrvHeap->Heap() };
+		mPostCommandList->SetDescriptorHeaps(_countof(heaps), heaps);
+		ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), mPostCommandList.Get());
+
+		// Back to PRESENT.
+		TrackBarriers(mPostBarriers, context.After, context.AfterCount, mGraphResources.data());
+		mPostBarriers.Finish(barrierList);
+		ThrowIfFailed(mPostCommandList->Close());
+	});
+	mFrameGraph.ReadWrite(uiPass, mGraphBackBuffer, ResourceState::RenderTarget);
+
+	mFrameGraph.Compile();
+#ifdef _DEBUG
+	::OutputDebugStringA(mFrameGraph.Dump().c_str());
+#endif
 }
 
 void GameApp::OnMouseDown(WPARAM btnState, int x, int y) {
@@ -230,35 +573,6 @@ void GameApp::OnMouseMove(WPARAM btnState, int x, int y) {
 	mLastMousePos.y = y;
 }
 
-void GameApp::BuildDescriptorHeaps() {
-	D3D12_DESCRIPTOR_HEAP_DESC cbvHeapDesc;
-	cbvHeapDesc.NumDescriptors = 1;
-	cbvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	cbvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	cbvHeapDesc.NodeMask = 0;
-	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&cbvHeapDesc,
-			IID_PPV_ARGS(&mCbvHeap)));
-}
-
-void GameApp::BuildConstantBuffers() {
-	mObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(md3dDevice.Get(), 1, true);
-
-	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-
-	D3D12_GPU_VIRTUAL_ADDRESS cbAddress = mObjectCB->Resource()->GetGPUVirtualAddress();
-	// Offset to the ith object constant buffer in the buffer.
-	int boxCBufIndex = 0;
-	cbAddress += boxCBufIndex * objCBByteSize;
-
-	D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc;
-	cbvDesc.BufferLocation = cbAddress;
-	cbvDesc.SizeInBytes = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-
-	md3dDevice->CreateConstantBufferView(
-			&cbvDesc,
-			mCbvHeap->GetCPUDescriptorHandleForHeapStart());
-}
-
 void GameApp::BuildRootSignature() {
 	// Shader programs typically require resources as input (constant buffers,
 	// textures, samplers).  The root signature defines the resources the shader
@@ -267,18 +581,27 @@ void GameApp::BuildRootSignature() {
 	// thought of as defining the function signature.
 
 	// Root parameter can be a table, root descriptor or root constants.
-	CD3DX12_ROOT_PARAMETER slotRootParameter[1];
-
-	// Create a single descriptor table of CBVs.
-	CD3DX12_DESCRIPTOR_RANGE cbvTable;
-	cbvTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
-	slotRootParameter[0].InitAsDescriptorTable(1, &cbvTable);
+	CD3DX12_ROOT_PARAMETER slotRootParameter[4];
+
+	// b0: bindless index of the frame's object buffer.
+	// t1: the current draw's slice of the instance list, one object index per
+	// instance, in the frame's upload arena.
+	// t0, space1: the whole bindless table, bound once per command list. The
+	// shader declares it as an unsized array, so the range is unbounded too
+	// (allowed because it is the last range of its table).
+	// b1: the frame's PassConstants, in its upload arena.
+	CD3DX12_DESCRIPTOR_RANGE bindlessRange;
+	bindlessRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 1);
+	slotRootParameter[0].InitAsConstants(1, 0);
+	slotRootParameter[1].InitAsShaderResourceView(1);
+	slotRootParameter[2].InitAsDescriptorTable(1, &bindlessRange);
+	slotRootParameter[3].InitAsConstantBufferView(1);
 
 	// A root signature is an array of root parameters.
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(1, slotRootParameter, 0, nullptr,
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(4, slotRootParameter, 0, nullptr,
 			D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
-	// create a root signature with a single slot which points to a descriptor range consisting of a single constant buffer
+	// create a root signature with a single slot which points to a constant buffer
 	ComPtr<ID3DBlob> serializedRootSig = nullptr;
 	ComPtr<ID3DBlob> errorBlob = nullptr;
 	HRESULT hr = D3D12SerializeRootSignature(&rootSigDesc, D3D_ROOT_SIGNATURE_VERSION_1,
@@ -294,18 +617,38 @@ void GameApp::BuildRootSignature() {
 			serializedRootSig->GetBufferPointer(),
 			serializedRootSig->GetBufferSize(),
 			IID_PPV_ARGS(&mRootSignature)));
+
+	// Pipelines are keyed by the root signature's contents, so they can be
+	// found in the pipeline library on the next run.
+	mPsoCache->RegisterRootSignature(mRootSignature.Get(), serializedRootSig->GetBufferPointer(),
+			serializedRootSig->GetBufferSize());
 }
 
 void GameApp::BuildShadersAndInputLayout() {
 	HRESULT hr = S_OK;
 
-	mvsByteCode = d3dUtil::CompileShader(L"Shaders\\color.hlsl", nullptr, "VS", "vs_5_1");
-	mpsByteCode = d3dUtil::CompileShader(L"Shaders\\color.hlsl", nullptr, "PS", "ps_5_1");
-
-	mInputLayout = {
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-	};
+	// Bytecode is cached on disk keyed by the source, its includes, the
+	// compile options and the compiler build, so warm starts skip the compiler
+	// entirely.
+	mShaderCache = std::make_unique<ShaderCache>(L"ShaderCache.bin", d3dUtil::CompileShaderBytecode,
+			d3dUtil::ShaderCompilerVersion());
+	mShaderCache->Load();
+	d3dUtil::SetShaderCache(mShaderCache.get());
+
+	// Shaders build on the job system while Initialize carries on with the
+	// geometry and frame resources; BuildPSO waits for them.
+	mShaderBuilds = std::make_unique<ShaderBuildQueue>(mJobs.get(), mShaderCache.get());
+	// The vertex shader has compile-time variants.  The default one is built up
+	// front, others compile the first time they are drawn with.
+	mCustomColorOption = mColorShaderOptions.AddBool("USE_CUSTOM_COLOR");
+	mColorVS = std::make_unique<ShaderVariantCache>(&mColorShaderOptions,
+			d3dUtil::MakeShaderCompileRequest(L"Shaders\\color.hlsl", nullptr, "VS", "vs_5_1"), mShaderCache.get(), 16);
+	mVsShader = mShaderBuilds->Enqueue(mColorVS->MakeRequest(0));
+	mPsShader = mShaderBuilds->Enqueue(d3dUtil::MakeShaderCompileRequest(L"Shaders\\color.hlsl", nullptr, "PS", "ps_5_1"));
+
+	// Positions arrive as unorm16 and colors as unorm8; the input assembler
+	// expands both to the floats color.hlsl reads.
+	mInputLayout = MakeInputLayout(MakeVertexLayout(gBoxAttributes, true));
 }
 
 void GameApp::BuildBoxGeometry() {
@@ -346,50 +689,227 @@ void GameApp::BuildBoxGeometry() {
 		4, 3, 7
 	};
 
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+	// Vertex matches the MeshData layout of these attributes.  The box is
+	// drawn from its packed form: 12 instead of 28 bytes per vertex.
+	MeshData mesh;
+	mesh.Name = "boxGeo";
+	mesh.Attributes = gBoxAttributes;
+	mesh.VertexStride = sizeof(Vertex);
+	mesh.VertexCount = (UINT)vertices.size();
+	mesh.Vertices.assign(reinterpret_cast<const uint8_t *>(vertices.data()),
+			reinterpret_cast<const uint8_t *>(vertices.data() + vertices.size()));
+	mesh.IndexByteSize = sizeof(std::uint16_t);
+	mesh.IndexCount = (UINT)indices.size();
+	mesh.Indices.assign(reinterpret_cast<const uint8_t *>(indices.data()),
+			reinterpret_cast<const uint8_t *>(indices.data() + indices.size()));
+
+	MeshSubset subset;
+	subset.Name = "box";
+	subset.IndexCount = mesh.IndexCount;
+	mesh.Subsets.push_back(subset);
+
+	PackedMesh packed;
+	PackMesh(mesh, packed);
+
+	// Both buffers go out in one copy batch; Initialize makes the direct
+	// queue wait for it.
+	mBoxGeo = d3dUtil::CreateMeshGeometry(md3dDevice.Get(), *mUploads, packed);
+}
 
-	mBoxGeo = std::make_unique<MeshGeometry>();
-	mBoxGeo->Name = "boxGeo";
+void GameApp::BuildRenderItems() {
+	mRitems = std::make_unique<RenderItemStore>(gMaxRenderItems, gNumFrameResources);
+	mGeometries.push_back(mBoxGeo.get());
+
+	const SubmeshGeometry &box = mBoxGeo->DrawArgs["box"];
+	RenderItemDesc desc;
+	desc.GeoIndex = 0;
+	desc.PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	desc.IndexCount = box.IndexCount;
+	desc.StartIndexLocation = box.StartIndexLocation;
+	desc.BaseVertexLocation = box.BaseVertexLocation;
+	desc.BoundsCenter = *reinterpret_cast<const Float3 *>(&box.Bounds.Center);
+	desc.BoundsExtents = *reinterpret_cast<const Float3 *>(&box.Bounds.Extents);
+	mBoxRitem = mRitems->Create(desc);
+}
+
+void GameApp::UpdateMainPassCB(const GameTimer &gt) {
+	XMMATRIX view = XMLoadFloat4x4(&mView);
+	XMMATRIX proj = XMLoadFloat4x4(&mProj);
+	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+	XMMATRIX invView = XMMatrixInverse(get_rvalue_ptr(XMMatrixDeterminant(view)), view);
+	XMMATRIX invProj = XMMatrixInverse(get_rvalue_ptr(XMMatrixDeterminant(proj)), proj);
+	XMMATRIX invViewProj = XMMatrixInverse(get_rvalue_ptr(XMMatrixDeterminant(viewProj)), viewProj);
+
+	PassConstants pass;
+	XMStoreFloat4x4(&pass.View, XMMatrixTranspose(view));
+	XMStoreFloat4x4(&pass.InvView, XMMatrixTranspose(invView));
+	XMStoreFloat4x4(&pass.Proj, XMMatrixTranspose(proj));
+	XMStoreFloat4x4(&pass.InvProj, XMMatrixTranspose(invProj));
+	XMStoreFloat4x4(&pass.ViewProj, XMMatrixTranspose(viewProj));
+	XMStoreFloat4x4(&pass.InvViewProj, XMMatrixTranspose(invViewProj));
+	pass.EyePosW = mEyePos;
+	pass.RenderTargetSize = XMFLOAT2((float)mClientWidth, (float)mClientHeight);
+	pass.InvRenderTargetSize = XMFLOAT2(1.0f / mClientWidth, 1.0f / mClientHeight);
+	pass.NearZ = gNearZ;
+	pass.FarZ = gFarZ;
+	pass.TotalTime = gt.TotalTime();
+	pass.DeltaTime = gt.DeltaTime();
+	mPassCBAddress = mCurrFrameResource->UploadArena->Upload(&pass, sizeof(PassConstants)).Gpu;
+}
+
+void GameApp::UpdateObjectCBs() {
+	// Only repack the ranges that changed since this frame resource was last
+	// used.  The camera is in the pass constants, so these are the items that
+	// moved or changed color.  World matrices for a whole range are transposed
+	// in one batch straight into the mapped buffer; colors follow.
+	TransformStreamLayout layout;
+	layout.Stride = mCurrFrameResource->ObjectCB->ElementByteSize();
+	layout.WorldOffset = offsetof(ObjectConstants, world);
+
+	const Float4x4 *worlds = mRitems->World();
+	const Float4 *colors = mRitems->Color();
+	BYTE *mapped = mCurrFrameResource->ObjectCB->MappedData();
+	mRitems->ForEachDirtyRange(mCurrFrameResourceIndex, [&](uint32_t first, uint32_t count) {
+		BatchTransposeWorlds(worlds + first, count, mapped + first * layout.Stride, layout);
+		for (uint32_t i = first; i < first + count; ++i) {
+			BYTE *dst = mapped + i * layout.Stride;
+			memcpy(dst + offsetof(ObjectConstants, color), &colors[i], sizeof(XMFLOAT4));
+		}
+	});
+}
+
+void GameApp::CullRenderItems() {
+	XMMATRIX viewProj = XMLoadFloat4x4(&mView) * XMLoadFloat4x4(&mProj);
+	Float4x4 vp;
+	XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4 *>(&vp), viewProj);
+
+	mCuller.Cull(Frustum::FromViewProj(vp), mRitems->WorldBounds(), mVisibleRitems);
+}
+
+void GameApp::BuildDrawQueue() {
+	mItemQueue.Clear();
+
+	// Sort key depth is the view-space depth of the item's bounds center, so
+	// draws sharing all state go front to back.
+	const AabbSoA &bounds = mRitems->WorldBounds();
+	const XMFLOAT4X4 &v = mView;
+	const uint32_t *geoIndex = mRitems->GeoIndex();
+	const uint32_t *materialIndex = mRitems->MaterialIndex();
+	const uint32_t *primitiveType = mRitems->PrimitiveType();
+	const uint32_t *indexCount = mRitems->IndexCount();
+	const uint32_t *startIndex = mRitems->StartIndexLocation();
+	const int32_t *baseVertex = mRitems->BaseVertexLocation();
+	for (uint32_t i : mVisibleRitems) {
+		// Evicted streamed meshes keep their items, with nothing to draw.
+		if (indexCount[i] == 0)
+			continue;
+		float viewZ = bounds.CenterX[i] * v._13 + bounds.CenterY[i] * v._23 + bounds.CenterZ[i] * v._33 + v._43;
+
+		DrawPacket packet;
+		packet.Pipeline = mScenePipeline;
+		packet.Material = materialIndex[i];
+		packet.Mesh = geoIndex[i];
+		packet.PrimitiveType = primitiveType[i];
+		packet.Object = i;
+		packet.IndexCount = indexCount[i];
+		packet.StartIndexLocation = startIndex[i];
+		packet.BaseVertexLocation = baseVertex[i];
+		packet.Key = SortKey::Make(0, packet.Pipeline, packet.Material, packet.Mesh,
+				SortKey::QuantizeDepth(viewZ, gNearZ, gFarZ));
+		mItemQueue.Push(packet);
+	}
+	mItemQueue.Sort();
+
+	// Items that draw the same submesh the same way become one instanced draw.
+	// The per-instance object indices go into this frame's upload memory.
+	mInstanceStats = mInstanceBatcher.Build(mItemQueue, mDrawQueue);
+	const std::vector<uint32_t> &instances = mInstanceBatcher.Instances();
+	mInstanceData = UploadAllocation();
+	if (!instances.empty()) {
+		mInstanceData = mCurrFrameResource->UploadArena->Upload(instances.data(), instances.size() * sizeof(uint32_t));
+	}
+}
 
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &mBoxGeo->VertexBufferCPU));
-	CopyMemory(mBoxGeo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
+void GameApp::RecordDrawChunk(const RecordChunk &chunk) {
+	// Each chunk owns its allocator and list for this frame, so chunks can be
+	// recorded on any thread.  Command list state does not carry over between
+	// lists, so every chunk sets up the pass state itself.
+	ID3D12CommandAllocator *alloc = mCurrFrameResource->ThreadCmdListAllocs[chunk.ListIndex].Get();
+	ID3D12GraphicsCommandList *cmdList = mCurrFrameResource->ThreadCmdLists[chunk.ListIndex].Get();
+	ThrowIfFailed(alloc->Reset());
+	// The pipeline is bound by the first packet of the chunk.
+	ThrowIfFailed(cmdList->Reset(alloc, nullptr));
 
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &mBoxGeo->IndexBufferCPU));
-	CopyMemory(mBoxGeo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	cmdList->RSSetViewports(1, &mScreenViewport);
+	cmdList->RSSetScissorRects(1, &mScissorRect);
 
-	mBoxGeo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-			mCommandList.Get(), vertices.data(), vbByteSize, mBoxGeo->VertexBufferUploader);
+	// Specify the buffers we are going to render to.
+	cmdList->OMSetRenderTargets(1, get_rvalue_ptr(CurrentBackBufferView()), true, get_rvalue_ptr(DepthStencilView()));
 
-	mBoxGeo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-			mCommandList.Get(), indices.data(), ibByteSize, mBoxGeo->IndexBufferUploader);
+	ID3D12DescriptorHeap *heaps[] = { mSrvHeap->Heap() };
+	cmdList->SetDescriptorHeaps(_countof(heaps), heaps);
+	cmdList->SetGraphicsRootSignature(mRootSignature.Get());
+	cmdList->SetGraphicsRootDescriptorTable(2, mBindless->TableStart());
 
-	mBoxGeo->VertexByteStride = sizeof(Vertex);
-	mBoxGeo->VertexBufferByteSize = vbByteSize;
-	mBoxGeo->IndexFormat = DXGI_FORMAT_R16_UINT;
-	mBoxGeo->IndexBufferByteSize = ibByteSize;
+	// Per-object data for every item; draws index into it through their instances.
+	cmdList->SetGraphicsRoot32BitConstant(0, mCurrFrameResource->ObjectSrv.Index, 0);
+	cmdList->SetGraphicsRootConstantBufferView(3, mPassCBAddress);
 
-	SubmeshGeometry submesh;
-	submesh.IndexCount = (UINT)indices.size();
-	submesh.StartIndexLocation = 0;
-	submesh.BaseVertexLocation = 0;
+	// Chunks cover disjoint ranges of the sorted queue; each starts with no
+	// state bound since it is a fresh list.
+	CommandListDrawSink sink(cmdList, mPipelines.data(), mGeometries.data(), mInstanceData.Gpu);
+	mChunkDrawStats[chunk.ListIndex] = mDrawQueue.Submit(sink, chunk.First, chunk.Count);
 
-	mBoxGeo->DrawArgs["box"] = submesh;
+	ThrowIfFailed(cmdList->Close());
+}
+
+void GameApp::WaitForShaders() {
+	mShaderBuilds->WaitAll();
+	// Keeps the startup shaders if the run dies; variants not requested yet
+	// may still be, so pruning waits for the save on exit.
+	mShaderCache->Save(false);
+
+	const ShaderBuildStats &stats = mShaderBuilds->Stats();
+	ShaderCacheStats cacheStats = mShaderCache->Stats();
+	char msg[160];
+	snprintf(msg, sizeof(msg), "Shaders ready in %.2f ms, %.2f ms of compiling (%u built, %u deduplicated, %u cache hits)\n",
+			stats.WallSeconds * 1000.0, stats.SerialSeconds * 1000.0, stats.Built, stats.Deduplicated, cacheStats.Hits);
+	OutputDebugStringA(msg);
+
+	for (ShaderBuildHandle handle : { mVsShader, mPsShader }) {
+		if (!mShaderBuilds->Succeeded(handle)) {
+			OutputDebugStringA(mShaderBuilds->Errors(handle).c_str());
+			ThrowIfFailed(E_FAIL);
+		}
+	}
 }
 
 void GameApp::BuildPSO() {
+	WaitForShaders();
+	mScenePipeline = GetPipeline(0);
+}
+
+uint32_t GameApp::GetPipeline(uint64_t vsVariant) {
+	auto it = mPipelineByVariant.find(vsVariant);
+	if (it != mPipelineByVariant.end())
+		return it->second;
+
+	// First use of this variant: compile it (or fetch it from the shader cache)
+	// and build its PSO.  The PSO keeps its own copy of the bytecode.
+	std::string errors;
+	ShaderVariantCache::ByteCode vsByteCode = mColorVS->Get(vsVariant, &errors);
+	if (!errors.empty())
+		OutputDebugStringA(errors.c_str());
+	if (vsByteCode == nullptr)
+		ThrowIfFailed(E_FAIL);
+	const std::vector<uint8_t> &psByteCode = mShaderBuilds->ByteCode(mPsShader);
+
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc;
 	ZeroMemory(&psoDesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
 	psoDesc.InputLayout = { mInputLayout.data(), static_cast<UINT>(mInputLayout.size()) };
 	psoDesc.pRootSignature = mRootSignature.Get();
-	psoDesc.VS = {
-		reinterpret_cast<BYTE *>(mvsByteCode->GetBufferPointer()),
-		mvsByteCode->GetBufferSize()
-	};
-	psoDesc.PS = {
-		reinterpret_cast<BYTE *>(mpsByteCode->GetBufferPointer()),
-		mpsByteCode->GetBufferSize()
-	};
+	psoDesc.VS = { vsByteCode->data(), vsByteCode->size() };
+	psoDesc.PS = { psByteCode.data(), psByteCode.size() };
 	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
 	psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
@@ -400,13 +920,33 @@ void GameApp::BuildPSO() {
 	psoDesc.SampleDesc.Count = m4xMsaaState ? 4 : 1;
 	psoDesc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
 	psoDesc.DSVFormat = mDepthStencilFormat;
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&mPSO)));
+	// The PSO cache owns the pipeline; toggling back to an earlier state (or
+	// restarting) finds it there instead of compiling it again.
+	ComPtr<ID3D12PipelineState> pso = mPsoCache->GetOrCreate(psoDesc);
+
+	// Draw packets refer to pipelines by index into mPipelines.
+	uint32_t index = static_cast<uint32_t>(mPipelines.size());
+	mPipelines.push_back(pso.Get());
+	mPipelineByVariant.emplace(vsVariant, index);
+	return index;
 }
 
 void GameApp::BuildFrameResources() {
-	// UINT itemCount = (UINT)mAllRitems.size();
-	UINT itemCount = 1;
+	UINT itemCount = mRitems->Capacity();
+	UINT threadCount = mJobs->ThreadCount();
 	for (int i = 0; i < gNumFrameResources; ++i) {
-		mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(), 1, itemCount));
+		mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(), itemCount, threadCount));
+		mFrameResources.back()->ObjectSrv = mBindless->RegisterStructuredBuffer(
+				mFrameResources.back()->ObjectCB->Resource(), itemCount, sizeof(ObjectConstants));
 	}
+	mDrawRecorder = std::make_unique<ParallelCommandRecorder>(mJobs.get(), threadCount);
+	mChunkDrawStats.resize(threadCount);
+
+	ThrowIfFailed(md3dDevice->CreateCommandList(
+			0,
+			D3D12_COMMAND_LIST_TYPE_DIRECT,
+			mFrameResources[0]->CmdListAlloc.Get(),
+			nullptr,
+			IID_PPV_ARGS(mPostCommandList.GetAddressOf())));
+	mPostCommandList->Close();
 }
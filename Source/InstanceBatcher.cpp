@@ -0,0 +1,67 @@
+#include "InstanceBatcher.h"
+
+size_t InstanceBatcher::DrawIdentityHash::operator()(const DrawIdentity &id) const {
+	// FNV-1a over the fields.
+	uint64_t hash = 14695981039346656037ull;
+	const uint32_t fields[] = {
+		id.Pipeline, id.Material, id.Mesh, id.PrimitiveType,
+		id.IndexCount, id.StartIndexLocation, static_cast<uint32_t>(id.BaseVertexLocation)
+	};
+	for (uint32_t field : fields) {
+		hash ^= field;
+		hash *= 1099511628211ull;
+	}
+	return static_cast<size_t>(hash);
+}
+
+InstanceBatchStats InstanceBatcher::Build(const DrawQueue &input, DrawQueue &output) {
+	uint32_t count = input.Size();
+	mBatchLookup.clear();
+	mBatchOfPacket.resize(count);
+	mBatches.clear();
+
+	// Assign every packet to a batch, counting instances per batch.
+	for (uint32_t i = 0; i < count; ++i) {
+		const DrawPacket &packet = input.Packet(i);
+		DrawIdentity id = {
+			packet.Pipeline, packet.Material, packet.Mesh, packet.PrimitiveType,
+			packet.IndexCount, packet.StartIndexLocation, packet.BaseVertexLocation
+		};
+
+		auto [it, inserted] = mBatchLookup.try_emplace(id, static_cast<uint32_t>(mBatches.size()));
+		if (inserted) {
+			// The first (nearest) packet stands in for the batch, keeping its key.
+			DrawPacket batch = packet;
+			batch.InstanceCount = 0;
+			mBatches.push_back(batch);
+		}
+		mBatches[it->second].InstanceCount += packet.InstanceCount;
+		mBatchOfPacket[i] = it->second;
+	}
+
+	// Lay the batches out back to back in the instance list.
+	uint32_t instanceCount = 0;
+	for (DrawPacket &batch : mBatches) {
+		batch.FirstInstance = instanceCount;
+		instanceCount += batch.InstanceCount;
+		batch.InstanceCount = 0;
+	}
+
+	mInstances.resize(instanceCount);
+	for (uint32_t i = 0; i < count; ++i) {
+		const DrawPacket &packet = input.Packet(i);
+		DrawPacket &batch = mBatches[mBatchOfPacket[i]];
+		for (uint32_t n = 0; n < packet.InstanceCount; ++n)
+			mInstances[batch.FirstInstance + batch.InstanceCount++] = packet.Object + n;
+	}
+
+	output.Clear();
+	output.Reserve(static_cast<uint32_t>(mBatches.size()));
+	for (const DrawPacket &batch : mBatches)
+		output.Push(batch);
+
+	InstanceBatchStats stats;
+	stats.InputDraws = count;
+	stats.OutputDraws = output.Size();
+	return stats;
+}
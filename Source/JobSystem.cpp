@@ -0,0 +1,165 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+// Set on worker threads only. The owner makes the index per job system, so a
+// worker of one that submits to another uses the other's shared queue.
+static thread_local const JobSystem *tThreadOwner = nullptr;
+static thread_local uint32_t tThreadIndex = 0;
+
+JobSystem::JobSystem(uint32_t workerCount) {
+	if (workerCount == 0) {
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	for (uint32_t i = 0; i <= workerCount; ++i)
+		mQueues.push_back(std::make_unique<WorkQueue>());
+
+	mWorkers.reserve(workerCount);
+	for (uint32_t i = 1; i <= workerCount; ++i)
+		mWorkers.emplace_back(&JobSystem::WorkerMain, this, i);
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+		mStopping = true;
+	}
+	mWake.notify_all();
+	for (std::thread &worker : mWorkers)
+		worker.join();
+}
+
+uint32_t JobSystem::ThreadIndex() const {
+	return tThreadOwner == this ? tThreadIndex : 0;
+}
+
+void JobSystem::Run(std::function<void()> job, JobCounter *counter) {
+	if (counter != nullptr)
+		counter->mPending.fetch_add(1, std::memory_order_relaxed);
+	Push(Job{ std::move(job), counter });
+}
+
+void JobSystem::RunAfter(JobCounter &dependency, std::function<void()> job, JobCounter *counter) {
+	if (counter != nullptr)
+		counter->mPending.fetch_add(1, std::memory_order_relaxed);
+
+	{
+		std::lock_guard<std::mutex> lock(dependency.mMutex);
+		if (dependency.mPending.load(std::memory_order_acquire) != 0) {
+			// Queued by whichever job brings the dependency to zero.
+			dependency.mContinuations.push_back([this, job = std::move(job), counter]() mutable {
+				Push(Job{ std::move(job), counter });
+			});
+			return;
+		}
+	}
+	Push(Job{ std::move(job), counter });
+}
+
+void JobSystem::Wait(JobCounter &counter) {
+	while (!counter.IsDone()) {
+		if (!TryRunOne())
+			std::this_thread::yield();
+	}
+
+	// The job that finished the counter decrements it under the lock, so once we
+	// can take the lock nobody touches the counter any more and it may be freed.
+	std::lock_guard<std::mutex> lock(counter.mMutex);
+}
+
+void JobSystem::Push(Job job) {
+	uint32_t index = ThreadIndex();
+	WorkQueue &queue = *mQueues[index];
+
+	// Count first so the counter never drops below the number of queued jobs.
+	mQueuedJobs.fetch_add(1, std::memory_order_release);
+	{
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		queue.Jobs.push_back(std::move(job));
+	}
+
+	// Taking the sleep lock orders this push against a worker that has just
+	// checked for work and is about to sleep, so the wake-up is not lost.
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+	}
+	mWake.notify_one();
+}
+
+bool JobSystem::TryPop(Job &job) {
+	uint32_t index = ThreadIndex();
+	WorkQueue &queue = *mQueues[index];
+	std::lock_guard<std::mutex> lock(queue.Mutex);
+	if (queue.Jobs.empty())
+		return false;
+
+	// Newest first: its data is most likely still in cache.
+	job = std::move(queue.Jobs.back());
+	queue.Jobs.pop_back();
+	return true;
+}
+
+bool JobSystem::TrySteal(uint32_t thief, Job &job) {
+	uint32_t queueCount = static_cast<uint32_t>(mQueues.size());
+	for (uint32_t i = 1; i < queueCount; ++i) {
+		WorkQueue &victim = *mQueues[(thief + i) % queueCount];
+		std::lock_guard<std::mutex> lock(victim.Mutex);
+		if (victim.Jobs.empty())
+			continue;
+
+		// Oldest first: it tends to be the biggest remaining piece of work.
+		job = std::move(victim.Jobs.front());
+		victim.Jobs.pop_front();
+		return true;
+	}
+	return false;
+}
+
+bool JobSystem::TryRunOne() {
+	if (mQueuedJobs.load(std::memory_order_acquire) == 0)
+		return false;
+
+	Job job;
+	uint32_t index = ThreadIndex();
+	if (!TryPop(job) && !TrySteal(index, job))
+		return false;
+
+	mQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	Execute(job);
+	return true;
+}
+
+void JobSystem::Execute(Job &job) {
+	job.Fn();
+
+	JobCounter *counter = job.Counter;
+	if (counter == nullptr)
+		return;
+
+	std::vector<std::function<void()>> continuations;
+	{
+		std::lock_guard<std::mutex> lock(counter->mMutex);
+		if (counter->mPending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			continuations.swap(counter->mContinuations);
+	}
+	for (std::function<void()> &continuation : continuations)
+		continuation();
+}
+
+void JobSystem::WorkerMain(uint32_t index) {
+	tThreadOwner = this;
+	tThreadIndex = index;
+
+	for (;;) {
+		if (TryRunOne())
+			continue;
+
+		std::unique_lock<std::mutex> lock(mSleepMutex);
+		mWake.wait(lock, [this]() {
+			return mStopping || mQueuedJobs.load(std::memory_order_acquire) != 0;
+		});
+		if (mStopping && mQueuedJobs.load(std::memory_order_acquire) == 0)
+			return;
+	}
+}
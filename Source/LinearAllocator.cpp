@@ -0,0 +1,126 @@
+#include "LinearAllocator.h"
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+// Buffer resources are placed on 64KB boundaries, so mirror that here to keep
+// alignment behaviour identical between backends.
+static const uint64_t kMallocPageAlignment = 65536;
+
+UploadPage MallocPageProvider::CreatePage(uint64_t byteSize) {
+	UploadPage page;
+	size_t size = static_cast<size_t>(LinearAllocator::AlignUp(byteSize, kMallocPageAlignment));
+#if defined(_WIN32)
+	page.CpuBase = static_cast<uint8_t *>(_aligned_malloc(size, kMallocPageAlignment));
+#else
+	page.CpuBase = static_cast<uint8_t *>(std::aligned_alloc(kMallocPageAlignment, size));
+#endif
+	assert(page.CpuBase != nullptr);
+	page.GpuBase = reinterpret_cast<uint64_t>(page.CpuBase);
+	page.ByteSize = byteSize;
+	page.Handle = page.CpuBase;
+	return page;
+}
+
+void MallocPageProvider::DestroyPage(UploadPage &page) {
+#if defined(_WIN32)
+	_aligned_free(page.CpuBase);
+#else
+	std::free(page.CpuBase);
+#endif
+	page = UploadPage();
+}
+
+LinearAllocator::LinearAllocator(IUploadPageProvider *provider, uint64_t pageByteSize) :
+		mProvider(provider),
+		mPageByteSize(pageByteSize) {
+	assert(mProvider != nullptr);
+	assert(mPageByteSize > 0);
+	mPages.push_back(mProvider->CreatePage(mPageByteSize));
+}
+
+LinearAllocator::~LinearAllocator() {
+	for (UploadPage &page : mPages)
+		mProvider->DestroyPage(page);
+	for (UploadPage &page : mDedicatedPages)
+		mProvider->DestroyPage(page);
+}
+
+UploadAllocation LinearAllocator::Allocate(uint64_t byteSize, uint64_t alignment) {
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+	assert(alignment <= kMallocPageAlignment);
+
+	UploadAllocation alloc;
+	if (byteSize > mPageByteSize)
+		return AllocateDedicated(byteSize);
+
+	if (!TryAllocateFromCurrent(byteSize, alignment, alloc)) {
+		// Move on to the next page in the chain, growing it under pressure.
+		++mCurrPage;
+		mCurrOffset = 0;
+		if (mCurrPage == mPages.size())
+			mPages.push_back(mProvider->CreatePage(mPageByteSize));
+
+		bool ok = TryAllocateFromCurrent(byteSize, alignment, alloc);
+		assert(ok);
+		(void)ok;
+	}
+	return alloc;
+}
+
+UploadAllocation LinearAllocator::Upload(const void *data, uint64_t byteSize, uint64_t alignment) {
+	UploadAllocation alloc = Allocate(byteSize, alignment);
+	memcpy(alloc.Cpu, data, static_cast<size_t>(byteSize));
+	return alloc;
+}
+
+void LinearAllocator::Reset(size_t maxRetainedPages) {
+	for (UploadPage &page : mDedicatedPages)
+		mProvider->DestroyPage(page);
+	mDedicatedPages.clear();
+
+	if (maxRetainedPages == 0)
+		maxRetainedPages = 1;
+	while (mPages.size() > maxRetainedPages) {
+		mProvider->DestroyPage(mPages.back());
+		mPages.pop_back();
+	}
+
+	mCurrPage = 0;
+	mCurrOffset = 0;
+	mBytesAllocated = 0;
+}
+
+bool LinearAllocator::TryAllocateFromCurrent(uint64_t byteSize, uint64_t alignment, UploadAllocation &out) {
+	const UploadPage &page = mPages[mCurrPage];
+	uint64_t offset = AlignUp(mCurrOffset, alignment);
+	if (offset + byteSize > page.ByteSize)
+		return false;
+
+	out.Cpu = page.CpuBase + offset;
+	out.Gpu = page.GpuBase + offset;
+	out.ByteSize = byteSize;
+	out.PageHandle = page.Handle;
+	out.PageOffset = offset;
+
+	mBytesAllocated += (offset - mCurrOffset) + byteSize;
+	mHighWaterMark = mBytesAllocated > mHighWaterMark ? mBytesAllocated : mHighWaterMark;
+	mCurrOffset = offset + byteSize;
+	return true;
+}
+
+UploadAllocation LinearAllocator::AllocateDedicated(uint64_t byteSize) {
+	mDedicatedPages.push_back(mProvider->CreatePage(byteSize));
+	const UploadPage &page = mDedicatedPages.back();
+
+	UploadAllocation alloc;
+	alloc.Cpu = page.CpuBase;
+	alloc.Gpu = page.GpuBase;
+	alloc.ByteSize = byteSize;
+	alloc.PageHandle = page.Handle;
+	alloc.PageOffset = 0;
+
+	mBytesAllocated += byteSize;
+	mHighWaterMark = mBytesAllocated > mHighWaterMark ? mBytesAllocated : mHighWaterMark;
+	return alloc;
+}
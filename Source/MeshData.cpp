@@ -0,0 +1,270 @@
+#include "MeshData.h"
+#include <charconv>
+#include <cstring>
+#include <unordered_map>
+
+uint32_t MeshVertexStride(uint32_t attributes) {
+	uint32_t stride = 0;
+	if (attributes & MeshAttributePosition)
+		stride += 12;
+	if (attributes & MeshAttributeNormal)
+		stride += 12;
+	if (attributes & MeshAttributeTexCoord)
+		stride += 8;
+	if (attributes & MeshAttributeColor)
+		stride += 16;
+	if (attributes & MeshAttributeTangent)
+		stride += 16;
+	return stride;
+}
+
+uint32_t MeshAttributeOffset(uint32_t attributes, MeshAttribute attribute) {
+	if ((attributes & attribute) == 0)
+		return UINT32_MAX;
+	// Everything before the attribute in declaration order.
+	return MeshVertexStride(attributes & (attribute - 1));
+}
+
+uint32_t MeshData::Index(uint32_t i) const {
+	if (IndexByteSize == 2) {
+		uint16_t index;
+		memcpy(&index, Indices.data() + i * 2, 2);
+		return index;
+	}
+	uint32_t index;
+	memcpy(&index, Indices.data() + i * 4, 4);
+	return index;
+}
+
+struct ObjVertexKey {
+	int32_t Position;
+	int32_t TexCoord;
+	int32_t Normal;
+
+	bool operator==(const ObjVertexKey &rhs) const {
+		return Position == rhs.Position && TexCoord == rhs.TexCoord && Normal == rhs.Normal;
+	}
+};
+
+struct ObjVertexKeyHash {
+	size_t operator()(const ObjVertexKey &key) const {
+		uint64_t h = uint64_t(uint32_t(key.Position)) * 0x9E3779B97F4A7C15ull;
+		h ^= (uint64_t(uint32_t(key.TexCoord)) + 0x632BE59BD9B4E019ull + (h << 6) + (h >> 2));
+		h ^= (uint64_t(uint32_t(key.Normal)) + 0x8CB92BA72F3D8DD7ull + (h << 6) + (h >> 2));
+		return static_cast<size_t>(h);
+	}
+};
+
+struct ObjSubsetStart {
+	std::string Name;
+	size_t FirstCorner;
+};
+
+static const char *SkipSpaces(const char *p, const char *end) {
+	while (p != end && (*p == ' ' || *p == '\t'))
+		++p;
+	return p;
+}
+
+static bool ParseFloats(const char *&p, const char *end, float *values, int count) {
+	for (int i = 0; i < count; ++i) {
+		p = SkipSpaces(p, end);
+		// from_chars does not accept a leading '+'.
+		if (p != end && *p == '+')
+			++p;
+		std::from_chars_result result = std::from_chars(p, end, values[i]);
+		if (result.ec != std::errc())
+			return false;
+		p = result.ptr;
+	}
+	return true;
+}
+
+// OBJ indices are 1-based, or relative to the end of the list when negative.
+static bool ParseIndex(const char *&p, const char *end, size_t count, int32_t &index) {
+	int32_t value = 0;
+	std::from_chars_result result = std::from_chars(p, end, value);
+	if (result.ec != std::errc() || value == 0)
+		return false;
+	p = result.ptr;
+
+	int64_t resolved = value > 0 ? int64_t(value) - 1 : int64_t(count) + value;
+	if (resolved < 0 || resolved >= int64_t(count))
+		return false;
+	index = static_cast<int32_t>(resolved);
+	return true;
+}
+
+static bool ParseCorner(const char *&p, const char *end, size_t positions, size_t texCoords, size_t normals,
+		ObjVertexKey &key) {
+	key = { -1, -1, -1 };
+	if (!ParseIndex(p, end, positions, key.Position))
+		return false;
+	if (p == end || *p != '/')
+		return true;
+	++p;
+	if (p != end && *p != '/') {
+		if (!ParseIndex(p, end, texCoords, key.TexCoord))
+			return false;
+	}
+	if (p == end || *p != '/')
+		return true;
+	++p;
+	return ParseIndex(p, end, normals, key.Normal);
+}
+
+bool DecodeObjMesh(const uint8_t *data, size_t size, MeshData &mesh, std::string &error) {
+	std::vector<float> positions;
+	std::vector<float> texCoords;
+	std::vector<float> normals;
+	std::vector<ObjVertexKey> corners;
+	std::vector<ObjSubsetStart> subsets;
+	std::vector<ObjVertexKey> face;
+
+	const char *text = reinterpret_cast<const char *>(data);
+	const char *end = text + size;
+	uint32_t lineNumber = 0;
+	for (const char *line = text; line < end;) {
+		const char *lineEnd = static_cast<const char *>(memchr(line, '\n', end - line));
+		if (lineEnd == nullptr)
+			lineEnd = end;
+		const char *next = lineEnd + (lineEnd != end ? 1 : 0);
+		if (lineEnd != line && lineEnd[-1] == '\r')
+			--lineEnd;
+		++lineNumber;
+
+		const char *p = SkipSpaces(line, lineEnd);
+		line = next;
+		if (p == lineEnd || *p == '#')
+			continue;
+
+		const char *keyword = p;
+		while (p != lineEnd && *p != ' ' && *p != '\t')
+			++p;
+		size_t keywordLength = p - keyword;
+
+		bool ok = true;
+		if (keywordLength == 1 && keyword[0] == 'v') {
+			float v[3];
+			ok = ParseFloats(p, lineEnd, v, 3);
+			positions.insert(positions.end(), v, v + 3);
+		} else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 't') {
+			float v[2];
+			ok = ParseFloats(p, lineEnd, v, 2);
+			texCoords.insert(texCoords.end(), v, v + 2);
+		} else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 'n') {
+			float v[3];
+			ok = ParseFloats(p, lineEnd, v, 3);
+			normals.insert(normals.end(), v, v + 3);
+		} else if (keywordLength == 1 && keyword[0] == 'f') {
+			face.clear();
+			for (p = SkipSpaces(p, lineEnd); ok && p != lineEnd; p = SkipSpaces(p, lineEnd)) {
+				ObjVertexKey key;
+				ok = ParseCorner(p, lineEnd, positions.size() / 3, texCoords.size() / 2, normals.size() / 3, key);
+				face.push_back(key);
+			}
+			ok = ok && face.size() >= 3;
+			// Fan the polygon into triangles.
+			for (size_t i = 2; ok && i < face.size(); ++i) {
+				corners.push_back(face[0]);
+				corners.push_back(face[i - 1]);
+				corners.push_back(face[i]);
+			}
+		} else if (keywordLength == 1 && (keyword[0] == 'o' || keyword[0] == 'g')) {
+			p = SkipSpaces(p, lineEnd);
+			subsets.push_back({ std::string(p, lineEnd), corners.size() });
+		}
+		// Materials, smoothing groups, lines and points are ignored.
+
+		if (!ok) {
+			error = "malformed statement on line " + std::to_string(lineNumber);
+			return false;
+		}
+	}
+
+	if (corners.empty()) {
+		error = "no faces";
+		return false;
+	}
+
+	mesh = MeshData();
+	mesh.Attributes = MeshAttributePosition;
+	if (!normals.empty())
+		mesh.Attributes |= MeshAttributeNormal;
+	if (!texCoords.empty())
+		mesh.Attributes |= MeshAttributeTexCoord;
+	mesh.VertexStride = MeshVertexStride(mesh.Attributes);
+
+	// One vertex per distinct position/texcoord/normal combination.
+	std::unordered_map<ObjVertexKey, uint32_t, ObjVertexKeyHash> vertexByKey;
+	vertexByKey.reserve(corners.size() / 2);
+	std::vector<uint32_t> indices(corners.size());
+	std::vector<float> vertex(mesh.VertexStride / sizeof(float));
+	for (size_t i = 0; i < corners.size(); ++i) {
+		const ObjVertexKey &key = corners[i];
+		auto [it, inserted] = vertexByKey.try_emplace(key, mesh.VertexCount);
+		indices[i] = it->second;
+		if (!inserted)
+			continue;
+
+		float *out = vertex.data();
+		memcpy(out, &positions[key.Position * 3], 12);
+		out += 3;
+		if (mesh.Attributes & MeshAttributeNormal) {
+			if (key.Normal >= 0)
+				memcpy(out, &normals[key.Normal * 3], 12);
+			else
+				out[0] = out[1] = out[2] = 0.0f;
+			out += 3;
+		}
+		if (mesh.Attributes & MeshAttributeTexCoord) {
+			if (key.TexCoord >= 0)
+				memcpy(out, &texCoords[key.TexCoord * 2], 8);
+			else
+				out[0] = out[1] = 0.0f;
+		}
+		const uint8_t *bytes = reinterpret_cast<const uint8_t *>(vertex.data());
+		mesh.Vertices.insert(mesh.Vertices.end(), bytes, bytes + mesh.VertexStride);
+		++mesh.VertexCount;
+	}
+
+	mesh.IndexCount = static_cast<uint32_t>(indices.size());
+	mesh.IndexByteSize = mesh.VertexCount <= 65536 ? 2 : 4;
+	mesh.Indices.resize(size_t(mesh.IndexCount) * mesh.IndexByteSize);
+	for (uint32_t i = 0; i < mesh.IndexCount; ++i) {
+		if (mesh.IndexByteSize == 2) {
+			uint16_t index = static_cast<uint16_t>(indices[i]);
+			memcpy(&mesh.Indices[i * 2], &index, 2);
+		} else {
+			memcpy(&mesh.Indices[i * 4], &indices[i], 4);
+		}
+	}
+
+	// Faces before the first o/g go in an unnamed subset.
+	if (subsets.empty() || subsets[0].FirstCorner != 0)
+		subsets.insert(subsets.begin(), { std::string(), 0 });
+	for (size_t s = 0; s < subsets.size(); ++s) {
+		size_t first = subsets[s].FirstCorner;
+		size_t last = s + 1 < subsets.size() ? subsets[s + 1].FirstCorner : corners.size();
+		if (first == last)
+			continue;
+
+		MeshSubset subset;
+		subset.Name = subsets[s].Name;
+		subset.StartIndex = static_cast<uint32_t>(first);
+		subset.IndexCount = static_cast<uint32_t>(last - first);
+		for (int axis = 0; axis < 3; ++axis) {
+			subset.BoundsMin[axis] = positions[corners[first].Position * 3 + axis];
+			subset.BoundsMax[axis] = subset.BoundsMin[axis];
+		}
+		for (size_t i = first; i < last; ++i) {
+			const float *position = &positions[corners[i].Position * 3];
+			for (int axis = 0; axis < 3; ++axis) {
+				subset.BoundsMin[axis] = position[axis] < subset.BoundsMin[axis] ? position[axis] : subset.BoundsMin[axis];
+				subset.BoundsMax[axis] = position[axis] > subset.BoundsMax[axis] ? position[axis] : subset.BoundsMax[axis];
+			}
+		}
+		mesh.Subsets.push_back(std::move(subset));
+	}
+	return true;
+}
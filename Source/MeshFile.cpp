@@ -0,0 +1,286 @@
+#include "MeshFile.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include <cstdio>
+#include <cstring>
+
+static uint64_t AlignStream(uint64_t offset) {
+	return (offset + MeshFileStreamAlignment - 1) & ~uint64_t(MeshFileStreamAlignment - 1);
+}
+
+bool IsMeshFile(const uint8_t *data, size_t size) {
+	uint32_t magic = 0;
+	if (size < sizeof(MeshFileHeader))
+		return false;
+	memcpy(&magic, data, sizeof(magic));
+	return magic == MeshFileMagic;
+}
+
+bool IsCurrentMeshFile(const std::string &path, const MeshCookDesc &desc) {
+	MappedFile file;
+	MeshFileView view;
+	std::string error;
+	if (!file.Open(path) || !ParseMeshFile(file.Data(), file.Size(), view, error))
+		return false;
+	return (desc.Attributes == 0 || view.Header->Attributes == desc.Attributes) && view.IsPacked() == desc.Packed;
+}
+
+static uint32_t VertexStrideOf(const MeshFileHeader &header) {
+	if (header.Flags & MeshFilePacked)
+		return MakeVertexLayout(header.Attributes, true).Stride;
+	return MeshVertexStride(header.Attributes);
+}
+
+static bool InRange(uint64_t offset, uint64_t byteSize, uint64_t size) {
+	return offset <= size && byteSize <= size - offset;
+}
+
+bool ParseMeshFile(const uint8_t *data, size_t size, MeshFileView &view, std::string &error) {
+	if (!IsMeshFile(data, size)) {
+		error = "not a mesh file";
+		return false;
+	}
+	// Mapped files are page aligned; anything else must at least keep the
+	// header's 64-bit fields aligned.
+	if (reinterpret_cast<uintptr_t>(data) % alignof(MeshFileHeader) != 0) {
+		error = "mesh data is misaligned";
+		return false;
+	}
+
+	const MeshFileHeader *header = reinterpret_cast<const MeshFileHeader *>(data);
+	if (header->Version != MeshFileVersion) {
+		error = "unsupported mesh file version " + std::to_string(header->Version);
+		return false;
+	}
+	if (header->FileSize != size || (header->IndexByteSize != 2 && header->IndexByteSize != 4) ||
+			(header->Flags & ~MeshFilePacked) != 0 || header->VertexStride != VertexStrideOf(*header)) {
+		error = "corrupt mesh file header";
+		return false;
+	}
+
+	uint64_t vertexBytes = uint64_t(header->VertexCount) * header->VertexStride;
+	uint64_t indexBytes = uint64_t(header->IndexCount) * header->IndexByteSize;
+	if (!InRange(header->SubsetOffset, uint64_t(header->SubsetCount) * sizeof(MeshFileSubset), size) ||
+			header->SubsetOffset % alignof(MeshFileSubset) != 0 ||
+			!InRange(header->NameOffset, header->NameByteSize, size) ||
+			!InRange(header->VertexOffset, vertexBytes, size) || header->VertexOffset % MeshFileStreamAlignment != 0 ||
+			!InRange(header->IndexOffset, indexBytes, size) || header->IndexOffset % MeshFileStreamAlignment != 0) {
+		error = "mesh file is truncated";
+		return false;
+	}
+
+	view.Header = header;
+	view.Subsets = reinterpret_cast<const MeshFileSubset *>(data + header->SubsetOffset);
+	view.Names = reinterpret_cast<const char *>(data + header->NameOffset);
+	view.Vertices = data + header->VertexOffset;
+	view.Indices = data + header->IndexOffset;
+
+	for (uint32_t i = 0; i < header->SubsetCount; ++i) {
+		const MeshFileSubset &subset = view.Subsets[i];
+		if (!InRange(subset.NameOffset, subset.NameLength, header->NameByteSize) ||
+				!InRange(subset.StartIndex, subset.IndexCount, header->IndexCount)) {
+			error = "corrupt mesh subset " + std::to_string(i);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Lays the file out around the streams. header has the vertex and index
+// format filled in; quantization is null for unpacked meshes.
+static void SerializeStreams(MeshFileHeader header, const std::vector<MeshSubset> &sourceSubsets,
+		const PackedSubset *quantization, const std::vector<uint8_t> &vertices, const std::vector<uint8_t> &indices,
+		std::vector<uint8_t> &bytes) {
+	header.Magic = MeshFileMagic;
+	header.Version = MeshFileVersion;
+	header.SubsetCount = static_cast<uint32_t>(sourceSubsets.size());
+
+	std::vector<MeshFileSubset> subsets(sourceSubsets.size());
+	std::string names;
+	for (size_t i = 0; i < sourceSubsets.size(); ++i) {
+		const MeshSubset &source = sourceSubsets[i];
+		MeshFileSubset &subset = subsets[i];
+		subset = {};
+		subset.IndexCount = source.IndexCount;
+		subset.StartIndex = source.StartIndex;
+		subset.BaseVertex = source.BaseVertex;
+		subset.NameOffset = static_cast<uint32_t>(names.size());
+		subset.NameLength = static_cast<uint32_t>(source.Name.size());
+		memcpy(subset.BoundsMin, source.BoundsMin, sizeof(subset.BoundsMin));
+		memcpy(subset.BoundsMax, source.BoundsMax, sizeof(subset.BoundsMax));
+		subset.LodLevel = source.LodLevel;
+		subset.LodError = source.LodError;
+		for (int c = 0; c < 3; ++c) {
+			subset.PositionScale[c] = quantization != nullptr ? quantization[i].PositionScale[c] : 1.0f;
+			subset.PositionOffset[c] = quantization != nullptr ? quantization[i].PositionOffset[c] : 0.0f;
+		}
+		names += source.Name;
+	}
+
+	header.SubsetOffset = sizeof(MeshFileHeader);
+	header.NameOffset = header.SubsetOffset + subsets.size() * sizeof(MeshFileSubset);
+	header.NameByteSize = names.size();
+	header.VertexOffset = AlignStream(header.NameOffset + header.NameByteSize);
+	header.IndexOffset = AlignStream(header.VertexOffset + vertices.size());
+	header.FileSize = AlignStream(header.IndexOffset + indices.size());
+
+	bytes.assign(static_cast<size_t>(header.FileSize), 0);
+	memcpy(bytes.data(), &header, sizeof(header));
+	if (!subsets.empty())
+		memcpy(bytes.data() + header.SubsetOffset, subsets.data(), subsets.size() * sizeof(MeshFileSubset));
+	if (!names.empty())
+		memcpy(bytes.data() + header.NameOffset, names.data(), names.size());
+	if (!vertices.empty())
+		memcpy(bytes.data() + header.VertexOffset, vertices.data(), vertices.size());
+	if (!indices.empty())
+		memcpy(bytes.data() + header.IndexOffset, indices.data(), indices.size());
+}
+
+void SerializeMeshFile(const MeshData &mesh, std::vector<uint8_t> &bytes) {
+	MeshFileHeader header = {};
+	header.Attributes = mesh.Attributes;
+	header.VertexStride = mesh.VertexStride;
+	header.VertexCount = mesh.VertexCount;
+	header.IndexByteSize = mesh.IndexByteSize;
+	header.IndexCount = mesh.IndexCount;
+	SerializeStreams(header, mesh.Subsets, nullptr, mesh.Vertices, mesh.Indices, bytes);
+}
+
+void SerializeMeshFile(const PackedMesh &mesh, std::vector<uint8_t> &bytes) {
+	MeshFileHeader header = {};
+	for (const VertexElement &element : mesh.Layout.Elements)
+		header.Attributes |= element.Attribute;
+	header.Flags = MeshFilePacked;
+	header.VertexStride = mesh.Layout.Stride;
+	header.VertexCount = mesh.VertexCount;
+	header.IndexByteSize = mesh.IndexByteSize;
+	header.IndexCount = mesh.IndexCount;
+	SerializeStreams(header, mesh.Subsets, mesh.Quantization.data(), mesh.Vertices, mesh.Indices, bytes);
+}
+
+static bool WriteFileBytes(const std::string &path, const std::vector<uint8_t> &bytes, std::string &error) {
+	// Write to a temporary and rename, so a crash never leaves a torn file.
+	std::string tempPath = path + ".tmp";
+	FILE *file = fopen(tempPath.c_str(), "wb");
+	if (file == nullptr) {
+		error = "cannot create " + tempPath;
+		return false;
+	}
+	bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+	written = fclose(file) == 0 && written;
+	std::remove(path.c_str());
+	if (!written || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+		std::remove(tempPath.c_str());
+		error = "cannot write " + path;
+		return false;
+	}
+	return true;
+}
+
+bool WriteMeshFile(const std::string &path, const MeshData &mesh, std::string &error) {
+	std::vector<uint8_t> bytes;
+	SerializeMeshFile(mesh, bytes);
+	return WriteFileBytes(path, bytes, error);
+}
+
+bool WriteMeshFile(const std::string &path, const PackedMesh &mesh, std::string &error) {
+	std::vector<uint8_t> bytes;
+	SerializeMeshFile(mesh, bytes);
+	return WriteFileBytes(path, bytes, error);
+}
+
+bool DecodeMeshFile(const uint8_t *data, size_t size, MeshData &mesh, std::string &error) {
+	MeshFileView view;
+	if (!ParseMeshFile(data, size, view, error))
+		return false;
+	if (view.IsPacked()) {
+		error = "mesh file is packed";
+		return false;
+	}
+
+	const MeshFileHeader &header = *view.Header;
+	mesh = MeshData();
+	mesh.Attributes = header.Attributes;
+	mesh.VertexStride = header.VertexStride;
+	mesh.VertexCount = header.VertexCount;
+	mesh.IndexByteSize = header.IndexByteSize;
+	mesh.IndexCount = header.IndexCount;
+	mesh.Vertices.assign(view.Vertices, view.Vertices + view.VertexByteSize());
+	mesh.Indices.assign(view.Indices, view.Indices + view.IndexByteSize());
+	mesh.Subsets.resize(header.SubsetCount);
+	for (uint32_t i = 0; i < header.SubsetCount; ++i) {
+		const MeshFileSubset &source = view.Subsets[i];
+		MeshSubset &subset = mesh.Subsets[i];
+		subset.Name = view.SubsetName(i);
+		subset.IndexCount = source.IndexCount;
+		subset.StartIndex = source.StartIndex;
+		subset.BaseVertex = source.BaseVertex;
+		memcpy(subset.BoundsMin, source.BoundsMin, sizeof(subset.BoundsMin));
+		memcpy(subset.BoundsMax, source.BoundsMax, sizeof(subset.BoundsMax));
+		subset.LodLevel = source.LodLevel;
+		subset.LodError = source.LodError;
+	}
+	return true;
+}
+
+// Rewrites the vertices with exactly the given attributes, filling in the
+// ones the mesh lacks as MeshCookDesc describes.
+static void ConvertAttributes(MeshData &mesh, uint32_t attributes) {
+	if (attributes == 0 || attributes == mesh.Attributes)
+		return;
+
+	std::vector<uint8_t> source = std::move(mesh.Vertices);
+	uint32_t sourceAttributes = mesh.Attributes;
+	uint32_t sourceStride = mesh.VertexStride;
+	uint32_t normalOffset = MeshAttributeOffset(sourceAttributes, MeshAttributeNormal);
+	mesh.Attributes = attributes;
+	mesh.VertexStride = MeshVertexStride(attributes);
+	mesh.Vertices.assign(size_t(mesh.VertexCount) * mesh.VertexStride, 0);
+	for (uint32_t v = 0; v < mesh.VertexCount; ++v) {
+		const uint8_t *src = source.data() + size_t(v) * sourceStride;
+		uint8_t *dst = mesh.Vertices.data() + size_t(v) * mesh.VertexStride;
+		for (uint32_t attribute = 1; attribute <= MeshAttributeTangent; attribute <<= 1) {
+			if ((attributes & attribute) == 0)
+				continue;
+			MeshAttribute element = static_cast<MeshAttribute>(attribute);
+			uint8_t *to = dst + MeshAttributeOffset(attributes, element);
+			if (sourceAttributes & attribute) {
+				memcpy(to, src + MeshAttributeOffset(sourceAttributes, element), MeshVertexStride(attribute));
+			} else if (attribute == MeshAttributeColor) {
+				float color[4] = { 0.6f, 0.6f, 0.6f, 1.0f };
+				if (normalOffset != UINT32_MAX) {
+					float normal[3];
+					memcpy(normal, src + normalOffset, sizeof(normal));
+					for (int c = 0; c < 3; ++c)
+						color[c] = normal[c] * 0.5f + 0.5f;
+				}
+				memcpy(to, color, sizeof(color));
+			}
+		}
+	}
+}
+
+bool ConvertObjToMeshFile(const std::string &objPath, const std::string &meshPath, const MeshCookDesc &desc,
+		std::string &error) {
+	MappedFile obj;
+	if (!obj.Open(objPath)) {
+		error = "cannot read " + objPath;
+		return false;
+	}
+
+	MeshData mesh;
+	if (!DecodeObjMesh(obj.Data(), obj.Size(), mesh, error)) {
+		error = objPath + ": " + error;
+		return false;
+	}
+	ConvertAttributes(mesh, desc.Attributes);
+	OptimizeMesh(mesh);
+	BuildLodChain(mesh);
+	if (!desc.Packed)
+		return WriteMeshFile(meshPath, mesh, error);
+
+	PackedMesh packed;
+	PackMesh(mesh, packed);
+	return WriteMeshFile(meshPath, packed, error);
+}
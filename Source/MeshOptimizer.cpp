@@ -0,0 +1,443 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Returns how many of the triangle's vertices missed a FIFO cache of
+// cacheSize entries. A vertex is cached if it was transformed within the last
+// cacheSize misses; timestamps hold each vertex's miss count when it was last
+// transformed and timestamp is the running miss count.
+static uint32_t UpdateFifoCache(const uint32_t *triangle, uint32_t cacheSize, uint32_t *timestamps,
+		uint32_t &timestamp) {
+	uint32_t misses = 0;
+	for (int k = 0; k < 3; ++k) {
+		uint32_t v = triangle[k];
+		if (timestamp - timestamps[v] > cacheSize) {
+			timestamps[v] = timestamp++;
+			++misses;
+		}
+	}
+	return misses;
+}
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t *indices, size_t indexCount, size_t vertexCount,
+		uint32_t cacheSize) {
+	VertexCacheStats stats;
+	std::vector<uint32_t> timestamps(vertexCount, 0);
+	std::vector<bool> used(vertexCount, false);
+	uint32_t timestamp = cacheSize + 1;
+	uint32_t unique = 0;
+
+	for (size_t i = 0; i + 2 < indexCount; i += 3) {
+		stats.VerticesTransformed += UpdateFifoCache(indices + i, cacheSize, timestamps.data(), timestamp);
+		for (int k = 0; k < 3; ++k) {
+			if (!used[indices[i + k]]) {
+				used[indices[i + k]] = true;
+				++unique;
+			}
+		}
+	}
+	stats.Triangles = static_cast<uint32_t>(indexCount / 3);
+	if (stats.Triangles != 0)
+		stats.Acmr = float(stats.VerticesTransformed) / float(stats.Triangles);
+	if (unique != 0)
+		stats.Atvr = float(stats.VerticesTransformed) / float(unique);
+	return stats;
+}
+
+float AnalyzeVertexFetch(const uint32_t *indices, size_t indexCount, size_t vertexCount, size_t vertexStride) {
+	// A small fully associative LRU cache of lines, roughly what one shader
+	// core's vertex fetch sees.
+	const size_t LineSize = 64;
+	const size_t LineCount = 64;
+
+	size_t lines[LineCount];
+	uint64_t lastUse[LineCount];
+	size_t lineCount = 0;
+	uint64_t clock = 0;
+	uint64_t bytesFetched = 0;
+	std::vector<bool> used(vertexCount, false);
+	uint64_t bytesUsed = 0;
+
+	for (size_t i = 0; i < indexCount; ++i) {
+		uint32_t v = indices[i];
+		if (!used[v]) {
+			used[v] = true;
+			bytesUsed += vertexStride;
+		}
+
+		size_t first = v * vertexStride / LineSize;
+		size_t last = (v * vertexStride + vertexStride - 1) / LineSize;
+		for (size_t line = first; line <= last; ++line) {
+			++clock;
+			size_t slot = 0;
+			while (slot < lineCount && lines[slot] != line)
+				++slot;
+			if (slot == lineCount) {
+				bytesFetched += LineSize;
+				if (lineCount < LineCount) {
+					++lineCount;
+				} else {
+					slot = 0;
+					for (size_t s = 1; s < LineCount; ++s)
+						if (lastUse[s] < lastUse[slot])
+							slot = s;
+				}
+				lines[slot] = line;
+			}
+			lastUse[slot] = clock;
+		}
+	}
+	return bytesUsed != 0 ? float(double(bytesFetched) / double(bytesUsed)) : 0.0f;
+}
+
+// Forsyth, "Linear-Speed Vertex Cache Optimisation". Vertices are scored by
+// their position in a simulated LRU cache and by how few triangles they have
+// left, so the greedy pass both reuses cached vertices and finishes off
+// vertices before they are evicted.
+static const uint32_t ScoreCacheSize = 32;
+static const float CacheDecayPower = 1.5f;
+static const float LastTriangleScore = 0.75f;
+static const float ValenceBoostScale = 2.0f;
+static const float ValenceBoostPower = 0.5f;
+static const uint32_t MaxValenceScored = 32;
+
+struct VertexScoreTable {
+	float Cache[ScoreCacheSize];
+	float Valence[MaxValenceScored + 1];
+
+	VertexScoreTable() {
+		for (uint32_t i = 0; i < ScoreCacheSize; ++i) {
+			// The last triangle's three vertices score the same no matter
+			// which order they went in.
+			if (i < 3)
+				Cache[i] = LastTriangleScore;
+			else
+				Cache[i] = powf(1.0f - float(i - 3) / float(ScoreCacheSize - 3), CacheDecayPower);
+		}
+		Valence[0] = 0.0f;
+		for (uint32_t i = 1; i <= MaxValenceScored; ++i)
+			Valence[i] = ValenceBoostScale * powf(float(i), -ValenceBoostPower);
+	}
+
+	float Score(int32_t cachePosition, uint32_t remaining) const {
+		if (remaining == 0)
+			return -1.0f;
+		float score = cachePosition >= 0 ? Cache[cachePosition] : 0.0f;
+		return score + Valence[remaining < MaxValenceScored ? remaining : MaxValenceScored];
+	}
+};
+
+void OptimizeVertexCache(uint32_t *destination, const uint32_t *indices, size_t indexCount, size_t vertexCount) {
+	static const VertexScoreTable table;
+
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangles adjacent to each vertex, as a compact array with offsets.
+	// Counts shrink as triangles are emitted so only live ones are scanned.
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+		++remaining[indices[i]];
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v)
+		offsets[v + 1] = offsets[v] + remaining[v];
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+		vertexScore[v] = table.Score(-1, remaining[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	for (size_t t = 0; t < triangleCount; ++t)
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] +
+				vertexScore[indices[t * 3 + 2]];
+	std::vector<bool> emitted(triangleCount, false);
+
+	// The cache holds the scored entries plus room for the three vertices
+	// pushed by the triangle being emitted.
+	uint32_t cache[ScoreCacheSize + 3];
+	uint32_t cacheNext[ScoreCacheSize + 3];
+	uint32_t cacheCount = 0;
+
+	size_t inputCursor = 0;
+	size_t bestTriangle = 0;
+	float bestScore = triangleScore[0];
+	for (size_t t = 1; t < triangleCount; ++t) {
+		if (triangleScore[t] > bestScore) {
+			bestScore = triangleScore[t];
+			bestTriangle = t;
+		}
+	}
+
+	for (size_t output = 0; output < triangleCount; ++output) {
+		if (bestScore < 0.0f) {
+			// Nothing in the cache touches an unemitted triangle: restart
+			// from the next one in input order.
+			while (emitted[inputCursor])
+				++inputCursor;
+			bestTriangle = inputCursor;
+		}
+
+		const uint32_t *triangle = indices + bestTriangle * 3;
+		memcpy(destination + output * 3, triangle, 3 * sizeof(uint32_t));
+		emitted[bestTriangle] = true;
+
+		// Move the triangle's vertices to the front of the cache, and drop it
+		// from their adjacency lists.
+		uint32_t nextCount = 0;
+		for (int k = 0; k < 3; ++k) {
+			uint32_t v = triangle[k];
+			if (k == 0 || (v != triangle[0] && (k == 1 || v != triangle[1])))
+				cacheNext[nextCount++] = v;
+
+			uint32_t *begin = adjacency.data() + offsets[v];
+			uint32_t *end = begin + remaining[v];
+			uint32_t *found = std::find(begin, end, static_cast<uint32_t>(bestTriangle));
+			*found = end[-1];
+			--remaining[v];
+		}
+		for (uint32_t i = 0; i < cacheCount; ++i) {
+			uint32_t v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				cacheNext[nextCount++] = v;
+		}
+
+		// Rescore everything that was or is in the cache; the triangles
+		// around those vertices are the candidates for the next pick.
+		for (uint32_t i = 0; i < nextCount; ++i) {
+			uint32_t v = cacheNext[i];
+			int32_t position = i < ScoreCacheSize ? int32_t(i) : -1;
+
+			float score = table.Score(position, remaining[v]);
+			float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+			const uint32_t *adjacent = adjacency.data() + offsets[v];
+			for (uint32_t a = 0; a < remaining[v]; ++a)
+				triangleScore[adjacent[a]] += delta;
+		}
+
+		bestScore = -1.0f;
+		for (uint32_t i = 0; i < nextCount && i < ScoreCacheSize; ++i) {
+			uint32_t v = cacheNext[i];
+			const uint32_t *adjacent = adjacency.data() + offsets[v];
+			for (uint32_t a = 0; a < remaining[v]; ++a) {
+				if (triangleScore[adjacent[a]] > bestScore) {
+					bestScore = triangleScore[adjacent[a]];
+					bestTriangle = adjacent[a];
+				}
+			}
+		}
+
+		cacheCount = nextCount < ScoreCacheSize ? nextCount : ScoreCacheSize;
+		memcpy(cache, cacheNext, cacheCount * sizeof(uint32_t));
+	}
+}
+
+void OptimizeOverdraw(uint32_t *destination, const uint32_t *indices, size_t indexCount, const float *positions,
+		size_t positionStride, size_t vertexCount, float threshold) {
+	const uint32_t CacheSize = 16;
+
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	std::vector<uint32_t> timestamps(vertexCount, 0);
+	uint32_t timestamp = 0;
+
+	// Hard boundaries: triangles where all three vertices miss, which is
+	// where the cache optimizer started a new patch.
+	std::vector<uint32_t> hard;
+	timestamp = CacheSize + 1;
+	for (size_t t = 0; t < triangleCount; ++t) {
+		uint32_t misses = UpdateFifoCache(indices + t * 3, CacheSize, timestamps.data(), timestamp);
+		if (t == 0 || misses == 3)
+			hard.push_back(static_cast<uint32_t>(t));
+	}
+
+	// Soft boundaries: split each hard cluster wherever the cache-cold ACMR
+	// of the piece so far is already within threshold of the whole cluster's.
+	// Reordering pieces can then cost at most that much.
+	std::vector<uint32_t> clusters;
+	for (size_t h = 0; h < hard.size(); ++h) {
+		uint32_t start = hard[h];
+		uint32_t end = h + 1 < hard.size() ? hard[h + 1] : static_cast<uint32_t>(triangleCount);
+
+		timestamp += CacheSize + 1;
+		uint32_t clusterMisses = 0;
+		for (uint32_t t = start; t < end; ++t)
+			clusterMisses += UpdateFifoCache(indices + t * 3, CacheSize, timestamps.data(), timestamp);
+		float clusterThreshold = threshold * float(clusterMisses) / float(end - start);
+
+		clusters.push_back(start);
+		timestamp += CacheSize + 1;
+		uint32_t misses = 0;
+		uint32_t faces = 0;
+		for (uint32_t t = start; t < end; ++t) {
+			misses += UpdateFifoCache(indices + t * 3, CacheSize, timestamps.data(), timestamp);
+			++faces;
+			if (t + 1 < end && float(misses) / float(faces) <= clusterThreshold) {
+				clusters.push_back(t + 1);
+				timestamp += CacheSize + 1;
+				misses = 0;
+				faces = 0;
+			}
+		}
+	}
+
+	// Sort clusters by how far they face away from the mesh centre: the
+	// outward-facing shell draws first and occludes what lies inside it.
+	const uint8_t *base = reinterpret_cast<const uint8_t *>(positions);
+	auto position = [&](uint32_t v) { return reinterpret_cast<const float *>(base + v * positionStride); };
+
+	float meshCentroid[3] = {};
+	{
+		std::vector<bool> used(vertexCount, false);
+		size_t usedCount = 0;
+		for (size_t i = 0; i < triangleCount * 3; ++i) {
+			uint32_t v = indices[i];
+			if (used[v])
+				continue;
+			used[v] = true;
+			++usedCount;
+			for (int c = 0; c < 3; ++c)
+				meshCentroid[c] += position(v)[c];
+		}
+		for (int c = 0; c < 3; ++c)
+			meshCentroid[c] /= float(usedCount);
+	}
+
+	std::vector<float> sortKey(clusters.size());
+	for (size_t c = 0; c < clusters.size(); ++c) {
+		uint32_t start = clusters[c];
+		uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : static_cast<uint32_t>(triangleCount);
+
+		// Area-weighted centroid and normal.
+		float centroid[3] = {};
+		float normal[3] = {};
+		float area = 0.0f;
+		for (uint32_t t = start; t < end; ++t) {
+			const float *p0 = position(indices[t * 3]);
+			const float *p1 = position(indices[t * 3 + 1]);
+			const float *p2 = position(indices[t * 3 + 2]);
+			float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+			float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+			float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+			float a = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			for (int k = 0; k < 3; ++k) {
+				centroid[k] += (p0[k] + p1[k] + p2[k]) * (a / 3.0f);
+				normal[k] += n[k];
+			}
+			area += a;
+		}
+		float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (area == 0.0f || length == 0.0f) {
+			sortKey[c] = 0.0f;
+			continue;
+		}
+		float key = 0.0f;
+		for (int k = 0; k < 3; ++k)
+			key += (centroid[k] / area - meshCentroid[k]) * (normal[k] / length);
+		sortKey[c] = key;
+	}
+
+	std::vector<uint32_t> order(clusters.size());
+	for (size_t c = 0; c < order.size(); ++c)
+		order[c] = static_cast<uint32_t>(c);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+	size_t output = 0;
+	for (uint32_t c : order) {
+		uint32_t start = clusters[c];
+		uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : static_cast<uint32_t>(triangleCount);
+		memcpy(destination + output, indices + start * 3, (end - start) * 3 * sizeof(uint32_t));
+		output += (end - start) * 3;
+	}
+}
+
+uint32_t OptimizeVertexFetchRemap(uint32_t *remap, uint32_t *indices, size_t indexCount, size_t vertexCount) {
+	std::fill(remap, remap + vertexCount, UINT32_MAX);
+	uint32_t next = 0;
+	for (size_t i = 0; i < indexCount; ++i) {
+		uint32_t &index = indices[i];
+		if (remap[index] == UINT32_MAX)
+			remap[index] = next++;
+		index = remap[index];
+	}
+	return next;
+}
+
+MeshOptimizeStats OptimizeMesh(MeshData &mesh, const MeshOptimizeOptions &options) {
+	MeshOptimizeStats stats;
+
+	// Work on 32-bit indices relative to the start of the vertex buffer.
+	std::vector<uint32_t> indices(mesh.IndexCount);
+	for (uint32_t i = 0; i < mesh.IndexCount; ++i)
+		indices[i] = mesh.Index(i);
+	for (const MeshSubset &subset : mesh.Subsets) {
+		for (uint32_t i = subset.StartIndex; i < subset.StartIndex + subset.IndexCount; ++i)
+			indices[i] = static_cast<uint32_t>(int64_t(indices[i]) + subset.BaseVertex);
+	}
+	stats.Before = AnalyzeVertexCache(indices.data(), indices.size(), mesh.VertexCount, options.CacheSize);
+	stats.FetchBefore = AnalyzeVertexFetch(indices.data(), indices.size(), mesh.VertexCount, mesh.VertexStride);
+
+	// Subsets are drawn separately, so each is optimized on its own range.
+	uint32_t positionOffset = MeshAttributeOffset(mesh.Attributes, MeshAttributePosition);
+	bool overdraw = options.Overdraw && positionOffset != UINT32_MAX;
+	std::vector<uint32_t> scratch, original;
+	for (const MeshSubset &subset : mesh.Subsets) {
+		uint32_t *range = indices.data() + subset.StartIndex;
+		size_t count = subset.IndexCount - subset.IndexCount % 3;
+		original.assign(range, range + count);
+		scratch.resize(count);
+		OptimizeVertexCache(scratch.data(), range, count, mesh.VertexCount);
+		if (overdraw) {
+			const float *positions = reinterpret_cast<const float *>(mesh.Vertices.data() + positionOffset);
+			OptimizeOverdraw(range, scratch.data(), count, positions, mesh.VertexStride, mesh.VertexCount,
+					options.OverdrawThreshold);
+		} else {
+			std::copy(scratch.begin(), scratch.end(), range);
+		}
+
+		// Forsyth's order is not optimal; an input that already beats it, like
+		// a small grid in row order, is kept.
+		if (AnalyzeVertexCache(range, count, mesh.VertexCount, options.CacheSize).VerticesTransformed >
+				AnalyzeVertexCache(original.data(), count, mesh.VertexCount, options.CacheSize).VerticesTransformed)
+			std::copy(original.begin(), original.end(), range);
+	}
+
+	// Lay vertices out in the order the optimized index buffer first uses
+	// them.
+	std::vector<uint32_t> remap(mesh.VertexCount);
+	uint32_t vertexCount = OptimizeVertexFetchRemap(remap.data(), indices.data(), indices.size(), mesh.VertexCount);
+	std::vector<uint8_t> vertices(size_t(vertexCount) * mesh.VertexStride);
+	for (uint32_t v = 0; v < mesh.VertexCount; ++v) {
+		if (remap[v] != UINT32_MAX)
+			memcpy(vertices.data() + size_t(remap[v]) * mesh.VertexStride,
+					mesh.Vertices.data() + size_t(v) * mesh.VertexStride, mesh.VertexStride);
+	}
+	mesh.Vertices.swap(vertices);
+	mesh.VertexCount = vertexCount;
+	for (MeshSubset &subset : mesh.Subsets)
+		subset.BaseVertex = 0;
+
+	mesh.IndexByteSize = vertexCount <= 65536 ? 2 : 4;
+	mesh.Indices.resize(indices.size() * mesh.IndexByteSize);
+	if (mesh.IndexByteSize == 2) {
+		uint16_t *narrow = reinterpret_cast<uint16_t *>(mesh.Indices.data());
+		for (size_t i = 0; i < indices.size(); ++i)
+			narrow[i] = static_cast<uint16_t>(indices[i]);
+	} else {
+		memcpy(mesh.Indices.data(), indices.data(), indices.size() * sizeof(uint32_t));
+	}
+
+	stats.After = AnalyzeVertexCache(indices.data(), indices.size(), mesh.VertexCount, options.CacheSize);
+	stats.FetchAfter = AnalyzeVertexFetch(indices.data(), indices.size(), mesh.VertexCount, mesh.VertexStride);
+	return stats;
+}
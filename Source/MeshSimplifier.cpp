@@ -0,0 +1,425 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// Sum of squared distances to a set of planes, as the symmetric matrix A,
+// vector b and constant c of p'Ap + 2b'p + c. Weight is the total area the
+// planes were weighted by, which turns the sum back into a mean.
+struct Quadric {
+	double A00 = 0, A01 = 0, A02 = 0, A11 = 0, A12 = 0, A22 = 0;
+	double B0 = 0, B1 = 0, B2 = 0;
+	double C = 0;
+	double Weight = 0;
+
+	void AddPlane(const double *n, double d, double weight) {
+		A00 += weight * n[0] * n[0];
+		A01 += weight * n[0] * n[1];
+		A02 += weight * n[0] * n[2];
+		A11 += weight * n[1] * n[1];
+		A12 += weight * n[1] * n[2];
+		A22 += weight * n[2] * n[2];
+		B0 += weight * n[0] * d;
+		B1 += weight * n[1] * d;
+		B2 += weight * n[2] * d;
+		C += weight * d * d;
+	}
+
+	void Add(const Quadric &q) {
+		A00 += q.A00, A01 += q.A01, A02 += q.A02, A11 += q.A11, A12 += q.A12, A22 += q.A22;
+		B0 += q.B0, B1 += q.B1, B2 += q.B2;
+		C += q.C;
+		Weight += q.Weight;
+	}
+
+	double Evaluate(const float *p) const {
+		double x = p[0], y = p[1], z = p[2];
+		double result = A00 * x * x + A11 * y * y + A22 * z * z + 2.0 * (A01 * x * y + A02 * x * z + A12 * y * z) +
+				2.0 * (B0 * x + B1 * y + B2 * z) + C;
+		return result > 0.0 ? result : 0.0;
+	}
+};
+
+enum class VertexKind : uint8_t {
+	Manifold,
+	Border,
+	Locked,
+};
+
+// Borders get planes through the edge, perpendicular to the face, weighted
+// well above the faces so open edges keep their outline.
+static const double BorderWeight = 10.0;
+
+struct Collapse {
+	uint32_t From;
+	uint32_t To;
+	double Cost;
+};
+
+// Unit normal of triangle p into n; returns its area.
+static double TriangleNormal(const float *const *p, double *n) {
+	double e1[3] = { double(p[1][0]) - p[0][0], double(p[1][1]) - p[0][1], double(p[1][2]) - p[0][2] };
+	double e2[3] = { double(p[2][0]) - p[0][0], double(p[2][1]) - p[0][1], double(p[2][2]) - p[0][2] };
+	n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+	double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	if (length == 0.0)
+		return 0.0;
+	for (int c = 0; c < 3; ++c)
+		n[c] /= length;
+	return length * 0.5;
+}
+
+size_t SimplifyMesh(uint32_t *destination, const uint32_t *indices, size_t indexCount, const float *positions,
+		size_t positionStride, size_t vertexCount, size_t targetIndexCount, float targetError, float *resultError) {
+	auto position = [&](uint32_t v) {
+		return reinterpret_cast<const float *>(reinterpret_cast<const uint8_t *>(positions) + v * positionStride);
+	};
+
+	size_t triangleCount = indexCount / 3;
+	std::vector<uint32_t> result(indices, indices + triangleCount * 3);
+	if (resultError != nullptr)
+		*resultError = 0.0f;
+
+	// Weld vertices by position. Collapses work on positions ("reps"); a rep
+	// with several vertices sits on an attribute seam.
+	std::vector<uint32_t> rep(vertexCount, UINT32_MAX);
+	std::vector<uint32_t> wedge(vertexCount, UINT32_MAX);
+	std::vector<uint32_t> wedgeCount(vertexCount, 0);
+	{
+		struct PositionHash {
+			size_t operator()(const std::array<uint32_t, 3> &p) const {
+				return size_t((p[0] * 73856093u) ^ (p[1] * 19349663u) ^ (p[2] * 83492791u));
+			}
+		};
+		std::unordered_map<std::array<uint32_t, 3>, uint32_t, PositionHash> reps;
+		reps.reserve(vertexCount);
+		for (size_t i = 0; i < triangleCount * 3; ++i) {
+			uint32_t v = result[i];
+			if (rep[v] != UINT32_MAX)
+				continue;
+			std::array<uint32_t, 3> key;
+			memcpy(key.data(), position(v), sizeof(key));
+			auto inserted = reps.emplace(key, v);
+			rep[v] = inserted.first->second;
+			if (wedgeCount[rep[v]]++ == 0)
+				wedge[rep[v]] = v;
+		}
+	}
+
+	// Triangles that collapse in rep space have no area; drop them up front.
+	{
+		size_t write = 0;
+		for (size_t t = 0; t < triangleCount; ++t) {
+			const uint32_t *tri = result.data() + t * 3;
+			if (rep[tri[0]] == rep[tri[1]] || rep[tri[1]] == rep[tri[2]] || rep[tri[0]] == rep[tri[2]])
+				continue;
+			memmove(result.data() + write * 3, tri, 3 * sizeof(uint32_t));
+			++write;
+		}
+		triangleCount = write;
+	}
+
+	// Triangles around each rep, rebuilt whenever the triangles change.
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<uint32_t> fill;
+	auto buildAdjacency = [&]() {
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+			++adjacencyOffsets[rep[result[i]] + 1];
+		for (size_t v = 0; v < vertexCount; ++v)
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		adjacency.resize(triangleCount * 3);
+		fill.assign(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+			adjacency[fill[rep[result[i]]]++] = static_cast<uint32_t>(i / 3);
+	};
+	// Triangles using edge ab: one on a border, more than two if non-manifold.
+	auto edgeUse = [&](uint32_t a, uint32_t b) {
+		uint32_t count = 0;
+		for (uint32_t i = adjacencyOffsets[a]; i < adjacencyOffsets[a + 1]; ++i) {
+			const uint32_t *tri = result.data() + size_t(adjacency[i]) * 3;
+			count += uint32_t(rep[tri[0]] == b || rep[tri[1]] == b || rep[tri[2]] == b);
+		}
+		return count;
+	};
+	buildAdjacency();
+
+	std::vector<VertexKind> kind(vertexCount, VertexKind::Manifold);
+	for (size_t t = 0; t < triangleCount; ++t) {
+		for (int k = 0; k < 3; ++k) {
+			uint32_t a = rep[result[t * 3 + k]], b = rep[result[t * 3 + (k + 1) % 3]];
+			uint32_t use = edgeUse(a, b);
+			VertexKind edgeKind = use == 1 ? VertexKind::Border : (use > 2 ? VertexKind::Locked : VertexKind::Manifold);
+			kind[a] = std::max(kind[a], edgeKind);
+			kind[b] = std::max(kind[b], edgeKind);
+		}
+	}
+	for (size_t v = 0; v < vertexCount; ++v)
+		if (wedgeCount[v] > 1)
+			kind[v] = VertexKind::Locked;
+
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t t = 0; t < triangleCount; ++t) {
+		const float *p[3] = { position(rep[result[t * 3]]), position(rep[result[t * 3 + 1]]),
+			position(rep[result[t * 3 + 2]]) };
+		double n[3];
+		double area = TriangleNormal(p, n);
+		if (area == 0.0)
+			continue;
+		double d = -(n[0] * p[0][0] + n[1] * p[0][1] + n[2] * p[0][2]);
+
+		Quadric face;
+		face.AddPlane(n, d, area);
+		face.Weight = area;
+		for (int k = 0; k < 3; ++k)
+			quadrics[rep[result[t * 3 + k]]].Add(face);
+
+		for (int k = 0; k < 3; ++k) {
+			uint32_t a = rep[result[t * 3 + k]], b = rep[result[t * 3 + (k + 1) % 3]];
+			if (edgeUse(a, b) != 1)
+				continue;
+			const float *pa = position(a);
+			const float *pb = position(b);
+			double edge[3] = { double(pb[0]) - pa[0], double(pb[1]) - pa[1], double(pb[2]) - pa[2] };
+			double edgeLengthSq = edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2];
+			double bn[3] = { edge[1] * n[2] - edge[2] * n[1], edge[2] * n[0] - edge[0] * n[2],
+				edge[0] * n[1] - edge[1] * n[0] };
+			double bl = sqrt(bn[0] * bn[0] + bn[1] * bn[1] + bn[2] * bn[2]);
+			if (bl == 0.0)
+				continue;
+			for (double &c : bn)
+				c /= bl;
+			Quadric border;
+			border.AddPlane(bn, -(bn[0] * pa[0] + bn[1] * pa[1] + bn[2] * pa[2]), BorderWeight * edgeLengthSq);
+			quadrics[a].Add(border);
+			quadrics[b].Add(border);
+		}
+	}
+
+	// Error of collapsing from onto to, in model units.
+	auto collapseError = [&](uint32_t from, uint32_t to) {
+		Quadric q = quadrics[from];
+		q.Add(quadrics[to]);
+		return q.Weight > 0.0 ? sqrt(q.Evaluate(position(to)) / q.Weight) : 0.0;
+	};
+	auto canCollapse = [&](uint32_t from, uint32_t to, bool border) {
+		if (kind[from] == VertexKind::Locked || wedgeCount[to] != 1)
+			return false;
+		if (kind[from] == VertexKind::Border)
+			return kind[to] != VertexKind::Manifold && border;
+		return true;
+	};
+
+	double maxError = 0.0;
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<uint8_t> touched(vertexCount);
+
+	while (triangleCount * 3 > targetIndexCount) {
+		// Cheapest valid direction of every edge, cheapest edges first.
+		collapses.clear();
+		for (size_t t = 0; t < triangleCount; ++t) {
+			for (int k = 0; k < 3; ++k) {
+				uint32_t a = rep[result[t * 3 + k]], b = rep[result[t * 3 + (k + 1) % 3]];
+				// Interior edges are seen from both sides; take them once.
+				bool border = edgeUse(a, b) == 1;
+				if (a > b && !border)
+					continue;
+				double ab = canCollapse(a, b, border) ? collapseError(a, b) : INFINITY;
+				double ba = canCollapse(b, a, border) ? collapseError(b, a) : INFINITY;
+				if (ab > targetError && ba > targetError)
+					continue;
+				if (ab <= ba)
+					collapses.push_back({ a, b, ab });
+				else
+					collapses.push_back({ b, a, ba });
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(),
+				[](const Collapse &x, const Collapse &y) { return x.Cost < y.Cost; });
+
+		// Apply independent collapses: nothing in the one-ring of an applied
+		// collapse is touched again this pass, so the flip checks see
+		// current geometry.
+		for (size_t v = 0; v < vertexCount; ++v)
+			remap[v] = static_cast<uint32_t>(v);
+		std::fill(touched.begin(), touched.end(), 0);
+		size_t removed = 0;
+		size_t applied = 0;
+		size_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+		for (const Collapse &collapse : collapses) {
+			if (removed >= trianglesToRemove)
+				break;
+			uint32_t from = collapse.From, to = collapse.To;
+			if (touched[from] || touched[to])
+				continue;
+
+			const float *target = position(to);
+			bool flips = false;
+			size_t shared = 0;
+			for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1] && !flips; ++a) {
+				const uint32_t *tri = result.data() + size_t(adjacency[a]) * 3;
+				uint32_t r[3] = { rep[tri[0]], rep[tri[1]], rep[tri[2]] };
+				if (r[0] == to || r[1] == to || r[2] == to) {
+					++shared;
+					continue;
+				}
+				// Normal before and after moving from onto to; reject flips
+				// and triangles folding to slivers.
+				const float *before[3] = { position(r[0]), position(r[1]), position(r[2]) };
+				const float *after[3] = { r[0] == from ? target : before[0], r[1] == from ? target : before[1],
+					r[2] == from ? target : before[2] };
+				double n0[3], n1[3];
+				if (TriangleNormal(before, n0) == 0.0 || TriangleNormal(after, n1) == 0.0)
+					flips = true;
+				else
+					flips = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0.25;
+			}
+			if (flips)
+				continue;
+
+			for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; ++a) {
+				const uint32_t *tri = result.data() + size_t(adjacency[a]) * 3;
+				for (int k = 0; k < 3; ++k)
+					touched[rep[tri[k]]] = 1;
+			}
+			remap[from] = to;
+			quadrics[to].Add(quadrics[from]);
+			maxError = std::max(maxError, collapse.Cost);
+			removed += shared;
+			++applied;
+		}
+		if (applied == 0)
+			break;
+
+		// Rewrite the collapsed vertices and drop the triangles that folded.
+		size_t write = 0;
+		for (size_t t = 0; t < triangleCount; ++t) {
+			uint32_t tri[3];
+			for (int k = 0; k < 3; ++k) {
+				uint32_t v = result[t * 3 + k];
+				uint32_t r = remap[rep[v]];
+				tri[k] = r == rep[v] ? v : wedge[r];
+			}
+			if (rep[tri[0]] == rep[tri[1]] || rep[tri[1]] == rep[tri[2]] || rep[tri[0]] == rep[tri[2]])
+				continue;
+			memcpy(result.data() + write * 3, tri, sizeof(tri));
+			++write;
+		}
+		triangleCount = write;
+		buildAdjacency();
+	}
+
+	memcpy(destination, result.data(), triangleCount * 3 * sizeof(uint32_t));
+	if (resultError != nullptr)
+		*resultError = static_cast<float>(maxError);
+	return triangleCount * 3;
+}
+
+void BuildLodChain(MeshData &mesh, const LodChainDesc &desc) {
+	uint32_t positionOffset = MeshAttributeOffset(mesh.Attributes, MeshAttributePosition);
+	if (positionOffset == UINT32_MAX)
+		return;
+	const float *positions = reinterpret_cast<const float *>(mesh.Vertices.data() + positionOffset);
+
+	std::vector<uint32_t> indices(mesh.IndexCount);
+	for (uint32_t i = 0; i < mesh.IndexCount; ++i)
+		indices[i] = mesh.Index(i);
+
+	std::vector<MeshSubset> subsets;
+	std::vector<uint32_t> source;
+	std::vector<uint32_t> simplified;
+	std::vector<uint32_t> optimized;
+	for (const MeshSubset &subset : mesh.Subsets) {
+		// A mesh that already has a chain keeps it.
+		if (subset.LodLevel != 0)
+			return;
+	}
+	// Levels of a subset follow it, so a renderer can take a subset and the
+	// LodLevel > 0 entries after it as its chain.
+	for (const MeshSubset &subset : mesh.Subsets) {
+		subsets.push_back(subset);
+
+		// Simplify in the subset's own vertex numbering.
+		source.assign(indices.begin() + subset.StartIndex,
+				indices.begin() + subset.StartIndex + subset.IndexCount - subset.IndexCount % 3);
+		for (uint32_t &index : source)
+			index = static_cast<uint32_t>(int64_t(index) + subset.BaseVertex);
+		float boundsMin[3] = { INFINITY, INFINITY, INFINITY };
+		float boundsMax[3] = { -INFINITY, -INFINITY, -INFINITY };
+		for (uint32_t index : source) {
+			const float *p = reinterpret_cast<const float *>(
+					reinterpret_cast<const uint8_t *>(positions) + size_t(index) * mesh.VertexStride);
+			for (int c = 0; c < 3; ++c) {
+				boundsMin[c] = std::min(boundsMin[c], p[c]);
+				boundsMax[c] = std::max(boundsMax[c], p[c]);
+			}
+		}
+		float diagonal = 0.0f;
+		for (int c = 0; c < 3; ++c)
+			diagonal += source.empty() ? 0.0f : (boundsMax[c] - boundsMin[c]) * (boundsMax[c] - boundsMin[c]);
+		float maxError = sqrtf(diagonal) * desc.MaxRelativeError;
+
+		size_t previous = source.size();
+		simplified.resize(source.size());
+		for (uint32_t level = 1; level <= desc.MaxLevels; ++level) {
+			size_t target = size_t(float(previous / 3) * desc.Reduction) * 3;
+			if (target / 3 < desc.MinTriangles)
+				break;
+			float error = 0.0f;
+			size_t count = SimplifyMesh(simplified.data(), source.data(), source.size(), positions, mesh.VertexStride,
+					mesh.VertexCount, target, maxError, &error);
+			if (count == 0 || count > previous - previous / 10)
+				break;
+			previous = count;
+
+			optimized.resize(count);
+			OptimizeVertexCache(optimized.data(), simplified.data(), count, mesh.VertexCount);
+			MeshSubset lod;
+			lod.Name = subset.Name + "_lod" + std::to_string(level);
+			lod.StartIndex = static_cast<uint32_t>(indices.size());
+			lod.IndexCount = static_cast<uint32_t>(count);
+			lod.BaseVertex = subset.BaseVertex;
+			lod.LodLevel = level;
+			lod.LodError = error;
+			memcpy(lod.BoundsMin, subset.BoundsMin, sizeof(lod.BoundsMin));
+			memcpy(lod.BoundsMax, subset.BoundsMax, sizeof(lod.BoundsMax));
+			for (uint32_t index : optimized)
+				indices.push_back(static_cast<uint32_t>(int64_t(index) - subset.BaseVertex));
+			subsets.push_back(lod);
+		}
+	}
+
+	mesh.Subsets.swap(subsets);
+
+	mesh.IndexCount = static_cast<uint32_t>(indices.size());
+	mesh.Indices.resize(indices.size() * mesh.IndexByteSize);
+	if (mesh.IndexByteSize == 2) {
+		uint16_t *narrow = reinterpret_cast<uint16_t *>(mesh.Indices.data());
+		for (size_t i = 0; i < indices.size(); ++i)
+			narrow[i] = static_cast<uint16_t>(indices[i]);
+	} else {
+		memcpy(mesh.Indices.data(), indices.data(), indices.size() * sizeof(uint32_t));
+	}
+}
+
+uint32_t SelectLod(const float *errors, uint32_t levelCount, float distance, float worldScale,
+		float projectionScale, float pixelThreshold) {
+	// Inside the object everything is close; stay at full detail.
+	if (distance <= 0.0f)
+		return 0;
+	uint32_t selected = 0;
+	for (uint32_t level = 1; level < levelCount; ++level) {
+		float pixels = errors[level] * worldScale * projectionScale / distance;
+		if (pixels > pixelThreshold)
+			break;
+		selected = level;
+	}
+	return selected;
+}
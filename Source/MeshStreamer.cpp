@@ -0,0 +1,233 @@
+#include "MeshStreamer.h"
+#include <cassert>
+#include <chrono>
+#include <fstream>
+
+static uint64_t NanosecondsSince(std::chrono::steady_clock::time_point start) {
+	return static_cast<uint64_t>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+static bool ReadFile(const std::string &path, std::vector<uint8_t> &bytes) {
+	std::ifstream fin(path, std::ios::binary | std::ios::ate);
+	if (!fin)
+		return false;
+	std::streamoff size = fin.tellg();
+	if (size < 0)
+		return false;
+	bytes.resize(static_cast<size_t>(size));
+	fin.seekg(0);
+	return size == 0 || fin.read(reinterpret_cast<char *>(bytes.data()), size).good();
+}
+
+// Reads one byte of every page, so later copies out of the mapping do not
+// wait on the disk.
+static void TouchPages(const uint8_t *data, uint64_t size) {
+	const uint64_t PageSize = 4096;
+	uint8_t sum = 0;
+	for (uint64_t offset = 0; offset < size; offset += PageSize)
+		sum += data[offset];
+	volatile uint8_t sink = sum;
+	(void)sink;
+}
+
+MeshStreamer::MeshStreamer(MeshDecodeFn decode, JobSystem *jobs, const MeshStreamerDesc &desc) :
+		mDecode(std::move(decode)),
+		mJobs(jobs),
+		mDesc(desc),
+		mReady(desc.MaxReadyMeshes != 0 ? desc.MaxReadyMeshes : 1) {
+	uint32_t threadCount = mDesc.IoThreads != 0 ? mDesc.IoThreads : 1;
+	for (uint32_t i = 0; i < threadCount; ++i)
+		mIoThreads.emplace_back([this]() { IoThreadMain(); });
+}
+
+MeshStreamer::~MeshStreamer() {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+		mReads.clear();
+	}
+	mWake.notify_all();
+	for (std::thread &thread : mIoThreads)
+		thread.join();
+	if (mJobs != nullptr)
+		mJobs->Wait(mDecodes);
+
+	StreamedMesh *mesh = nullptr;
+	while (mReady.TryPop(mesh))
+		delete mesh;
+}
+
+MeshHandle MeshStreamer::Request(const std::string &path) {
+	auto it = mHandleByPath.find(path);
+	MeshHandle handle;
+	if (it != mHandleByPath.end()) {
+		handle = it->second;
+		MeshResidency residency = mEntries[handle].Residency;
+		if (residency == MeshResidency::Loading || residency == MeshResidency::Resident)
+			return handle;
+	} else {
+		handle = static_cast<MeshHandle>(mEntries.size());
+		mEntries.emplace_back().Path = path;
+		mHandleByPath.emplace(path, handle);
+	}
+
+	mEntries[handle].Residency = MeshResidency::Loading;
+	++mLoadsInFlight;
+	++mStats.Requested;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mReads.push_back({ handle, path });
+	}
+	mWake.notify_one();
+	return handle;
+}
+
+void MeshStreamer::IoThreadMain() {
+	for (;;) {
+		ReadRequest request;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWake.wait(lock, [this]() {
+				return mStopping || (!mReads.empty() && mUnpolled.load() < mReady.Capacity());
+			});
+			if (mStopping)
+				return;
+			request = std::move(mReads.front());
+			mReads.pop_front();
+			mUnpolled.fetch_add(1);
+		}
+
+		if (!mDecode) {
+			Map(request);
+			continue;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<uint8_t> bytes;
+		if (!ReadFile(request.Path, bytes)) {
+			StreamedMesh *mesh = new StreamedMesh();
+			mesh->Handle = request.Handle;
+			mesh->Error = "cannot read " + request.Path;
+			Publish(mesh);
+			continue;
+		}
+		mReadNanoseconds.fetch_add(NanosecondsSince(start), std::memory_order_relaxed);
+		mBytesRead.fetch_add(bytes.size(), std::memory_order_relaxed);
+
+		MeshHandle handle = request.Handle;
+		if (mJobs != nullptr)
+			mJobs->Run([this, handle, bytes = std::move(bytes)]() mutable { Decode(handle, std::move(bytes)); }, &mDecodes);
+		else
+			Decode(handle, std::move(bytes));
+	}
+}
+
+void MeshStreamer::Decode(MeshHandle handle, std::vector<uint8_t> bytes) {
+	auto start = std::chrono::steady_clock::now();
+	StreamedMesh *mesh = new StreamedMesh();
+	mesh->Handle = handle;
+	mesh->Data = std::make_unique<MeshData>();
+	if (!mDecode(bytes.data(), bytes.size(), *mesh->Data, mesh->Error))
+		mesh->Data.reset();
+	mDecodeNanoseconds.fetch_add(NanosecondsSince(start), std::memory_order_relaxed);
+	Publish(mesh);
+}
+
+void MeshStreamer::Map(const ReadRequest &request) {
+	auto start = std::chrono::steady_clock::now();
+	StreamedMesh *mesh = new StreamedMesh();
+	mesh->Handle = request.Handle;
+	mesh->File = std::make_unique<MappedFile>();
+	if (!mesh->File->Open(request.Path)) {
+		mesh->File.reset();
+		mesh->Error = "cannot read " + request.Path;
+	} else if (!ParseMeshFile(mesh->File->Data(), mesh->File->Size(), mesh->View, mesh->Error)) {
+		mesh->File.reset();
+	} else {
+		TouchPages(mesh->View.Vertices, mesh->View.VertexByteSize());
+		TouchPages(mesh->View.Indices, mesh->View.IndexByteSize());
+		mReadNanoseconds.fetch_add(NanosecondsSince(start), std::memory_order_relaxed);
+		mBytesRead.fetch_add(mesh->File->Size(), std::memory_order_relaxed);
+	}
+	Publish(mesh);
+}
+
+void MeshStreamer::Publish(StreamedMesh *mesh) {
+	// Reads are only started while the queue has room for their result.
+	bool pushed = mReady.TryPush(std::move(mesh));
+	assert(pushed);
+	(void)pushed;
+}
+
+uint32_t MeshStreamer::Poll(std::vector<StreamedMesh> &loaded, uint64_t maxBytes) {
+	uint32_t count = 0;
+	uint64_t bytes = 0;
+	StreamedMesh *mesh = nullptr;
+	while ((count == 0 || bytes < maxBytes) && mReady.TryPop(mesh)) {
+		Entry &entry = mEntries[mesh->Handle];
+		assert(entry.Residency == MeshResidency::Loading);
+		if (mesh->IsLoaded()) {
+			entry.Residency = MeshResidency::Resident;
+			entry.ByteSize = mesh->ByteSize();
+			entry.LastUsedFrame = mFrame;
+			entry.LruPosition = mLru.insert(mLru.begin(), mesh->Handle);
+			mResidentBytes += entry.ByteSize;
+			bytes += entry.ByteSize;
+			++mStats.Loaded;
+		} else {
+			entry.Residency = MeshResidency::Failed;
+			++mStats.Failed;
+		}
+
+		loaded.push_back(std::move(*mesh));
+		delete mesh;
+		--mLoadsInFlight;
+		++count;
+	}
+
+	if (count != 0) {
+		// Wake I/O threads that stopped because the ready queue was full.
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mUnpolled.fetch_sub(count);
+		}
+		mWake.notify_all();
+	}
+	return count;
+}
+
+void MeshStreamer::Touch(MeshHandle handle) {
+	Entry &entry = mEntries[handle];
+	if (entry.Residency != MeshResidency::Resident)
+		return;
+	entry.LastUsedFrame = mFrame;
+	mLru.splice(mLru.begin(), mLru, entry.LruPosition);
+}
+
+void MeshStreamer::Evict(std::vector<MeshHandle> &evicted) {
+	while (mResidentBytes > mDesc.BudgetBytes && !mLru.empty()) {
+		MeshHandle handle = mLru.back();
+		Entry &entry = mEntries[handle];
+		// Everything further up the list is in use too.
+		if (entry.LastUsedFrame == mFrame)
+			break;
+
+		mLru.pop_back();
+		entry.Residency = MeshResidency::Unloaded;
+		mResidentBytes -= entry.ByteSize;
+		entry.ByteSize = 0;
+		evicted.push_back(handle);
+		++mStats.Evicted;
+	}
+	++mFrame;
+}
+
+MeshStreamerStats MeshStreamer::Stats() const {
+	MeshStreamerStats stats = mStats;
+	stats.ResidentBytes = mResidentBytes;
+	stats.BytesRead = mBytesRead.load(std::memory_order_relaxed);
+	stats.ReadSeconds = mReadNanoseconds.load(std::memory_order_relaxed) * 1e-9;
+	stats.DecodeSeconds = mDecodeNanoseconds.load(std::memory_order_relaxed) * 1e-9;
+	return stats;
+}
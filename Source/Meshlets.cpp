@@ -0,0 +1,267 @@
+#include "Meshlets.h"
+#include <algorithm>
+#include <cmath>
+
+static const float *PositionAt(const float *positions, size_t positionStride, uint32_t v) {
+	return reinterpret_cast<const float *>(reinterpret_cast<const uint8_t *>(positions) + v * positionStride);
+}
+
+static float DistanceSquared(const float *a, const float *b) {
+	float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+	return dx * dx + dy * dy + dz * dz;
+}
+
+// Ritter's bounding sphere: start from a roughly diameter-spanning pair of
+// points and grow the sphere over whatever is still outside.
+static void ComputeBoundingSphere(MeshletBounds &bounds, const uint32_t *vertices, uint32_t count,
+		const float *positions, size_t positionStride) {
+	const float *first = PositionAt(positions, positionStride, vertices[0]);
+	const float *a = first;
+	float best = -1.0f;
+	for (uint32_t i = 0; i < count; ++i) {
+		const float *p = PositionAt(positions, positionStride, vertices[i]);
+		float d = DistanceSquared(p, first);
+		if (d > best) {
+			best = d;
+			a = p;
+		}
+	}
+	const float *b = a;
+	best = -1.0f;
+	for (uint32_t i = 0; i < count; ++i) {
+		const float *p = PositionAt(positions, positionStride, vertices[i]);
+		float d = DistanceSquared(p, a);
+		if (d > best) {
+			best = d;
+			b = p;
+		}
+	}
+
+	float center[3] = { (a[0] + b[0]) * 0.5f, (a[1] + b[1]) * 0.5f, (a[2] + b[2]) * 0.5f };
+	float radius = sqrtf(best) * 0.5f;
+	for (uint32_t i = 0; i < count; ++i) {
+		const float *p = PositionAt(positions, positionStride, vertices[i]);
+		float d = sqrtf(DistanceSquared(p, center));
+		if (d > radius) {
+			// Move the centre towards p just enough to take it in.
+			float grown = (radius + d) * 0.5f;
+			float k = (grown - radius) / d;
+			for (int c = 0; c < 3; ++c)
+				center[c] += (p[c] - center[c]) * k;
+			radius = grown;
+		}
+	}
+	bounds.Center = { center[0], center[1], center[2] };
+	// Float rounding in the growth steps can leave a point a hair outside.
+	bounds.Radius = radius * 1.0001f;
+}
+
+static void ComputeNormalCone(MeshletBounds &bounds, const uint32_t *indices, uint32_t triangleCount,
+		const float *positions, size_t positionStride) {
+	std::vector<float> normals;
+	normals.reserve(triangleCount * 3);
+	float axis[3] = {};
+	for (uint32_t t = 0; t < triangleCount; ++t) {
+		const float *p0 = PositionAt(positions, positionStride, indices[t * 3]);
+		const float *p1 = PositionAt(positions, positionStride, indices[t * 3 + 1]);
+		const float *p2 = PositionAt(positions, positionStride, indices[t * 3 + 2]);
+		float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+		float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		// Degenerate triangles are never rasterized, whatever way they face.
+		if (length == 0.0f)
+			continue;
+		for (int c = 0; c < 3; ++c) {
+			normals.push_back(n[c] / length);
+			axis[c] += n[c] / length;
+		}
+	}
+
+	bounds.ConeAxis = {};
+	bounds.ConeCutoff = 1.0f;
+	float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	if (normals.empty() || length < 1e-6f)
+		return;
+	for (int c = 0; c < 3; ++c)
+		axis[c] /= length;
+
+	float minDot = 1.0f;
+	for (size_t i = 0; i < normals.size(); i += 3) {
+		float d = normals[i] * axis[0] + normals[i + 1] * axis[1] + normals[i + 2] * axis[2];
+		minDot = d < minDot ? d : minDot;
+	}
+	bounds.ConeAxis = { axis[0], axis[1], axis[2] };
+	// A cone of a hemisphere or more faces the camera from anywhere.
+	if (minDot <= 0.0f)
+		return;
+	bounds.ConeCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+void BuildMeshlets(MeshletMesh &out, const uint32_t *indices, size_t indexCount, const float *positions,
+		size_t positionStride, size_t vertexCount, const MeshletLimits &limits) {
+	out = MeshletMesh();
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || limits.MaxVertices < 3 || limits.MaxTriangles == 0)
+		return;
+
+	// Unused triangles around each vertex; emitted ones are swapped out.
+	std::vector<uint32_t> live(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+		++live[indices[i]];
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v)
+		offsets[v + 1] = offsets[v] + live[v];
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	// Position of each vertex in the meshlet being built, or UINT32_MAX.
+	std::vector<uint32_t> slot(vertexCount, UINT32_MAX);
+	out.Indices.reserve(triangleCount * 3);
+
+	Meshlet meshlet;
+	size_t cursor = 0;
+
+	auto sharedCount = [&](uint32_t t) {
+		const uint32_t *tri = indices + size_t(t) * 3;
+		return uint32_t(slot[tri[0]] != UINT32_MAX) + uint32_t(slot[tri[1]] != UINT32_MAX) +
+				uint32_t(slot[tri[2]] != UINT32_MAX);
+	};
+	auto fits = [&](uint32_t t) {
+		const uint32_t *tri = indices + size_t(t) * 3;
+		// A degenerate triangle adds its repeated vertex once.
+		uint32_t added = 0;
+		for (int k = 0; k < 3; ++k)
+			if (slot[tri[k]] == UINT32_MAX && (k == 0 || tri[k] != tri[0]) && (k < 2 || tri[k] != tri[1]))
+				++added;
+		return meshlet.VertexCount + added <= limits.MaxVertices;
+	};
+	// Best unused neighbour of vertex v that fits: the one sharing the most
+	// vertices with the meshlet, then the one whose vertices have the fewest
+	// triangles left, which fills in fans instead of growing tendrils.
+	auto bestAround = [&](uint32_t v, uint32_t &best, uint32_t &bestScore) {
+		const uint32_t *adjacent = adjacency.data() + offsets[v];
+		for (uint32_t a = 0; a < live[v]; ++a) {
+			uint32_t t = adjacent[a];
+			const uint32_t *tri = indices + size_t(t) * 3;
+			uint32_t remaining = live[tri[0]] + live[tri[1]] + live[tri[2]];
+			uint32_t score = sharedCount(t) * 1024 + (remaining < 1023 ? 1023 - remaining : 0);
+			if (score > bestScore && fits(t)) {
+				best = t;
+				bestScore = score;
+			}
+		}
+	};
+
+	auto finishMeshlet = [&]() {
+		if (meshlet.TriangleCount == 0)
+			return;
+		MeshletBounds bounds;
+		ComputeBoundingSphere(bounds, out.Vertices.data() + meshlet.VertexOffset, meshlet.VertexCount, positions,
+				positionStride);
+		ComputeNormalCone(bounds, out.Indices.data() + size_t(meshlet.TriangleOffset) * 3, meshlet.TriangleCount,
+				positions, positionStride);
+		for (uint32_t i = 0; i < meshlet.VertexCount; ++i)
+			slot[out.Vertices[meshlet.VertexOffset + i]] = UINT32_MAX;
+		out.Meshlets.push_back(meshlet);
+		out.Bounds.push_back(bounds);
+
+		meshlet = Meshlet();
+		meshlet.VertexOffset = static_cast<uint32_t>(out.Vertices.size());
+		meshlet.TriangleOffset = static_cast<uint32_t>(out.Indices.size() / 3);
+	};
+
+	for (size_t added = 0; added < triangleCount;) {
+		uint32_t next = UINT32_MAX;
+		if (meshlet.TriangleCount != 0 && meshlet.TriangleCount < limits.MaxTriangles) {
+			// Grow from the last triangle first; only when none of its
+			// neighbours fit look around the rest of the meshlet.
+			uint32_t bestScore = 0;
+			const uint32_t *last = out.Indices.data() + out.Indices.size() - 3;
+			for (int k = 0; k < 3; ++k)
+				bestAround(last[k], next, bestScore);
+			for (uint32_t i = 0; next == UINT32_MAX && i < meshlet.VertexCount; ++i)
+				bestAround(out.Vertices[meshlet.VertexOffset + i], next, bestScore);
+		}
+		if (next == UINT32_MAX) {
+			finishMeshlet();
+			while (emitted[cursor])
+				++cursor;
+			next = static_cast<uint32_t>(cursor);
+		}
+
+		const uint32_t *tri = indices + size_t(next) * 3;
+		emitted[next] = true;
+		++added;
+		for (int k = 0; k < 3; ++k) {
+			uint32_t v = tri[k];
+			if (slot[v] == UINT32_MAX) {
+				slot[v] = meshlet.VertexCount++;
+				out.Vertices.push_back(v);
+			}
+			out.Indices.push_back(v);
+
+			uint32_t *begin = adjacency.data() + offsets[v];
+			uint32_t *end = begin + live[v];
+			*std::find(begin, end, next) = end[-1];
+			--live[v];
+		}
+		++meshlet.TriangleCount;
+	}
+	finishMeshlet();
+}
+
+uint32_t CullMeshlets(const MeshletMesh &mesh, const MeshletCullView &view, uint32_t first, uint32_t count,
+		std::vector<MeshletDrawRange> &outRanges, MeshletCullStats *stats) {
+	MeshletCullStats local;
+	size_t firstRange = outRanges.size();
+	const Float4 *planes = view.ViewFrustum.Planes;
+	const Float3 &eye = view.CameraPosition;
+
+	for (uint32_t m = first; m < first + count; ++m) {
+		const MeshletBounds &bounds = mesh.Bounds[m];
+		const Meshlet &meshlet = mesh.Meshlets[m];
+		local.Triangles += meshlet.TriangleCount;
+
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; ++p) {
+			inside = planes[p].x * bounds.Center.x + planes[p].y * bounds.Center.y + planes[p].z * bounds.Center.z +
+							planes[p].w >=
+					-bounds.Radius;
+		}
+		if (!inside) {
+			++local.FrustumCulled;
+			continue;
+		}
+
+		if (view.Backface && bounds.ConeCutoff < 1.0f) {
+			float dx = bounds.Center.x - eye.x, dy = bounds.Center.y - eye.y, dz = bounds.Center.z - eye.z;
+			float along = dx * bounds.ConeAxis.x + dy * bounds.ConeAxis.y + dz * bounds.ConeAxis.z;
+			if (along >= bounds.ConeCutoff * sqrtf(dx * dx + dy * dy + dz * dz) + bounds.Radius) {
+				++local.BackfaceCulled;
+				continue;
+			}
+		}
+
+		local.VisibleTriangles += meshlet.TriangleCount;
+		uint32_t start = meshlet.TriangleOffset * 3;
+		if (outRanges.size() > firstRange && outRanges.back().StartIndex + outRanges.back().IndexCount == start)
+			outRanges.back().IndexCount += meshlet.TriangleCount * 3;
+		else
+			outRanges.push_back({ start, meshlet.TriangleCount * 3 });
+	}
+
+	if (stats != nullptr) {
+		stats->Meshlets += count;
+		stats->FrustumCulled += local.FrustumCulled;
+		stats->BackfaceCulled += local.BackfaceCulled;
+		stats->Triangles += local.Triangles;
+		stats->VisibleTriangles += local.VisibleTriangles;
+	}
+	return static_cast<uint32_t>(outRanges.size() - firstRange);
+}
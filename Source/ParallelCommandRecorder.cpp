@@ -0,0 +1,87 @@
+#include "ParallelCommandRecorder.h"
+#include "JobSystem.h"
+#include <algorithm>
+
+ParallelCommandRecorder::ParallelCommandRecorder(JobSystem *jobs, uint32_t maxLists, uint32_t minItemsPerChunk) :
+		mJobs(jobs),
+		mMaxLists(std::max(maxLists, 1u)),
+		mMinItemsPerChunk(std::max(minItemsPerChunk, 1u)) {
+}
+
+void ParallelCommandRecorder::PlanChunks(uint32_t itemCount, uint32_t maxLists, uint32_t minItemsPerChunk,
+		std::vector<RecordChunk> &chunks) {
+	chunks.clear();
+
+	// Round down: rounding up would split e.g. 65 items into two chunks that
+	// are both under the minimum.
+	uint32_t chunkCount = itemCount / std::max(minItemsPerChunk, 1u);
+	chunkCount = std::clamp(chunkCount, 1u, std::max(maxLists, 1u));
+
+	// Spread the remainder over the first chunks so sizes differ by at most one.
+	uint32_t base = itemCount / chunkCount;
+	uint32_t remainder = itemCount % chunkCount;
+	uint32_t first = 0;
+	for (uint32_t i = 0; i < chunkCount; ++i) {
+		RecordChunk chunk;
+		chunk.First = first;
+		chunk.Count = base + (i < remainder ? 1 : 0);
+		chunk.ListIndex = i;
+		chunks.push_back(chunk);
+		first += chunk.Count;
+	}
+}
+
+uint32_t ParallelCommandRecorder::Record(uint32_t itemCount, const RecordFn &recordChunk) {
+	PlanChunks(itemCount, mMaxLists, mMinItemsPerChunk, mChunks);
+
+	uint32_t chunkCount = static_cast<uint32_t>(mChunks.size());
+	if (mJobs == nullptr || chunkCount == 1) {
+		for (const RecordChunk &chunk : mChunks)
+			recordChunk(chunk);
+	} else {
+		mJobs->ParallelFor(chunkCount, 1, [&](uint32_t first, uint32_t count) {
+			for (uint32_t i = first; i < first + count; ++i)
+				recordChunk(mChunks[i]);
+		});
+	}
+	return chunkCount;
+}
+
+StubCommandLists::StubCommandLists(uint32_t listCount, uint32_t workPerDraw) :
+		mLists(std::max(listCount, 1u)),
+		mWorkPerDraw(workPerDraw) {
+}
+
+void StubCommandLists::Reset() {
+	for (StubList &list : mLists) {
+		list.Items.clear();
+		list.RecordCount = 0;
+	}
+}
+
+void StubCommandLists::Record(const RecordChunk &chunk) {
+	StubList &list = mLists[chunk.ListIndex];
+	++list.RecordCount;
+	for (uint32_t item = chunk.First; item < chunk.First + chunk.Count; ++item) {
+		// An LCG the compiler cannot fold away stands in for encoding the draw.
+		uint32_t state = item;
+		for (uint32_t i = 0; i < mWorkPerDraw; ++i)
+			state = state * 1664525u + 1013904223u;
+		list.Checksum += state;
+		list.Items.push_back(item);
+	}
+}
+
+std::vector<uint32_t> StubCommandLists::ExecutionOrder() const {
+	std::vector<uint32_t> order;
+	for (const StubList &list : mLists)
+		order.insert(order.end(), list.Items.begin(), list.Items.end());
+	return order;
+}
+
+uint64_t StubCommandLists::Checksum() const {
+	uint64_t checksum = 0;
+	for (const StubList &list : mLists)
+		checksum += list.Checksum;
+	return checksum;
+}
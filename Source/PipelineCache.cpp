@@ -0,0 +1,38 @@
+#include "PipelineCache.h"
+
+uint64_t PipelineKey::HashBytes(const void *data, size_t size, uint64_t seed) {
+	// 64-bit FNV-1a.
+	const uint8_t *bytes = static_cast<const uint8_t *>(data);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+void PipelineKey::Bytes(const void *data, size_t size) {
+	const uint8_t *bytes = static_cast<const uint8_t *>(data);
+	mData.insert(mData.end(), bytes, bytes + size);
+	mHash = HashBytes(data, size, mHash);
+}
+
+void PipelineKey::String(const char *s) {
+	size_t length = s != nullptr ? strlen(s) : 0;
+	U64(length);
+	Bytes(s, length);
+}
+
+void PipelineKey::Blob(const void *data, size_t size) {
+	U64(size);
+	if (size != 0)
+		Bytes(data, size);
+}
+
+std::wstring PipelineKey::Name() const {
+	static const wchar_t digits[] = L"0123456789abcdef";
+	std::wstring name = L"pso_";
+	for (int shift = 60; shift >= 0; shift -= 4)
+		name += digits[(mHash >> shift) & 0xf];
+	return name;
+}
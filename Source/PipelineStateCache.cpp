@@ -0,0 +1,91 @@
+#include "PipelineStateCache.h"
+#include <fstream>
+#include <iterator>
+
+using Microsoft::WRL::ComPtr;
+
+PipelineStateCache::PipelineStateCache(ID3D12Device *device, std::filesystem::path libraryPath) :
+		mDevice(device),
+		mLibraryPath(std::move(libraryPath)) {
+	OpenLibrary();
+}
+
+void PipelineStateCache::OpenLibrary() {
+	ComPtr<ID3D12Device1> device1;
+	if (FAILED(mDevice->QueryInterface(IID_PPV_ARGS(&device1))))
+		return;
+
+	std::ifstream fin(mLibraryPath, std::ios::binary);
+	if (fin)
+		mLibraryData.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+
+	HRESULT hr = E_FAIL;
+	if (!mLibraryData.empty())
+		hr = device1->CreatePipelineLibrary(mLibraryData.data(), mLibraryData.size(), IID_PPV_ARGS(&mLibrary));
+
+	if (FAILED(hr)) {
+		// Missing, corrupt, or written by another driver/adapter: start empty.
+		mLibraryData.clear();
+		mLibrary.Reset();
+		if (FAILED(device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&mLibrary))))
+			mLibrary.Reset();
+	}
+}
+
+void PipelineStateCache::RegisterRootSignature(ID3D12RootSignature *rootSignature, const void *serialized, size_t byteSize) {
+	const uint8_t *bytes = static_cast<const uint8_t *>(serialized);
+	mRootSignatures[rootSignature].assign(bytes, bytes + byteSize);
+}
+
+ComPtr<ID3D12PipelineState> PipelineStateCache::GetOrCreate(const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc) {
+	PipelineKey key;
+	CanonicalizePipelineDesc(desc, mRootSignatures, key);
+
+	return mCache.GetOrCreate(key, [&]() {
+		ComPtr<ID3D12PipelineState> pso;
+		bool persist = mLibrary != nullptr && key.IsPersistent();
+		std::wstring name = key.Name();
+
+		// The library checks desc against what it stored, so a hash collision
+		// fails the load rather than returning the wrong pipeline.
+		if (persist && SUCCEEDED(mLibrary->LoadGraphicsPipeline(name.c_str(), &desc, IID_PPV_ARGS(&pso)))) {
+			++mLibraryLoads;
+			return pso;
+		}
+
+		ThrowIfFailed(mDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pso)));
+		if (persist && SUCCEEDED(mLibrary->StorePipeline(name.c_str(), pso.Get())))
+			mLibraryDirty = true;
+		return pso;
+	});
+}
+
+bool PipelineStateCache::SaveLibrary() {
+	if (mLibrary == nullptr || !mLibraryDirty)
+		return true;
+
+	std::vector<char> data(mLibrary->GetSerializedSize());
+	if (FAILED(mLibrary->Serialize(data.data(), data.size())))
+		return false;
+
+	// Write to a temporary file and swap it in, so a crash mid-write never
+	// leaves a truncated library behind.
+	std::filesystem::path tempPath = mLibraryPath;
+	tempPath += ".tmp";
+	{
+		std::ofstream fout(tempPath, std::ios::binary | std::ios::trunc);
+		if (!fout)
+			return false;
+		fout.write(data.data(), data.size());
+		if (!fout)
+			return false;
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, mLibraryPath, ec);
+	if (ec)
+		return false;
+
+	mLibraryDirty = false;
+	return true;
+}
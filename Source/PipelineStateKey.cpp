@@ -0,0 +1,117 @@
+#include "PipelineStateKey.h"
+
+// -0.0f and 0.0f describe the same state.
+static void CanonicalFloat(float value, PipelineKey &key) {
+	key.F32(value == 0.0f ? 0.0f : value);
+}
+
+static void CanonicalizeStencilOp(const D3D12_DEPTH_STENCILOP_DESC &op, PipelineKey &key) {
+	key.U32(op.StencilFailOp);
+	key.U32(op.StencilDepthFailOp);
+	key.U32(op.StencilPassOp);
+	key.U32(op.StencilFunc);
+}
+
+void CanonicalizePipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc,
+		const std::unordered_map<ID3D12RootSignature *, std::vector<uint8_t>> &rootSignatures, PipelineKey &key) {
+	auto rootSignature = rootSignatures.find(desc.pRootSignature);
+	if (rootSignature != rootSignatures.end()) {
+		key.Blob(rootSignature->second.data(), rootSignature->second.size());
+	} else {
+		key.U64(reinterpret_cast<uintptr_t>(desc.pRootSignature));
+		key.MarkTransient();
+	}
+
+	for (const D3D12_SHADER_BYTECODE *shader : { &desc.VS, &desc.PS, &desc.DS, &desc.HS, &desc.GS })
+		key.Blob(shader->pShaderBytecode, shader->BytecodeLength);
+
+	const D3D12_STREAM_OUTPUT_DESC &so = desc.StreamOutput;
+	key.U32(so.NumEntries);
+	for (UINT i = 0; i < so.NumEntries; ++i) {
+		const D3D12_SO_DECLARATION_ENTRY &entry = so.pSODeclaration[i];
+		key.U32(entry.Stream);
+		key.String(entry.SemanticName);
+		key.U32(entry.SemanticIndex);
+		key.U32(entry.StartComponent);
+		key.U32(entry.ComponentCount);
+		key.U32(entry.OutputSlot);
+	}
+	key.U32(so.NumStrides);
+	for (UINT i = 0; i < so.NumStrides; ++i)
+		key.U32(so.pBufferStrides[i]);
+	key.U32(so.NumEntries != 0 ? so.RasterizedStream : 0);
+
+	// Without independent blending only render target 0's state is used.
+	const D3D12_BLEND_DESC &blend = desc.BlendState;
+	key.U32(blend.AlphaToCoverageEnable);
+	key.U32(blend.IndependentBlendEnable);
+	UINT blendCount = blend.IndependentBlendEnable ? desc.NumRenderTargets : (desc.NumRenderTargets != 0 ? 1 : 0);
+	for (UINT i = 0; i < blendCount; ++i) {
+		const D3D12_RENDER_TARGET_BLEND_DESC &rt = blend.RenderTarget[i];
+		key.U32(rt.BlendEnable);
+		key.U32(rt.LogicOpEnable);
+		if (rt.BlendEnable) {
+			key.U32(rt.SrcBlend);
+			key.U32(rt.DestBlend);
+			key.U32(rt.BlendOp);
+			key.U32(rt.SrcBlendAlpha);
+			key.U32(rt.DestBlendAlpha);
+			key.U32(rt.BlendOpAlpha);
+		}
+		if (rt.LogicOpEnable)
+			key.U32(rt.LogicOp);
+		key.U32(rt.RenderTargetWriteMask);
+	}
+	key.U32(desc.SampleMask);
+
+	const D3D12_RASTERIZER_DESC &raster = desc.RasterizerState;
+	key.U32(raster.FillMode);
+	key.U32(raster.CullMode);
+	key.U32(raster.FrontCounterClockwise);
+	key.U32(static_cast<uint32_t>(raster.DepthBias));
+	CanonicalFloat(raster.DepthBiasClamp, key);
+	CanonicalFloat(raster.SlopeScaledDepthBias, key);
+	key.U32(raster.DepthClipEnable);
+	key.U32(raster.MultisampleEnable);
+	key.U32(raster.AntialiasedLineEnable);
+	key.U32(raster.ForcedSampleCount);
+	key.U32(raster.ConservativeRaster);
+
+	const D3D12_DEPTH_STENCIL_DESC &ds = desc.DepthStencilState;
+	key.U32(ds.DepthEnable);
+	if (ds.DepthEnable) {
+		key.U32(ds.DepthWriteMask);
+		key.U32(ds.DepthFunc);
+	}
+	key.U32(ds.StencilEnable);
+	if (ds.StencilEnable) {
+		key.U32(ds.StencilReadMask);
+		key.U32(ds.StencilWriteMask);
+		CanonicalizeStencilOp(ds.FrontFace, key);
+		CanonicalizeStencilOp(ds.BackFace, key);
+	}
+
+	const D3D12_INPUT_LAYOUT_DESC &layout = desc.InputLayout;
+	key.U32(layout.NumElements);
+	for (UINT i = 0; i < layout.NumElements; ++i) {
+		const D3D12_INPUT_ELEMENT_DESC &element = layout.pInputElementDescs[i];
+		key.String(element.SemanticName);
+		key.U32(element.SemanticIndex);
+		key.U32(element.Format);
+		key.U32(element.InputSlot);
+		key.U32(element.AlignedByteOffset);
+		key.U32(element.InputSlotClass);
+		key.U32(element.InputSlotClass == D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA ? element.InstanceDataStepRate : 0);
+	}
+
+	key.U32(desc.IBStripCutValue);
+	key.U32(desc.PrimitiveTopologyType);
+	key.U32(desc.NumRenderTargets);
+	for (UINT i = 0; i < desc.NumRenderTargets; ++i)
+		key.U32(desc.RTVFormats[i]);
+	key.U32(desc.DSVFormat);
+	key.U32(desc.SampleDesc.Count);
+	key.U32(desc.SampleDesc.Quality);
+	key.U32(desc.NodeMask);
+	key.U32(desc.Flags);
+}
@@ -0,0 +1,353 @@
+#include "RenderGraph.h"
+#include "BarrierTracker.h"
+#include "TransientAllocator.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+
+void RenderGraph::Reset() {
+	mPasses.clear();
+	mResources.clear();
+	mBarriers.clear();
+	mFinalBarriers.clear();
+	mStats = RenderGraphStats();
+}
+
+RenderGraphResource RenderGraph::Import(std::string name, ResourceState initialState, ResourceState finalState) {
+	Resource resource;
+	resource.Name = std::move(name);
+	resource.Imported = true;
+	resource.InitialState = initialState;
+	resource.FinalState = finalState;
+	mResources.push_back(std::move(resource));
+	return { static_cast<uint32_t>(mResources.size() - 1) };
+}
+
+RenderGraphResource RenderGraph::CreateTransient(std::string name, const RenderGraphResourceDesc &desc) {
+	Resource resource;
+	resource.Name = std::move(name);
+	resource.Desc = desc;
+	mResources.push_back(std::move(resource));
+	return { static_cast<uint32_t>(mResources.size() - 1) };
+}
+
+uint32_t RenderGraph::AddPass(std::string name, ExecuteFn execute) {
+	Pass pass;
+	pass.Name = std::move(name);
+	pass.Execute = std::move(execute);
+	mPasses.push_back(std::move(pass));
+	return static_cast<uint32_t>(mPasses.size() - 1);
+}
+
+void RenderGraph::AddUse(uint32_t pass, RenderGraphResource resource, ResourceState state, bool reads, bool writes) {
+	assert(pass < mPasses.size() && resource.Index < mResources.size());
+
+	// One entry per resource per pass; repeated reads merge their states.
+	for (Use &use : mPasses[pass].Uses) {
+		if (use.Resource != resource.Index)
+			continue;
+		assert((IsCombinableRead(use.State) && IsCombinableRead(state)) || use.State == state);
+		use.State = use.State | state;
+		use.Reads |= reads;
+		use.Writes |= writes;
+		return;
+	}
+	mPasses[pass].Uses.push_back({ resource.Index, state, reads, writes });
+}
+
+void RenderGraph::Read(uint32_t pass, RenderGraphResource resource, ResourceState state) {
+	AddUse(pass, resource, state, true, false);
+}
+
+void RenderGraph::Write(uint32_t pass, RenderGraphResource resource, ResourceState state) {
+	AddUse(pass, resource, state, false, true);
+}
+
+void RenderGraph::ReadWrite(uint32_t pass, RenderGraphResource resource, ResourceState state) {
+	AddUse(pass, resource, state, true, true);
+}
+
+void RenderGraph::SetSideEffects(uint32_t pass) {
+	mPasses[pass].SideEffects = true;
+}
+
+void RenderGraph::CullPasses() {
+	// Walk backwards from the observable results. A resource is "needed" when
+	// a later live pass reads its current contents, or it is imported and its
+	// contents survive the frame. A pass is live if it writes something needed.
+	std::vector<bool> needed(mResources.size());
+	for (size_t i = 0; i < mResources.size(); ++i)
+		needed[i] = mResources[i].Imported;
+
+	for (size_t p = mPasses.size(); p-- > 0;) {
+		Pass &pass = mPasses[p];
+		bool live = pass.SideEffects;
+		for (const Use &use : pass.Uses)
+			live = live || (use.Writes && needed[use.Resource]);
+
+		pass.Culled = !live;
+		if (!live)
+			continue;
+
+		// Overwriting kills the previous contents; reading needs them.
+		for (const Use &use : pass.Uses) {
+			if (use.Writes && !use.Reads)
+				needed[use.Resource] = false;
+		}
+		for (const Use &use : pass.Uses) {
+			if (use.Reads)
+				needed[use.Resource] = true;
+		}
+	}
+}
+
+void RenderGraph::ComputeLifetimes() {
+	for (uint32_t p = 0; p < mPasses.size(); ++p) {
+		if (mPasses[p].Culled)
+			continue;
+
+		for (const Use &use : mPasses[p].Uses) {
+			Resource &resource = mResources[use.Resource];
+			if (!resource.Lifetime.IsUsed()) {
+				resource.Lifetime.FirstPass = p;
+				// Created directly in the state of its first use.
+				if (!resource.Imported)
+					resource.InitialState = use.State;
+			}
+			resource.Lifetime.LastPass = p;
+		}
+	}
+}
+
+void RenderGraph::PlaceTransients() {
+	std::vector<uint32_t> transients;
+	std::vector<TransientAllocationRequest> requests;
+	for (uint32_t i = 0; i < mResources.size(); ++i) {
+		const Resource &resource = mResources[i];
+		if (resource.Imported || !resource.Lifetime.IsUsed())
+			continue;
+		transients.push_back(i);
+		requests.push_back({ resource.Desc.ByteSize, resource.Desc.Alignment,
+				resource.Lifetime.FirstPass, resource.Lifetime.LastPass });
+	}
+
+	TransientAllocationResult result;
+	PackTransientAllocations(requests, result);
+	mStats.TransientHeapSize = result.HeapSize;
+	mStats.TransientCommittedSize = result.CommittedSize;
+
+	// Anything sharing memory with another resource, earlier in the frame or
+	// later (and so in the previous frame), needs an aliasing barrier.
+	for (size_t a = 0; a < transients.size(); ++a) {
+		Resource &resource = mResources[transients[a]];
+		resource.HeapOffset = result.Offsets[a];
+		for (size_t b = 0; b < transients.size() && !resource.Aliased; ++b) {
+			resource.Aliased = b != a && result.Offsets[a] < result.Offsets[b] + requests[b].ByteSize &&
+					result.Offsets[b] < result.Offsets[a] + requests[a].ByteSize;
+		}
+	}
+}
+
+void RenderGraph::ComputeBarriers() {
+	std::vector<ResourceState> current(mResources.size());
+	std::vector<bool> lastUseWrote(mResources.size(), false);
+	for (size_t i = 0; i < mResources.size(); ++i)
+		current[i] = mResources[i].InitialState;
+
+	// Live uses of each resource in pass order, so looking ahead for reads to
+	// merge does not scan unrelated passes.
+	std::vector<std::vector<const Use *>> uses(mResources.size());
+	for (const Pass &pass : mPasses) {
+		if (pass.Culled)
+			continue;
+		for (const Use &use : pass.Uses)
+			uses[use.Resource].push_back(&use);
+	}
+	std::vector<uint32_t> nextUse(mResources.size(), 0);
+
+	for (uint32_t p = 0; p < mPasses.size(); ++p) {
+		Pass &pass = mPasses[p];
+		pass.BarrierBegin = static_cast<uint32_t>(mBarriers.size());
+		if (pass.Culled)
+			continue;
+
+		for (const Use &use : pass.Uses) {
+			Resource &resource = mResources[use.Resource];
+			ResourceState &state = current[use.Resource];
+			bool readOnly = !use.Writes && IsCombinableRead(use.State);
+			uint32_t useIndex = nextUse[use.Resource]++;
+			bool firstUse = useIndex == 0;
+
+			if (firstUse && resource.Aliased)
+				mBarriers.push_back({ RenderGraphBarrier::Aliasing, { use.Resource }, state, state });
+
+			if (state == ResourceState::UnorderedAccess && use.State == ResourceState::UnorderedAccess) {
+				if (!firstUse && (use.Writes || lastUseWrote[use.Resource]))
+					mBarriers.push_back({ RenderGraphBarrier::UavFlush, { use.Resource }, state, state });
+			} else if (readOnly && IsCombinableRead(state) && ContainsStates(state, use.State)) {
+				// Already readable this way.
+			} else if (state != use.State) {
+				// Going to a read state: also cover the reads that follow before
+				// the next write, so they need no barrier of their own.
+				ResourceState target = use.State;
+				const std::vector<const Use *> &later = uses[use.Resource];
+				for (size_t i = useIndex + 1; readOnly && i < later.size(); ++i) {
+					if (later[i]->Writes || !IsCombinableRead(later[i]->State))
+						readOnly = false;
+					else
+						target = target | later[i]->State;
+				}
+				mBarriers.push_back({ RenderGraphBarrier::Transition, { use.Resource }, state, target });
+				state = target;
+			}
+			lastUseWrote[use.Resource] = use.Writes;
+		}
+		pass.BarrierCount = static_cast<uint32_t>(mBarriers.size()) - pass.BarrierBegin;
+	}
+
+	// Imported resources go back to their final state after the last pass that
+	// touched them, transient ones to the state they were created in.
+	std::vector<std::pair<uint32_t, RenderGraphBarrier>> finals;
+	for (uint32_t i = 0; i < mResources.size(); ++i) {
+		const Resource &resource = mResources[i];
+		ResourceState finalState = resource.Imported ? resource.FinalState : resource.InitialState;
+		if (resource.Lifetime.IsUsed() && current[i] != finalState) {
+			finals.push_back({ resource.Lifetime.LastPass,
+					{ RenderGraphBarrier::Transition, { i }, current[i], finalState } });
+		}
+	}
+	std::stable_sort(finals.begin(), finals.end(),
+			[](const auto &a, const auto &b) { return a.first < b.first; });
+
+	size_t next = 0;
+	for (uint32_t p = 0; p < mPasses.size(); ++p) {
+		Pass &pass = mPasses[p];
+		pass.FinalBegin = static_cast<uint32_t>(mFinalBarriers.size());
+		for (; next < finals.size() && finals[next].first == p; ++next)
+			mFinalBarriers.push_back(finals[next].second);
+		pass.FinalCount = static_cast<uint32_t>(mFinalBarriers.size()) - pass.FinalBegin;
+	}
+}
+
+void RenderGraph::Compile() {
+	auto start = std::chrono::steady_clock::now();
+
+	mBarriers.clear();
+	mFinalBarriers.clear();
+	for (Resource &resource : mResources) {
+		resource.Lifetime = RenderGraphLifetime();
+		resource.HeapOffset = 0;
+		resource.Aliased = false;
+		if (!resource.Imported)
+			resource.InitialState = ResourceState::Common;
+	}
+
+	CullPasses();
+	ComputeLifetimes();
+	PlaceTransients();
+	ComputeBarriers();
+
+	mStats.Passes = PassCount();
+	mStats.CulledPasses = static_cast<uint32_t>(
+			std::count_if(mPasses.begin(), mPasses.end(), [](const Pass &pass) { return pass.Culled; }));
+	mStats.Barriers = static_cast<uint32_t>(mBarriers.size() + mFinalBarriers.size());
+	mStats.CompileSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+RenderGraphPassContext RenderGraph::PassContext(uint32_t pass) const {
+	const Pass &p = mPasses[pass];
+	RenderGraphPassContext context;
+	context.Pass = pass;
+	context.Before = mBarriers.data() + p.BarrierBegin;
+	context.BeforeCount = p.BarrierCount;
+	context.After = mFinalBarriers.data() + p.FinalBegin;
+	context.AfterCount = p.FinalCount;
+	return context;
+}
+
+void RenderGraph::Execute() const {
+	for (uint32_t p = 0; p < mPasses.size(); ++p) {
+		if (!mPasses[p].Culled && mPasses[p].Execute)
+			mPasses[p].Execute(PassContext(p));
+	}
+}
+
+static void DumpBarrier(std::string &out, const char *prefix, const std::string &resource, const RenderGraphBarrier &barrier) {
+	out += prefix;
+	if (barrier.Type == RenderGraphBarrier::UavFlush) {
+		out += "uav " + resource + "\n";
+	} else if (barrier.Type == RenderGraphBarrier::Aliasing) {
+		out += "alias " + resource + "\n";
+	} else {
+		out += "transition " + resource + " " + ResourceStateName(barrier.Before) + " -> " +
+				ResourceStateName(barrier.After) + "\n";
+	}
+}
+
+std::string RenderGraph::Dump() const {
+	std::string out;
+	char line[128];
+
+	for (uint32_t p = 0; p < mPasses.size(); ++p) {
+		const Pass &pass = mPasses[p];
+		snprintf(line, sizeof(line), "%s %u ", pass.Culled ? "culled" : "pass", p);
+		out += line + pass.Name + "\n";
+		if (pass.Culled)
+			continue;
+
+		for (uint32_t i = 0; i < pass.BarrierCount; ++i) {
+			const RenderGraphBarrier &barrier = mBarriers[pass.BarrierBegin + i];
+			DumpBarrier(out, "  before ", mResources[barrier.Resource.Index].Name, barrier);
+		}
+		for (uint32_t i = 0; i < pass.FinalCount; ++i) {
+			const RenderGraphBarrier &barrier = mFinalBarriers[pass.FinalBegin + i];
+			DumpBarrier(out, "  after ", mResources[barrier.Resource.Index].Name, barrier);
+		}
+	}
+
+	for (uint32_t i = 0; i < mResources.size(); ++i) {
+		const Resource &resource = mResources[i];
+		snprintf(line, sizeof(line), "resource %u ", i);
+		out += line + resource.Name;
+		if (resource.Imported) {
+			out += " imported";
+		} else {
+			snprintf(line, sizeof(line), " transient %llu bytes", static_cast<unsigned long long>(resource.Desc.ByteSize));
+			out += line;
+		}
+
+		if (!resource.Lifetime.IsUsed()) {
+			out += " unused\n";
+			continue;
+		}
+		snprintf(line, sizeof(line), " passes %u..%u", resource.Lifetime.FirstPass, resource.Lifetime.LastPass);
+		out += line;
+		if (!resource.Imported) {
+			snprintf(line, sizeof(line), " at %llu", static_cast<unsigned long long>(resource.HeapOffset));
+			out += line;
+			out += " created as " + ResourceStateName(resource.InitialState);
+		}
+		out += "\n";
+	}
+
+	snprintf(line, sizeof(line), "transient heap %llu bytes (committed %llu)\n",
+			static_cast<unsigned long long>(mStats.TransientHeapSize),
+			static_cast<unsigned long long>(mStats.TransientCommittedSize));
+	out += line;
+	return out;
+}
+
+void TrackBarriers(BarrierTracker &tracker, const RenderGraphBarrier *barriers, uint32_t count,
+		const void *const *resources) {
+	for (uint32_t i = 0; i < count; ++i) {
+		const RenderGraphBarrier &barrier = barriers[i];
+		const void *resource = resources[barrier.Resource.Index];
+		if (barrier.Type == RenderGraphBarrier::UavFlush)
+			tracker.UavBarrier(resource);
+		else if (barrier.Type == RenderGraphBarrier::Aliasing)
+			tracker.AliasingBarrier(resource);
+		else
+			tracker.Transition(resource, barrier.After);
+	}
+}
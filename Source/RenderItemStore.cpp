@@ -0,0 +1,188 @@
+#include "RenderItemStore.h"
+#include <bit>
+#include <cassert>
+
+RenderItemStore::RenderItemStore(uint32_t maxItems, uint32_t framesInFlight) :
+		mMaxItems(maxItems),
+		mDirtyBits(framesInFlight, std::vector<uint64_t>((maxItems + 63) / 64, 0)) {
+	mWorld.reserve(maxItems);
+	mColor.reserve(maxItems);
+	mGeoIndex.reserve(maxItems);
+	mMaterialIndex.reserve(maxItems);
+	mPrimitiveType.reserve(maxItems);
+	mIndexCount.reserve(maxItems);
+	mStartIndexLocation.reserve(maxItems);
+	mBaseVertexLocation.reserve(maxItems);
+	mDenseToSlot.reserve(maxItems);
+	mLocalCenter.reserve(maxItems);
+	mLocalExtents.reserve(maxItems);
+}
+
+RenderItemHandle RenderItemStore::Create(const RenderItemDesc &desc) {
+	if (Size() >= mMaxItems)
+		return RenderItemHandle();
+
+	uint32_t slot;
+	if (!mFreeSlots.empty()) {
+		slot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+	} else {
+		slot = static_cast<uint32_t>(mSlotToDense.size());
+		mSlotToDense.push_back(0);
+		mSlotGeneration.push_back(0);
+	}
+
+	uint32_t index = Size();
+	mSlotToDense[slot] = index;
+
+	mWorld.push_back(desc.World);
+	mColor.push_back(desc.Color);
+	mGeoIndex.push_back(desc.GeoIndex);
+	mMaterialIndex.push_back(desc.MaterialIndex);
+	mPrimitiveType.push_back(desc.PrimitiveType);
+	mIndexCount.push_back(desc.IndexCount);
+	mStartIndexLocation.push_back(desc.StartIndexLocation);
+	mBaseVertexLocation.push_back(desc.BaseVertexLocation);
+	mDenseToSlot.push_back(slot);
+	mLocalCenter.push_back(desc.BoundsCenter);
+	mLocalExtents.push_back(desc.BoundsExtents);
+	mWorldBounds.PushBack(desc.BoundsCenter, desc.BoundsExtents);
+
+	UpdateWorldBounds(index);
+	MarkDirty(index);
+
+	RenderItemHandle handle;
+	handle.Slot = slot;
+	handle.Generation = mSlotGeneration[slot];
+	return handle;
+}
+
+void RenderItemStore::Destroy(RenderItemHandle handle) {
+	if (!IsAlive(handle))
+		return;
+
+	uint32_t index = mSlotToDense[handle.Slot];
+	uint32_t last = Size() - 1;
+	if (index != last) {
+		// Move the last item into the hole. Its constants now live at a new
+		// ObjectCB slot, so every frame resource needs them repacked.
+		mWorld[index] = mWorld[last];
+		mColor[index] = mColor[last];
+		mGeoIndex[index] = mGeoIndex[last];
+		mMaterialIndex[index] = mMaterialIndex[last];
+		mPrimitiveType[index] = mPrimitiveType[last];
+		mIndexCount[index] = mIndexCount[last];
+		mStartIndexLocation[index] = mStartIndexLocation[last];
+		mBaseVertexLocation[index] = mBaseVertexLocation[last];
+		mDenseToSlot[index] = mDenseToSlot[last];
+		mLocalCenter[index] = mLocalCenter[last];
+		mLocalExtents[index] = mLocalExtents[last];
+		mWorldBounds.Copy(index, last);
+		mSlotToDense[mDenseToSlot[index]] = index;
+		MarkDirty(index);
+	}
+	ClearDirty(last);
+
+	mWorld.pop_back();
+	mColor.pop_back();
+	mGeoIndex.pop_back();
+	mMaterialIndex.pop_back();
+	mPrimitiveType.pop_back();
+	mIndexCount.pop_back();
+	mStartIndexLocation.pop_back();
+	mBaseVertexLocation.pop_back();
+	mDenseToSlot.pop_back();
+	mLocalCenter.pop_back();
+	mLocalExtents.pop_back();
+	mWorldBounds.PopBack();
+
+	++mSlotGeneration[handle.Slot];
+	mFreeSlots.push_back(handle.Slot);
+}
+
+bool RenderItemStore::IsAlive(RenderItemHandle handle) const {
+	return handle.Slot < mSlotGeneration.size() && mSlotGeneration[handle.Slot] == handle.Generation;
+}
+
+uint32_t RenderItemStore::IndexOf(RenderItemHandle handle) const {
+	assert(IsAlive(handle));
+	return mSlotToDense[handle.Slot];
+}
+
+void RenderItemStore::SetWorld(RenderItemHandle handle, const Float4x4 &world) {
+	uint32_t index = IndexOf(handle);
+	mWorld[index] = world;
+	UpdateWorldBounds(index);
+	MarkDirty(index);
+}
+
+void RenderItemStore::SetColor(RenderItemHandle handle, const Float4 &color) {
+	uint32_t index = IndexOf(handle);
+	mColor[index] = color;
+	MarkDirty(index);
+}
+
+void RenderItemStore::SetDrawArgs(RenderItemHandle handle, uint32_t indexCount, uint32_t startIndexLocation) {
+	uint32_t index = IndexOf(handle);
+	mIndexCount[index] = indexCount;
+	mStartIndexLocation[index] = startIndexLocation;
+}
+
+void RenderItemStore::MarkDirty(uint32_t index) {
+	uint64_t bit = uint64_t(1) << (index & 63);
+	for (std::vector<uint64_t> &bits : mDirtyBits)
+		bits[index >> 6] |= bit;
+}
+
+void RenderItemStore::MarkAllDirty() {
+	uint32_t count = Size();
+	size_t fullWords = count >> 6;
+	uint64_t tail = (count & 63) ? (uint64_t(1) << (count & 63)) - 1 : 0;
+	for (std::vector<uint64_t> &bits : mDirtyBits) {
+		for (size_t w = 0; w < fullWords; ++w)
+			bits[w] = ~uint64_t(0);
+		if (tail != 0)
+			bits[fullWords] |= tail;
+	}
+}
+
+void RenderItemStore::UpdateWorldBounds(uint32_t index) {
+	Float3 center, extents;
+	TransformAabb(mLocalCenter[index], mLocalExtents[index], mWorld[index], center, extents);
+	mWorldBounds.Set(index, center, extents);
+}
+
+void RenderItemStore::ClearDirty(uint32_t index) {
+	uint64_t mask = ~(uint64_t(1) << (index & 63));
+	for (std::vector<uint64_t> &bits : mDirtyBits)
+		bits[index >> 6] &= mask;
+}
+
+size_t RenderItemStore::TakeDirtyRun(std::vector<uint64_t> &bits, size_t &word, uint32_t &first) {
+	// Find the start of the next run.
+	while (word < bits.size() && bits[word] == 0)
+		++word;
+	if (word == bits.size())
+		return 0;
+
+	int bit = std::countr_zero(bits[word]);
+	first = static_cast<uint32_t>(word * 64 + bit);
+
+	// Extend it across as many set bits (and whole words) as possible,
+	// clearing them as we go.
+	size_t count = 0;
+	while (word < bits.size()) {
+		uint64_t shifted = bits[word] >> bit;
+		int ones = std::countr_one(shifted);
+		uint64_t runMask = ones == 64 ? ~uint64_t(0) : ((uint64_t(1) << ones) - 1) << bit;
+		bits[word] &= ~runMask;
+		count += ones;
+		if (bit + ones < 64)
+			break;
+		++word;
+		bit = 0;
+		if (word < bits.size() && (bits[word] & 1) == 0)
+			break;
+	}
+	return count;
+}
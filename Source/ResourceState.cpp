@@ -0,0 +1,31 @@
+#include "ResourceState.h"
+
+static const char *const sStateNames[] = {
+	"VertexAndConstantBuffer",
+	"IndexBuffer",
+	"ShaderResource",
+	"IndirectArgument",
+	"CopySource",
+	"DepthRead",
+	"Present",
+	"RenderTarget",
+	"DepthWrite",
+	"UnorderedAccess",
+	"CopyDest",
+};
+
+std::string ResourceStateName(ResourceState state) {
+	uint32_t bits = static_cast<uint32_t>(state);
+	if (bits == 0)
+		return "Common";
+
+	std::string name;
+	for (uint32_t i = 0; i < sizeof(sStateNames) / sizeof(sStateNames[0]); ++i) {
+		if ((bits & (1u << i)) == 0)
+			continue;
+		if (!name.empty())
+			name += '|';
+		name += sStateNames[i];
+	}
+	return name;
+}
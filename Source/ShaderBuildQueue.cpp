@@ -0,0 +1,106 @@
+#include "ShaderBuildQueue.h"
+#include <algorithm>
+
+ShaderBuildQueue::ShaderBuildQueue(JobSystem *jobs, ShaderCache *cache) :
+		mJobs(jobs),
+		mCache(cache) {
+}
+
+ShaderBuildQueue::~ShaderBuildQueue() {
+	// Jobs write into mBuilds; never let them outlive it.
+	WaitAll();
+}
+
+ShaderBuildHandle ShaderBuildQueue::Enqueue(const ShaderCompileRequest &request) {
+	if (mStats.Requested++ == 0)
+		mStartTime = std::chrono::steady_clock::now();
+
+	uint64_t key = mCache->HashRequest(request);
+	auto it = mHandleByKey.find(key);
+	if (it != mHandleByKey.end()) {
+		++mStats.Deduplicated;
+		return it->second;
+	}
+
+	ShaderBuildHandle handle = static_cast<ShaderBuildHandle>(mBuilds.size());
+	mHandleByKey.emplace(key, handle);
+	Build &build = mBuilds.emplace_back();
+	build.Request = request;
+	build.Key = key;
+
+	auto run = [this, &build]() {
+		auto start = std::chrono::steady_clock::now();
+		build.Succeeded = mCache->GetOrCompile(build.Key, build.Request, build.ByteCode, &build.Errors);
+		build.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	};
+	if (mJobs != nullptr)
+		mJobs->Run(run, &mCounter);
+	else
+		run();
+	return handle;
+}
+
+void ShaderBuildQueue::WaitAll() {
+	if (mJobs != nullptr)
+		mJobs->Wait(mCounter);
+
+	if (mStats.Built == mBuilds.size())
+		return;
+
+	mStats.Built = static_cast<uint32_t>(mBuilds.size());
+	mStats.SerialSeconds = 0.0;
+	for (const Build &build : mBuilds)
+		mStats.SerialSeconds += build.Seconds;
+	mStats.WallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - mStartTime).count();
+}
+
+// A fixed amount of arithmetic; returned so it cannot be optimized out.
+static uint32_t SpinWork(uint64_t iterations) {
+	uint32_t state = 1;
+	for (uint64_t i = 0; i < iterations; ++i)
+		state = state * 1664525u + 1013904223u;
+	return state;
+}
+
+FakeShaderCompiler::FakeShaderCompiler(double millisecondsPerShader, bool spin) :
+		mMilliseconds(millisecondsPerShader),
+		mSpin(spin) {
+	if (!mSpin || mMilliseconds <= 0.0)
+		return;
+	// Spin a calibrated amount of work rather than until a deadline, so
+	// compiles that share a core take longer, as real ones do.
+	const uint64_t Probe = 4000000;
+	auto start = std::chrono::steady_clock::now();
+	mSink += SpinWork(Probe);
+	double probeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	mSpinIterations = static_cast<uint64_t>(Probe * mMilliseconds / std::max(probeMs, 1e-3));
+}
+
+ShaderCompileFn FakeShaderCompiler::Fn() {
+	return [this](const ShaderCompileRequest &request, std::vector<uint8_t> &byteCode, std::string &errors) {
+		return Compile(request, byteCode, errors);
+	};
+}
+
+bool FakeShaderCompiler::Compile(const ShaderCompileRequest &request, std::vector<uint8_t> &byteCode,
+		std::string &errors) {
+	++mCalls;
+	uint32_t running = ++mRunning;
+	uint32_t peak = mPeak.load();
+	while (running > peak && !mPeak.compare_exchange_weak(peak, running)) {
+	}
+
+	if (mSpin)
+		mSink += SpinWork(mSpinIterations);
+	else
+		std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(mMilliseconds));
+	--mRunning;
+
+	if (request.EntryPoint.compare(0, 6, "Broken") == 0) {
+		errors = request.EntryPoint + ": error X3000: syntax error";
+		return false;
+	}
+	byteCode.assign(request.EntryPoint.begin(), request.EntryPoint.end());
+	byteCode.insert(byteCode.end(), request.Target.begin(), request.Target.end());
+	return true;
+}
@@ -0,0 +1,243 @@
+#include "ShaderCache.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unordered_set>
+
+static const uint32_t kCacheMagic = 0x43535350; // "PSSC"
+static const uint32_t kCacheVersion = 1;
+
+struct CacheHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t EntryCount;
+};
+
+struct CacheIndexEntry {
+	uint64_t Key;
+	uint64_t Offset;
+	uint64_t ByteSize;
+};
+
+// 64-bit FNV-1a. Every field is hashed with its length so that adjacent
+// strings cannot run into each other.
+class ShaderHasher {
+public:
+	void Bytes(const void *data, size_t size) {
+		const uint8_t *bytes = static_cast<const uint8_t *>(data);
+		for (size_t i = 0; i < size; ++i) {
+			mHash ^= bytes[i];
+			mHash *= 1099511628211ull;
+		}
+	}
+	void Field(const void *data, size_t size) {
+		uint64_t length = size;
+		Bytes(&length, sizeof(length));
+		Bytes(data, size);
+	}
+	void Field(const std::string &s) { Field(s.data(), s.size()); }
+
+	uint64_t Value() const { return mHash; }
+
+private:
+	uint64_t mHash = 14695981039346656037ull;
+};
+
+static bool ReadFile(const std::filesystem::path &path, std::string &contents) {
+	std::ifstream fin(path, std::ios::binary);
+	if (!fin)
+		return false;
+	contents.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+	return true;
+}
+
+// Hashes a file and, depth first, every file it includes. Only the textual
+// #include "file" / <file> form is recognized; anything it cannot open is
+// hashed by name so the compiler gets to report it.
+static void HashSourceTree(const std::filesystem::path &path, ShaderHasher &hasher,
+		std::unordered_set<std::string> &visited) {
+	std::filesystem::path normalized = path.lexically_normal();
+	if (!visited.insert(normalized.generic_string()).second)
+		return;
+
+	std::string source;
+	if (!ReadFile(normalized, source)) {
+		hasher.Field("<missing>");
+		hasher.Field(normalized.generic_string());
+		return;
+	}
+	hasher.Field(source);
+
+	size_t pos = 0;
+	while (pos < source.size()) {
+		size_t end = source.find('\n', pos);
+		if (end == std::string::npos)
+			end = source.size();
+
+		size_t i = source.find_first_not_of(" \t", pos);
+		if (i < end && source.compare(i, 8, "#include") == 0) {
+			size_t open = source.find_first_of("\"<", i + 8);
+			if (open < end) {
+				char closeChar = source[open] == '"' ? '"' : '>';
+				size_t close = source.find(closeChar, open + 1);
+				if (close < end) {
+					std::string name = source.substr(open + 1, close - open - 1);
+					HashSourceTree(normalized.parent_path() / name, hasher, visited);
+				}
+			}
+		}
+		pos = end + 1;
+	}
+}
+
+ShaderCache::ShaderCache(std::filesystem::path cachePath, ShaderCompileFn compiler, std::string compilerVersion) :
+		mCachePath(std::move(cachePath)),
+		mCompiler(std::move(compiler)),
+		mCompilerVersion(std::move(compilerVersion)) {
+}
+
+bool ShaderCache::Load() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mEntries.clear();
+	mDirty = false;
+
+	std::string file;
+	if (!ReadFile(mCachePath, file))
+		return false;
+
+	CacheHeader header;
+	if (file.size() < sizeof(header))
+		return false;
+	memcpy(&header, file.data(), sizeof(header));
+	if (header.Magic != kCacheMagic || header.Version != kCacheVersion)
+		return false;
+
+	uint64_t indexEnd = sizeof(header) + header.EntryCount * sizeof(CacheIndexEntry);
+	if (header.EntryCount > file.size() / sizeof(CacheIndexEntry) || indexEnd > file.size())
+		return false;
+
+	for (uint64_t i = 0; i < header.EntryCount; ++i) {
+		CacheIndexEntry entry;
+		memcpy(&entry, file.data() + sizeof(header) + i * sizeof(entry), sizeof(entry));
+		if (entry.Offset < indexEnd || entry.Offset > file.size() || entry.ByteSize > file.size() - entry.Offset) {
+			mEntries.clear();
+			return false;
+		}
+
+		const uint8_t *blob = reinterpret_cast<const uint8_t *>(file.data()) + entry.Offset;
+		mEntries[entry.Key].ByteCode.assign(blob, blob + entry.ByteSize);
+	}
+	return true;
+}
+
+bool ShaderCache::Save(bool pruneUnused) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	// Entries nobody asked for this run belong to old sources or options.
+	if (pruneUnused) {
+		std::erase_if(mEntries, [this](const auto &item) {
+			if (item.second.Used)
+				return false;
+			mDirty = true;
+			return true;
+		});
+	}
+	if (!mDirty)
+		return true;
+
+	CacheHeader header = { kCacheMagic, kCacheVersion, mEntries.size() };
+	std::vector<CacheIndexEntry> index;
+	index.reserve(mEntries.size());
+	uint64_t offset = sizeof(header) + mEntries.size() * sizeof(CacheIndexEntry);
+	for (const auto &[key, entry] : mEntries) {
+		index.push_back({ key, offset, entry.ByteCode.size() });
+		offset += entry.ByteCode.size();
+	}
+
+	// Write to a temporary file and swap it in, so a crash mid-write never
+	// leaves a truncated cache behind.
+	std::filesystem::path tempPath = mCachePath;
+	tempPath += ".tmp";
+	{
+		std::ofstream fout(tempPath, std::ios::binary | std::ios::trunc);
+		if (!fout)
+			return false;
+		fout.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		fout.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(CacheIndexEntry));
+		for (const auto &[key, entry] : mEntries)
+			fout.write(reinterpret_cast<const char *>(entry.ByteCode.data()), entry.ByteCode.size());
+		if (!fout)
+			return false;
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, mCachePath, ec);
+	if (ec)
+		return false;
+
+	mDirty = false;
+	return true;
+}
+
+uint64_t ShaderCache::HashRequest(const ShaderCompileRequest &request) const {
+	ShaderHasher hasher;
+	hasher.Field(mCompilerVersion);
+	std::unordered_set<std::string> visited;
+	HashSourceTree(request.SourcePath, hasher, visited);
+
+	uint64_t defineCount = request.Defines.size();
+	hasher.Bytes(&defineCount, sizeof(defineCount));
+	for (const auto &[name, value] : request.Defines) {
+		hasher.Field(name);
+		hasher.Field(value);
+	}
+	hasher.Field(request.EntryPoint);
+	hasher.Field(request.Target);
+	hasher.Bytes(&request.Flags, sizeof(request.Flags));
+	return hasher.Value();
+}
+
+size_t ShaderCache::EntryCount() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mEntries.size();
+}
+
+ShaderCacheStats ShaderCache::Stats() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStats;
+}
+
+bool ShaderCache::GetOrCompile(const ShaderCompileRequest &request, std::vector<uint8_t> &byteCode,
+		std::string *errors) {
+	return GetOrCompile(HashRequest(request), request, byteCode, errors);
+}
+
+bool ShaderCache::GetOrCompile(uint64_t key, const ShaderCompileRequest &request, std::vector<uint8_t> &byteCode,
+		std::string *errors) {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto it = mEntries.find(key);
+		if (it != mEntries.end()) {
+			++mStats.Hits;
+			it->second.Used = true;
+			byteCode = it->second.ByteCode;
+			return true;
+		}
+		++mStats.Misses;
+	}
+
+	std::string compileErrors;
+	bool compiled = mCompiler(request, byteCode, compileErrors);
+	if (errors != nullptr)
+		*errors = std::move(compileErrors);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!compiled) {
+		++mStats.Failures;
+		return false;
+	}
+	Entry &entry = mEntries[key];
+	entry.ByteCode = byteCode;
+	entry.Used = true;
+	mDirty = true;
+	return true;
+}
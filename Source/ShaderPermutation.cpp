@@ -0,0 +1,106 @@
+#include "ShaderPermutation.h"
+#include <bit>
+#include <cassert>
+
+uint32_t ShaderPermutationDesc::AddBool(const std::string &define) {
+	Option option;
+	option.Define = define;
+	return AddOption(std::move(option));
+}
+
+uint32_t ShaderPermutationDesc::AddEnum(const std::string &define, std::vector<std::string> values) {
+	assert(values.size() >= 2);
+	Option option;
+	option.Define = define;
+	option.ValueCount = static_cast<uint32_t>(values.size());
+	option.Values = std::move(values);
+	return AddOption(std::move(option));
+}
+
+uint32_t ShaderPermutationDesc::AddOption(Option option) {
+	option.Shift = mKeyBits;
+	option.Bits = std::bit_width(option.ValueCount - 1);
+	assert(mKeyBits + option.Bits <= 64);
+	mKeyBits += option.Bits;
+	mOptions.push_back(std::move(option));
+	return static_cast<uint32_t>(mOptions.size() - 1);
+}
+
+uint64_t ShaderPermutationDesc::Set(uint64_t key, uint32_t option, uint32_t value) const {
+	const Option &opt = mOptions[option];
+	if (value >= opt.ValueCount)
+		return key;
+	uint64_t mask = ((uint64_t(1) << opt.Bits) - 1) << opt.Shift;
+	return (key & ~mask) | (uint64_t(value) << opt.Shift);
+}
+
+uint32_t ShaderPermutationDesc::Get(uint64_t key, uint32_t option) const {
+	const Option &opt = mOptions[option];
+	return static_cast<uint32_t>((key >> opt.Shift) & ((uint64_t(1) << opt.Bits) - 1));
+}
+
+bool ShaderPermutationDesc::IsValid(uint64_t key) const {
+	if (mKeyBits < 64 && (key >> mKeyBits) != 0)
+		return false;
+	for (uint32_t i = 0; i < OptionCount(); ++i)
+		if (Get(key, i) >= mOptions[i].ValueCount)
+			return false;
+	return true;
+}
+
+void ShaderPermutationDesc::AppendDefines(uint64_t key,
+		std::vector<std::pair<std::string, std::string>> &defines) const {
+	for (uint32_t i = 0; i < OptionCount(); ++i) {
+		const Option &opt = mOptions[i];
+		uint32_t value = Get(key, i);
+		if (opt.Values.empty())
+			defines.emplace_back(opt.Define, value != 0 ? "1" : "0");
+		else
+			defines.emplace_back(opt.Define, opt.Values[value]);
+	}
+}
+
+ShaderVariantCache::ShaderVariantCache(const ShaderPermutationDesc *desc, ShaderCompileRequest baseRequest,
+		ShaderCache *cache, size_t capacity) :
+		mDesc(desc),
+		mBaseRequest(std::move(baseRequest)),
+		mCache(cache),
+		mCapacity(capacity > 0 ? capacity : 1) {
+}
+
+ShaderCompileRequest ShaderVariantCache::MakeRequest(uint64_t key) const {
+	ShaderCompileRequest request = mBaseRequest;
+	mDesc->AppendDefines(key, request.Defines);
+	return request;
+}
+
+ShaderVariantCache::ByteCode ShaderVariantCache::Get(uint64_t key, std::string *errors) {
+	auto it = mVariants.find(key);
+	if (it != mVariants.end()) {
+		++mStats.Hits;
+		mLru.splice(mLru.begin(), mLru, it->second);
+		return it->second->Code;
+	}
+
+	++mStats.Misses;
+	if (!mDesc->IsValid(key)) {
+		if (errors != nullptr)
+			*errors = "invalid variant key " + std::to_string(key);
+		++mStats.Failures;
+		return nullptr;
+	}
+	auto code = std::make_shared<std::vector<uint8_t>>();
+	if (!mCache->GetOrCompile(MakeRequest(key), *code, errors)) {
+		++mStats.Failures;
+		return nullptr;
+	}
+
+	if (mVariants.size() == mCapacity) {
+		mVariants.erase(mLru.back().Key);
+		mLru.pop_back();
+		++mStats.Evictions;
+	}
+	mLru.push_front({ key, code });
+	mVariants.emplace(key, mLru.begin());
+	return code;
+}
@@ -0,0 +1,235 @@
+#include "TransformBatch.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TRANSFORM_BATCH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// GCC and clang(-cl) only emit AVX2/FMA instructions inside functions that are
+// explicitly allowed to; MSVC does not need the annotation.
+#if defined(__clang__) || defined(__GNUC__)
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define TARGET_AVX2
+#endif
+
+static void StoreTransposed(uint8_t *dst, const Float4x4 &m) {
+	float t[4][4];
+	for (int r = 0; r < 4; ++r)
+		for (int c = 0; c < 4; ++c)
+			t[c][r] = m.m[r][c];
+	memcpy(dst, t, sizeof(t));
+}
+
+static void BatchScalar(const Float4x4 *worlds, uint32_t count, const Float4x4 &viewProj,
+		uint8_t *out, const TransformStreamLayout &layout) {
+	for (uint32_t i = 0; i < count; ++i, out += layout.Stride) {
+		const Float4x4 &w = worlds[i];
+		Float4x4 wvp;
+		for (int r = 0; r < 4; ++r) {
+			for (int c = 0; c < 4; ++c) {
+				wvp.m[r][c] = w.m[r][0] * viewProj.m[0][c] + w.m[r][1] * viewProj.m[1][c] +
+						w.m[r][2] * viewProj.m[2][c] + w.m[r][3] * viewProj.m[3][c];
+			}
+		}
+		StoreTransposed(out + layout.WorldViewProjOffset, wvp);
+		StoreTransposed(out + layout.WorldOffset, w);
+	}
+}
+
+static void TransposeScalar(const Float4x4 *worlds, uint32_t count, uint8_t *out, const TransformStreamLayout &layout) {
+	for (uint32_t i = 0; i < count; ++i, out += layout.Stride)
+		StoreTransposed(out + layout.WorldOffset, worlds[i]);
+}
+
+#if defined(TRANSFORM_BATCH_X86)
+
+static inline void StoreTransposedSSE(uint8_t *dst, __m128 r0, __m128 r1, __m128 r2, __m128 r3) {
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	float *f = reinterpret_cast<float *>(dst);
+	_mm_storeu_ps(f + 0, r0);
+	_mm_storeu_ps(f + 4, r1);
+	_mm_storeu_ps(f + 8, r2);
+	_mm_storeu_ps(f + 12, r3);
+}
+
+// One output row: row . viewProj, i.e. sum_k row[k] * vp[k].
+static inline __m128 RowTimesMatrixSSE(const float *row, __m128 vp0, __m128 vp1, __m128 vp2, __m128 vp3) {
+	__m128 x = _mm_mul_ps(_mm_set1_ps(row[0]), vp0);
+	__m128 y = _mm_mul_ps(_mm_set1_ps(row[1]), vp1);
+	__m128 z = _mm_mul_ps(_mm_set1_ps(row[2]), vp2);
+	__m128 w = _mm_mul_ps(_mm_set1_ps(row[3]), vp3);
+	return _mm_add_ps(_mm_add_ps(x, y), _mm_add_ps(z, w));
+}
+
+static void BatchSSE2(const Float4x4 *worlds, uint32_t count, const Float4x4 &viewProj,
+		uint8_t *out, const TransformStreamLayout &layout) {
+	__m128 vp0 = _mm_loadu_ps(viewProj.m[0]);
+	__m128 vp1 = _mm_loadu_ps(viewProj.m[1]);
+	__m128 vp2 = _mm_loadu_ps(viewProj.m[2]);
+	__m128 vp3 = _mm_loadu_ps(viewProj.m[3]);
+
+	for (uint32_t i = 0; i < count; ++i, out += layout.Stride) {
+		const Float4x4 &w = worlds[i];
+		StoreTransposedSSE(out + layout.WorldViewProjOffset,
+				RowTimesMatrixSSE(w.m[0], vp0, vp1, vp2, vp3),
+				RowTimesMatrixSSE(w.m[1], vp0, vp1, vp2, vp3),
+				RowTimesMatrixSSE(w.m[2], vp0, vp1, vp2, vp3),
+				RowTimesMatrixSSE(w.m[3], vp0, vp1, vp2, vp3));
+		StoreTransposedSSE(out + layout.WorldOffset,
+				_mm_loadu_ps(w.m[0]), _mm_loadu_ps(w.m[1]), _mm_loadu_ps(w.m[2]), _mm_loadu_ps(w.m[3]));
+	}
+}
+
+static void TransposeSSE2(const Float4x4 *worlds, uint32_t count, uint8_t *out, const TransformStreamLayout &layout) {
+	for (uint32_t i = 0; i < count; ++i, out += layout.Stride) {
+		const Float4x4 &w = worlds[i];
+		StoreTransposedSSE(out + layout.WorldOffset,
+				_mm_loadu_ps(w.m[0]), _mm_loadu_ps(w.m[1]), _mm_loadu_ps(w.m[2]), _mm_loadu_ps(w.m[3]));
+	}
+}
+
+// Two rows of the world matrix at a time: the low lane carries row r, the high
+// lane row r + 1, and each view-projection row is broadcast into both lanes.
+TARGET_AVX2 static inline __m256 RowPairTimesMatrixAVX2(__m256 rows, __m256 vp0, __m256 vp1, __m256 vp2, __m256 vp3) {
+	__m256 acc = _mm256_mul_ps(_mm256_permute_ps(rows, _MM_SHUFFLE(0, 0, 0, 0)), vp0);
+	acc = _mm256_fmadd_ps(_mm256_permute_ps(rows, _MM_SHUFFLE(1, 1, 1, 1)), vp1, acc);
+	acc = _mm256_fmadd_ps(_mm256_permute_ps(rows, _MM_SHUFFLE(2, 2, 2, 2)), vp2, acc);
+	acc = _mm256_fmadd_ps(_mm256_permute_ps(rows, _MM_SHUFFLE(3, 3, 3, 3)), vp3, acc);
+	return acc;
+}
+
+TARGET_AVX2 static void BatchAVX2(const Float4x4 *worlds, uint32_t count, const Float4x4 &viewProj,
+		uint8_t *out, const TransformStreamLayout &layout) {
+	__m256 vp0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(viewProj.m[0]));
+	__m256 vp1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(viewProj.m[1]));
+	__m256 vp2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(viewProj.m[2]));
+	__m256 vp3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(viewProj.m[3]));
+
+	for (uint32_t i = 0; i < count; ++i, out += layout.Stride) {
+		const float *w = &worlds[i].m[0][0];
+		__m256 w01 = _mm256_loadu_ps(w);
+		__m256 w23 = _mm256_loadu_ps(w + 8);
+		__m256 r01 = RowPairTimesMatrixAVX2(w01, vp0, vp1, vp2, vp3);
+		__m256 r23 = RowPairTimesMatrixAVX2(w23, vp0, vp1, vp2, vp3);
+
+		StoreTransposedSSE(out + layout.WorldViewProjOffset,
+				_mm256_castps256_ps128(r01), _mm256_extractf128_ps(r01, 1),
+				_mm256_castps256_ps128(r23), _mm256_extractf128_ps(r23, 1));
+		StoreTransposedSSE(out + layout.WorldOffset,
+				_mm256_castps256_ps128(w01), _mm256_extractf128_ps(w01, 1),
+				_mm256_castps256_ps128(w23), _mm256_extractf128_ps(w23, 1));
+	}
+}
+
+static SimdPath DetectSimdPathX86() {
+	int regs[4] = {};
+#if defined(_MSC_VER) && !defined(__clang__)
+	__cpuid(regs, 0);
+	int maxLeaf = regs[0];
+	__cpuid(regs, 1);
+#else
+	int maxLeaf = __get_cpuid_max(0, nullptr);
+	__cpuid(1, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	bool fma = (regs[2] & (1 << 12)) != 0;
+	bool osxsave = (regs[2] & (1 << 27)) != 0;
+	bool avx = (regs[2] & (1 << 28)) != 0;
+
+	bool avx2 = false;
+	if (maxLeaf >= 7) {
+#if defined(_MSC_VER) && !defined(__clang__)
+		__cpuidex(regs, 7, 0);
+#else
+		__cpuid_count(7, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+		avx2 = (regs[1] & (1 << 5)) != 0;
+	}
+
+	// The OS must also save the YMM registers across context switches.
+	bool ymmEnabled = false;
+	if (osxsave && avx) {
+#if defined(_MSC_VER) && !defined(__clang__)
+		unsigned long long xcr0 = _xgetbv(0);
+#else
+		unsigned int eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		unsigned long long xcr0 = (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+		ymmEnabled = (xcr0 & 0x6) == 0x6;
+	}
+
+	if (avx2 && fma && ymmEnabled)
+		return SimdPath::AVX2;
+	return SimdPath::SSE2;
+}
+
+#endif // TRANSFORM_BATCH_X86
+
+SimdPath DetectSimdPath() {
+#if defined(TRANSFORM_BATCH_X86)
+	static const SimdPath path = DetectSimdPathX86();
+	return path;
+#else
+	return SimdPath::Scalar;
+#endif
+}
+
+const char *SimdPathName(SimdPath path) {
+	switch (path) {
+		case SimdPath::AVX2:
+			return "AVX2";
+		case SimdPath::SSE2:
+			return "SSE2";
+		default:
+			return "Scalar";
+	}
+}
+
+void BatchWorldViewProj(const Float4x4 *worlds, uint32_t count, const Float4x4 &viewProj,
+		uint8_t *out, const TransformStreamLayout &layout) {
+	BatchWorldViewProj(worlds, count, viewProj, out, layout, DetectSimdPath());
+}
+
+void BatchWorldViewProj(const Float4x4 *worlds, uint32_t count, const Float4x4 &viewProj,
+		uint8_t *out, const TransformStreamLayout &layout, SimdPath path) {
+	switch (path) {
+#if defined(TRANSFORM_BATCH_X86)
+		case SimdPath::AVX2:
+			BatchAVX2(worlds, count, viewProj, out, layout);
+			return;
+		case SimdPath::SSE2:
+			BatchSSE2(worlds, count, viewProj, out, layout);
+			return;
+#endif
+		default:
+			BatchScalar(worlds, count, viewProj, out, layout);
+			return;
+	}
+}
+
+void BatchTransposeWorlds(const Float4x4 *worlds, uint32_t count, uint8_t *out, const TransformStreamLayout &layout) {
+	BatchTransposeWorlds(worlds, count, out, layout, DetectSimdPath());
+}
+
+void BatchTransposeWorlds(const Float4x4 *worlds, uint32_t count, uint8_t *out, const TransformStreamLayout &layout,
+		SimdPath path) {
+	switch (path) {
+#if defined(TRANSFORM_BATCH_X86)
+		// A transpose is all shuffles; 256-bit registers do not help it.
+		case SimdPath::AVX2:
+		case SimdPath::SSE2:
+			TransposeSSE2(worlds, count, out, layout);
+			return;
+#endif
+		default:
+			TransposeScalar(worlds, count, out, layout);
+			return;
+	}
+}
@@ -0,0 +1,57 @@
+#include "TransientAllocator.h"
+#include <algorithm>
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+	return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+void PackTransientAllocations(const std::vector<TransientAllocationRequest> &requests, TransientAllocationResult &result) {
+	size_t count = requests.size();
+	result.Offsets.assign(count, 0);
+	result.HeapSize = 0;
+	result.CommittedSize = 0;
+
+	std::vector<uint32_t> order(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		order[i] = i;
+		result.CommittedSize += AlignUp(requests[i].ByteSize, requests[i].Alignment);
+	}
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		if (requests[a].ByteSize != requests[b].ByteSize)
+			return requests[a].ByteSize > requests[b].ByteSize;
+		return requests[a].FirstPass < requests[b].FirstPass;
+	});
+
+	struct Interval {
+		uint64_t Begin;
+		uint64_t End;
+	};
+	std::vector<uint32_t> placed;
+	std::vector<Interval> busy;
+	placed.reserve(count);
+
+	for (uint32_t index : order) {
+		const TransientAllocationRequest &request = requests[index];
+
+		// Memory taken by placed requests alive at the same time, by offset.
+		busy.clear();
+		for (uint32_t other : placed) {
+			const TransientAllocationRequest &o = requests[other];
+			if (o.FirstPass <= request.LastPass && request.FirstPass <= o.LastPass)
+				busy.push_back({ result.Offsets[other], result.Offsets[other] + o.ByteSize });
+		}
+		std::sort(busy.begin(), busy.end(), [](const Interval &a, const Interval &b) { return a.Begin < b.Begin; });
+
+		// Lowest gap that fits.
+		uint64_t offset = 0;
+		for (const Interval &interval : busy) {
+			if (offset + request.ByteSize <= interval.Begin)
+				break;
+			offset = std::max(offset, AlignUp(interval.End, request.Alignment));
+		}
+
+		result.Offsets[index] = offset;
+		result.HeapSize = std::max(result.HeapSize, offset + request.ByteSize);
+		placed.push_back(index);
+	}
+}
@@ -0,0 +1,197 @@
+#include "UploadQueue.h"
+#include <cassert>
+#include <cstring>
+
+UploadQueue::UploadQueue(IUploadPageProvider *pages, IUploadCopyQueue *copyQueue, IFrameFence *fence,
+		const UploadQueueDesc &desc) :
+		mPages(pages),
+		mCopyQueue(copyQueue),
+		mFence(fence),
+		mDesc(desc) {
+	assert(mPages != nullptr && mCopyQueue != nullptr && mFence != nullptr);
+	assert(mDesc.StagingByteSize > 0);
+	mStaging = mPages->CreatePage(mDesc.StagingByteSize);
+	mPendingCopies.reserve(mDesc.MaxBatchCopies);
+}
+
+UploadQueue::~UploadQueue() {
+	Wait(Flush());
+	mPages->DestroyPage(mStaging);
+}
+
+bool UploadQueue::TryAllocateRing(uint64_t byteSize, uint64_t alignment, uint64_t &offset) {
+	uint64_t capacity = mStaging.ByteSize;
+	if (mAllocated == mFreed) {
+		// Empty: restart at the beginning so the whole ring is available.
+		// Batches still in flight own no ring memory, so they end there too.
+		mAllocated = mFreed = 0;
+		for (Batch &batch : mBatches)
+			batch.Allocated = 0;
+	}
+
+	uint64_t head = mAllocated % capacity;
+	uint64_t start = LinearAllocator::AlignUp(head, alignment);
+	if (start + byteSize > capacity)
+		start = 0; // Skip the tail of the page and wrap around.
+
+	uint64_t skipped = start >= head ? start - head : capacity - head + start;
+	if (mAllocated - mFreed + skipped + byteSize > capacity)
+		return false;
+
+	mAllocated += skipped + byteSize;
+	uint64_t used = mAllocated - mFreed;
+	mStats.StagingHighWaterMark = used > mStats.StagingHighWaterMark ? used : mStats.StagingHighWaterMark;
+	offset = start;
+	return true;
+}
+
+UploadQueue::Staging UploadQueue::AllocateStaging(uint64_t byteSize, uint64_t alignment) {
+	Staging staging;
+	if (byteSize > mStaging.ByteSize) {
+		mPendingPages.push_back(mPages->CreatePage(byteSize));
+		++mStats.DedicatedPages;
+		staging.Cpu = mPendingPages.back().CpuBase;
+		staging.Handle = mPendingPages.back().Handle;
+		return staging;
+	}
+
+	uint64_t offset = 0;
+	while (!TryAllocateRing(byteSize, alignment, offset)) {
+		// Out of staging memory: submit what is open, then wait for the oldest
+		// batch to free its part of the ring.
+		if (mBatches.empty()) {
+			assert(!mPendingCopies.empty());
+			Flush();
+			continue;
+		}
+		++mStats.Stalls;
+		mFence->Wait(mBatches.front().FenceValue);
+		RetireBatch();
+	}
+
+	staging.Cpu = mStaging.CpuBase + offset;
+	staging.Handle = mStaging.Handle;
+	staging.Offset = offset;
+	return staging;
+}
+
+void UploadQueue::Queue(const UploadCopy &copy) {
+	mPendingCopies.push_back(copy);
+	mPendingBytes += copy.ByteSize;
+	mStats.BytesUploaded += copy.ByteSize;
+}
+
+uint64_t UploadQueue::UploadBuffer(void *destination, uint64_t destinationOffset, const void *data, uint64_t byteSize) {
+	Retire();
+
+	Staging staging = AllocateStaging(byteSize, BufferAlignment);
+	memcpy(staging.Cpu, data, static_cast<size_t>(byteSize));
+
+	UploadCopy copy;
+	copy.Type = UploadCopy::Buffer;
+	copy.Destination = destination;
+	copy.DestinationOffset = destinationOffset;
+	copy.Source = staging.Handle;
+	copy.SourceOffset = staging.Offset;
+	copy.ByteSize = byteSize;
+	Queue(copy);
+
+	++mStats.Uploads;
+	uint64_t fenceValue = PendingFenceValue();
+	if (mPendingBytes >= mDesc.MaxBatchBytes || mPendingCopies.size() >= mDesc.MaxBatchCopies)
+		Flush();
+	return fenceValue;
+}
+
+uint64_t UploadQueue::UploadTexture(void *destination, const UploadTextureFootprint *footprints,
+		const UploadSubresourceData *data, uint32_t count) {
+	Retire();
+
+	// All subresources go in one staging block, each placement aligned.
+	uint64_t byteSize = 0;
+	for (uint32_t i = 0; i < count; ++i) {
+		const UploadTextureFootprint &footprint = footprints[i];
+		byteSize = LinearAllocator::AlignUp(byteSize, TextureAlignment);
+		byteSize += uint64_t(footprint.RowPitch) * footprint.RowCount * footprint.Depth;
+	}
+	Staging staging = AllocateStaging(byteSize, TextureAlignment);
+
+	uint64_t offset = 0;
+	for (uint32_t i = 0; i < count; ++i) {
+		const UploadTextureFootprint &footprint = footprints[i];
+		const UploadSubresourceData &source = data[i];
+		assert(footprint.RowSizeInBytes <= footprint.RowPitch);
+		offset = LinearAllocator::AlignUp(offset, TextureAlignment);
+
+		uint8_t *dst = staging.Cpu + offset;
+		const uint8_t *src = static_cast<const uint8_t *>(source.Data);
+		for (uint32_t z = 0; z < footprint.Depth; ++z) {
+			for (uint32_t row = 0; row < footprint.RowCount; ++row) {
+				memcpy(dst + (uint64_t(z) * footprint.RowCount + row) * footprint.RowPitch,
+						src + z * source.SlicePitch + row * source.RowPitch, static_cast<size_t>(footprint.RowSizeInBytes));
+			}
+		}
+
+		UploadCopy copy;
+		copy.Type = UploadCopy::Texture;
+		copy.Destination = destination;
+		copy.Source = staging.Handle;
+		copy.SourceOffset = staging.Offset + offset;
+		copy.ByteSize = uint64_t(footprint.RowPitch) * footprint.RowCount * footprint.Depth;
+		copy.Footprint = footprint;
+		Queue(copy);
+
+		offset += copy.ByteSize;
+	}
+
+	++mStats.Uploads;
+	uint64_t fenceValue = PendingFenceValue();
+	if (mPendingBytes >= mDesc.MaxBatchBytes || mPendingCopies.size() >= mDesc.MaxBatchCopies)
+		Flush();
+	return fenceValue;
+}
+
+uint64_t UploadQueue::Flush() {
+	if (mPendingCopies.empty())
+		return mLastSubmitted;
+
+	Batch batch;
+	batch.FenceValue = ++mLastSubmitted;
+	batch.Allocated = mAllocated;
+	batch.DedicatedPages.swap(mPendingPages);
+	mCopyQueue->Submit(mPendingCopies.data(), static_cast<uint32_t>(mPendingCopies.size()), batch.FenceValue);
+	mBatches.push_back(std::move(batch));
+
+	mPendingCopies.clear();
+	mPendingBytes = 0;
+	++mStats.Batches;
+	return mLastSubmitted;
+}
+
+void UploadQueue::RetireBatch() {
+	Batch &batch = mBatches.front();
+	mFreed = batch.Allocated;
+	for (UploadPage &page : batch.DedicatedPages)
+		mPages->DestroyPage(page);
+	mBatches.pop_front();
+}
+
+void UploadQueue::Retire() {
+	if (mBatches.empty())
+		return;
+
+	uint64_t completed = mFence->CompletedValue();
+	while (!mBatches.empty() && mBatches.front().FenceValue <= completed)
+		RetireBatch();
+}
+
+void UploadQueue::Wait(uint64_t fenceValue) {
+	if (fenceValue > mLastSubmitted)
+		Flush();
+	// Nothing was queued for a value that is still open; everything before
+	// it is done once the last batch is.
+	if (fenceValue > mLastSubmitted)
+		fenceValue = mLastSubmitted;
+	mFence->Wait(fenceValue);
+	Retire();
+}
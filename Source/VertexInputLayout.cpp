@@ -0,0 +1,32 @@
+#include "VertexInputLayout.h"
+
+DXGI_FORMAT ToDxgiFormat(VertexFormat format) {
+	switch (format) {
+	case VertexFormat::Float2:
+		return DXGI_FORMAT_R32G32_FLOAT;
+	case VertexFormat::Float3:
+		return DXGI_FORMAT_R32G32B32_FLOAT;
+	case VertexFormat::Float4:
+		return DXGI_FORMAT_R32G32B32A32_FLOAT;
+	case VertexFormat::Half2:
+		return DXGI_FORMAT_R16G16_FLOAT;
+	case VertexFormat::Unorm16x4:
+		return DXGI_FORMAT_R16G16B16A16_UNORM;
+	case VertexFormat::Snorm16x2:
+		return DXGI_FORMAT_R16G16_SNORM;
+	case VertexFormat::Snorm8x4:
+		return DXGI_FORMAT_R8G8B8A8_SNORM;
+	case VertexFormat::Unorm8x4:
+		return DXGI_FORMAT_R8G8B8A8_UNORM;
+	}
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+std::vector<D3D12_INPUT_ELEMENT_DESC> MakeInputLayout(const VertexLayout &layout) {
+	std::vector<D3D12_INPUT_ELEMENT_DESC> elements;
+	for (const VertexElement &element : layout.Elements) {
+		elements.push_back({ element.Semantic, 0, ToDxgiFormat(element.Format), 0, element.Offset,
+			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
+	}
+	return elements;
+}
@@ -0,0 +1,456 @@
+#include "VertexPacking.h"
+#include <cmath>
+#include <cstring>
+
+uint32_t VertexFormatSize(VertexFormat format) {
+	switch (format) {
+	case VertexFormat::Float2:
+		return 8;
+	case VertexFormat::Float3:
+		return 12;
+	case VertexFormat::Float4:
+		return 16;
+	case VertexFormat::Unorm16x4:
+		return 8;
+	default:
+		return 4;
+	}
+}
+
+const VertexElement *VertexLayout::Find(MeshAttribute attribute) const {
+	for (const VertexElement &element : Elements)
+		if (element.Attribute == attribute)
+			return &element;
+	return nullptr;
+}
+
+VertexLayout MakeVertexLayout(uint32_t attributes, bool packed) {
+	// Same order as MeshData, so the unpacked layout matches its vertices.
+	struct AttributeFormat {
+		MeshAttribute Attribute;
+		const char *Semantic;
+		VertexFormat Full;
+		VertexFormat Packed;
+	};
+	static const AttributeFormat formats[] = {
+		{ MeshAttributePosition, "POSITION", VertexFormat::Float3, VertexFormat::Unorm16x4 },
+		{ MeshAttributeNormal, "NORMAL", VertexFormat::Float3, VertexFormat::Snorm16x2 },
+		{ MeshAttributeTexCoord, "TEXCOORD", VertexFormat::Float2, VertexFormat::Half2 },
+		{ MeshAttributeColor, "COLOR", VertexFormat::Float4, VertexFormat::Unorm8x4 },
+		{ MeshAttributeTangent, "TANGENT", VertexFormat::Float4, VertexFormat::Snorm8x4 },
+	};
+
+	VertexLayout layout;
+	for (const AttributeFormat &format : formats) {
+		if ((attributes & format.Attribute) == 0)
+			continue;
+		VertexFormat storage = packed ? format.Packed : format.Full;
+		layout.Elements.push_back({ format.Attribute, format.Semantic, storage, layout.Stride });
+		layout.Stride += VertexFormatSize(storage);
+	}
+	return layout;
+}
+
+void OctahedralEncode(const float *n, float &u, float &v) {
+	float length = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+	if (length == 0.0f) {
+		u = v = 0.0f;
+		return;
+	}
+	float x = n[0] / length;
+	float y = n[1] / length;
+	// Fold the lower hemisphere over the diagonals.
+	if (n[2] < 0.0f) {
+		float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+	u = x;
+	v = y;
+}
+
+void OctahedralDecode(float u, float v, float *n) {
+	float x = u;
+	float y = v;
+	float z = 1.0f - fabsf(u) - fabsf(v);
+	if (z < 0.0f) {
+		x = (1.0f - fabsf(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+		y = (1.0f - fabsf(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+	}
+	float length = sqrtf(x * x + y * y + z * z);
+	n[0] = x / length;
+	n[1] = y / length;
+	n[2] = z / length;
+}
+
+uint16_t FloatToHalf(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+	uint32_t magnitude = bits & 0x7FFFFFFF;
+
+	if (magnitude >= 0x7F800000)
+		return sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0);
+	// 65520 and up round to infinity.
+	if (magnitude >= 0x477FF000)
+		return sign | 0x7C00;
+	// Below the smallest normal half: subnormal steps of 2^-24, rounded to
+	// nearest even.
+	if (magnitude < 0x38800000)
+		return sign | static_cast<uint16_t>(lrintf(fabsf(value) * 16777216.0f));
+
+	uint32_t half = (magnitude - 0x38000000) >> 13;
+	uint32_t rest = magnitude & 0x1FFF;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+		++half;
+	return sign | static_cast<uint16_t>(half);
+}
+
+float HalfToFloat(uint16_t value) {
+	uint32_t sign = uint32_t(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1F;
+	uint32_t mantissa = value & 0x3FF;
+	uint32_t bits;
+	if (exponent == 0) {
+		float magnitude = float(mantissa) / 16777216.0f;
+		return sign ? -magnitude : magnitude;
+	}
+	if (exponent == 31)
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+static uint32_t QuantizeUnorm(float value, uint32_t maxValue) {
+	value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+	return static_cast<uint32_t>(lrintf(value * float(maxValue)));
+}
+
+static float DequantizeSnorm(int32_t value, int32_t maxValue) {
+	float result = float(value) / float(maxValue);
+	return result < -1.0f ? -1.0f : result;
+}
+
+// Octahedral encoding at maxValue steps per unit. Rounding each coordinate
+// on its own is not always closest on the sphere, so all four neighbours are
+// tried and the one whose decoded direction is nearest wins.
+static void EncodeOctahedralSnorm(const float *n, int32_t maxValue, int32_t &qu, int32_t &qv) {
+	float u, v;
+	OctahedralEncode(n, u, v);
+	int32_t baseU = static_cast<int32_t>(floorf(u * float(maxValue)));
+	int32_t baseV = static_cast<int32_t>(floorf(v * float(maxValue)));
+
+	float best = -2.0f;
+	for (int32_t du = 0; du < 2; ++du) {
+		for (int32_t dv = 0; dv < 2; ++dv) {
+			int32_t cu = baseU + du;
+			int32_t cv = baseV + dv;
+			if (cu < -maxValue || cu > maxValue || cv < -maxValue || cv > maxValue)
+				continue;
+			float decoded[3];
+			OctahedralDecode(DequantizeSnorm(cu, maxValue), DequantizeSnorm(cv, maxValue), decoded);
+			float cosine = decoded[0] * n[0] + decoded[1] * n[1] + decoded[2] * n[2];
+			if (cosine > best) {
+				best = cosine;
+				qu = cu;
+				qv = cv;
+			}
+		}
+	}
+}
+
+// Writes one attribute of a vertex. values are the MeshData floats; the
+// position is already normalized to the subset's bounds.
+static void PackElement(const VertexElement &element, const float *values, uint8_t *vertex) {
+	uint8_t *dst = vertex + element.Offset;
+	switch (element.Format) {
+	case VertexFormat::Float2:
+	case VertexFormat::Float3:
+	case VertexFormat::Float4:
+		memcpy(dst, values, VertexFormatSize(element.Format));
+		break;
+	case VertexFormat::Half2: {
+		uint16_t halves[2] = { FloatToHalf(values[0]), FloatToHalf(values[1]) };
+		memcpy(dst, halves, sizeof(halves));
+		break;
+	}
+	case VertexFormat::Unorm16x4: {
+		uint16_t q[4] = {};
+		for (int c = 0; c < 3; ++c)
+			q[c] = static_cast<uint16_t>(QuantizeUnorm(values[c], 65535));
+		memcpy(dst, q, sizeof(q));
+		break;
+	}
+	case VertexFormat::Snorm16x2: {
+		int32_t u = 0, v = 0;
+		EncodeOctahedralSnorm(values, 32767, u, v);
+		int16_t q[2] = { static_cast<int16_t>(u), static_cast<int16_t>(v) };
+		memcpy(dst, q, sizeof(q));
+		break;
+	}
+	case VertexFormat::Snorm8x4: {
+		int32_t u = 0, v = 0;
+		EncodeOctahedralSnorm(values, 127, u, v);
+		int8_t q[4] = { static_cast<int8_t>(u), static_cast<int8_t>(v), static_cast<int8_t>(values[3] < 0.0f ? -127 : 127),
+			0 };
+		memcpy(dst, q, sizeof(q));
+		break;
+	}
+	case VertexFormat::Unorm8x4:
+		for (int c = 0; c < 4; ++c)
+			dst[c] = static_cast<uint8_t>(QuantizeUnorm(values[c], 255));
+		break;
+	}
+}
+
+// Inverse of PackElement.
+static void UnpackElement(const VertexElement &element, const uint8_t *vertex, float *values) {
+	const uint8_t *src = vertex + element.Offset;
+	switch (element.Format) {
+	case VertexFormat::Float2:
+	case VertexFormat::Float3:
+	case VertexFormat::Float4:
+		memcpy(values, src, VertexFormatSize(element.Format));
+		break;
+	case VertexFormat::Half2: {
+		uint16_t halves[2];
+		memcpy(halves, src, sizeof(halves));
+		values[0] = HalfToFloat(halves[0]);
+		values[1] = HalfToFloat(halves[1]);
+		break;
+	}
+	case VertexFormat::Unorm16x4: {
+		uint16_t q[4];
+		memcpy(q, src, sizeof(q));
+		for (int c = 0; c < 3; ++c)
+			values[c] = float(q[c]) / 65535.0f;
+		break;
+	}
+	case VertexFormat::Snorm16x2: {
+		int16_t q[2];
+		memcpy(q, src, sizeof(q));
+		OctahedralDecode(DequantizeSnorm(q[0], 32767), DequantizeSnorm(q[1], 32767), values);
+		break;
+	}
+	case VertexFormat::Snorm8x4: {
+		int8_t q[4];
+		memcpy(q, src, sizeof(q));
+		OctahedralDecode(DequantizeSnorm(q[0], 127), DequantizeSnorm(q[1], 127), values);
+		values[3] = q[2] < 0 ? -1.0f : 1.0f;
+		break;
+	}
+	case VertexFormat::Unorm8x4:
+		for (int c = 0; c < 4; ++c)
+			values[c] = float(src[c]) / 255.0f;
+		break;
+	}
+}
+
+void PackMesh(const MeshData &mesh, PackedMesh &packed) {
+	packed = PackedMesh();
+	packed.Name = mesh.Name;
+	packed.Layout = MakeVertexLayout(mesh.Attributes, true);
+	packed.IndexCount = mesh.IndexCount;
+	packed.Subsets = mesh.Subsets;
+	packed.Quantization.resize(mesh.Subsets.size());
+
+	// Give every subset its own vertex range, in the order it first uses
+	// them, so each can be quantized to its own bounds. LOD levels share the
+	// range of the full-detail subset they follow.
+	std::vector<uint32_t> indices(mesh.IndexCount, 0);
+	std::vector<uint32_t> sources;
+	std::vector<uint32_t> local(mesh.VertexCount, UINT32_MAX);
+	std::vector<size_t> parents(packed.Subsets.size());
+	uint32_t maxSubsetVertices = 0;
+	uint32_t base = 0;
+	for (size_t s = 0; s < packed.Subsets.size(); ++s) {
+		MeshSubset &subset = packed.Subsets[s];
+		parents[s] = subset.LodLevel != 0 && s > 0 ? parents[s - 1] : s;
+		if (parents[s] == s) {
+			for (size_t i = base; i < sources.size(); ++i)
+				local[sources[i]] = UINT32_MAX;
+			base = static_cast<uint32_t>(sources.size());
+		}
+		for (uint32_t i = subset.StartIndex; i < subset.StartIndex + subset.IndexCount; ++i) {
+			uint32_t v = static_cast<uint32_t>(int64_t(mesh.Index(i)) + subset.BaseVertex);
+			if (local[v] == UINT32_MAX) {
+				local[v] = static_cast<uint32_t>(sources.size()) - base;
+				sources.push_back(v);
+			}
+			indices[i] = local[v];
+		}
+
+		uint32_t count = static_cast<uint32_t>(sources.size()) - base;
+		maxSubsetVertices = count > maxSubsetVertices ? count : maxSubsetVertices;
+		subset.BaseVertex = static_cast<int32_t>(base);
+	}
+	packed.VertexCount = static_cast<uint32_t>(sources.size());
+
+	uint32_t positionOffset = MeshAttributeOffset(mesh.Attributes, MeshAttributePosition);
+	packed.Vertices.assign(size_t(packed.VertexCount) * packed.Layout.Stride, 0);
+	for (size_t s = 0; s < packed.Subsets.size(); ++s) {
+		MeshSubset &subset = packed.Subsets[s];
+		PackedSubset &quantization = packed.Quantization[s];
+		if (parents[s] != s) {
+			const MeshSubset &parent = packed.Subsets[parents[s]];
+			memcpy(subset.BoundsMin, parent.BoundsMin, sizeof(subset.BoundsMin));
+			memcpy(subset.BoundsMax, parent.BoundsMax, sizeof(subset.BoundsMax));
+			quantization = packed.Quantization[parents[s]];
+			continue;
+		}
+		uint32_t first = static_cast<uint32_t>(subset.BaseVertex);
+		uint32_t last = packed.VertexCount;
+		for (size_t next = s + 1; next < packed.Subsets.size(); ++next) {
+			if (parents[next] == next) {
+				last = static_cast<uint32_t>(packed.Subsets[next].BaseVertex);
+				break;
+			}
+		}
+
+		// Tight bounds of what the subset draws; these are also the ones
+		// culling uses.
+		if (positionOffset != UINT32_MAX && first < last) {
+			for (int c = 0; c < 3; ++c) {
+				subset.BoundsMin[c] = INFINITY;
+				subset.BoundsMax[c] = -INFINITY;
+			}
+			for (uint32_t v = first; v < last; ++v) {
+				float position[3];
+				memcpy(position, mesh.Vertices.data() + size_t(sources[v]) * mesh.VertexStride + positionOffset,
+						sizeof(position));
+				for (int c = 0; c < 3; ++c) {
+					subset.BoundsMin[c] = position[c] < subset.BoundsMin[c] ? position[c] : subset.BoundsMin[c];
+					subset.BoundsMax[c] = position[c] > subset.BoundsMax[c] ? position[c] : subset.BoundsMax[c];
+				}
+			}
+		}
+		for (int c = 0; c < 3; ++c) {
+			quantization.PositionOffset[c] = subset.BoundsMin[c];
+			quantization.PositionScale[c] = subset.BoundsMax[c] - subset.BoundsMin[c];
+		}
+
+		for (uint32_t v = first; v < last; ++v) {
+			const uint8_t *source = mesh.Vertices.data() + size_t(sources[v]) * mesh.VertexStride;
+			uint8_t *vertex = packed.Vertices.data() + size_t(v) * packed.Layout.Stride;
+			for (const VertexElement &element : packed.Layout.Elements) {
+				float values[4];
+				memcpy(values, source + MeshAttributeOffset(mesh.Attributes, element.Attribute),
+						MeshVertexStride(element.Attribute));
+				if (element.Attribute == MeshAttributePosition) {
+					for (int c = 0; c < 3; ++c) {
+						float scale = quantization.PositionScale[c];
+						values[c] = scale > 0.0f ? (values[c] - quantization.PositionOffset[c]) / scale : 0.0f;
+					}
+				}
+				PackElement(element, values, vertex);
+			}
+		}
+	}
+
+	packed.IndexByteSize = maxSubsetVertices <= 65536 ? 2 : 4;
+	packed.Indices.resize(indices.size() * packed.IndexByteSize);
+	if (packed.IndexByteSize == 2) {
+		uint16_t *narrow = reinterpret_cast<uint16_t *>(packed.Indices.data());
+		for (size_t i = 0; i < indices.size(); ++i)
+			narrow[i] = static_cast<uint16_t>(indices[i]);
+	} else {
+		memcpy(packed.Indices.data(), indices.data(), indices.size() * sizeof(uint32_t));
+	}
+}
+
+static void Accumulate(AttributeError &error, double value) {
+	error.Max = value > error.Max ? value : error.Max;
+	error.Mean += value;
+}
+
+static double AngleDegrees(const float *a, const float *b) {
+	double la = sqrt(double(a[0]) * a[0] + double(a[1]) * a[1] + double(a[2]) * a[2]);
+	double lb = sqrt(double(b[0]) * b[0] + double(b[1]) * b[1] + double(b[2]) * b[2]);
+	if (la == 0.0 || lb == 0.0)
+		return 0.0;
+	double cosine = (double(a[0]) * b[0] + double(a[1]) * b[1] + double(a[2]) * b[2]) / (la * lb);
+	cosine = cosine > 1.0 ? 1.0 : (cosine < -1.0 ? -1.0 : cosine);
+	return acos(cosine) * (180.0 / 3.14159265358979323846);
+}
+
+VertexPackingError MeasurePackingError(const MeshData &mesh, const PackedMesh &packed) {
+	VertexPackingError error;
+	std::vector<bool> visited(packed.VertexCount, false);
+	uint32_t compared = 0;
+
+	for (size_t s = 0; s < packed.Subsets.size() && s < mesh.Subsets.size(); ++s) {
+		const MeshSubset &subset = packed.Subsets[s];
+		const PackedSubset &quantization = packed.Quantization[s];
+		for (uint32_t i = subset.StartIndex; i < subset.StartIndex + subset.IndexCount; ++i) {
+			uint32_t index;
+			if (packed.IndexByteSize == 2) {
+				uint16_t narrow;
+				memcpy(&narrow, packed.Indices.data() + size_t(i) * 2, sizeof(narrow));
+				index = narrow;
+			} else {
+				memcpy(&index, packed.Indices.data() + size_t(i) * 4, sizeof(index));
+			}
+			uint32_t v = index + static_cast<uint32_t>(subset.BaseVertex);
+			if (visited[v])
+				continue;
+			visited[v] = true;
+			++compared;
+
+			uint32_t sourceIndex = static_cast<uint32_t>(int64_t(mesh.Index(i)) + mesh.Subsets[s].BaseVertex);
+			const uint8_t *source = mesh.Vertices.data() + size_t(sourceIndex) * mesh.VertexStride;
+			const uint8_t *vertex = packed.Vertices.data() + size_t(v) * packed.Layout.Stride;
+			for (const VertexElement &element : packed.Layout.Elements) {
+				float original[4] = {};
+				float decoded[4] = {};
+				memcpy(original, source + MeshAttributeOffset(mesh.Attributes, element.Attribute),
+						MeshVertexStride(element.Attribute));
+				UnpackElement(element, vertex, decoded);
+
+				double worst = 0.0;
+				switch (element.Attribute) {
+				case MeshAttributePosition: {
+					double squared = 0.0;
+					for (int c = 0; c < 3; ++c) {
+						double d = quantization.PositionOffset[c] + double(decoded[c]) * quantization.PositionScale[c] -
+								original[c];
+						squared += d * d;
+					}
+					Accumulate(error.Position, sqrt(squared));
+					break;
+				}
+				case MeshAttributeNormal:
+					Accumulate(error.Normal, AngleDegrees(original, decoded));
+					break;
+				case MeshAttributeTangent:
+					Accumulate(error.Tangent, AngleDegrees(original, decoded));
+					if ((original[3] < 0.0f) != (decoded[3] < 0.0f))
+						++error.TangentSignFlips;
+					break;
+				case MeshAttributeTexCoord:
+					for (int c = 0; c < 2; ++c)
+						worst = fmax(worst, fabs(double(decoded[c]) - original[c]));
+					Accumulate(error.TexCoord, worst);
+					break;
+				case MeshAttributeColor:
+					for (int c = 0; c < 4; ++c)
+						worst = fmax(worst, fabs(double(decoded[c]) - original[c]));
+					Accumulate(error.Color, worst);
+					break;
+				}
+			}
+		}
+	}
+
+	if (compared != 0) {
+		error.Position.Mean /= compared;
+		error.Normal.Mean /= compared;
+		error.TexCoord.Mean /= compared;
+		error.Color.Mean /= compared;
+		error.Tangent.Mean /= compared;
+	}
+	return error;
+}
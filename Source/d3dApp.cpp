@@ -33,8 +33,10 @@ D3DApp::D3DApp(HINSTANCE hInstance)
 
 D3DApp::~D3DApp()
 {
-	if(md3dDevice != nullptr)
+	if(md3dDevice != nullptr && mFramePacer != nullptr)
 		FlushCommandQueue();
+	if(mUploads != nullptr)
+		mUploads->Wait(mUploads->Flush());
 }
 
 HINSTANCE D3DApp::AppInst()const
@@ -120,24 +122,14 @@ bool D3DApp::Initialize()
  
 void D3DApp::CreateRtvAndDsvDescriptorHeaps()
 {
-	D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc;
-	rtvHeapDesc.NumDescriptors = SwapChainBufferCount;
-	rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-	rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-	rtvHeapDesc.NodeMask = 0;
-	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(
-		&rtvHeapDesc, IID_PPV_ARGS(mRtvHeap.GetAddressOf())));
-
-
-	D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc;
-	dsvHeapDesc.NumDescriptors = 1;
-	dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-	dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-	dsvHeapDesc.NodeMask = 0;
-	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(
-		&dsvHeapDesc, IID_PPV_ARGS(mDsvHeap.GetAddressOf())));
-
-	
+	// Room beyond the swap chain for off-screen targets.
+	mRtvHeap = std::make_unique<D3D12DescriptorHeap>(md3dDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_RTV, 64);
+	mDsvHeap = std::make_unique<D3D12DescriptorHeap>(md3dDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_DSV, 16);
+	mSrvHeap = std::make_unique<D3D12DescriptorHeap>(md3dDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+		1024, 4096);
+
+	mBackBufferRtvs = mRtvHeap->Allocate(SwapChainBufferCount);
+	mDepthStencilDsv = mDsvHeap->Allocate();
 }
 
 void D3DApp::OnResize()
@@ -165,15 +157,36 @@ void D3DApp::OnResize()
 
 	mCurrBackBuffer = 0;
  
-	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHeapHandle(mRtvHeap->GetCPUDescriptorHandleForHeapStart());
 	for (UINT i = 0; i < SwapChainBufferCount; i++)
 	{
 		ThrowIfFailed(mSwapChain->GetBuffer(i, IID_PPV_ARGS(&mSwapChainBuffer[i])));
-		md3dDevice->CreateRenderTargetView(mSwapChainBuffer[i].Get(), nullptr, rtvHeapHandle);
-		rtvHeapHandle.Offset(1, mRtvDescriptorSize);
+		md3dDevice->CreateRenderTargetView(mSwapChainBuffer[i].Get(), nullptr, mRtvHeap->CpuHandle(mBackBufferRtvs, i));
 	}
 
 	// Create the depth/stencil buffer and view.
+	CreateDepthStencilBuffer();
+
+	// Execute the resize commands.
+	ThrowIfFailed(mCommandList->Close());
+	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
+	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+
+	// Wait until resize is complete.
+	FlushCommandQueue();
+
+	// Update the viewport transform to cover the client area.
+	mScreenViewport.TopLeftX = 0;
+	mScreenViewport.TopLeftY = 0;
+	mScreenViewport.Width    = static_cast<float>(mClientWidth);
+	mScreenViewport.Height   = static_cast<float>(mClientHeight);
+	mScreenViewport.MinDepth = 0.0f;
+	mScreenViewport.MaxDepth = 1.0f;
+
+	mScissorRect = { 0, 0, mClientWidth, mClientHeight };
+}
+
+D3D12_RESOURCE_DESC D3DApp::DepthStencilDesc()const
+{
 	D3D12_RESOURCE_DESC depthStencilDesc;
 	depthStencilDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 	depthStencilDesc.Alignment = 0;
@@ -194,47 +207,44 @@ void D3DApp::OnResize()
 	depthStencilDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
 	depthStencilDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
 
+	return depthStencilDesc;
+}
+
+D3D12_CLEAR_VALUE D3DApp::DepthStencilClearValue()const
+{
 	D3D12_CLEAR_VALUE optClear;
 	optClear.Format = mDepthStencilFormat;
 	optClear.DepthStencil.Depth = 1.0f;
 	optClear.DepthStencil.Stencil = 0;
+	return optClear;
+}
+
+void D3DApp::CreateDepthStencilBuffer()
+{
+	D3D12_RESOURCE_DESC depthStencilDesc = DepthStencilDesc();
+	D3D12_CLEAR_VALUE optClear = DepthStencilClearValue();
+
+	// Created directly in the state it is used in, so it needs no barrier.
 	ThrowIfFailed(md3dDevice->CreateCommittedResource(
 		get_rvalue_ptr(CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT)),
 		D3D12_HEAP_FLAG_NONE,
 		&depthStencilDesc,
-		D3D12_RESOURCE_STATE_COMMON,
+		D3D12_RESOURCE_STATE_DEPTH_WRITE,
 		&optClear,
 		IID_PPV_ARGS(mDepthStencilBuffer.GetAddressOf())));
 
+	CreateDepthStencilView(mDepthStencilBuffer.Get());
+}
+
+void D3DApp::CreateDepthStencilView(ID3D12Resource* buffer)
+{
 	// Create descriptor to mip level 0 of entire resource using the format of the resource.
 	D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc;
 	dsvDesc.Flags = D3D12_DSV_FLAG_NONE;
 	dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
 	dsvDesc.Format = mDepthStencilFormat;
 	dsvDesc.Texture2D.MipSlice = 0;
-	md3dDevice->CreateDepthStencilView(mDepthStencilBuffer.Get(), &dsvDesc, DepthStencilView());
-
-	// Transition the resource from its initial state to be used as a depth buffer.
-	mCommandList->ResourceBarrier(1, get_rvalue_ptr(CD3DX12_RESOURCE_BARRIER::Transition(mDepthStencilBuffer.Get(),
-		D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_DEPTH_WRITE)));
-	
-	// Execute the resize commands.
-	ThrowIfFailed(mCommandList->Close());
-	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
-	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
-
-	// Wait until resize is complete.
-	FlushCommandQueue();
-
-	// Update the viewport transform to cover the client area.
-	mScreenViewport.TopLeftX = 0;
-	mScreenViewport.TopLeftY = 0;
-	mScreenViewport.Width    = static_cast<float>(mClientWidth);
-	mScreenViewport.Height   = static_cast<float>(mClientHeight);
-	mScreenViewport.MinDepth = 0.0f;
-	mScreenViewport.MaxDepth = 1.0f;
-
-	mScissorRect = { 0, 0, mClientWidth, mClientHeight };
+	md3dDevice->CreateDepthStencilView(buffer, &dsvDesc, DepthStencilView());
 }
  
 LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
@@ -449,9 +459,6 @@ bool D3DApp::InitDirect3D()
 			IID_PPV_ARGS(&md3dDevice)));
 	}
 
-	ThrowIfFailed(md3dDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE,
-		IID_PPV_ARGS(&mFence)));
-
 	mRtvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 	mDsvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
 	mCbvSrvUavDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
@@ -478,18 +485,22 @@ bool D3DApp::InitDirect3D()
 #endif
 
 	CreateCommandObjects();
+
+	mFrameFence = std::make_unique<D3D12FrameFence>(md3dDevice.Get(), mCommandQueue.Get());
+	mFramePacer = std::make_unique<FramePacer>(mFrameFence.get(), gNumFrameResources);
+
+	mStagingPages = std::make_unique<D3D12UploadPageProvider>(md3dDevice.Get());
+	mCopyQueue = std::make_unique<D3D12CopyQueue>(md3dDevice.Get());
+	mUploads = std::make_unique<UploadQueue>(mStagingPages.get(), mCopyQueue.get(), mCopyQueue->Fence());
+
 	CreateSwapChain();
 	CreateRtvAndDsvDescriptorHeaps();
 
-	// Create ImGui DescHeap
-	D3D12_DESCRIPTOR_HEAP_DESC imguiDesc = {};
-	imguiDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	imguiDesc.NumDescriptors = 1;
-	imguiDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&imguiDesc, IID_PPV_ARGS(mImguiHeap.GetAddressOf())));
+	mBindless = std::make_unique<D3D12BindlessTable>(md3dDevice.Get(), mSrvHeap.get(), 512);
 
-	ImGui_ImplDX12_Init(md3dDevice.Get(), SwapChainBufferCount, mBackBufferFormat, mImguiHeap.Get(),
-		mImguiHeap.Get()->GetCPUDescriptorHandleForHeapStart(), mImguiHeap.Get()->GetGPUDescriptorHandleForHeapStart());
+	mImguiFontSrv = mSrvHeap->Allocate();
+	ImGui_ImplDX12_Init(md3dDevice.Get(), SwapChainBufferCount, mBackBufferFormat, mSrvHeap->Heap(),
+		mSrvHeap->CpuHandle(mImguiFontSrv), mSrvHeap->GpuHandle(mImguiFontSrv));
 	return true;
 }
 
@@ -548,26 +559,9 @@ void D3DApp::CreateSwapChain()
 
 void D3DApp::FlushCommandQueue()
 {
-	// Advance the fence value to mark commands up to this fence point.
-	mCurrentFence++;
-
-	// Add an instruction to the command queue to set a new fence point.  Because we 
-	// are on the GPU timeline, the new fence point won't be set until the GPU finishes
-	// processing all the commands prior to this Signal().
-	ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), mCurrentFence));
-
-	// Wait until the GPU has completed commands up to this fence point.
-	if(mFence->GetCompletedValue() < mCurrentFence)
-	{
-		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-
-		// Fire event when GPU hits current fence.  
-		ThrowIfFailed(mFence->SetEventOnCompletion(mCurrentFence, eventHandle));
-
-		// Wait until the GPU hits current fence event is fired.
-		WaitForSingleObject(eventHandle, INFINITE);
-		CloseHandle(eventHandle);
-	}
+	// Signal a new fence point on the queue and wait until the GPU has processed
+	// every command submitted before it.  The pacer reuses a single wait event.
+	mFramePacer->Flush();
 }
 
 ID3D12Resource* D3DApp::CurrentBackBuffer()const
@@ -577,15 +571,12 @@ ID3D12Resource* D3DApp::CurrentBackBuffer()const
 
 D3D12_CPU_DESCRIPTOR_HANDLE D3DApp::CurrentBackBufferView()const
 {
-	return CD3DX12_CPU_DESCRIPTOR_HANDLE(
-		mRtvHeap->GetCPUDescriptorHandleForHeapStart(),
-		mCurrBackBuffer,
-		mRtvDescriptorSize);
+	return mRtvHeap->CpuHandle(mBackBufferRtvs, mCurrBackBuffer);
 }
 
 D3D12_CPU_DESCRIPTOR_HANDLE D3DApp::DepthStencilView()const
 {
-	return mDsvHeap->GetCPUDescriptorHandleForHeapStart();
+	return mDsvHeap->CpuHandle(mDepthStencilDsv);
 }
 
 void D3DApp::CalculateFrameStats()
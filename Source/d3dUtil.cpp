@@ -36,54 +36,305 @@ ComPtr<ID3DBlob> d3dUtil::LoadBinary(const std::wstring& filename)
 
 Microsoft::WRL::ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(
     ID3D12Device* device,
-    ID3D12GraphicsCommandList* cmdList,
+    UploadQueue& uploads,
     const void* initData,
     UINT64 byteSize,
-    Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer)
+    uint64_t* readyFenceValue)
 {
     ComPtr<ID3D12Resource> defaultBuffer;
-
-    // Create the actual default buffer resource.
     ThrowIfFailed(device->CreateCommittedResource(
         get_rvalue_ptr(CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT)),
         D3D12_HEAP_FLAG_NONE,
         get_rvalue_ptr(CD3DX12_RESOURCE_DESC::Buffer(byteSize)),
-		D3D12_RESOURCE_STATE_COMMON,
+        D3D12_RESOURCE_STATE_COMMON,
         nullptr,
         IID_PPV_ARGS(defaultBuffer.GetAddressOf())));
 
-    // In order to copy CPU memory data into our default buffer, we need to create
-    // an intermediate upload heap. 
-    ThrowIfFailed(device->CreateCommittedResource(
-        get_rvalue_ptr(CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD)),
-		D3D12_HEAP_FLAG_NONE,
-        get_rvalue_ptr(CD3DX12_RESOURCE_DESC::Buffer(byteSize)),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(uploadBuffer.GetAddressOf())));
+    uint64_t fenceValue = uploads.UploadBuffer(defaultBuffer.Get(), 0, initData, byteSize);
+    if(readyFenceValue != nullptr)
+        *readyFenceValue = fenceValue;
 
+    return defaultBuffer;
+}
 
-    // Describe the data we want to copy into the default buffer.
-    D3D12_SUBRESOURCE_DATA subResourceData = {};
-    subResourceData.pData = initData;
-    subResourceData.RowPitch = byteSize;
-    subResourceData.SlicePitch = subResourceData.RowPitch;
+// Vertex and index buffers of a MeshGeometry, uploaded through the copy queue.
+static std::unique_ptr<MeshGeometry> CreateMeshBuffers(
+    ID3D12Device* device,
+    UploadQueue& uploads,
+    const void* vertices,
+    UINT vbByteSize,
+    UINT vertexStride,
+    const void* indices,
+    UINT ibByteSize,
+    UINT indexByteSize,
+    uint64_t* readyFenceValue)
+{
+    auto geo = std::make_unique<MeshGeometry>();
 
-    // Schedule to copy the data to the default buffer resource.  At a high level, the helper function UpdateSubresources
-    // will copy the CPU memory into the intermediate upload heap.  Then, using ID3D12CommandList::CopySubresourceRegion,
-    // the intermediate upload heap data will be copied to mBuffer.
-	cmdList->ResourceBarrier(1, get_rvalue_ptr(CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
-        D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST)));
-    UpdateSubresources<1>(cmdList, defaultBuffer.Get(), uploadBuffer.Get(), 0, 0, 1, &subResourceData);
-	cmdList->ResourceBarrier(1, get_rvalue_ptr(CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
-        D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ)));
+    uint64_t vbReady = 0;
+    uint64_t ibReady = 0;
+    geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(device, uploads, vertices, vbByteSize, &vbReady);
+    geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(device, uploads, indices, ibByteSize, &ibReady);
+    if(readyFenceValue != nullptr)
+        *readyFenceValue = vbReady > ibReady ? vbReady : ibReady;
 
-    // Note: uploadBuffer has to be kept alive after the above function calls because
-    // the command list has not been executed yet that performs the actual copy.
-    // The caller can Release the uploadBuffer after it knows the copy has been executed.
+    geo->VertexByteStride = vertexStride;
+    geo->VertexBufferByteSize = vbByteSize;
+    geo->IndexFormat = indexByteSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    geo->IndexBufferByteSize = ibByteSize;
+    return geo;
+}
 
+static SubmeshGeometry& AddSubmesh(MeshGeometry& geo, size_t index, const std::string& name, UINT indexCount,
+    UINT startIndex, INT baseVertex, const float* boundsMin, const float* boundsMax)
+{
+    SubmeshGeometry submesh;
+    submesh.IndexCount = indexCount;
+    submesh.StartIndexLocation = startIndex;
+    submesh.BaseVertexLocation = baseVertex;
+    DirectX::BoundingBox::CreateFromPoints(submesh.Bounds,
+        DirectX::XMLoadFloat3(reinterpret_cast<const DirectX::XMFLOAT3*>(boundsMin)),
+        DirectX::XMLoadFloat3(reinterpret_cast<const DirectX::XMFLOAT3*>(boundsMax)));
 
-    return defaultBuffer;
+    SubmeshGeometry& added = geo.DrawArgs[name.empty() ? "subset" + std::to_string(index) : name];
+    added = submesh;
+    return added;
+}
+
+std::unique_ptr<MeshGeometry> d3dUtil::CreateMeshGeometry(
+    ID3D12Device* device,
+    UploadQueue& uploads,
+    const MeshData& mesh,
+    uint64_t* readyFenceValue)
+{
+    auto geo = CreateMeshBuffers(device, uploads,
+        mesh.Vertices.data(), (UINT)mesh.Vertices.size(), mesh.VertexStride,
+        mesh.Indices.data(), (UINT)mesh.Indices.size(), mesh.IndexByteSize, readyFenceValue);
+    geo->Name = mesh.Name;
+
+    for(size_t i = 0; i < mesh.Subsets.size(); ++i)
+    {
+        const MeshSubset& subset = mesh.Subsets[i];
+        SubmeshGeometry& submesh = AddSubmesh(*geo, i, subset.Name, subset.IndexCount, subset.StartIndex,
+            subset.BaseVertex, subset.BoundsMin, subset.BoundsMax);
+        submesh.LodLevel = subset.LodLevel;
+        submesh.LodError = subset.LodError;
+    }
+    return geo;
+}
+
+std::unique_ptr<MeshGeometry> d3dUtil::CreateMeshGeometry(
+    ID3D12Device* device,
+    UploadQueue& uploads,
+    const MeshFileView& mesh,
+    uint64_t* readyFenceValue)
+{
+    auto geo = CreateMeshBuffers(device, uploads,
+        mesh.Vertices, (UINT)mesh.VertexByteSize(), mesh.Header->VertexStride,
+        mesh.Indices, (UINT)mesh.IndexByteSize(), mesh.Header->IndexByteSize, readyFenceValue);
+
+    const float unitMin[3] = { 0.0f, 0.0f, 0.0f };
+    const float unitMax[3] = { 1.0f, 1.0f, 1.0f };
+    for(uint32_t i = 0; i < mesh.Header->SubsetCount; ++i)
+    {
+        const MeshFileSubset& subset = mesh.Subsets[i];
+        SubmeshGeometry& submesh = AddSubmesh(*geo, i, std::string(mesh.SubsetName(i)), subset.IndexCount,
+            subset.StartIndex, subset.BaseVertex, mesh.IsPacked() ? unitMin : subset.BoundsMin,
+            mesh.IsPacked() ? unitMax : subset.BoundsMax);
+        submesh.LodLevel = subset.LodLevel;
+        submesh.LodError = subset.LodError;
+
+        DirectX::XMMATRIX dequantize =
+            DirectX::XMMatrixScaling(subset.PositionScale[0], subset.PositionScale[1], subset.PositionScale[2]) *
+            DirectX::XMMatrixTranslation(subset.PositionOffset[0], subset.PositionOffset[1],
+                subset.PositionOffset[2]);
+        DirectX::XMStoreFloat4x4(&submesh.PositionTransform, dequantize);
+    }
+    return geo;
+}
+
+std::unique_ptr<MeshGeometry> d3dUtil::CreateMeshGeometry(
+    ID3D12Device* device,
+    UploadQueue& uploads,
+    const PackedMesh& mesh,
+    uint64_t* readyFenceValue)
+{
+    auto geo = CreateMeshBuffers(device, uploads,
+        mesh.Vertices.data(), (UINT)mesh.Vertices.size(), mesh.Layout.Stride,
+        mesh.Indices.data(), (UINT)mesh.Indices.size(), mesh.IndexByteSize, readyFenceValue);
+    geo->Name = mesh.Name;
+
+    // Culling sees the same unit-cube positions the vertex shader does; the
+    // dequantization rides along in the world matrix.
+    const float unitMin[3] = { 0.0f, 0.0f, 0.0f };
+    const float unitMax[3] = { 1.0f, 1.0f, 1.0f };
+    for(size_t i = 0; i < mesh.Subsets.size(); ++i)
+    {
+        const MeshSubset& subset = mesh.Subsets[i];
+        const PackedSubset& quantization = mesh.Quantization[i];
+        SubmeshGeometry& submesh = AddSubmesh(*geo, i, subset.Name, subset.IndexCount, subset.StartIndex,
+            subset.BaseVertex, unitMin, unitMax);
+        submesh.LodLevel = subset.LodLevel;
+        submesh.LodError = subset.LodError;
+
+        DirectX::XMMATRIX dequantize =
+            DirectX::XMMatrixScaling(quantization.PositionScale[0], quantization.PositionScale[1],
+                quantization.PositionScale[2]) *
+            DirectX::XMMatrixTranslation(quantization.PositionOffset[0], quantization.PositionOffset[1],
+                quantization.PositionOffset[2]);
+        DirectX::XMStoreFloat4x4(&submesh.PositionTransform, dequantize);
+    }
+    return geo;
+}
+
+uint64_t d3dUtil::UploadTexture(
+    ID3D12Device* device,
+    UploadQueue& uploads,
+    ID3D12Resource* texture,
+    const D3D12_SUBRESOURCE_DATA* subresources,
+    UINT firstSubresource,
+    UINT count)
+{
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(count);
+    std::vector<UINT> rowCounts(count);
+    std::vector<UINT64> rowSizes(count);
+    D3D12_RESOURCE_DESC desc = texture->GetDesc();
+    device->GetCopyableFootprints(&desc, firstSubresource, count, 0,
+        layouts.data(), rowCounts.data(), rowSizes.data(), nullptr);
+
+    std::vector<UploadTextureFootprint> footprints(count);
+    std::vector<UploadSubresourceData> data(count);
+    for(UINT i = 0; i < count; ++i)
+    {
+        footprints[i].Subresource = firstSubresource + i;
+        footprints[i].Format = layouts[i].Footprint.Format;
+        footprints[i].Width = layouts[i].Footprint.Width;
+        footprints[i].Height = layouts[i].Footprint.Height;
+        footprints[i].Depth = layouts[i].Footprint.Depth;
+        footprints[i].RowPitch = layouts[i].Footprint.RowPitch;
+        footprints[i].RowCount = rowCounts[i];
+        footprints[i].RowSizeInBytes = rowSizes[i];
+
+        data[i].Data = subresources[i].pData;
+        data[i].RowPitch = subresources[i].RowPitch;
+        data[i].SlicePitch = subresources[i].SlicePitch;
+    }
+
+    return uploads.UploadTexture(texture, footprints.data(), data.data(), count);
+}
+
+D3D12_RESOURCE_STATES d3dUtil::ToD3D12States(ResourceState state)
+{
+    static const D3D12_RESOURCE_STATES states[] =
+    {
+        D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
+        D3D12_RESOURCE_STATE_INDEX_BUFFER,
+        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+        D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT,
+        D3D12_RESOURCE_STATE_COPY_SOURCE,
+        D3D12_RESOURCE_STATE_DEPTH_READ,
+        D3D12_RESOURCE_STATE_PRESENT,
+        D3D12_RESOURCE_STATE_RENDER_TARGET,
+        D3D12_RESOURCE_STATE_DEPTH_WRITE,
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        D3D12_RESOURCE_STATE_COPY_DEST,
+    };
+
+    UINT bits = static_cast<UINT>(state);
+    D3D12_RESOURCE_STATES result = D3D12_RESOURCE_STATE_COMMON;
+    for(UINT i = 0; i < _countof(states); ++i)
+    {
+        if(bits & (1u << i))
+            result |= states[i];
+    }
+    return result;
+}
+
+static ShaderCache* sShaderCache = nullptr;
+
+void d3dUtil::SetShaderCache(ShaderCache* cache)
+{
+    sShaderCache = cache;
+}
+
+bool d3dUtil::CompileShaderBytecode(
+    const ShaderCompileRequest& request,
+    std::vector<uint8_t>& byteCode,
+    std::string& errors)
+{
+    std::vector<D3D_SHADER_MACRO> macros;
+    for(const auto& define : request.Defines)
+        macros.push_back({ define.first.c_str(), define.second.c_str() });
+    macros.push_back({ nullptr, nullptr });
+
+    ComPtr<ID3DBlob> code = nullptr;
+    ComPtr<ID3DBlob> errorBlob;
+    HRESULT hr = D3DCompileFromFile(request.SourcePath.c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
+        request.EntryPoint.c_str(), request.Target.c_str(), request.Flags, 0, &code, &errorBlob);
+
+    if(errorBlob != nullptr)
+        errors.assign((const char*)errorBlob->GetBufferPointer(), errorBlob->GetBufferSize());
+
+    if(FAILED(hr))
+        return false;
+
+    const uint8_t* data = (const uint8_t*)code->GetBufferPointer();
+    byteCode.assign(data, data + code->GetBufferSize());
+    return true;
+}
+
+std::string d3dUtil::ShaderCompilerVersion()
+{
+    // The DLL name only changes with the major version; the file version
+    // also changes with SDK updates that generate different code.
+    std::string version = "d3dcompiler_" + std::to_string(D3D_COMPILER_VERSION);
+
+    wchar_t path[MAX_PATH];
+    HMODULE module = GetModuleHandleW(D3DCOMPILER_DLL_W);
+    if(module == nullptr || GetModuleFileNameW(module, path, MAX_PATH) == 0)
+        return version;
+
+    DWORD unused = 0;
+    DWORD infoSize = GetFileVersionInfoSizeW(path, &unused);
+    if(infoSize == 0)
+        return version;
+    std::vector<uint8_t> info(infoSize);
+    VS_FIXEDFILEINFO* fixed = nullptr;
+    UINT fixedSize = 0;
+    if(!GetFileVersionInfoW(path, 0, infoSize, info.data()) ||
+       !VerQueryValueW(info.data(), L"\\", (void**)&fixed, &fixedSize) || fixed == nullptr)
+        return version;
+
+    version += " " + std::to_string(HIWORD(fixed->dwFileVersionMS)) + "." +
+        std::to_string(LOWORD(fixed->dwFileVersionMS)) + "." +
+        std::to_string(HIWORD(fixed->dwFileVersionLS)) + "." +
+        std::to_string(LOWORD(fixed->dwFileVersionLS));
+    return version;
+}
+
+static UINT DefaultShaderCompileFlags()
+{
+	UINT compileFlags = 0;
+#if defined(DEBUG) || defined(_DEBUG)  
+	compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+	return compileFlags;
+}
+
+ShaderCompileRequest d3dUtil::MakeShaderCompileRequest(
+	const std::wstring& filename,
+	const D3D_SHADER_MACRO* defines,
+	const std::string& entrypoint,
+	const std::string& target)
+{
+	ShaderCompileRequest request;
+	request.SourcePath = filename;
+	for(const D3D_SHADER_MACRO* define = defines; define != nullptr && define->Name != nullptr; ++define)
+		request.Defines.emplace_back(define->Name, define->Definition != nullptr ? define->Definition : "");
+	request.EntryPoint = entrypoint;
+	request.Target = target;
+	request.Flags = DefaultShaderCompileFlags();
+	return request;
 }
 
 ComPtr<ID3DBlob> d3dUtil::CompileShader(
@@ -92,10 +343,24 @@ ComPtr<ID3DBlob> d3dUtil::CompileShader(
 	const std::string& entrypoint,
 	const std::string& target)
 {
-	UINT compileFlags = 0;
-#if defined(DEBUG) || defined(_DEBUG)  
-	compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
+	UINT compileFlags = DefaultShaderCompileFlags();
+
+	if(sShaderCache != nullptr)
+	{
+		ShaderCompileRequest request = MakeShaderCompileRequest(filename, defines, entrypoint, target);
+		std::vector<uint8_t> byteCode;
+		std::string errors;
+		bool compiled = sShaderCache->GetOrCompile(request, byteCode, &errors);
+		if(!errors.empty())
+			OutputDebugStringA(errors.c_str());
+		if(!compiled)
+			ThrowIfFailed(E_FAIL);
+
+		ComPtr<ID3DBlob> blob;
+		ThrowIfFailed(D3DCreateBlob(byteCode.size(), blob.GetAddressOf()));
+		CopyMemory(blob->GetBufferPointer(), byteCode.data(), byteCode.size());
+		return blob;
+	}
 
 	HRESULT hr = S_OK;
 
@@ -112,6 +377,316 @@ ComPtr<ID3DBlob> d3dUtil::CompileShader(
 	return byteCode;
 }
 
+D3D12FrameFence::D3D12FrameFence(ID3D12Device* device, ID3D12CommandQueue* queue) :
+    mQueue(queue)
+{
+    ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence)));
+
+    mEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+    if(mEvent == nullptr)
+        ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+}
+
+D3D12FrameFence::~D3D12FrameFence()
+{
+    if(mEvent != nullptr)
+        CloseHandle(mEvent);
+}
+
+uint64_t D3D12FrameFence::CompletedValue()const
+{
+    return mFence->GetCompletedValue();
+}
+
+void D3D12FrameFence::Signal(uint64_t value)
+{
+    ThrowIfFailed(mQueue->Signal(mFence.Get(), value));
+}
+
+void D3D12FrameFence::Wait(uint64_t value)
+{
+    if(mFence->GetCompletedValue() >= value)
+        return;
+
+    // Auto-reset event, so it is ready for the next wait once this one returns.
+    ThrowIfFailed(mFence->SetEventOnCompletion(value, mEvent));
+    WaitForSingleObject(mEvent, INFINITE);
+}
+
+D3D12DescriptorHeap::D3D12DescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type,
+    UINT persistentCount, UINT transientCount) :
+    mPersistent(0, persistentCount),
+    mTransient(persistentCount, transientCount)
+{
+    bool shaderVisible = type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV ||
+        type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER;
+
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+    heapDesc.Type = type;
+    heapDesc.NumDescriptors = persistentCount + transientCount;
+    heapDesc.Flags = shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+    heapDesc.NodeMask = 0;
+    ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mHeap)));
+
+    mCpuStart = mHeap->GetCPUDescriptorHandleForHeapStart();
+    if(shaderVisible)
+        mGpuStart = mHeap->GetGPUDescriptorHandleForHeapStart();
+    mDescriptorSize = device->GetDescriptorHandleIncrementSize(type);
+}
+
+DescriptorRange D3D12DescriptorHeap::Allocate(UINT count)
+{
+    DescriptorRange range = mPersistent.Allocate(count);
+    if(!range.IsValid())
+        ThrowIfFailed(E_OUTOFMEMORY);
+    return range;
+}
+
+DescriptorRange D3D12DescriptorHeap::AllocateTransient(UINT count)
+{
+    DescriptorRange range = mTransient.Allocate(count);
+    if(!range.IsValid())
+        ThrowIfFailed(E_OUTOFMEMORY);
+    return range;
+}
+
+void D3D12DescriptorHeap::Free(DescriptorRange range)
+{
+    mPersistent.Free(range);
+}
+
+void D3D12DescriptorHeap::FinishFrame(uint64_t fenceValue)
+{
+    mTransient.FinishFrame(fenceValue);
+}
+
+void D3D12DescriptorHeap::Retire(uint64_t completedFenceValue)
+{
+    mTransient.Retire(completedFenceValue);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE D3D12DescriptorHeap::CpuHandle(DescriptorRange range, UINT index)const
+{
+    assert(range.IsValid() && index < range.Count);
+    return CD3DX12_CPU_DESCRIPTOR_HANDLE(mCpuStart, range.Offset + index, mDescriptorSize);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE D3D12DescriptorHeap::GpuHandle(DescriptorRange range, UINT index)const
+{
+    assert(range.IsValid() && index < range.Count && mGpuStart.ptr != 0);
+    return CD3DX12_GPU_DESCRIPTOR_HANDLE(mGpuStart, range.Offset + index, mDescriptorSize);
+}
+
+D3D12BindlessTable::D3D12BindlessTable(ID3D12Device* device, D3D12DescriptorHeap* heap, UINT capacity) :
+    mDevice(device),
+    mHeap(heap),
+    mRange(heap->Allocate(capacity)),
+    mRegistry(capacity)
+{
+}
+
+BindlessHandle D3D12BindlessTable::Register(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc)
+{
+    BindlessHandle handle = mRegistry.Register();
+    if(!handle.IsValid())
+        ThrowIfFailed(E_OUTOFMEMORY);
+
+    mDevice->CreateShaderResourceView(resource, desc, mHeap->CpuHandle(mRange, handle.Index));
+    return handle;
+}
+
+BindlessHandle D3D12BindlessTable::RegisterTexture(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc)
+{
+    return Register(resource, desc);
+}
+
+BindlessHandle D3D12BindlessTable::RegisterStructuredBuffer(ID3D12Resource* resource, UINT elementCount, UINT elementByteSize)
+{
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Buffer.FirstElement = 0;
+    srvDesc.Buffer.NumElements = elementCount;
+    srvDesc.Buffer.StructureByteStride = elementByteSize;
+    srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+    return Register(resource, &srvDesc);
+}
+
+void D3D12BindlessTable::Release(BindlessHandle handle)
+{
+    mRegistry.Release(handle);
+}
+
+void D3D12BindlessTable::FinishFrame(uint64_t fenceValue)
+{
+    mRegistry.FinishFrame(fenceValue);
+}
+
+void D3D12BindlessTable::Retire(uint64_t completedFenceValue)
+{
+    mRegistry.Retire(completedFenceValue);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE D3D12BindlessTable::TableStart()const
+{
+    return mHeap->GpuHandle(mRange);
+}
+
+D3D12CopyQueue::D3D12CopyQueue(ID3D12Device* device) :
+    mDevice(device)
+{
+    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+    queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    ThrowIfFailed(device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(mQueue.GetAddressOf())));
+    mQueue->SetName(L"Upload Copy Queue");
+
+    mFence = std::make_unique<D3D12FrameFence>(device, mQueue.Get());
+}
+
+void D3D12CopyQueue::Submit(const UploadCopy* copies, uint32_t count, uint64_t fenceValue)
+{
+    // Reuse the oldest allocator if its batch is done, else make another.
+    Allocator allocator;
+    if(!mAllocators.empty() && mAllocators.front().FenceValue <= mFence->CompletedValue())
+    {
+        allocator = mAllocators.front();
+        mAllocators.pop_front();
+        ThrowIfFailed(allocator.CmdListAlloc->Reset());
+    }
+    else
+    {
+        ThrowIfFailed(mDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY,
+            IID_PPV_ARGS(allocator.CmdListAlloc.GetAddressOf())));
+    }
+
+    if(mCmdList == nullptr)
+    {
+        ThrowIfFailed(mDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY,
+            allocator.CmdListAlloc.Get(), nullptr, IID_PPV_ARGS(mCmdList.GetAddressOf())));
+    }
+    else
+    {
+        ThrowIfFailed(mCmdList->Reset(allocator.CmdListAlloc.Get(), nullptr));
+    }
+
+    // Destinations are promoted from COMMON to COPY_DEST by the copy and decay
+    // back once the batch completes, so no barriers are recorded here.
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const UploadCopy& copy = copies[i];
+        ID3D12Resource* dst = static_cast<ID3D12Resource*>(copy.Destination);
+        ID3D12Resource* src = static_cast<ID3D12Resource*>(copy.Source);
+        if(copy.Type == UploadCopy::Buffer)
+        {
+            mCmdList->CopyBufferRegion(dst, copy.DestinationOffset, src, copy.SourceOffset, copy.ByteSize);
+            continue;
+        }
+
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout = {};
+        layout.Offset = copy.SourceOffset;
+        layout.Footprint.Format = static_cast<DXGI_FORMAT>(copy.Footprint.Format);
+        layout.Footprint.Width = copy.Footprint.Width;
+        layout.Footprint.Height = copy.Footprint.Height;
+        layout.Footprint.Depth = copy.Footprint.Depth;
+        layout.Footprint.RowPitch = copy.Footprint.RowPitch;
+        CD3DX12_TEXTURE_COPY_LOCATION dstLocation(dst, copy.Footprint.Subresource);
+        CD3DX12_TEXTURE_COPY_LOCATION srcLocation(src, layout);
+        mCmdList->CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, nullptr);
+    }
+
+    ThrowIfFailed(mCmdList->Close());
+    ID3D12CommandList* cmdLists[] = { mCmdList.Get() };
+    mQueue->ExecuteCommandLists(_countof(cmdLists), cmdLists);
+    mFence->Signal(fenceValue);
+
+    allocator.FenceValue = fenceValue;
+    mAllocators.push_back(allocator);
+}
+
+void D3D12CopyQueue::WaitOnQueue(ID3D12CommandQueue* queue, uint64_t fenceValue)const
+{
+    ThrowIfFailed(queue->Wait(mFence->Fence(), fenceValue));
+}
+
+void D3D12BarrierCommandList::ResourceBarrier(const TrackedBarrier* barriers, uint32_t count)
+{
+    static const D3D12_RESOURCE_BARRIER_FLAGS splitFlags[] =
+    {
+        D3D12_RESOURCE_BARRIER_FLAG_NONE,
+        D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY,
+        D3D12_RESOURCE_BARRIER_FLAG_END_ONLY,
+    };
+
+    mBarriers.resize(count);
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const TrackedBarrier& barrier = barriers[i];
+        ID3D12Resource* resource = static_cast<ID3D12Resource*>(const_cast<void*>(barrier.Resource));
+        if(barrier.Type == TrackedBarrier::Uav)
+            mBarriers[i] = CD3DX12_RESOURCE_BARRIER::UAV(resource);
+        else if(barrier.Type == TrackedBarrier::Aliasing)
+            mBarriers[i] = CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, resource);
+        else
+            mBarriers[i] = CD3DX12_RESOURCE_BARRIER::Transition(resource,
+                d3dUtil::ToD3D12States(barrier.Before), d3dUtil::ToD3D12States(barrier.After),
+                barrier.Subresource, splitFlags[barrier.Split]);
+    }
+    mCmdList->ResourceBarrier(count, mBarriers.data());
+}
+
+RenderGraphResourceDesc D3D12TransientResources::Describe(ID3D12Device* device, const D3D12_RESOURCE_DESC& desc)
+{
+    D3D12_RESOURCE_ALLOCATION_INFO info = device->GetResourceAllocationInfo(0, 1, &desc);
+
+    RenderGraphResourceDesc graphDesc;
+    graphDesc.ByteSize = info.SizeInBytes;
+    graphDesc.Alignment = info.Alignment;
+    return graphDesc;
+}
+
+void D3D12TransientResources::Create(ID3D12Device* device, const RenderGraph& graph,
+    const std::vector<D3D12_RESOURCE_DESC>& descs,
+    const std::vector<D3D12_CLEAR_VALUE>& clearValues)
+{
+    mResources.clear();
+    mResources.resize(graph.ResourceCount());
+    mHeap.Reset();
+    mHeapSize = graph.TransientHeapSize();
+    if(mHeapSize == 0)
+        return;
+
+    // Tier 1 hardware cannot mix buffers and render targets in one heap; the
+    // graph is for short-lived targets, so keep to those there.
+    D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+    ThrowIfFailed(device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)));
+
+    D3D12_HEAP_DESC heapDesc = {};
+    heapDesc.SizeInBytes = mHeapSize;
+    heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    heapDesc.Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+    heapDesc.Flags = options.ResourceHeapTier == D3D12_RESOURCE_HEAP_TIER_1 ?
+        D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES;
+    ThrowIfFailed(device->CreateHeap(&heapDesc, IID_PPV_ARGS(&mHeap)));
+
+    for(UINT i = 0; i < graph.ResourceCount(); ++i)
+    {
+        RenderGraphResource resource = { i };
+        if(!graph.IsTransient(resource) || !graph.Lifetime(resource).IsUsed())
+            continue;
+
+        const D3D12_CLEAR_VALUE* clearValue = clearValues[i].Format != DXGI_FORMAT_UNKNOWN ? &clearValues[i] : nullptr;
+        ThrowIfFailed(device->CreatePlacedResource(
+            mHeap.Get(),
+            graph.TransientHeapOffset(resource),
+            &descs[i],
+            d3dUtil::ToD3D12States(graph.InitialState(resource)),
+            clearValue,
+            IID_PPV_ARGS(&mResources[i])));
+    }
+}
+
 std::wstring DxException::ToString()const
 {
     // Get the string description of the error code.
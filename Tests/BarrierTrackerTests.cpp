@@ -0,0 +1,201 @@
+#include "BarrierTracker.h"
+#include "RenderGraph.h"
+#include "TestHarness.h"
+#include <map>
+#include <vector>
+
+// Stand-ins for GPU resources: the tracker only needs stable pointers.
+static int sTextureA, sTextureB, sBuffer;
+
+TEST(TransitionsOfOneResourceMerge) {
+	ResourceStateTable table;
+	table.Register(&sTextureA, ResourceState::RenderTarget);
+	BarrierTracker tracker(&table);
+	NullBarrierCommandList cmdList;
+
+	// RT -> SRV -> CopyDest before anything uses it is one RT -> CopyDest.
+	tracker.Transition(&sTextureA, ResourceState::ShaderResource);
+	tracker.Transition(&sTextureA, ResourceState::CopyDest);
+	tracker.Flush(cmdList);
+	CHECK_EQ(cmdList.Calls, 1u);
+	CHECK_EQ(cmdList.Barriers.size(), 1u);
+	CHECK(cmdList.Barriers[0].Before == ResourceState::RenderTarget);
+	CHECK(cmdList.Barriers[0].After == ResourceState::CopyDest);
+	CHECK_EQ(tracker.Stats().Requested, 2u);
+	CHECK_EQ(tracker.Stats().Emitted, 1u);
+}
+
+TEST(TransitionsThatCancelDisappear) {
+	ResourceStateTable table;
+	table.Register(&sTextureA, ResourceState::RenderTarget);
+	BarrierTracker tracker(&table);
+	NullBarrierCommandList cmdList;
+
+	tracker.Transition(&sTextureA, ResourceState::ShaderResource);
+	tracker.Transition(&sTextureA, ResourceState::RenderTarget);
+	CHECK_EQ(tracker.PendingCount(), 0u);
+	tracker.Finish(cmdList);
+	CHECK_EQ(cmdList.Calls, 0u);
+	CHECK(table.State(&sTextureA) == ResourceState::RenderTarget);
+}
+
+TEST(ReadsCombineAndPromotionsNeedNoBarrier) {
+	ResourceStateTable table;
+	table.Register(&sTextureA, ResourceState::ShaderResource | ResourceState::CopySource);
+	table.Register(&sBuffer, ResourceState::Common, 1, true);
+	BarrierTracker tracker(&table);
+	NullBarrierCommandList cmdList;
+
+	tracker.Transition(&sTextureA, ResourceState::CopySource);
+	tracker.Transition(&sBuffer, ResourceState::CopyDest);
+	tracker.Finish(cmdList);
+	CHECK_EQ(cmdList.Calls, 0u);
+	CHECK_EQ(tracker.Stats().Elided, 2u);
+	// Promoted buffers decay back to Common when the list completes.
+	CHECK(table.State(&sBuffer) == ResourceState::Common);
+}
+
+TEST(OneCallPerFlushAndStatesCarryAcrossLists) {
+	ResourceStateTable table;
+	table.Register(&sTextureA, ResourceState::Common);
+	table.Register(&sTextureB, ResourceState::Common);
+	NullBarrierCommandList first, second;
+
+	BarrierTracker tracker(&table);
+	tracker.Transition(&sTextureA, ResourceState::RenderTarget);
+	tracker.Transition(&sTextureB, ResourceState::DepthWrite);
+	tracker.Finish(first);
+	CHECK_EQ(first.Calls, 1u);
+	CHECK_EQ(first.Barriers.size(), 2u);
+
+	BarrierTracker next(&table);
+	next.Transition(&sTextureA, ResourceState::ShaderResource);
+	next.Finish(second);
+	CHECK_EQ(second.Barriers.size(), 1u);
+	CHECK(second.Barriers[0].Before == ResourceState::RenderTarget);
+	CHECK(table.State(&sTextureA) == ResourceState::ShaderResource);
+	CHECK(table.State(&sTextureB) == ResourceState::DepthWrite);
+}
+
+TEST(SplitTransitionEndsAtNextUse) {
+	ResourceStateTable table;
+	table.Register(&sTextureA, ResourceState::RenderTarget);
+	BarrierTracker tracker(&table);
+	NullBarrierCommandList cmdList;
+
+	tracker.BeginTransition(&sTextureA, ResourceState::ShaderResource);
+	tracker.Flush(cmdList);
+	tracker.Transition(&sTextureA, ResourceState::ShaderResource);
+	tracker.Finish(cmdList);
+	CHECK_EQ(cmdList.Barriers.size(), 2u);
+	CHECK(cmdList.Barriers[0].Split == TrackedBarrier::BeginOnly);
+	CHECK(cmdList.Barriers[1].Split == TrackedBarrier::EndOnly);
+	CHECK(cmdList.Barriers[1].After == ResourceState::ShaderResource);
+}
+
+// Shadow map, HDR scene and post-processing into the back buffer.
+struct PostGraph {
+	struct Use {
+		RenderGraphResource Resource;
+		ResourceState State;
+	};
+
+	RenderGraph Graph;
+	RenderGraphResource BackBuffer, Shadow, Hdr;
+	uint32_t Passes[3] = {};
+	// What each pass declared, to check against what it finds.
+	std::vector<Use> Uses[3];
+
+	PostGraph() {
+		BackBuffer = Graph.Import("BackBuffer", ResourceState::Present, ResourceState::Present);
+		Shadow = Graph.CreateTransient("Shadow", {});
+		Hdr = Graph.CreateTransient("Hdr", {});
+		Passes[0] = Graph.AddPass("Shadow", nullptr);
+		Write(0, Shadow, ResourceState::DepthWrite);
+		Passes[1] = Graph.AddPass("Scene", nullptr);
+		Read(1, Shadow, ResourceState::ShaderResource);
+		Write(1, Hdr, ResourceState::RenderTarget);
+		Passes[2] = Graph.AddPass("Post", nullptr);
+		Read(2, Hdr, ResourceState::ShaderResource);
+		Write(2, BackBuffer, ResourceState::RenderTarget);
+		Graph.Compile();
+	}
+
+	void Read(uint32_t pass, RenderGraphResource resource, ResourceState state) {
+		Graph.Read(Passes[pass], resource, state);
+		Uses[pass].push_back({ resource, state });
+	}
+
+	void Write(uint32_t pass, RenderGraphResource resource, ResourceState state) {
+		Graph.Write(Passes[pass], resource, state);
+		Uses[pass].push_back({ resource, state });
+	}
+};
+
+// Applies barriers in order, checking each starts from the current state.
+static bool Replay(std::map<const void *, ResourceState> &states, const std::vector<TrackedBarrier> &barriers,
+		size_t first) {
+	for (size_t i = first; i < barriers.size(); ++i) {
+		const TrackedBarrier &barrier = barriers[i];
+		if (barrier.Type != TrackedBarrier::Transition)
+			continue;
+		if (states[barrier.Resource] != barrier.Before)
+			return false;
+		states[barrier.Resource] = barrier.After;
+	}
+	return true;
+}
+
+TEST(GraphBarriersThroughTheTrackerAreCorrectAndBatched) {
+	PostGraph post;
+	const void *resources[] = { &sTextureA, &sTextureB, &sBuffer };
+	ResourceStateTable table;
+	table.Register(resources[post.BackBuffer.Index], ResourceState::Present);
+	table.Register(resources[post.Shadow.Index], post.Graph.InitialState(post.Shadow));
+	table.Register(resources[post.Hdr.Index], post.Graph.InitialState(post.Hdr));
+	std::map<const void *, ResourceState> replayed;
+	for (const void *resource : resources)
+		replayed[resource] = table.State(resource);
+
+	// Naive: every non-empty before or after batch is its own call.
+	uint32_t naiveCalls = 0, naiveBarriers = 0;
+	for (uint32_t pass : post.Passes) {
+		RenderGraphPassContext context = post.Graph.PassContext(pass);
+		naiveCalls += (context.BeforeCount != 0) + (context.AfterCount != 0);
+		naiveBarriers += context.BeforeCount + context.AfterCount;
+	}
+
+	// Tracked: each pass flushes right before its work, so a pass's after
+	// barriers ride along with the next pass's before barriers.
+	BarrierTracker tracker(&table);
+	NullBarrierCommandList cmdList;
+	bool statesMatch = true;
+	size_t replayedCount = 0;
+	for (uint32_t p = 0; p < 3; ++p) {
+		RenderGraphPassContext context = post.Graph.PassContext(post.Passes[p]);
+		TrackBarriers(tracker, context.Before, context.BeforeCount, resources);
+		tracker.Flush(cmdList);
+		CHECK(Replay(replayed, cmdList.Barriers, replayedCount));
+		replayedCount = cmdList.Barriers.size();
+
+		// What the pass declared is what it finds.
+		for (const PostGraph::Use &use : post.Uses[p]) {
+			if (!ContainsStates(replayed[resources[use.Resource.Index]], use.State))
+				statesMatch = false;
+		}
+		TrackBarriers(tracker, context.After, context.AfterCount, resources);
+	}
+	tracker.Finish(cmdList);
+	CHECK(Replay(replayed, cmdList.Barriers, replayedCount));
+	CHECK(statesMatch);
+
+	// Everything back where the graph promises: imported to its final state,
+	// transients to the state they were created in.
+	CHECK(table.State(resources[post.BackBuffer.Index]) == ResourceState::Present);
+	CHECK(table.State(resources[post.Shadow.Index]) == post.Graph.InitialState(post.Shadow));
+	CHECK(table.State(resources[post.Hdr.Index]) == post.Graph.InitialState(post.Hdr));
+
+	CHECK_EQ(cmdList.Barriers.size(), size_t(naiveBarriers));
+	CHECK_EQ(naiveCalls, 4u);
+	CHECK_EQ(cmdList.Calls, 3u);
+}
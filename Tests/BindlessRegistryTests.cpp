@@ -0,0 +1,108 @@
+#include "BindlessRegistry.h"
+#include "TestHarness.h"
+#include <random>
+#include <vector>
+
+TEST(HandsOutLowIndicesFirst) {
+	BindlessRegistry registry(4);
+	for (uint32_t i = 0; i < 4; ++i)
+		CHECK_EQ(registry.Register().Index, i);
+	CHECK(!registry.Register().IsValid());
+	CHECK_EQ(registry.LiveCount(), 4u);
+}
+
+TEST(StaleHandlesAreDetected) {
+	BindlessRegistry registry(2);
+	BindlessHandle handle = registry.Register();
+	CHECK(registry.IsAlive(handle));
+	CHECK(registry.Release(handle));
+	CHECK(!registry.IsAlive(handle));
+	// A second release of the same handle is ignored.
+	CHECK(!registry.Release(handle));
+	CHECK_EQ(registry.PendingCount(), 1u);
+	CHECK(!registry.Release(BindlessHandle()));
+
+	registry.FinishFrame(1);
+	registry.Retire(1);
+	// Same slot, newer generation: the old handle stays dead.
+	BindlessHandle reused = registry.Register();
+	BindlessHandle other = registry.Register();
+	CHECK(reused.Index == handle.Index || other.Index == handle.Index);
+	BindlessHandle &again = reused.Index == handle.Index ? reused : other;
+	CHECK(again.Generation != handle.Generation);
+	CHECK(registry.IsAlive(again));
+	CHECK(!registry.IsAlive(handle));
+	CHECK(!registry.Release(handle));
+	CHECK(registry.IsAlive(again));
+}
+
+TEST(ReleasedSlotsWaitForTheirFrame) {
+	BindlessRegistry registry(3);
+	BindlessHandle a = registry.Register();
+	BindlessHandle b = registry.Register();
+	BindlessHandle c = registry.Register();
+
+	registry.Release(a);
+	registry.FinishFrame(10);
+	registry.Release(b);
+	registry.FinishFrame(11);
+	registry.Release(c);
+	CHECK_EQ(registry.LiveCount(), 0u);
+	CHECK_EQ(registry.PendingCount(), 3u);
+	// Nothing retired yet, so nothing can be handed out.
+	CHECK(!registry.Register().IsValid());
+
+	registry.Retire(9);
+	CHECK(!registry.Register().IsValid());
+	registry.Retire(10);
+	CHECK_EQ(registry.PendingCount(), 2u);
+	BindlessHandle first = registry.Register();
+	CHECK_EQ(first.Index, a.Index);
+	CHECK(!registry.Register().IsValid());
+
+	// c belongs to the frame still being recorded; retiring a later fence
+	// must not free it before that frame is finished.
+	registry.Retire(100);
+	CHECK_EQ(registry.PendingCount(), 1u);
+	CHECK_EQ(registry.Register().Index, b.Index);
+	registry.FinishFrame(12);
+	registry.Retire(12);
+	CHECK_EQ(registry.Register().Index, c.Index);
+	CHECK_EQ(registry.PendingCount(), 0u);
+}
+
+TEST(ChurnNeverReusesASlotTheGpuMayRead) {
+	// Three frames in flight, the GPU two frames behind. A slot released in
+	// frame F must not be registered again before F is retired.
+	std::mt19937 rng(41);
+	const uint32_t Capacity = 64;
+	BindlessRegistry registry(Capacity);
+	std::vector<BindlessHandle> live;
+	std::vector<uint64_t> releasedIn(Capacity, 0);
+	uint64_t retired = 0;
+	for (uint64_t frame = 1; frame <= 3000; ++frame) {
+		for (int op = 0; op < 8; ++op) {
+			if (!live.empty() && rng() % 2 == 0) {
+				size_t i = rng() % live.size();
+				CHECK(registry.Release(live[i]));
+				releasedIn[live[i].Index] = frame;
+				live[i] = live.back();
+				live.pop_back();
+			} else {
+				BindlessHandle handle = registry.Register();
+				if (!handle.IsValid())
+					continue;
+				CHECK(handle.Index < Capacity);
+				CHECK(releasedIn[handle.Index] <= retired);
+				live.push_back(handle);
+			}
+		}
+		registry.FinishFrame(frame);
+		if (frame > 2)
+			registry.Retire(retired = frame - 2);
+		CHECK(registry.LiveCount() + registry.PendingCount() <= Capacity);
+		CHECK_EQ(registry.LiveCount(), uint32_t(live.size()));
+	}
+	for (const BindlessHandle &handle : live)
+		CHECK(registry.IsAlive(handle));
+}
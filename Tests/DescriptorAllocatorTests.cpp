@@ -0,0 +1,174 @@
+#include "DescriptorAllocator.h"
+#include "TestHarness.h"
+#include <random>
+#include <vector>
+
+static bool Overlaps(DescriptorRange a, DescriptorRange b) {
+	return a.Offset < b.Offset + b.Count && b.Offset < a.Offset + a.Count;
+}
+
+TEST(FreeListBestFitAndMerge) {
+	DescriptorFreeList list(100, 64);
+	DescriptorRange a = list.Allocate(8);
+	DescriptorRange b = list.Allocate(4);
+	DescriptorRange c = list.Allocate(8);
+	DescriptorRange d = list.Allocate(4);
+	CHECK_EQ(a.Offset, 100u);
+	CHECK_EQ(b.Offset, 108u);
+	CHECK_EQ(c.Offset, 112u);
+	CHECK_EQ(d.Offset, 120u);
+	CHECK_EQ(list.FreeCount(), 40u);
+
+	// A 4 hole and the 40 at the end: a 3 goes in the 4.
+	list.Free(b);
+	DescriptorRange e = list.Allocate(3);
+	CHECK_EQ(e.Offset, 108u);
+	list.Free(e);
+	CHECK_EQ(list.FreeRangeCount(), 2u);
+
+	// Two 8 holes besides the tail: the lower one wins.
+	b = list.Allocate(4);
+	CHECK_EQ(b.Offset, 108u);
+	list.Free(a);
+	list.Free(c);
+	CHECK_EQ(list.FreeRangeCount(), 3u);
+	e = list.Allocate(5);
+	CHECK_EQ(e.Offset, 100u);
+	list.Free(e);
+
+	// Freeing b joins a, b and c into one range; d joins it to the tail.
+	list.Free(b);
+	CHECK_EQ(list.FreeRangeCount(), 2u);
+	CHECK_EQ(list.LargestFreeRange(), 40u);
+	list.Free(d);
+	CHECK_EQ(list.FreeRangeCount(), 1u);
+	CHECK_EQ(list.FreeCount(), 64u);
+	CHECK_EQ(list.LargestFreeRange(), 64u);
+}
+
+TEST(FreeListRejectsWhatDoesNotFit) {
+	DescriptorFreeList list(0, 16);
+	CHECK(!list.Allocate(0).IsValid());
+	CHECK(!list.Allocate(17).IsValid());
+	DescriptorRange all = list.Allocate(16);
+	CHECK(all.IsValid());
+	CHECK(!list.Allocate(1).IsValid());
+	list.Free(DescriptorRange());
+	list.Free(all);
+	CHECK_EQ(list.FreeCount(), 16u);
+
+	DescriptorFreeList empty(0, 0);
+	CHECK(!empty.Allocate(1).IsValid());
+}
+
+TEST(FreeListRandomChurnNeverOverlaps) {
+	std::mt19937 rng(17);
+	DescriptorFreeList list(0, 1024);
+	std::vector<DescriptorRange> live;
+	for (int step = 0; step < 20000; ++step) {
+		if (live.empty() || rng() % 2 == 0) {
+			DescriptorRange range = list.Allocate(1 + rng() % 16);
+			if (!range.IsValid())
+				continue;
+			CHECK(range.Offset + range.Count <= 1024u);
+			for (const DescriptorRange &other : live)
+				if (Overlaps(range, other))
+					CHECK(false);
+			live.push_back(range);
+		} else {
+			size_t i = rng() % live.size();
+			list.Free(live[i]);
+			live[i] = live.back();
+			live.pop_back();
+		}
+		uint32_t used = 0;
+		for (const DescriptorRange &range : live)
+			used += range.Count;
+		if (list.FreeCount() + used != 1024u) {
+			CHECK_EQ(list.FreeCount() + used, 1024u);
+			break;
+		}
+	}
+	for (const DescriptorRange &range : live)
+		list.Free(range);
+	CHECK_EQ(list.FreeRangeCount(), 1u);
+}
+
+TEST(RingRecyclesOnlyRetiredFrames) {
+	DescriptorRing ring(1000, 16);
+	DescriptorRange a = ring.Allocate(6);
+	CHECK_EQ(a.Offset, 1000u);
+	ring.FinishFrame(1);
+	DescriptorRange b = ring.Allocate(6);
+	CHECK_EQ(b.Offset, 1006u);
+	ring.FinishFrame(2);
+	CHECK_EQ(ring.FramesInFlight(), 2u);
+
+	// 4 left before the end, frame 1 still in flight.
+	CHECK(!ring.Allocate(5).IsValid());
+	ring.Retire(0);
+	CHECK(!ring.Allocate(5).IsValid());
+
+	// Frame 1 done: [0, 6) is free again, so a 5 skips the 4 at the end and
+	// wraps to the start.
+	ring.Retire(1);
+	CHECK_EQ(ring.FramesInFlight(), 1u);
+	DescriptorRange c = ring.Allocate(5);
+	CHECK_EQ(c.Offset, 1000u);
+	CHECK_EQ(ring.UsedCount(), 6u + 4u + 5u);
+	ring.FinishFrame(3);
+
+	ring.Retire(3);
+	CHECK_EQ(ring.UsedCount(), 0u);
+	CHECK_EQ(ring.FramesInFlight(), 0u);
+	// Empty again, so the whole ring is available in one piece.
+	CHECK_EQ(ring.Allocate(16).Offset, 1000u);
+}
+
+TEST(RingRejectsOversizedAndZero) {
+	DescriptorRing ring(0, 8);
+	CHECK(!ring.Allocate(0).IsValid());
+	CHECK(!ring.Allocate(9).IsValid());
+	CHECK(ring.Allocate(8).IsValid());
+	CHECK(!ring.Allocate(1).IsValid());
+	CHECK_EQ(ring.UsedCount(), 8u);
+}
+
+TEST(RingSimulatedFramesNeverOverlapLiveAllocations) {
+	// Three frames in flight; the GPU finishes a frame two frames after it
+	// was submitted. Live ranges must never overlap.
+	std::mt19937 rng(23);
+	const uint32_t Capacity = 256;
+	DescriptorRing ring(0, Capacity);
+	struct Live {
+		uint64_t Fence;
+		DescriptorRange Range;
+	};
+	std::vector<Live> live;
+	uint64_t fence = 1;
+	uint32_t failures = 0;
+	for (int frame = 0; frame < 2000; ++frame) {
+		int allocations = rng() % 12;
+		for (int i = 0; i < allocations; ++i) {
+			DescriptorRange range = ring.Allocate(1 + rng() % 8);
+			if (!range.IsValid()) {
+				++failures;
+				continue;
+			}
+			CHECK(range.Offset + range.Count <= Capacity);
+			for (const Live &other : live)
+				if (Overlaps(range, other.Range))
+					CHECK(false);
+			live.push_back({ fence, range });
+		}
+		ring.FinishFrame(fence);
+		if (fence > 2) {
+			ring.Retire(fence - 2);
+			std::erase_if(live, [&](const Live &l) { return l.Fence <= fence - 2; });
+		}
+		++fence;
+		CHECK(ring.FramesInFlight() <= 2u);
+	}
+	// At most ~3 * 11 * 8 slots are live at once, so nothing should fail.
+	CHECK_EQ(failures, 0u);
+}
@@ -0,0 +1,116 @@
+#include "DrawQueue.h"
+#include "TestHarness.h"
+#include <algorithm>
+#include <random>
+
+static DrawPacket MakePacket(uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t depth, uint32_t object) {
+	DrawPacket packet;
+	packet.Key = SortKey::Make(0, pipeline, material, mesh, depth);
+	packet.Pipeline = pipeline;
+	packet.Material = material;
+	packet.Mesh = mesh;
+	packet.Object = object;
+	packet.IndexCount = 36;
+	return packet;
+}
+
+TEST(KeyFieldsOrderByImportance) {
+	CHECK(SortKey::Make(1, 0, 0, 0, 0) > SortKey::Make(0, 4095, 65535, 65535, 65535));
+	CHECK(SortKey::Make(0, 1, 0, 0, 0) > SortKey::Make(0, 0, 65535, 65535, 65535));
+	CHECK(SortKey::Make(0, 0, 1, 0, 0) > SortKey::Make(0, 0, 0, 65535, 65535));
+	CHECK(SortKey::Make(0, 0, 0, 1, 0) > SortKey::Make(0, 0, 0, 0, 65535));
+	// Oversized fields are truncated instead of spilling into the next one.
+	CHECK_EQ(SortKey::Make(0, 0x1001, 0, 0, 0), SortKey::Make(0, 1, 0, 0, 0));
+}
+
+TEST(QuantizeDepthClampsToRange) {
+	CHECK_EQ(SortKey::QuantizeDepth(1.0f, 1.0f, 100.0f), 0u);
+	CHECK_EQ(SortKey::QuantizeDepth(100.0f, 1.0f, 100.0f), 65535u);
+	CHECK_EQ(SortKey::QuantizeDepth(-5.0f, 1.0f, 100.0f), 0u);
+	CHECK_EQ(SortKey::QuantizeDepth(500.0f, 1.0f, 100.0f), 65535u);
+	CHECK(SortKey::QuantizeDepth(10.0f, 1.0f, 100.0f) < SortKey::QuantizeDepth(11.0f, 1.0f, 100.0f));
+}
+
+TEST(RadixSortMatchesStableSort) {
+	std::mt19937 rng(5);
+	for (uint32_t count : { 0u, 1u, 2u, 257u, 20000u }) {
+		DrawQueue queue;
+		std::vector<DrawPacket> packets;
+		for (uint32_t i = 0; i < count; ++i) {
+			// Few distinct values per field so ties (and stability) matter.
+			DrawPacket packet = MakePacket(rng() % 4, rng() % 8, rng() % 16, rng() % 3, i);
+			packets.push_back(packet);
+			queue.Push(packet);
+		}
+		queue.Sort();
+		std::stable_sort(packets.begin(), packets.end(),
+				[](const DrawPacket &a, const DrawPacket &b) { return a.Key < b.Key; });
+		CHECK_EQ(queue.Size(), count);
+		bool same = true;
+		for (uint32_t i = 0; i < count; ++i)
+			same = same && queue.Packet(i).Object == packets[i].Object;
+		CHECK(same);
+	}
+}
+
+TEST(SortHandlesKeysDifferingInHighBytesOnly) {
+	DrawQueue queue;
+	for (uint32_t i = 0; i < 100; ++i)
+		queue.Push(MakePacket(99 - i, 7, 7, 7, i));
+	queue.Sort();
+	for (uint32_t i = 0; i < 100; ++i)
+		CHECK_EQ(queue.Packet(i).Pipeline, i);
+}
+
+TEST(SubmitFiltersRedundantState) {
+	DrawQueue queue;
+	queue.Push(MakePacket(1, 1, 1, 0, 0));
+	queue.Push(MakePacket(1, 1, 1, 1, 1));
+	queue.Push(MakePacket(1, 1, 2, 0, 2));
+	queue.Push(MakePacket(1, 2, 2, 0, 3));
+	queue.Push(MakePacket(2, 2, 2, 0, 4));
+	queue.Sort();
+
+	NullDrawSink sink;
+	DrawSubmitStats stats = queue.Submit(sink, 0, queue.Size());
+	CHECK_EQ(stats.Draws, 5u);
+	CHECK_EQ(stats.PipelineChanges, 2u);
+	// Changing pipeline rebinds nothing else, so material 2 stays bound.
+	CHECK_EQ(stats.MaterialChanges, 2u);
+	CHECK_EQ(stats.MeshChanges, 2u);
+	CHECK_EQ(stats.PrimitiveTypeChanges, 1u);
+	CHECK_EQ(stats.AvoidedChanges, 5u * 4u - 7u);
+	CHECK_EQ(sink.Calls, uint64_t(5 + 7));
+}
+
+TEST(RangesStartWithNothingBound) {
+	DrawQueue queue;
+	for (uint32_t i = 0; i < 10; ++i)
+		queue.Push(MakePacket(1, 1, 1, i, i));
+	queue.Sort();
+
+	NullDrawSink whole;
+	DrawSubmitStats total = queue.Submit(whole, 0, 10);
+	CHECK_EQ(total.PipelineChanges, 1u);
+
+	DrawSubmitStats split;
+	NullDrawSink a, b;
+	split += queue.Submit(a, 0, 6);
+	split += queue.Submit(b, 6, 100); // clamped to the queue size
+	CHECK_EQ(split.Draws, 10u);
+	CHECK_EQ(split.PipelineChanges, 2u);
+	CHECK_EQ(split.MeshChanges, 2u);
+}
+
+TEST(ClearKeepsQueueReusable) {
+	DrawQueue queue;
+	queue.Push(MakePacket(3, 0, 0, 0, 0));
+	queue.Sort();
+	queue.Clear();
+	CHECK_EQ(queue.Size(), 0u);
+	queue.Push(MakePacket(2, 0, 0, 0, 1));
+	queue.Push(MakePacket(1, 0, 0, 0, 2));
+	queue.Sort();
+	CHECK_EQ(queue.Packet(0).Object, 2u);
+	CHECK_EQ(queue.Packet(1).Object, 1u);
+}
@@ -0,0 +1,104 @@
+#include "FramePacer.h"
+#include "TestHarness.h"
+
+TEST(FrameIndicesCycleThroughRing) {
+	FakeFence fence;
+	FramePacer pacer(&fence, 3);
+	for (uint32_t frame = 0; frame < 9; ++frame) {
+		CHECK_EQ(pacer.BeginFrame(), frame % 3);
+		uint64_t value = pacer.EndFrame();
+		CHECK_EQ(value, uint64_t(frame + 1));
+		CHECK_EQ(pacer.FrameFenceValue(frame % 3), value);
+		fence.RetireAll();
+	}
+	CHECK_EQ(pacer.Stats().FramesSubmitted, 9u);
+}
+
+TEST(NoStallsWhileGpuKeepsUp) {
+	FakeFence fence;
+	FramePacer pacer(&fence, 3);
+	for (int frame = 0; frame < 100; ++frame) {
+		pacer.BeginFrame();
+		pacer.EndFrame();
+		// The GPU finishes each frame before the CPU starts the one after next.
+		if (frame >= 1)
+			fence.Retire();
+	}
+	CHECK_EQ(pacer.Stats().Stalls, 0u);
+	CHECK_EQ(fence.WaitCount(), 0u);
+	CHECK(pacer.Stats().MaxCpuAheadFrames <= 2u);
+}
+
+TEST(SlowGpuCapsCpuLead) {
+	for (uint32_t latency = 1; latency <= 3; ++latency) {
+		FakeFence fence;
+		FramePacer pacer(&fence, 3, latency);
+		for (int frame = 0; frame < 60; ++frame) {
+			pacer.BeginFrame();
+			// Never more than latency frames outstanding when recording starts.
+			CHECK(pacer.CpuAheadFrames() < latency);
+			pacer.EndFrame();
+			CHECK(pacer.CpuAheadFrames() <= latency);
+		}
+		// The GPU never retires on its own, so every frame past the first
+		// latency frames has to wait.
+		CHECK_EQ(pacer.Stats().Stalls, uint64_t(60 - latency));
+		CHECK_EQ(pacer.Stats().MaxCpuAheadFrames, latency);
+	}
+}
+
+TEST(ReusedFrameResourceIsIdle) {
+	FakeFence fence;
+	FramePacer pacer(&fence, 2);
+	for (int frame = 0; frame < 20; ++frame) {
+		uint32_t index = pacer.BeginFrame();
+		// Whatever was last submitted from this frame resource is done.
+		CHECK(fence.CompletedValue() >= pacer.FrameFenceValue(index));
+		pacer.EndFrame();
+		if (frame % 3 == 0)
+			fence.Retire();
+	}
+}
+
+TEST(FlushWaitsForEverything) {
+	FakeFence fence;
+	FramePacer pacer(&fence, 3);
+	for (int frame = 0; frame < 3; ++frame) {
+		pacer.BeginFrame();
+		pacer.EndFrame();
+	}
+	CHECK_EQ(pacer.CpuAheadFrames(), 3u);
+	pacer.Flush();
+	CHECK_EQ(pacer.CpuAheadFrames(), 0u);
+	CHECK_EQ(fence.CompletedValue(), pacer.LastSignaledValue());
+	CHECK_EQ(fence.LastSignaledValue(), 4u);
+
+	// Even with the GPU idle, Flush's own signal has to be waited for.
+	uint64_t stalls = pacer.Stats().Stalls;
+	pacer.Flush();
+	CHECK_EQ(pacer.Stats().Stalls, stalls + 1);
+}
+
+TEST(LatencyIsClamped) {
+	FakeFence fence;
+	FramePacer pacer(&fence, 3);
+	CHECK_EQ(pacer.MaxLatency(), 3u);
+	pacer.SetMaxLatency(0);
+	CHECK_EQ(pacer.MaxLatency(), 1u);
+	pacer.SetMaxLatency(10);
+	CHECK_EQ(pacer.MaxLatency(), 3u);
+	pacer.SetMaxLatency(2);
+	CHECK_EQ(pacer.MaxLatency(), 2u);
+}
+
+TEST(LoweringLatencyTakesEffectNextFrame) {
+	FakeFence fence;
+	FramePacer pacer(&fence, 3);
+	for (int frame = 0; frame < 3; ++frame) {
+		pacer.BeginFrame();
+		pacer.EndFrame();
+	}
+	pacer.SetMaxLatency(1);
+	pacer.BeginFrame();
+	CHECK_EQ(pacer.CpuAheadFrames(), 0u);
+}
@@ -0,0 +1,147 @@
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+#include "TestHarness.h"
+#include <cmath>
+#include <random>
+
+// Camera at the origin looking down +z: a D3D left-handed perspective
+// projection with a 90 degree field of view, near 1 and far 100.
+static Frustum MakeFrustum() {
+	const float n = 1.0f, f = 100.0f;
+	Float4x4 proj;
+	proj.m[0][0] = 1.0f;
+	proj.m[1][1] = 1.0f;
+	proj.m[2][2] = f / (f - n);
+	proj.m[2][3] = 1.0f;
+	proj.m[3][2] = -n * f / (f - n);
+	proj.m[3][3] = 0.0f;
+	return Frustum::FromViewProj(proj);
+}
+
+static bool ReferenceVisible(const Frustum &frustum, const AabbSoA &boxes, uint32_t i) {
+	for (const Float4 &p : frustum.Planes) {
+		double dist = double(p.x) * boxes.CenterX[i] + double(p.y) * boxes.CenterY[i] +
+				double(p.z) * boxes.CenterZ[i] + p.w;
+		double radius = std::fabs(p.x) * double(boxes.ExtentX[i]) + std::fabs(p.y) * double(boxes.ExtentY[i]) +
+				std::fabs(p.z) * double(boxes.ExtentZ[i]);
+		if (dist + radius < 0.0)
+			return false;
+	}
+	return true;
+}
+
+static AabbSoA RandomBoxes(uint32_t count, uint32_t seed) {
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> pos(-150.0f, 150.0f);
+	std::uniform_real_distribution<float> size(0.1f, 5.0f);
+	AabbSoA boxes;
+	for (uint32_t i = 0; i < count; ++i)
+		boxes.PushBack({ pos(rng), pos(rng), pos(rng) }, { size(rng), size(rng), size(rng) });
+	return boxes;
+}
+
+static uint32_t CullOne(const Frustum &frustum, const Float3 &center, const Float3 &extents) {
+	AabbSoA boxes;
+	boxes.PushBack(center, extents);
+	uint32_t visible[1];
+	return CullAabbRange(frustum, boxes, 0, 1, visible);
+}
+
+TEST(PlanesAreNormalizedAndFaceInward) {
+	Frustum frustum = MakeFrustum();
+	for (const Float4 &p : frustum.Planes) {
+		CHECK_NEAR(std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z), 1.0f, 1e-5f);
+		// A point straight ahead is inside every plane.
+		CHECK(p.z * 10.0f + p.w > 0.0f);
+	}
+	// Near and far sit at z = 1 and z = 100.
+	CHECK_NEAR(-frustum.Planes[4].w / frustum.Planes[4].z, 1.0f, 1e-4f);
+	CHECK_NEAR(-frustum.Planes[5].w / frustum.Planes[5].z, 100.0f, 1e-2f);
+}
+
+TEST(ClassifiesSingleBoxes) {
+	Frustum frustum = MakeFrustum();
+	Float3 unit = { 0.5f, 0.5f, 0.5f };
+	CHECK_EQ(CullOne(frustum, { 0.0f, 0.0f, 10.0f }, unit), 1u);
+	CHECK_EQ(CullOne(frustum, { 0.0f, 0.0f, -10.0f }, unit), 0u); // behind
+	CHECK_EQ(CullOne(frustum, { 0.0f, 0.0f, 110.0f }, unit), 0u); // past far
+	CHECK_EQ(CullOne(frustum, { -20.0f, 0.0f, 10.0f }, unit), 0u); // left
+	CHECK_EQ(CullOne(frustum, { 0.0f, 20.0f, 10.0f }, unit), 0u); // above
+	// Straddling the left plane (x = -z) and the near plane.
+	CHECK_EQ(CullOne(frustum, { -10.4f, 0.0f, 10.0f }, unit), 1u);
+	CHECK_EQ(CullOne(frustum, { 0.0f, 0.0f, 0.7f }, unit), 1u);
+	// Enclosing the whole frustum.
+	CHECK_EQ(CullOne(frustum, { 0.0f, 0.0f, 0.0f }, { 500.0f, 500.0f, 500.0f }), 1u);
+}
+
+TEST(RangeMatchesReferenceForAnyOffsetAndCount) {
+	Frustum frustum = MakeFrustum();
+	AabbSoA boxes = RandomBoxes(1000, 1);
+	std::vector<uint32_t> visible(boxes.Size());
+	// Odd starts and lengths exercise the SIMD body and the scalar tail.
+	for (uint32_t first : { 0u, 1u, 3u, 17u }) {
+		for (uint32_t count : { 0u, 1u, 5u, 64u, 983u }) {
+			uint32_t written = CullAabbRange(frustum, boxes, first, count, visible.data());
+			uint32_t expected = 0;
+			for (uint32_t i = first; i < first + count; ++i) {
+				if (!ReferenceVisible(frustum, boxes, i))
+					continue;
+				CHECK(expected < written);
+				if (expected < written)
+					CHECK_EQ(visible[expected], i);
+				++expected;
+			}
+			CHECK_EQ(written, expected);
+		}
+	}
+}
+
+TEST(CullerMatchesAcrossThreadsAndChunks) {
+	Frustum frustum = MakeFrustum();
+	AabbSoA boxes = RandomBoxes(50001, 2);
+
+	std::vector<uint32_t> reference;
+	for (uint32_t i = 0; i < boxes.Size(); ++i)
+		if (ReferenceVisible(frustum, boxes, i))
+			reference.push_back(i);
+	CHECK(!reference.empty());
+
+	FrustumCuller inlineCuller;
+	std::vector<uint32_t> visible;
+	CHECK_EQ(inlineCuller.Cull(frustum, boxes, visible), uint32_t(reference.size()));
+	CHECK(visible == reference);
+
+	JobSystem jobs(3);
+	for (uint32_t minChunk : { 4u, 1000u, 4096u }) {
+		FrustumCuller culler(&jobs, minChunk);
+		for (int repeat = 0; repeat < 5; ++repeat) {
+			CHECK_EQ(culler.Cull(frustum, boxes, visible), uint32_t(reference.size()));
+			CHECK(visible == reference);
+		}
+	}
+}
+
+TEST(EmptySetCullsToNothing) {
+	FrustumCuller culler;
+	AabbSoA boxes;
+	std::vector<uint32_t> visible = { 1, 2, 3 };
+	CHECK_EQ(culler.Cull(MakeFrustum(), boxes, visible), 0u);
+	CHECK(visible.empty());
+}
+
+TEST(TransformAabbEnclosesRotatedBox) {
+	// 90 degree rotation about y plus a translation.
+	Float4x4 world;
+	world.m[0][0] = 0.0f;
+	world.m[0][2] = -1.0f;
+	world.m[2][0] = 1.0f;
+	world.m[2][2] = 0.0f;
+	world.m[3][0] = 5.0f;
+	Float3 center, extents;
+	TransformAabb({ 1.0f, 0.0f, 0.0f }, { 1.0f, 2.0f, 3.0f }, world, center, extents);
+	CHECK_NEAR(center.x, 5.0f, 1e-6f);
+	CHECK_NEAR(center.z, -1.0f, 1e-6f);
+	CHECK_NEAR(extents.x, 3.0f, 1e-6f);
+	CHECK_NEAR(extents.y, 2.0f, 1e-6f);
+	CHECK_NEAR(extents.z, 1.0f, 1e-6f);
+}
@@ -0,0 +1,177 @@
+#include "InstanceBatcher.h"
+#include "TestHarness.h"
+#include <random>
+
+// A render item as GameApp queues it: geometry, submesh (index range and base
+// vertex), material and depth, drawn with the scene pipeline.
+struct Item {
+	uint32_t Mesh;
+	uint32_t Submesh;
+	uint32_t Material;
+	uint32_t Depth;
+};
+
+static DrawPacket MakePacket(const Item &item, uint32_t object) {
+	DrawPacket packet;
+	packet.Pipeline = 1;
+	packet.Material = item.Material;
+	packet.Mesh = item.Mesh;
+	packet.Object = object;
+	// Submesh n of every mesh: 36 indices at 36n, vertices at 24n.
+	packet.IndexCount = 36;
+	packet.StartIndexLocation = 36 * item.Submesh;
+	packet.BaseVertexLocation = 24 * static_cast<int32_t>(item.Submesh);
+	packet.Key = SortKey::Make(0, packet.Pipeline, packet.Material, packet.Mesh, item.Depth);
+	return packet;
+}
+
+static void Queue(DrawQueue &queue, const std::vector<Item> &items) {
+	queue.Clear();
+	for (uint32_t i = 0; i < items.size(); ++i)
+		queue.Push(MakePacket(items[i], i));
+	queue.Sort();
+}
+
+// The objects a batch draws, in instance order.
+static std::vector<uint32_t> Objects(const InstanceBatcher &batcher, const DrawPacket &batch) {
+	const std::vector<uint32_t> &instances = batcher.Instances();
+	return std::vector<uint32_t>(instances.begin() + batch.FirstInstance,
+			instances.begin() + batch.FirstInstance + batch.InstanceCount);
+}
+
+TEST(MatchingItemsCollapseIntoOneBatch) {
+	DrawQueue input, output;
+	Queue(input, { { 3, 1, 7, 40 }, { 3, 1, 7, 10 }, { 3, 1, 7, 30 }, { 3, 1, 7, 20 } });
+
+	InstanceBatcher batcher;
+	InstanceBatchStats stats = batcher.Build(input, output);
+	CHECK_EQ(stats.InputDraws, 4u);
+	CHECK_EQ(stats.OutputDraws, 1u);
+	CHECK_EQ(output.Size(), 1u);
+
+	// The batch is the nearest item's packet, drawing all four front to back.
+	const DrawPacket &batch = output.Packet(0);
+	CHECK_EQ(batch.Key, input.Packet(0).Key);
+	CHECK_EQ(batch.Mesh, 3u);
+	CHECK_EQ(batch.Material, 7u);
+	CHECK_EQ(batch.StartIndexLocation, 36u);
+	CHECK_EQ(batch.BaseVertexLocation, 24);
+	CHECK_EQ(batch.FirstInstance, 0u);
+	CHECK_EQ(batch.InstanceCount, 4u);
+	CHECK(Objects(batcher, batch) == std::vector<uint32_t>({ 1, 3, 2, 0 }));
+}
+
+TEST(AnyDifferenceSplitsTheBatch) {
+	const Item base = { 3, 1, 7, 0 };
+	Item otherMesh = base, otherSubmesh = base, otherMaterial = base;
+	otherMesh.Mesh = 4;
+	otherSubmesh.Submesh = 2;
+	otherMaterial.Material = 8;
+
+	InstanceBatcher batcher;
+	DrawQueue input, output;
+	for (const Item &other : { otherMesh, otherSubmesh, otherMaterial }) {
+		Queue(input, { base, other, base, other });
+		InstanceBatchStats stats = batcher.Build(input, output);
+		CHECK_EQ(stats.OutputDraws, 2u);
+		CHECK_EQ(output.Packet(0).InstanceCount, 2u);
+		CHECK_EQ(output.Packet(1).InstanceCount, 2u);
+	}
+
+	// Each draw argument of the submesh counts on its own, as does the pipeline.
+	auto splits = [&](void (*edit)(DrawPacket &)) {
+		input.Clear();
+		DrawPacket packet = MakePacket(base, 0), edited = MakePacket(base, 1);
+		edit(edited);
+		input.Push(packet);
+		input.Push(edited);
+		input.Sort();
+		return batcher.Build(input, output).OutputDraws == 2;
+	};
+	CHECK(splits([](DrawPacket &p) { p.IndexCount = 6; }));
+	CHECK(splits([](DrawPacket &p) { p.StartIndexLocation = 0; }));
+	CHECK(splits([](DrawPacket &p) { p.BaseVertexLocation = 0; }));
+	CHECK(splits([](DrawPacket &p) { p.Pipeline = 2; }));
+	CHECK(splits([](DrawPacket &p) { p.PrimitiveType = 5; }));
+	CHECK(!splits([](DrawPacket &p) { p.Key += 1; }));
+}
+
+TEST(InstanceSlicesAreContiguousAndInOrder) {
+	std::mt19937 rng(21);
+	std::vector<Item> items;
+	for (uint32_t i = 0; i < 5000; ++i)
+		items.push_back({ uint32_t(rng() % 8), uint32_t(rng() % 3), uint32_t(rng() % 4), uint32_t(rng() & 0xffff) });
+	DrawQueue input, output;
+	Queue(input, items);
+
+	InstanceBatcher batcher;
+	batcher.Build(input, output);
+
+	// Batches tile the instance list back to back and cover every item once.
+	uint32_t next = 0;
+	std::vector<uint32_t> seen(items.size(), 0);
+	for (uint32_t b = 0; b < output.Size(); ++b) {
+		const DrawPacket &batch = output.Packet(b);
+		CHECK_EQ(batch.FirstInstance, next);
+		next += batch.InstanceCount;
+
+		// Every instance matches the batch, in sorted (front-to-back) order.
+		uint32_t lastDepth = 0;
+		bool matches = true, ordered = true;
+		for (uint32_t object : Objects(batcher, batch)) {
+			const Item &item = items[object];
+			matches = matches && item.Mesh == batch.Mesh && item.Material == batch.Material &&
+					36 * item.Submesh == batch.StartIndexLocation;
+			ordered = ordered && item.Depth >= lastDepth;
+			lastDepth = item.Depth;
+			++seen[object];
+		}
+		CHECK(matches);
+		CHECK(ordered);
+	}
+	CHECK_EQ(next, items.size());
+	CHECK_EQ(batcher.Instances().size(), items.size());
+	bool once = true;
+	for (uint32_t count : seen)
+		once = once && count == 1;
+	CHECK(once);
+
+	// Batches come out in the order of their first packet, so still sorted.
+	for (uint32_t b = 1; b < output.Size(); ++b)
+		CHECK(output.Packet(b - 1).Key <= output.Packet(b).Key);
+}
+
+TEST(DrawCountsBeforeAndAfter) {
+	// 8 meshes x 3 submeshes x 4 materials = 96 distinct draws.
+	std::vector<Item> items;
+	for (uint32_t i = 0; i < 960; ++i)
+		items.push_back({ i % 8, (i / 8) % 3, (i / 24) % 4, i });
+	DrawQueue input, output;
+	Queue(input, items);
+
+	InstanceBatcher batcher;
+	InstanceBatchStats stats = batcher.Build(input, output);
+	CHECK_EQ(stats.InputDraws, 960u);
+	CHECK_EQ(stats.OutputDraws, 96u);
+	for (uint32_t b = 0; b < output.Size(); ++b)
+		CHECK_EQ(output.Packet(b).InstanceCount, 10u);
+
+	// Packets that already carry instances add them all to their batch.
+	input.Clear();
+	DrawPacket packet = MakePacket(items[0], 100);
+	packet.InstanceCount = 3;
+	input.Push(packet);
+	input.Push(MakePacket(items[0], 200));
+	input.Sort();
+	stats = batcher.Build(input, output);
+	CHECK_EQ(stats.InputDraws, 2u);
+	CHECK_EQ(stats.OutputDraws, 1u);
+	CHECK(Objects(batcher, output.Packet(0)) == std::vector<uint32_t>({ 100, 101, 102, 200 }));
+
+	// Rebuilding from an empty queue clears the previous output.
+	input.Clear();
+	stats = batcher.Build(input, output);
+	CHECK_EQ(stats.OutputDraws, 0u);
+	CHECK_EQ(output.Size(), 0u);
+	CHECK(batcher.Instances().empty());
+}
@@ -0,0 +1,162 @@
+#include "JobSystem.h"
+#include "TestHarness.h"
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <vector>
+
+TEST(RunsEveryJobOnce) {
+	JobSystem jobs(3);
+	const int Count = 20000;
+	std::vector<std::atomic<int>> hits(Count);
+	JobCounter counter;
+	for (int i = 0; i < Count; ++i)
+		jobs.Run([&hits, i]() { hits[i].fetch_add(1); }, &counter);
+	jobs.Wait(counter);
+	CHECK(counter.IsDone());
+	int wrong = 0;
+	for (std::atomic<int> &hit : hits)
+		wrong += hit.load() != 1;
+	CHECK_EQ(wrong, 0);
+}
+
+TEST(NestedJobsFromWorkers) {
+	JobSystem jobs(3);
+	std::atomic<int> leaves{ 0 };
+	JobCounter counter;
+	for (int i = 0; i < 64; ++i) {
+		jobs.Run([&]() {
+			// Workers push onto their own queue; the outer counter covers these too.
+			for (int j = 0; j < 64; ++j)
+				jobs.Run([&]() { leaves.fetch_add(1); }, &counter);
+		}, &counter);
+	}
+	jobs.Wait(counter);
+	CHECK_EQ(leaves.load(), 64 * 64);
+}
+
+TEST(RunAfterWaitsForDependency) {
+	JobSystem jobs(2);
+	for (int round = 0; round < 200; ++round) {
+		JobCounter first, second;
+		std::atomic<int> firstDone{ 0 };
+		std::atomic<int> orderViolations{ 0 };
+		for (int i = 0; i < 16; ++i)
+			jobs.Run([&]() { firstDone.fetch_add(1); }, &first);
+		for (int i = 0; i < 4; ++i)
+			jobs.RunAfter(first, [&]() {
+				if (firstDone.load() != 16)
+					orderViolations.fetch_add(1);
+			}, &second);
+		jobs.Wait(second);
+		CHECK_EQ(orderViolations.load(), 0);
+	}
+
+	// A dependency that is already done runs the job straight away.
+	JobCounter done, after;
+	bool ran = false;
+	jobs.RunAfter(done, [&]() { ran = true; }, &after);
+	jobs.Wait(after);
+	CHECK(ran);
+}
+
+TEST(ParallelForCoversRangeExactly) {
+	JobSystem jobs(3);
+	for (uint32_t count : { 1u, 7u, 100u, 4097u, 100000u }) {
+		for (uint32_t grain : { 0u, 1u, 64u, 10000u }) {
+			std::vector<std::atomic<uint8_t>> hits(count);
+			jobs.ParallelFor(count, grain, [&](uint32_t first, uint32_t n) {
+				for (uint32_t i = first; i < first + n; ++i)
+					hits[i].fetch_add(1);
+			});
+			uint32_t wrong = 0;
+			for (std::atomic<uint8_t> &hit : hits)
+				wrong += hit.load() != 1;
+			CHECK_EQ(wrong, 0u);
+		}
+	}
+	bool called = false;
+	jobs.ParallelFor(0, 1, [&](uint32_t, uint32_t) { called = true; });
+	CHECK(!called);
+}
+
+TEST(ThreadIndicesAreStableAndInRange) {
+	JobSystem jobs(3);
+	CHECK_EQ(jobs.ThreadCount(), 4u);
+	CHECK_EQ(jobs.ThreadIndex(), 0u);
+	std::mutex mutex;
+	std::set<uint32_t> seen;
+	JobCounter counter;
+	for (int i = 0; i < 2000; ++i) {
+		jobs.Run([&]() {
+			uint32_t index = jobs.ThreadIndex();
+			std::lock_guard<std::mutex> lock(mutex);
+			seen.insert(index);
+		}, &counter);
+	}
+	jobs.Wait(counter);
+	for (uint32_t index : seen)
+		CHECK(index < jobs.ThreadCount());
+}
+
+TEST(WorkerOfOneSystemSubmittingToAnother) {
+	// Worker 3 of the big system has no queue 3 in the small one. Its jobs
+	// must go through the small system's shared queue and it must see itself
+	// as a non-worker there.
+	JobSystem big(3);
+	JobSystem small(1);
+	std::atomic<int> ran{ 0 };
+	std::atomic<int> wrongIndex{ 0 };
+	JobCounter outer;
+	for (int i = 0; i < 32; ++i) {
+		big.Run([&]() {
+			if (small.ThreadIndex() != 0)
+				wrongIndex.fetch_add(1);
+			JobCounter inner;
+			for (int j = 0; j < 16; ++j)
+				small.Run([&]() {
+					// Big's workers help here from small.Wait() but are not small's workers.
+					bool bigWorker = big.ThreadIndex() != 0;
+					if (small.ThreadIndex() > 1 || (bigWorker && small.ThreadIndex() != 0))
+						wrongIndex.fetch_add(1);
+					ran.fetch_add(1);
+				}, &inner);
+			small.Wait(inner);
+		}, &outer);
+	}
+	// Leave the outer jobs to big's workers rather than helping from here.
+	while (!outer.IsDone())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	big.Wait(outer);
+	CHECK_EQ(ran.load(), 32 * 16);
+	CHECK_EQ(wrongIndex.load(), 0);
+}
+
+TEST(ConcurrentWaitersFromManyThreads) {
+	JobSystem jobs(2);
+	std::atomic<int> total{ 0 };
+	std::vector<std::thread> submitters;
+	for (int t = 0; t < 4; ++t) {
+		submitters.emplace_back([&]() {
+			for (int round = 0; round < 50; ++round) {
+				JobCounter counter;
+				for (int i = 0; i < 20; ++i)
+					jobs.Run([&]() { total.fetch_add(1); }, &counter);
+				jobs.Wait(counter);
+			}
+		});
+	}
+	for (std::thread &submitter : submitters)
+		submitter.join();
+	CHECK_EQ(total.load(), 4 * 50 * 20);
+}
+
+TEST(DestructorDrainsQueuedJobs) {
+	std::atomic<int> ran{ 0 };
+	{
+		JobSystem jobs(2);
+		for (int i = 0; i < 1000; ++i)
+			jobs.Run([&]() { ran.fetch_add(1); });
+	}
+	CHECK_EQ(ran.load(), 1000);
+}
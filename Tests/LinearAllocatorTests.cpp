@@ -0,0 +1,137 @@
+#include "LinearAllocator.h"
+#include "TestHarness.h"
+#include <cstring>
+
+// Counts pages so tests can see what the allocator asked for.
+class CountingPageProvider : public MallocPageProvider {
+public:
+	virtual UploadPage CreatePage(uint64_t byteSize) override {
+		++Created;
+		return MallocPageProvider::CreatePage(byteSize);
+	}
+	virtual void DestroyPage(UploadPage &page) override {
+		++Destroyed;
+		MallocPageProvider::DestroyPage(page);
+	}
+
+	int Created = 0;
+	int Destroyed = 0;
+};
+
+TEST(AllocationsAreAligned) {
+	MallocPageProvider provider;
+	LinearAllocator allocator(&provider, 64 * 1024);
+	const uint64_t alignments[] = { 1, 4, 16, 256, 4096 };
+	for (int i = 0; i < 100; ++i) {
+		uint64_t alignment = alignments[i % 5];
+		UploadAllocation alloc = allocator.Allocate(1 + i * 7, alignment);
+		CHECK(alloc.Cpu != nullptr);
+		CHECK_EQ(alloc.Gpu % alignment, 0u);
+		CHECK_EQ(alloc.PageOffset % alignment, 0u);
+		CHECK_EQ(alloc.ByteSize, uint64_t(1 + i * 7));
+	}
+}
+
+TEST(DefaultAlignmentIsConstantBufferAlignment) {
+	MallocPageProvider provider;
+	LinearAllocator allocator(&provider, 64 * 1024);
+	UploadAllocation a = allocator.Allocate(4);
+	UploadAllocation b = allocator.Allocate(4);
+	CHECK_EQ(a.Gpu % 256, 0u);
+	CHECK_EQ(b.Gpu - a.Gpu, 256u);
+	CHECK_EQ(allocator.BytesAllocated(), 260u);
+}
+
+TEST(AllocationsDoNotOverlap) {
+	MallocPageProvider provider;
+	LinearAllocator allocator(&provider, 4096);
+	std::vector<UploadAllocation> allocs;
+	for (int i = 0; i < 200; ++i) {
+		allocs.push_back(allocator.Allocate(40 + i % 300, 16));
+		memset(allocs.back().Cpu, i & 0xFF, static_cast<size_t>(allocs.back().ByteSize));
+	}
+	for (size_t i = 0; i < allocs.size(); ++i) {
+		bool intact = true;
+		for (uint64_t b = 0; b < allocs[i].ByteSize; ++b)
+			intact = intact && allocs[i].Cpu[b] == uint8_t(i & 0xFF);
+		CHECK(intact);
+	}
+}
+
+TEST(GrowsByChainedPages) {
+	CountingPageProvider provider;
+	LinearAllocator allocator(&provider, 1024);
+	CHECK_EQ(allocator.PageCount(), 1u);
+	for (int i = 0; i < 10; ++i)
+		allocator.Allocate(256);
+	// Four 256-byte allocations fit a page.
+	CHECK_EQ(allocator.PageCount(), 3u);
+	CHECK_EQ(provider.Created, 3);
+
+	// A request that does not fit the rest of a page starts the next one.
+	allocator.Reset();
+	allocator.Allocate(768);
+	UploadAllocation next = allocator.Allocate(512);
+	CHECK_EQ(next.PageOffset, 0u);
+	CHECK_EQ(provider.Created, 3);
+}
+
+TEST(ResetReusesPages) {
+	CountingPageProvider provider;
+	LinearAllocator allocator(&provider, 1024);
+	for (int frame = 0; frame < 10; ++frame) {
+		for (int i = 0; i < 12; ++i)
+			allocator.Allocate(256);
+		allocator.Reset();
+	}
+	// Grew to the high-water mark once, then stopped allocating pages.
+	CHECK_EQ(provider.Created, 3);
+	CHECK_EQ(provider.Destroyed, 0);
+	CHECK_EQ(allocator.BytesAllocated(), 0u);
+	CHECK_EQ(allocator.HighWaterMark(), 12u * 256u);
+
+	// Resetting hands out the same memory again.
+	UploadAllocation first = allocator.Allocate(256);
+	allocator.Reset();
+	CHECK(allocator.Allocate(256).Cpu == first.Cpu);
+}
+
+TEST(ResetTrimsPages) {
+	CountingPageProvider provider;
+	LinearAllocator allocator(&provider, 1024);
+	for (int i = 0; i < 16; ++i)
+		allocator.Allocate(256);
+	CHECK_EQ(allocator.PageCount(), 4u);
+	allocator.Reset(2);
+	CHECK_EQ(allocator.PageCount(), 2u);
+	CHECK_EQ(provider.Destroyed, 2);
+	// At least one page is always kept.
+	allocator.Reset(0);
+	CHECK_EQ(allocator.PageCount(), 1u);
+}
+
+TEST(OversizedRequestsGetDedicatedPages) {
+	CountingPageProvider provider;
+	LinearAllocator allocator(&provider, 1024);
+	UploadAllocation small = allocator.Allocate(64);
+	UploadAllocation big = allocator.Allocate(10000);
+	CHECK_EQ(big.ByteSize, 10000u);
+	CHECK_EQ(big.PageOffset, 0u);
+	CHECK(big.PageHandle != small.PageHandle);
+	CHECK_EQ(allocator.PageCount(), 1u);
+	// The regular chain carries on where it was.
+	CHECK_EQ(allocator.Allocate(64).PageOffset, 256u);
+
+	allocator.Reset();
+	CHECK_EQ(provider.Destroyed, 1);
+}
+
+TEST(UploadCopiesData) {
+	MallocPageProvider provider;
+	LinearAllocator allocator(&provider, 4096);
+	float constants[16];
+	for (int i = 0; i < 16; ++i)
+		constants[i] = float(i) * 0.5f;
+	UploadAllocation alloc = allocator.Upload(constants, sizeof(constants));
+	CHECK(memcmp(alloc.Cpu, constants, sizeof(constants)) == 0);
+}
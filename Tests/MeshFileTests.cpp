@@ -0,0 +1,314 @@
+#include "MappedFile.h"
+#include "MeshFile.h"
+#include "TestHarness.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+
+// Two named subsets over a strip of triangles, positions and normals, 16-bit
+// indices.
+static MeshData MakeMesh() {
+	MeshData mesh;
+	mesh.Name = "strip";
+	mesh.Attributes = MeshAttributePosition | MeshAttributeNormal;
+	mesh.VertexStride = MeshVertexStride(mesh.Attributes);
+	mesh.VertexCount = 20;
+	mesh.IndexByteSize = 2;
+	mesh.Vertices.resize(size_t(mesh.VertexCount) * mesh.VertexStride);
+	for (uint32_t v = 0; v < mesh.VertexCount; ++v) {
+		float vertex[6] = { float(v / 2), float(v % 2), 0.0f, 0.0f, 0.0f, -1.0f };
+		memcpy(mesh.Vertices.data() + size_t(v) * mesh.VertexStride, vertex, sizeof(vertex));
+	}
+	std::vector<uint16_t> indices;
+	for (uint16_t v = 0; v + 2u < mesh.VertexCount; ++v) {
+		indices.push_back(v);
+		indices.push_back(uint16_t(v + 1 + v % 2));
+		indices.push_back(uint16_t(v + 2 - v % 2));
+	}
+	mesh.IndexCount = static_cast<uint32_t>(indices.size());
+	mesh.Indices.resize(indices.size() * 2);
+	memcpy(mesh.Indices.data(), indices.data(), mesh.Indices.size());
+
+	MeshSubset left, right;
+	left.Name = "left";
+	left.IndexCount = 27;
+	left.BoundsMax[0] = 5.0f;
+	left.BoundsMax[1] = 1.0f;
+	right.Name = "right_lod1";
+	right.StartIndex = 27;
+	right.IndexCount = mesh.IndexCount - 27;
+	right.BoundsMin[0] = 4.0f;
+	right.BoundsMax[0] = 9.0f;
+	right.BoundsMax[1] = 1.0f;
+	right.LodLevel = 1;
+	right.LodError = 0.25f;
+	mesh.Subsets = { left, right };
+	return mesh;
+}
+
+static std::vector<uint8_t> Serialize(const MeshData &mesh) {
+	std::vector<uint8_t> bytes;
+	SerializeMeshFile(mesh, bytes);
+	return bytes;
+}
+
+static bool Parses(const std::vector<uint8_t> &bytes, std::string *error = nullptr) {
+	MeshFileView view;
+	std::string message;
+	bool ok = ParseMeshFile(bytes.data(), bytes.size(), view, message);
+	if (error != nullptr)
+		*error = message;
+	return ok;
+}
+
+// Copies of the file with one header or subset field changed.
+static std::vector<uint8_t> WithHeader(std::vector<uint8_t> bytes, const std::function<void(MeshFileHeader &)> &fn) {
+	MeshFileHeader header;
+	memcpy(&header, bytes.data(), sizeof(header));
+	fn(header);
+	memcpy(bytes.data(), &header, sizeof(header));
+	return bytes;
+}
+
+static std::vector<uint8_t> WithSubset(std::vector<uint8_t> bytes, uint32_t index,
+		const std::function<void(MeshFileSubset &)> &fn) {
+	size_t offset = sizeof(MeshFileHeader) + index * sizeof(MeshFileSubset);
+	MeshFileSubset subset;
+	memcpy(&subset, bytes.data() + offset, sizeof(subset));
+	fn(subset);
+	memcpy(bytes.data() + offset, &subset, sizeof(subset));
+	return bytes;
+}
+
+TEST(RoundTripsThroughTheView) {
+	MeshData mesh = MakeMesh();
+	std::vector<uint8_t> bytes = Serialize(mesh);
+	CHECK(IsMeshFile(bytes.data(), bytes.size()));
+	CHECK_EQ(bytes.size() % MeshFileStreamAlignment, 0u);
+
+	MeshFileView view;
+	std::string error;
+	CHECK(ParseMeshFile(bytes.data(), bytes.size(), view, error));
+	CHECK_EQ(view.Header->SubsetCount, 2u);
+	CHECK(view.SubsetName(0) == "left");
+	CHECK(view.SubsetName(1) == "right_lod1");
+	CHECK_EQ(view.Subsets[1].StartIndex, 27u);
+	CHECK_EQ(view.Subsets[1].LodLevel, 1u);
+	CHECK_EQ(reinterpret_cast<uintptr_t>(view.Vertices) % MeshFileStreamAlignment, 0u);
+	CHECK_EQ(reinterpret_cast<uintptr_t>(view.Indices) % MeshFileStreamAlignment, 0u);
+	CHECK(memcmp(view.Vertices, mesh.Vertices.data(), mesh.Vertices.size()) == 0);
+	CHECK(memcmp(view.Indices, mesh.Indices.data(), mesh.Indices.size()) == 0);
+
+	MeshData decoded;
+	CHECK(DecodeMeshFile(bytes.data(), bytes.size(), decoded, error));
+	CHECK(decoded.Vertices == mesh.Vertices);
+	CHECK(decoded.Indices == mesh.Indices);
+	CHECK_EQ(decoded.IndexByteSize, 2u);
+	CHECK_EQ(decoded.Subsets.size(), 2u);
+	CHECK(decoded.Subsets[1].Name == "right_lod1");
+	CHECK_NEAR(decoded.Subsets[1].LodError, 0.25, 0.0);
+	CHECK_NEAR(decoded.Subsets[1].BoundsMax[0], 9.0, 0.0);
+}
+
+TEST(PackedMeshesRoundTripThroughTheView) {
+	MeshData mesh = MakeMesh();
+	PackedMesh packed;
+	PackMesh(mesh, packed);
+	std::vector<uint8_t> bytes;
+	SerializeMeshFile(packed, bytes);
+
+	MeshFileView view;
+	std::string error;
+	CHECK(ParseMeshFile(bytes.data(), bytes.size(), view, error));
+	CHECK(view.IsPacked());
+	CHECK_EQ(view.Header->Attributes, mesh.Attributes);
+	CHECK_EQ(view.Header->VertexStride, packed.Layout.Stride);
+	CHECK_EQ(view.Header->IndexByteSize, packed.IndexByteSize);
+	CHECK_EQ(view.VertexByteSize(), packed.Vertices.size());
+	CHECK(memcmp(view.Vertices, packed.Vertices.data(), packed.Vertices.size()) == 0);
+	CHECK(memcmp(view.Indices, packed.Indices.data(), packed.Indices.size()) == 0);
+	for (uint32_t s = 0; s < 2; ++s) {
+		CHECK_EQ(view.Subsets[s].BaseVertex, packed.Subsets[s].BaseVertex);
+		for (int c = 0; c < 3; ++c) {
+			CHECK_NEAR(view.Subsets[s].PositionScale[c], packed.Quantization[s].PositionScale[c], 0.0);
+			CHECK_NEAR(view.Subsets[s].PositionOffset[c], packed.Quantization[s].PositionOffset[c], 0.0);
+		}
+	}
+
+	// Unpacked files carry an identity quantization; packed ones cannot be
+	// decoded into floats.
+	std::vector<uint8_t> plain = Serialize(mesh);
+	CHECK(ParseMeshFile(plain.data(), plain.size(), view, error));
+	CHECK_NEAR(view.Subsets[1].PositionScale[2], 1.0, 0.0);
+	CHECK_NEAR(view.Subsets[1].PositionOffset[2], 0.0, 0.0);
+	MeshData decoded;
+	CHECK(!DecodeMeshFile(bytes.data(), bytes.size(), decoded, error));
+	CHECK(error == "mesh file is packed");
+}
+
+TEST(CookingConvertsAttributesAndPacks) {
+	std::filesystem::path dir = std::filesystem::temp_directory_path() / "photon_meshfile_cook";
+	std::filesystem::create_directories(dir);
+	std::string objPath = (dir / "quad.obj").string(), meshPath = (dir / "quad.mesh").string();
+	std::ofstream(objPath) << "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nvn 0 0 -1\nf 1//1 3//1 2//1\nf 1//1 4//1 3//1\n";
+
+	MeshCookDesc desc;
+	desc.Attributes = MeshAttributePosition | MeshAttributeColor;
+	desc.Packed = true;
+	std::string error;
+	CHECK(ConvertObjToMeshFile(objPath, meshPath, desc, error));
+	CHECK(IsCurrentMeshFile(meshPath, desc));
+	CHECK(!IsCurrentMeshFile(meshPath));
+	MeshCookDesc otherAttributes = desc;
+	otherAttributes.Attributes = MeshAttributePosition;
+	CHECK(!IsCurrentMeshFile(meshPath, otherAttributes));
+
+	// Every vertex is colored by the normal (0, 0, -1), in RGBA8.
+	MappedFile file;
+	MeshFileView view;
+	CHECK(file.Open(meshPath) && ParseMeshFile(file.Data(), file.Size(), view, error));
+	CHECK_EQ(view.Header->VertexStride, 12u);
+	CHECK_EQ(view.Header->IndexCount, 6u);
+	for (uint32_t v = 0; v < view.Header->VertexCount; ++v) {
+		const uint8_t *color = view.Vertices + v * 12 + 8;
+		CHECK_EQ(color[0], 128);
+		CHECK_EQ(color[1], 128);
+		CHECK_EQ(color[2], 0);
+		CHECK_EQ(color[3], 255);
+	}
+	file.Close();
+
+	// Unpacked with the OBJ's own attributes by default.
+	CHECK(ConvertObjToMeshFile(objPath, meshPath, MeshCookDesc(), error));
+	CHECK(IsCurrentMeshFile(meshPath));
+	CHECK(!IsCurrentMeshFile(meshPath, desc));
+	std::filesystem::remove_all(dir);
+}
+
+TEST(EveryTruncationIsRejected) {
+	std::vector<uint8_t> bytes = Serialize(MakeMesh());
+	for (size_t size = 0; size < bytes.size(); ++size) {
+		std::vector<uint8_t> truncated(bytes.begin(), bytes.begin() + size);
+		if (Parses(truncated))
+			CHECK(false);
+	}
+	std::string error;
+	CHECK(!Parses(std::vector<uint8_t>(bytes.begin(), bytes.end() - 1), &error));
+	CHECK(error == "corrupt mesh file header");
+	CHECK(!Parses(std::vector<uint8_t>(bytes.begin(), bytes.begin() + 10), &error));
+	CHECK(error == "not a mesh file");
+
+	// A header claiming the short size still has its streams run off the end.
+	std::vector<uint8_t> shortened(bytes.begin(), bytes.begin() + sizeof(MeshFileHeader) + 16);
+	shortened = WithHeader(shortened, [&](MeshFileHeader &h) { h.FileSize = shortened.size(); });
+	CHECK(!Parses(shortened, &error));
+	CHECK(error == "mesh file is truncated");
+}
+
+TEST(CorruptHeadersAreRejected) {
+	std::vector<uint8_t> bytes = Serialize(MakeMesh());
+	std::string error;
+	CHECK(!Parses(WithHeader(bytes, [](MeshFileHeader &h) { h.Magic ^= 1; }), &error));
+	CHECK(error == "not a mesh file");
+	CHECK(!Parses(WithHeader(bytes, [](MeshFileHeader &h) { h.Version = MeshFileVersion - 1; }), &error));
+	CHECK(error == "unsupported mesh file version " + std::to_string(MeshFileVersion - 1));
+	CHECK(IsMeshFile(bytes.data(), bytes.size()));
+
+	std::function<void(MeshFileHeader &)> corruptHeaders[] = {
+		[](MeshFileHeader &h) { h.FileSize += 16; },
+		[](MeshFileHeader &h) { h.IndexByteSize = 3; },
+		[](MeshFileHeader &h) { h.VertexStride += 4; },
+		[](MeshFileHeader &h) { h.Attributes |= MeshAttributeColor; },
+		[](MeshFileHeader &h) { h.Flags |= MeshFilePacked; },
+		[](MeshFileHeader &h) { h.Flags |= 1u << 7; },
+	};
+	for (const auto &corrupt : corruptHeaders) {
+		CHECK(!Parses(WithHeader(bytes, corrupt), &error));
+		CHECK(error == "corrupt mesh file header");
+	}
+
+	// Offsets and counts that point outside the file, including ones chosen
+	// to overflow a naive offset + size check, and misaligned streams.
+	std::function<void(MeshFileHeader &)> outOfRange[] = {
+		[](MeshFileHeader &h) { h.SubsetCount = 1000; },
+		[](MeshFileHeader &h) { h.SubsetOffset = UINT64_MAX - 8; },
+		[](MeshFileHeader &h) { h.SubsetOffset += 2; },
+		[](MeshFileHeader &h) { h.NameByteSize = UINT64_MAX; },
+		[](MeshFileHeader &h) { h.VertexCount = UINT32_MAX; },
+		[](MeshFileHeader &h) { h.VertexOffset = UINT64_MAX - 15; },
+		[](MeshFileHeader &h) { h.VertexOffset += 4; },
+		[](MeshFileHeader &h) { h.IndexCount += 8; },
+		[](MeshFileHeader &h) { h.IndexOffset = h.FileSize; },
+		[](MeshFileHeader &h) { h.IndexOffset += 2; },
+	};
+	for (const auto &corrupt : outOfRange) {
+		CHECK(!Parses(WithHeader(bytes, corrupt), &error));
+		CHECK(error == "mesh file is truncated");
+	}
+}
+
+TEST(CorruptSubsetsAreRejected) {
+	std::vector<uint8_t> bytes = Serialize(MakeMesh());
+	std::string error;
+	std::function<void(MeshFileSubset &)> corruptSubsets[] = {
+		[](MeshFileSubset &s) { s.NameLength += 1; },
+		[](MeshFileSubset &s) { s.NameOffset = UINT32_MAX; },
+		[](MeshFileSubset &s) { s.IndexCount += 1; },
+		[](MeshFileSubset &s) { s.StartIndex = UINT32_MAX; },
+	};
+	for (const auto &corrupt : corruptSubsets) {
+		CHECK(!Parses(WithSubset(bytes, 1, corrupt), &error));
+		CHECK(error == "corrupt mesh subset 1");
+	}
+
+	// Decoding reports the same errors.
+	MeshData mesh;
+	std::vector<uint8_t> corrupt = WithSubset(bytes, 0, corruptSubsets[1]);
+	CHECK(!DecodeMeshFile(corrupt.data(), corrupt.size(), mesh, error));
+	CHECK(error == "corrupt mesh subset 0");
+}
+
+TEST(MisalignedDataIsRejected) {
+	std::vector<uint8_t> bytes = Serialize(MakeMesh());
+	std::vector<uint8_t> shifted(bytes.size() + 1);
+	memcpy(shifted.data() + 1, bytes.data(), bytes.size());
+	MeshFileView view;
+	std::string error;
+	CHECK(!ParseMeshFile(shifted.data() + 1, bytes.size(), view, error));
+	CHECK(error == "mesh data is misaligned");
+}
+
+TEST(RandomCorruptionNeverEscapesTheBuffer) {
+	// Whatever survives parsing must only point inside the bytes.
+	std::vector<uint8_t> bytes = Serialize(MakeMesh());
+	size_t tableEnd = sizeof(MeshFileHeader) + 2 * sizeof(MeshFileSubset);
+	std::mt19937 rng(41);
+	uint32_t accepted = 0;
+	for (int trial = 0; trial < 20000; ++trial) {
+		std::vector<uint8_t> corrupt = bytes;
+		int flips = 1 + rng() % 4;
+		for (int i = 0; i < flips; ++i)
+			corrupt[rng() % tableEnd] ^= uint8_t(1u << (rng() % 8));
+
+		MeshFileView view;
+		std::string error;
+		if (!ParseMeshFile(corrupt.data(), corrupt.size(), view, error)) {
+			CHECK(!error.empty());
+			continue;
+		}
+		++accepted;
+		const uint8_t *begin = corrupt.data(), *end = corrupt.data() + corrupt.size();
+		CHECK(view.Vertices >= begin && view.VertexByteSize() <= uint64_t(end - view.Vertices));
+		CHECK(view.Indices >= begin && view.IndexByteSize() <= uint64_t(end - view.Indices));
+		for (uint32_t s = 0; s < view.Header->SubsetCount; ++s) {
+			std::string_view name = view.SubsetName(s);
+			CHECK(name.data() >= reinterpret_cast<const char *>(begin) &&
+					name.data() + name.size() <= reinterpret_cast<const char *>(end));
+			CHECK(uint64_t(view.Subsets[s].StartIndex) + view.Subsets[s].IndexCount <= view.Header->IndexCount);
+		}
+	}
+	// Flips in the bounds and LOD fields are harmless, so some get through.
+	CHECK(accepted > 0u);
+}
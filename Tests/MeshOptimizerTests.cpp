@@ -0,0 +1,191 @@
+#include "MeshOptimizer.h"
+#include "TestHarness.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <random>
+
+// A triangle by the positions of its corners, rotated so the smallest corner
+// comes first: equal for the same triangle whatever its vertices' indices,
+// and still telling the two windings apart.
+using Triangle = std::array<std::array<float, 3>, 3>;
+
+static Triangle Canonical(Triangle t) {
+	size_t first = std::min_element(t.begin(), t.end()) - t.begin();
+	std::rotate(t.begin(), t.begin() + first, t.end());
+	return t;
+}
+
+// Sorted triangles of each subset.
+static std::vector<std::vector<Triangle>> Triangles(const MeshData &mesh) {
+	std::vector<std::vector<Triangle>> result;
+	for (const MeshSubset &subset : mesh.Subsets) {
+		std::vector<Triangle> triangles;
+		for (uint32_t i = subset.StartIndex; i + 2 < subset.StartIndex + subset.IndexCount; i += 3) {
+			Triangle t;
+			for (uint32_t c = 0; c < 3; ++c) {
+				size_t v = size_t(int64_t(mesh.Index(i + c)) + subset.BaseVertex);
+				memcpy(t[c].data(), mesh.Vertices.data() + v * mesh.VertexStride, sizeof(t[c]));
+			}
+			triangles.push_back(Canonical(t));
+		}
+		std::sort(triangles.begin(), triangles.end());
+		result.push_back(triangles);
+	}
+	return result;
+}
+
+// One n x n vertex grid per subset in the xz plane, at y = subset number,
+// with position and color. Each subset's indices are relative to its own
+// base vertex, and its triangles are in row order or shuffled. A vertex
+// no triangle uses sits between the grids.
+static MeshData MakeGrids(uint32_t n, uint32_t subsets, bool shuffle) {
+	MeshData mesh;
+	mesh.Attributes = MeshAttributePosition | MeshAttributeColor;
+	mesh.VertexStride = MeshVertexStride(mesh.Attributes);
+	std::vector<uint32_t> indices;
+	std::mt19937 rng(3);
+	for (uint32_t s = 0; s < subsets; ++s) {
+		MeshSubset subset;
+		subset.StartIndex = static_cast<uint32_t>(indices.size());
+		subset.BaseVertex = static_cast<int32_t>(mesh.VertexCount);
+		for (uint32_t v = 0; v < n * n + 1; ++v) {
+			float vertex[7] = { float(v % n), float(s), float(v / n), float(v % n) / n, float(v / n) / n, 0.0f, 1.0f };
+			size_t offset = mesh.Vertices.size();
+			mesh.Vertices.resize(offset + mesh.VertexStride);
+			memcpy(mesh.Vertices.data() + offset, vertex, sizeof(vertex));
+			++mesh.VertexCount;
+		}
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (uint32_t y = 0; y + 1 < n; ++y)
+			for (uint32_t x = 0; x + 1 < n; ++x) {
+				uint32_t a = y * n + x, b = a + 1, c = a + n, d = c + 1;
+				triangles.push_back({ a, c, b });
+				triangles.push_back({ b, c, d });
+			}
+		if (shuffle)
+			std::shuffle(triangles.begin(), triangles.end(), rng);
+		for (const std::array<uint32_t, 3> &t : triangles)
+			indices.insert(indices.end(), t.begin(), t.end());
+		subset.IndexCount = static_cast<uint32_t>(indices.size()) - subset.StartIndex;
+		subset.BoundsMax[0] = subset.BoundsMax[2] = float(n - 1);
+		subset.BoundsMin[1] = subset.BoundsMax[1] = float(s);
+		mesh.Subsets.push_back(subset);
+	}
+	mesh.IndexCount = static_cast<uint32_t>(indices.size());
+	mesh.Indices.resize(indices.size() * sizeof(uint32_t));
+	memcpy(mesh.Indices.data(), indices.data(), mesh.Indices.size());
+	return mesh;
+}
+
+static bool IndicesInRange(const MeshData &mesh) {
+	for (const MeshSubset &subset : mesh.Subsets)
+		for (uint32_t i = subset.StartIndex; i < subset.StartIndex + subset.IndexCount; ++i)
+			if (int64_t(mesh.Index(i)) + subset.BaseVertex >= mesh.VertexCount)
+				return false;
+	return true;
+}
+
+TEST(CacheStatsOfKnownIndexBuffers) {
+	// Disjoint triangles transform every vertex; a repeated triangle only once.
+	std::vector<uint32_t> disjoint = { 0, 1, 2, 3, 4, 5 }, repeated = { 0, 1, 2, 0, 1, 2, 2, 1, 0 };
+	VertexCacheStats stats = AnalyzeVertexCache(disjoint.data(), disjoint.size(), 6);
+	CHECK_EQ(stats.Triangles, 2u);
+	CHECK_EQ(stats.VerticesTransformed, 6u);
+	CHECK_NEAR(stats.Acmr, 3.0, 1e-6);
+	CHECK_NEAR(stats.Atvr, 1.0, 1e-6);
+	stats = AnalyzeVertexCache(repeated.data(), repeated.size(), 3);
+	CHECK_EQ(stats.VerticesTransformed, 3u);
+	CHECK_NEAR(stats.Acmr, 1.0, 1e-6);
+
+	// A FIFO cache of 3 evicts the first vertex by the time it comes back.
+	std::vector<uint32_t> fifo = { 0, 1, 2, 3, 4, 5, 0, 4, 5 };
+	CHECK_EQ(AnalyzeVertexCache(fifo.data(), fifo.size(), 6, 3).VerticesTransformed, 7u);
+	CHECK_EQ(AnalyzeVertexCache(fifo.data(), fifo.size(), 6, 16).VerticesTransformed, 6u);
+
+	// Fetching in order reads each vertex once.
+	std::vector<uint32_t> sequential = { 0, 1, 2, 3, 4, 5 };
+	CHECK_NEAR(AnalyzeVertexFetch(sequential.data(), sequential.size(), 6, 64), 1.0, 1e-6);
+}
+
+TEST(OptimizeMeshKeepsEveryTriangle) {
+	MeshData mesh = MakeGrids(20, 3, true);
+	std::vector<std::vector<Triangle>> before = Triangles(mesh);
+	uint32_t indexCount = mesh.IndexCount;
+
+	OptimizeMesh(mesh);
+	CHECK_EQ(mesh.IndexCount, indexCount);
+	CHECK_EQ(mesh.Subsets.size(), 3u);
+	CHECK(Triangles(mesh) == before);
+
+	// Unused vertices are dropped, the rest laid out in first-use order, with
+	// 16-bit indices once they fit.
+	CHECK_EQ(mesh.VertexCount, 3u * 20 * 20);
+	CHECK_EQ(mesh.Vertices.size(), size_t(mesh.VertexCount) * mesh.VertexStride);
+	CHECK_EQ(mesh.IndexByteSize, 2u);
+	CHECK(IndicesInRange(mesh));
+	uint32_t next = 0;
+	bool firstUse = true;
+	for (uint32_t i = 0; i < mesh.IndexCount; ++i) {
+		firstUse = firstUse && mesh.Index(i) <= next;
+		next = std::max(next, mesh.Index(i) + 1);
+	}
+	CHECK(firstUse);
+	for (const MeshSubset &subset : mesh.Subsets)
+		CHECK_EQ(subset.BaseVertex, 0);
+
+	// Without the overdraw pass, and on meshes too large for 16-bit indices.
+	MeshData large = MakeGrids(260, 1, true);
+	before = Triangles(large);
+	MeshOptimizeOptions options;
+	options.Overdraw = false;
+	OptimizeMesh(large, options);
+	CHECK_EQ(large.IndexByteSize, 4u);
+	CHECK(IndicesInRange(large));
+	CHECK(Triangles(large) == before);
+}
+
+TEST(OptimizeMeshDoesNotRaiseAcmrOnAGrid) {
+	// Shuffled triangles transform nearly every corner; optimized ones come
+	// close to the 0.5 of a grid.
+	MeshData shuffled = MakeGrids(32, 1, true);
+	MeshOptimizeStats stats = OptimizeMesh(shuffled);
+	CHECK(stats.Before.Acmr > 2.0f);
+	CHECK(stats.After.Acmr < 0.8f);
+	CHECK(stats.After.Atvr < 1.6f);
+	CHECK(stats.FetchAfter <= stats.FetchBefore);
+
+	// Row order is already good; optimizing, with or without the overdraw
+	// pass, must not make it worse.
+	for (bool overdraw : { false, true }) {
+		MeshOptimizeOptions options;
+		options.Overdraw = overdraw;
+		for (uint32_t n : { 8u, 32u, 100u }) {
+			MeshData rows = MakeGrids(n, 1, false);
+			stats = OptimizeMesh(rows, options);
+			CHECK(stats.After.Acmr <= stats.Before.Acmr);
+			CHECK(stats.After.Acmr < 1.0f);
+		}
+	}
+
+	// Overdraw ordering keeps ACMR within its threshold of the cache-only order.
+	MeshData cacheOnly = MakeGrids(64, 1, true), withOverdraw = cacheOnly;
+	MeshOptimizeOptions noOverdraw;
+	noOverdraw.Overdraw = false;
+	float cacheAcmr = OptimizeMesh(cacheOnly, noOverdraw).After.Acmr;
+	float overdrawAcmr = OptimizeMesh(withOverdraw).After.Acmr;
+	CHECK(overdrawAcmr <= cacheAcmr * 1.05f + 1e-4f);
+}
+
+TEST(FetchRemapNumbersVerticesInFirstUseOrder) {
+	std::vector<uint32_t> indices = { 5, 2, 7, 7, 2, 0 };
+	std::vector<uint32_t> remap(9);
+	CHECK_EQ(OptimizeVertexFetchRemap(remap.data(), indices.data(), indices.size(), 9), 4u);
+	CHECK(indices == std::vector<uint32_t>({ 0, 1, 2, 2, 1, 3 }));
+	CHECK_EQ(remap[5], 0u);
+	CHECK_EQ(remap[2], 1u);
+	CHECK_EQ(remap[7], 2u);
+	CHECK_EQ(remap[0], 3u);
+	CHECK_EQ(remap[1], UINT32_MAX);
+	CHECK_EQ(remap[8], UINT32_MAX);
+}
@@ -0,0 +1,304 @@
+#include "MeshSimplifier.h"
+#include "TestHarness.h"
+#include <algorithm>
+#include <cstring>
+
+struct Point {
+	float X, Y, Z;
+};
+
+static Point Sub(Point a, Point b) { return { a.X - b.X, a.Y - b.Y, a.Z - b.Z }; }
+static float Dot(Point a, Point b) { return a.X * b.X + a.Y * b.Y + a.Z * b.Z; }
+static Point Lerp(Point a, Point d, float t) { return { a.X + d.X * t, a.Y + d.Y * t, a.Z + d.Z * t }; }
+static float Length(Point a) { return sqrtf(Dot(a, a)); }
+
+// Distance from p to triangle abc (closest point by Voronoi region).
+static float PointTriangleDistance(Point p, Point a, Point b, Point c) {
+	Point ab = Sub(b, a), ac = Sub(c, a), ap = Sub(p, a);
+	float d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f)
+		return Length(ap);
+	Point bp = Sub(p, b);
+	float d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3)
+		return Length(bp);
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		return Length(Sub(p, Lerp(a, ab, d1 / (d1 - d3))));
+	Point cp = Sub(p, c);
+	float d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6)
+		return Length(cp);
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		return Length(Sub(p, Lerp(a, ac, d2 / (d2 - d6))));
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+		return Length(Sub(p, Lerp(b, Sub(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+	float denom = 1.0f / (va + vb + vc);
+	return Length(Sub(p, Lerp(Lerp(a, ab, vb * denom), ac, vc * denom)));
+}
+
+// Unit UV sphere with single pole vertices: closed and manifold, so nothing
+// is locked and every collapse costs curvature.
+static void MakeSphere(uint32_t segments, uint32_t rings, std::vector<Point> &points, std::vector<uint32_t> &indices) {
+	const float pi = 3.14159265f;
+	points.push_back({ 0.0f, 1.0f, 0.0f });
+	for (uint32_t r = 1; r < rings; ++r) {
+		float phi = pi * r / rings;
+		for (uint32_t s = 0; s < segments; ++s) {
+			float theta = 2.0f * pi * s / segments;
+			points.push_back({ sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta) });
+		}
+	}
+	points.push_back({ 0.0f, -1.0f, 0.0f });
+	uint32_t south = static_cast<uint32_t>(points.size() - 1);
+	auto at = [&](uint32_t r, uint32_t s) { return 1 + (r - 1) * segments + s % segments; };
+	for (uint32_t s = 0; s < segments; ++s)
+		indices.insert(indices.end(), { 0u, at(1, s + 1), at(1, s) });
+	for (uint32_t r = 1; r + 1 < rings; ++r)
+		for (uint32_t s = 0; s < segments; ++s) {
+			uint32_t a = at(r, s), b = at(r, s + 1), c = at(r + 1, s), d = at(r + 1, s + 1);
+			indices.insert(indices.end(), { a, b, c, b, d, c });
+		}
+	for (uint32_t s = 0; s < segments; ++s)
+		indices.insert(indices.end(), { at(rings - 1, s), at(rings - 1, s + 1), south });
+}
+
+// A flat n x n vertex grid in the xz plane: open borders, all coplanar.
+static void MakeGrid(uint32_t n, std::vector<Point> &points, std::vector<uint32_t> &indices) {
+	for (uint32_t y = 0; y < n; ++y)
+		for (uint32_t x = 0; x < n; ++x)
+			points.push_back({ float(x), 0.0f, float(y) });
+	for (uint32_t y = 0; y + 1 < n; ++y)
+		for (uint32_t x = 0; x + 1 < n; ++x) {
+			uint32_t a = y * n + x, b = a + 1, c = a + n, d = c + 1;
+			indices.insert(indices.end(), { a, c, b, b, c, d });
+		}
+}
+
+static size_t Simplify(const std::vector<Point> &points, const std::vector<uint32_t> &indices, size_t targetTriangles,
+		float targetError, std::vector<uint32_t> &result, float &error) {
+	result.resize(indices.size());
+	size_t count = SimplifyMesh(result.data(), indices.data(), indices.size(), &points[0].X, sizeof(Point),
+			points.size(), targetTriangles * 3, targetError, &error);
+	result.resize(count);
+	return count / 3;
+}
+
+// Every index in range and no triangle repeating a vertex.
+static bool IsValid(const std::vector<uint32_t> &indices, size_t vertexCount) {
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+		if (a >= vertexCount || b >= vertexCount || c >= vertexCount || a == b || b == c || a == c)
+			return false;
+	}
+	return true;
+}
+
+// Furthest any original vertex is from the simplified surface.
+static float SurfaceDeviation(const std::vector<Point> &points, const std::vector<uint32_t> &simplified) {
+	float worst = 0.0f;
+	for (const Point &p : points) {
+		float nearest = INFINITY;
+		for (size_t i = 0; i < simplified.size(); i += 3)
+			nearest = std::min(nearest, PointTriangleDistance(p, points[simplified[i]], points[simplified[i + 1]],
+					points[simplified[i + 2]]));
+		worst = std::max(worst, nearest);
+	}
+	return worst;
+}
+
+TEST(SimplifyReachesTargetWithinErrorLimit) {
+	std::vector<Point> points;
+	std::vector<uint32_t> indices, result;
+	MakeSphere(64, 32, points, indices);
+	size_t triangles = indices.size() / 3;
+
+	// A generous limit: the triangle target decides.
+	for (size_t target : { triangles / 2, triangles / 4, triangles / 10 }) {
+		float error = -1.0f;
+		size_t count = Simplify(points, indices, target, 1.0f, result, error);
+		CHECK(count <= target);
+		CHECK(count > target * 9 / 10);
+		CHECK(IsValid(result, points.size()));
+		CHECK(error > 0.0f);
+		// The quadric error is measured at the kept vertices; the surface
+		// between them strays a little further on a sphere.
+		CHECK(SurfaceDeviation(points, result) <= 3.0f * error);
+	}
+
+	// A tight limit stops short of the target, and is never exceeded.
+	float looseError = 0.0f, tightError = 0.0f;
+	size_t loose = Simplify(points, indices, triangles / 10, 0.05f, result, looseError);
+	size_t tight = Simplify(points, indices, triangles / 10, 0.01f, result, tightError);
+	CHECK(looseError <= 0.05f);
+	CHECK(tightError <= 0.01f);
+	CHECK(tight > loose);
+	CHECK(tight > triangles / 10);
+	CHECK(tight < triangles / 2);
+	CHECK(SurfaceDeviation(points, result) <= 3.0f * tightError);
+
+	// Every edge on a sphere bends the surface, so no error means no change.
+	float none = -1.0f;
+	CHECK_EQ(Simplify(points, indices, 0, 0.0f, result, none), triangles);
+	CHECK_EQ(none, 0.0f);
+	CHECK(result == indices);
+}
+
+TEST(SimplifyCollapsesFlatRegionsForFree) {
+	// Coplanar interiors and straight borders cost nothing, so a flat grid
+	// goes down to two triangles that still cover the whole square.
+	std::vector<Point> points;
+	std::vector<uint32_t> indices, result;
+	MakeGrid(33, points, indices);
+	float error = -1.0f;
+	CHECK_EQ(Simplify(points, indices, 0, 0.0f, result, error), 2u);
+	CHECK_EQ(error, 0.0f);
+	CHECK(IsValid(result, points.size()));
+	CHECK_NEAR(SurfaceDeviation(points, result), 0.0, 1e-4);
+
+	// The corners are the only vertices a straight border cannot lose.
+	std::vector<uint32_t> corners(result);
+	std::sort(corners.begin(), corners.end());
+	corners.erase(std::unique(corners.begin(), corners.end()), corners.end());
+	CHECK(corners == std::vector<uint32_t>({ 0u, 32u, 33u * 32u, 33u * 33u - 1u }));
+}
+
+// The sphere as a MeshData with positions and normals (the normal equals the
+// position) and one named subset, offset in the vertex buffer.
+static MeshData SphereMesh(uint32_t segments, uint32_t rings, uint32_t indexByteSize) {
+	std::vector<Point> points;
+	std::vector<uint32_t> indices;
+	MakeSphere(segments, rings, points, indices);
+
+	const uint32_t leading = 5;
+	MeshData mesh;
+	mesh.Attributes = MeshAttributePosition | MeshAttributeNormal;
+	mesh.VertexStride = MeshVertexStride(mesh.Attributes);
+	mesh.VertexCount = static_cast<uint32_t>(points.size()) + leading;
+	mesh.Vertices.resize(size_t(mesh.VertexCount) * mesh.VertexStride);
+	for (size_t v = 0; v < points.size(); ++v) {
+		uint8_t *vertex = mesh.Vertices.data() + (v + leading) * mesh.VertexStride;
+		memcpy(vertex, &points[v], sizeof(Point));
+		memcpy(vertex + sizeof(Point), &points[v], sizeof(Point));
+	}
+	mesh.IndexByteSize = indexByteSize;
+	mesh.IndexCount = static_cast<uint32_t>(indices.size());
+	mesh.Indices.resize(indices.size() * indexByteSize);
+	for (size_t i = 0; i < indices.size(); ++i) {
+		if (indexByteSize == 2) {
+			uint16_t index = static_cast<uint16_t>(indices[i]);
+			memcpy(mesh.Indices.data() + i * 2, &index, 2);
+		} else {
+			memcpy(mesh.Indices.data() + i * 4, &indices[i], 4);
+		}
+	}
+	MeshSubset subset;
+	subset.Name = "sphere";
+	subset.IndexCount = mesh.IndexCount;
+	subset.BaseVertex = leading;
+	for (int c = 0; c < 3; ++c)
+		subset.BoundsMin[c] = -1.0f, subset.BoundsMax[c] = 1.0f;
+	mesh.Subsets.push_back(subset);
+	return mesh;
+}
+
+TEST(LodChainHalvesTrianglesWithGrowingError) {
+	for (uint32_t indexByteSize : { 2u, 4u }) {
+		MeshData mesh = SphereMesh(64, 32, indexByteSize);
+		const uint32_t fullTriangles = mesh.IndexCount / 3;
+		BuildLodChain(mesh);
+
+		LodChainDesc desc;
+		const float maxError = sqrtf(12.0f) * desc.MaxRelativeError;
+		CHECK(mesh.Subsets.size() >= 4u);
+		CHECK(mesh.Subsets.size() <= 1u + desc.MaxLevels);
+		CHECK_EQ(mesh.Subsets[0].LodLevel, 0u);
+		CHECK_EQ(mesh.Subsets[0].IndexCount / 3, fullTriangles);
+		CHECK_EQ(mesh.IndexByteSize, indexByteSize);
+		CHECK_EQ(mesh.Indices.size(), size_t(mesh.IndexCount) * indexByteSize);
+
+		for (size_t level = 1; level < mesh.Subsets.size(); ++level) {
+			const MeshSubset &lod = mesh.Subsets[level], &previous = mesh.Subsets[level - 1];
+			CHECK(lod.Name == "sphere_lod" + std::to_string(level));
+			CHECK_EQ(lod.LodLevel, level);
+			CHECK_EQ(lod.BaseVertex, 5);
+			CHECK(lod.IndexCount / 3 >= desc.MinTriangles);
+			CHECK(lod.IndexCount / 3 <= previous.IndexCount / 3 * 9 / 10);
+			CHECK(lod.IndexCount / 3 >= previous.IndexCount / 3 / 4);
+			CHECK(lod.LodError >= previous.LodError);
+			CHECK(lod.LodError <= maxError);
+			CHECK_NEAR(lod.BoundsMax[1], 1.0, 0.0);
+
+			// The level draws sphere vertices only, relative to BaseVertex.
+			bool inRange = true;
+			for (uint32_t i = lod.StartIndex; i < lod.StartIndex + lod.IndexCount; ++i)
+				inRange &= mesh.Index(i) < mesh.VertexCount - lod.BaseVertex;
+			CHECK(inRange);
+		}
+		CHECK(mesh.Subsets.back().LodError > 0.0f);
+
+		// A mesh that already has a chain keeps it.
+		MeshData again = mesh;
+		BuildLodChain(again);
+		CHECK_EQ(again.Subsets.size(), mesh.Subsets.size());
+		CHECK(again.Indices == mesh.Indices);
+	}
+}
+
+TEST(LodChainSkipsSmallAndUnreducibleMeshes) {
+	// 8 x 4 segments: 64 triangles, and halving would go below MinTriangles.
+	MeshData small = SphereMesh(8, 5, 4);
+	CHECK_EQ(small.IndexCount / 3, 64u);
+	BuildLodChain(small);
+	CHECK_EQ(small.Subsets.size(), 1u);
+
+	// A tight error limit allows no level that removes a tenth of the
+	// triangles.
+	MeshData tight = SphereMesh(64, 32, 4);
+	LodChainDesc desc;
+	desc.MaxRelativeError = 1e-6f;
+	BuildLodChain(tight, desc);
+	CHECK_EQ(tight.Subsets.size(), 1u);
+	CHECK_EQ(tight.IndexCount, tight.Subsets[0].IndexCount);
+}
+
+TEST(SelectLodCoarsensMonotonicallyWithDistance) {
+	MeshData mesh = SphereMesh(64, 32, 4);
+	BuildLodChain(mesh);
+	std::vector<float> errors;
+	for (const MeshSubset &subset : mesh.Subsets)
+		errors.push_back(subset.LodError);
+	const uint32_t levels = static_cast<uint32_t>(errors.size());
+	// 1080 pixels high at a 60 degree field of view.
+	const float projectionScale = 1080.0f / (2.0f * tanf(3.14159265f / 6.0f));
+
+	uint32_t previous = 0;
+	bool reachedCoarsest = false;
+	for (float distance = 0.5f; distance < 20000.0f; distance *= 1.1f) {
+		uint32_t level = SelectLod(errors.data(), levels, distance, 1.0f, projectionScale);
+		CHECK(level >= previous);
+		CHECK(level < levels);
+		// The pick stays under a pixel and the next level would not.
+		CHECK(errors[level] * projectionScale / distance <= 1.0f);
+		if (level + 1 < levels)
+			CHECK(errors[level + 1] * projectionScale / distance > 1.0f);
+		reachedCoarsest |= level == levels - 1;
+		previous = level;
+	}
+	CHECK(reachedCoarsest);
+	CHECK(previous == levels - 1);
+
+	// Up close, and inside the bounds, it is full detail; doubling the world
+	// scale is the same as halving the distance.
+	CHECK_EQ(SelectLod(errors.data(), levels, 0.5f, 1.0f, projectionScale), 0u);
+	CHECK_EQ(SelectLod(errors.data(), levels, -1.0f, 1.0f, projectionScale), 0u);
+	for (float distance : { 50.0f, 200.0f, 800.0f, 3200.0f })
+		CHECK_EQ(SelectLod(errors.data(), levels, distance, 2.0f, projectionScale),
+				SelectLod(errors.data(), levels, distance * 0.5f, 1.0f, projectionScale));
+	// A larger pixel threshold never picks a finer level.
+	for (float distance : { 50.0f, 200.0f, 800.0f })
+		CHECK(SelectLod(errors.data(), levels, distance, 1.0f, projectionScale, 4.0f) >=
+				SelectLod(errors.data(), levels, distance, 1.0f, projectionScale));
+}
@@ -0,0 +1,320 @@
+#include "MeshFile.h"
+#include "MeshStreamer.h"
+#include "TestHarness.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+// A position-only triangle list; seed makes the vertices of one mesh differ
+// from another's.
+static MeshData MakeMesh(uint32_t triangles, float seed) {
+	MeshData mesh;
+	mesh.Attributes = MeshAttributePosition;
+	mesh.VertexStride = MeshVertexStride(mesh.Attributes);
+	mesh.VertexCount = triangles * 3;
+	mesh.IndexByteSize = 4;
+	mesh.IndexCount = triangles * 3;
+	mesh.Vertices.resize(size_t(mesh.VertexCount) * mesh.VertexStride);
+	mesh.Indices.resize(size_t(mesh.IndexCount) * mesh.IndexByteSize);
+	for (uint32_t v = 0; v < mesh.VertexCount; ++v) {
+		float p[3] = { seed + float(v), float(v % 3), 0.0f };
+		memcpy(mesh.Vertices.data() + size_t(v) * mesh.VertexStride, p, sizeof(p));
+		memcpy(mesh.Indices.data() + size_t(v) * 4, &v, 4);
+	}
+	MeshSubset subset;
+	subset.Name = "part";
+	subset.IndexCount = mesh.IndexCount;
+	subset.BoundsMin[0] = seed;
+	subset.BoundsMax[0] = seed + float(mesh.VertexCount - 1);
+	subset.BoundsMax[1] = 2.0f;
+	mesh.Subsets.push_back(subset);
+	return mesh;
+}
+
+// A scratch directory of mesh files.
+struct MeshTree {
+	fs::path Dir;
+
+	explicit MeshTree(const char *name) {
+		Dir = fs::temp_directory_path() / name;
+		fs::remove_all(Dir);
+		fs::create_directories(Dir);
+	}
+	~MeshTree() { fs::remove_all(Dir); }
+
+	std::string Write(const char *file, const MeshData &mesh) const {
+		std::string path = (Dir / file).string();
+		std::string error;
+		CHECK(WriteMeshFile(path, mesh, error));
+		return path;
+	}
+	std::string Path(const char *file) const { return (Dir / file).string(); }
+};
+
+// Polls until every request has come back, or gives up after a few seconds.
+static void PollAll(MeshStreamer &streamer, std::vector<StreamedMesh> &loaded, uint64_t maxBytes = UINT64_MAX) {
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (streamer.LoadsInFlight() != 0 && std::chrono::steady_clock::now() < deadline) {
+		if (streamer.Poll(loaded, maxBytes) == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	CHECK_EQ(streamer.LoadsInFlight(), 0u);
+}
+
+// Loads the paths one after another, so they enter the LRU list in order.
+static std::vector<MeshHandle> LoadInOrder(MeshStreamer &streamer, const std::vector<std::string> &paths) {
+	std::vector<MeshHandle> handles;
+	std::vector<StreamedMesh> loaded;
+	for (const std::string &path : paths) {
+		handles.push_back(streamer.Request(path));
+		PollAll(streamer, loaded);
+	}
+	return handles;
+}
+
+TEST(LoadsFilesAndReportsMissingOnes) {
+	MeshTree tree("photon_meshstreamer_load");
+	MeshData a = MakeMesh(10, 0.0f), b = MakeMesh(20, 100.0f);
+	std::string pathA = tree.Write("a.mesh", a), pathB = tree.Write("b.mesh", b);
+
+	MeshStreamer streamer(DecodeMeshFile, nullptr);
+	MeshHandle ha = streamer.Request(pathA);
+	MeshHandle hb = streamer.Request(pathB);
+	MeshHandle missing = streamer.Request(tree.Path("missing.mesh"));
+	CHECK_EQ(streamer.Request(pathA), ha);
+	CHECK_EQ(streamer.LoadsInFlight(), 3u);
+
+	std::vector<StreamedMesh> loaded;
+	PollAll(streamer, loaded);
+	CHECK_EQ(loaded.size(), 3u);
+	for (const StreamedMesh &mesh : loaded) {
+		if (mesh.Handle == missing) {
+			CHECK(mesh.Data == nullptr);
+			CHECK(mesh.Error.find("cannot read") != std::string::npos);
+			continue;
+		}
+		const MeshData &expected = mesh.Handle == ha ? a : b;
+		CHECK(mesh.Data != nullptr);
+		CHECK_EQ(mesh.Data->VertexCount, expected.VertexCount);
+		CHECK(mesh.Data->Vertices == expected.Vertices);
+		CHECK(mesh.Data->Indices == expected.Indices);
+	}
+	CHECK(streamer.Residency(ha) == MeshResidency::Resident);
+	CHECK(streamer.Residency(hb) == MeshResidency::Resident);
+	CHECK(streamer.Residency(missing) == MeshResidency::Failed);
+	CHECK_EQ(streamer.ResidentBytes(), a.ByteSize() + b.ByteSize());
+
+	MeshStreamerStats stats = streamer.Stats();
+	CHECK_EQ(stats.Requested, 3u);
+	CHECK_EQ(stats.Loaded, 2u);
+	CHECK_EQ(stats.Failed, 1u);
+	CHECK_EQ(stats.BytesRead, fs::file_size(pathA) + fs::file_size(pathB));
+}
+
+TEST(MapsFilesWithoutADecoder) {
+	MeshTree tree("photon_meshstreamer_map");
+	MeshData plain = MakeMesh(10, 0.0f);
+	PackedMesh packed;
+	PackMesh(MakeMesh(20, 100.0f), packed);
+	std::string pathPlain = tree.Write("plain.mesh", plain);
+	std::string pathPacked = tree.Path("packed.mesh");
+	std::string error;
+	CHECK(WriteMeshFile(pathPacked, packed, error));
+	std::ofstream(tree.Path("garbage.mesh"), std::ios::binary) << "not a mesh";
+
+	MeshStreamer streamer(nullptr, nullptr);
+	MeshHandle hp = streamer.Request(pathPlain);
+	MeshHandle hq = streamer.Request(pathPacked);
+	MeshHandle garbage = streamer.Request(tree.Path("garbage.mesh"));
+	MeshHandle missing = streamer.Request(tree.Path("missing.mesh"));
+
+	std::vector<StreamedMesh> loaded;
+	PollAll(streamer, loaded);
+	CHECK_EQ(loaded.size(), 4u);
+	for (const StreamedMesh &mesh : loaded) {
+		CHECK(mesh.Data == nullptr);
+		if (mesh.Handle == garbage || mesh.Handle == missing) {
+			CHECK(!mesh.IsLoaded());
+			CHECK(mesh.Error == (mesh.Handle == garbage ? "not a mesh file" : "cannot read " + tree.Path("missing.mesh")));
+			continue;
+		}
+		// The streams are the file's own bytes, in the mapping.
+		CHECK(mesh.IsLoaded());
+		const uint8_t *begin = mesh.File->Data(), *end = begin + mesh.File->Size();
+		CHECK(mesh.View.Vertices >= begin && mesh.View.Vertices + mesh.View.VertexByteSize() <= end);
+		if (mesh.Handle == hp) {
+			CHECK(!mesh.View.IsPacked());
+			CHECK(memcmp(mesh.View.Vertices, plain.Vertices.data(), plain.Vertices.size()) == 0);
+			CHECK_EQ(mesh.ByteSize(), plain.ByteSize());
+		} else {
+			CHECK(mesh.View.IsPacked());
+			CHECK(memcmp(mesh.View.Vertices, packed.Vertices.data(), packed.Vertices.size()) == 0);
+			CHECK(memcmp(mesh.View.Indices, packed.Indices.data(), packed.Indices.size()) == 0);
+			CHECK_EQ(mesh.ByteSize(), packed.ByteSize());
+		}
+	}
+	CHECK(streamer.Residency(hp) == MeshResidency::Resident);
+	CHECK(streamer.Residency(hq) == MeshResidency::Resident);
+	CHECK(streamer.Residency(garbage) == MeshResidency::Failed);
+	CHECK(streamer.Residency(missing) == MeshResidency::Failed);
+	CHECK_EQ(streamer.ResidentBytes(), plain.ByteSize() + packed.ByteSize());
+	CHECK_EQ(streamer.Stats().BytesRead, fs::file_size(pathPlain) + fs::file_size(pathPacked));
+	CHECK_NEAR(streamer.Stats().DecodeSeconds, 0.0, 0.0);
+}
+
+TEST(EvictsLeastRecentlyUsedDownToBudget) {
+	MeshTree tree("photon_meshstreamer_budget");
+	MeshData mesh = MakeMesh(100, 0.0f);
+	std::vector<std::string> paths = { tree.Write("a.mesh", mesh), tree.Write("b.mesh", mesh),
+		tree.Write("c.mesh", mesh), tree.Write("d.mesh", mesh) };
+
+	MeshStreamerDesc desc;
+	desc.BudgetBytes = 2 * mesh.ByteSize();
+	MeshStreamer streamer(DecodeMeshFile, nullptr, desc);
+	std::vector<MeshHandle> h = LoadInOrder(streamer, paths);
+	CHECK_EQ(streamer.ResidentBytes(), 4 * mesh.ByteSize());
+
+	// Meshes polled this frame count as used.
+	std::vector<MeshHandle> evicted;
+	streamer.Evict(evicted);
+	CHECK(evicted.empty());
+
+	// a was loaded first but is used again, so b and c are the oldest.
+	streamer.Touch(h[0]);
+	streamer.Evict(evicted);
+	CHECK(evicted == std::vector<MeshHandle>({ h[1], h[2] }));
+	CHECK(streamer.Residency(h[1]) == MeshResidency::Unloaded);
+	CHECK(streamer.Residency(h[2]) == MeshResidency::Unloaded);
+	CHECK(streamer.Residency(h[0]) == MeshResidency::Resident);
+	CHECK(streamer.Residency(h[3]) == MeshResidency::Resident);
+	CHECK_EQ(streamer.ResidentBytes(), desc.BudgetBytes);
+	CHECK_EQ(streamer.Stats().Evicted, 2u);
+
+	// Within budget nothing more goes, used or not.
+	evicted.clear();
+	streamer.Evict(evicted);
+	CHECK(evicted.empty());
+
+	// A smaller budget takes the least recently touched first.
+	streamer.SetBudgetBytes(mesh.ByteSize());
+	streamer.Touch(h[3]);
+	streamer.Evict(evicted);
+	streamer.Evict(evicted);
+	CHECK(evicted == std::vector<MeshHandle>({ h[0] }));
+}
+
+TEST(TouchedMeshesAreNeverEvicted) {
+	MeshTree tree("photon_meshstreamer_touch");
+	MeshData mesh = MakeMesh(50, 0.0f);
+	std::vector<std::string> paths = { tree.Write("a.mesh", mesh), tree.Write("b.mesh", mesh),
+		tree.Write("c.mesh", mesh) };
+
+	MeshStreamerDesc desc;
+	desc.BudgetBytes = 0;
+	MeshStreamer streamer(DecodeMeshFile, nullptr, desc);
+	std::vector<MeshHandle> h = LoadInOrder(streamer, paths);
+
+	// Over budget, but everything is in use.
+	std::vector<MeshHandle> evicted;
+	streamer.Evict(evicted);
+	for (MeshHandle handle : h)
+		streamer.Touch(handle);
+	streamer.Evict(evicted);
+	CHECK(evicted.empty());
+	CHECK_EQ(streamer.ResidentBytes(), 3 * mesh.ByteSize());
+
+	// Only c stays in use.
+	streamer.Touch(h[2]);
+	streamer.Evict(evicted);
+	CHECK_EQ(evicted.size(), 2u);
+	CHECK(streamer.Residency(h[2]) == MeshResidency::Resident);
+	CHECK_EQ(streamer.ResidentBytes(), mesh.ByteSize());
+
+	// Touching an evicted mesh does not bring it back.
+	streamer.Touch(h[0]);
+	CHECK(streamer.Residency(h[0]) == MeshResidency::Unloaded);
+}
+
+TEST(RequestAgainReloadsEvictedMeshFromDisk) {
+	MeshTree tree("photon_meshstreamer_reload");
+	MeshData before = MakeMesh(30, 0.0f);
+	std::string path = tree.Write("a.mesh", before);
+	std::string other = tree.Write("b.mesh", MakeMesh(30, 50.0f));
+
+	MeshStreamerDesc desc;
+	desc.BudgetBytes = before.ByteSize();
+	MeshStreamer streamer(DecodeMeshFile, nullptr, desc);
+	std::vector<MeshHandle> h = LoadInOrder(streamer, { path, other });
+	std::vector<MeshHandle> evicted;
+	streamer.Evict(evicted);
+	streamer.Touch(h[1]);
+	streamer.Evict(evicted);
+	CHECK(evicted == std::vector<MeshHandle>({ h[0] }));
+
+	// The file changed while the mesh was out; the reload reads it again.
+	MeshData after = MakeMesh(40, 7.0f);
+	tree.Write("a.mesh", after);
+	CHECK_EQ(streamer.Request(path), h[0]);
+	CHECK(streamer.Residency(h[0]) == MeshResidency::Loading);
+
+	std::vector<StreamedMesh> loaded;
+	PollAll(streamer, loaded);
+	CHECK_EQ(loaded.size(), 1u);
+	CHECK_EQ(loaded[0].Handle, h[0]);
+	CHECK(loaded[0].Data != nullptr && loaded[0].Data->Vertices == after.Vertices);
+	CHECK(streamer.Residency(h[0]) == MeshResidency::Resident);
+	CHECK_EQ(streamer.ResidentBytes(), before.ByteSize() + after.ByteSize());
+	CHECK_EQ(streamer.Stats().Loaded, 3u);
+
+	// Requesting a resident mesh does not reload it.
+	CHECK_EQ(streamer.Request(path), h[0]);
+	CHECK_EQ(streamer.LoadsInFlight(), 0u);
+}
+
+TEST(FailedMeshCanBeRequestedOnceTheFileExists) {
+	MeshTree tree("photon_meshstreamer_failed");
+	std::string path = tree.Path("late.mesh");
+	MeshStreamer streamer(DecodeMeshFile, nullptr);
+	MeshHandle handle = LoadInOrder(streamer, { path })[0];
+	CHECK(streamer.Residency(handle) == MeshResidency::Failed);
+
+	// A file that is not a mesh fails to decode.
+	fs::path bogus = tree.Dir / "bogus.mesh";
+	std::ofstream(bogus, std::ios::binary) << "not a mesh";
+	MeshHandle bogusHandle = LoadInOrder(streamer, { bogus.string() })[0];
+	CHECK(streamer.Residency(bogusHandle) == MeshResidency::Failed);
+
+	MeshData mesh = MakeMesh(5, 0.0f);
+	tree.Write("late.mesh", mesh);
+	CHECK_EQ(LoadInOrder(streamer, { path })[0], handle);
+	CHECK(streamer.Residency(handle) == MeshResidency::Resident);
+	CHECK_EQ(streamer.ResidentBytes(), mesh.ByteSize());
+	CHECK_EQ(streamer.Stats().Failed, 2u);
+}
+
+TEST(PollStopsAtMaxBytes) {
+	MeshTree tree("photon_meshstreamer_poll");
+	MeshData mesh = MakeMesh(20, 0.0f);
+	MeshStreamer streamer(DecodeMeshFile, nullptr);
+	for (const char *file : { "a.mesh", "b.mesh", "c.mesh", "d.mesh" })
+		streamer.Request(tree.Write(file, mesh));
+
+	// Each call takes one mesh: the first always goes, and it alone is over
+	// the cap.
+	std::vector<StreamedMesh> loaded;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (loaded.size() < 4 && std::chrono::steady_clock::now() < deadline) {
+		size_t before = loaded.size();
+		uint32_t polled = streamer.Poll(loaded, mesh.ByteSize() / 2);
+		CHECK(polled <= 1u);
+		CHECK_EQ(loaded.size() - before, size_t(polled));
+		if (polled == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	CHECK_EQ(loaded.size(), 4u);
+	CHECK_EQ(streamer.ResidentBytes(), 4 * mesh.ByteSize());
+}
@@ -0,0 +1,275 @@
+#include "Meshlets.h"
+#include "MeshOptimizer.h"
+#include "TestHarness.h"
+#include <algorithm>
+#include <array>
+#include <random>
+
+struct Point {
+	float X, Y, Z;
+};
+
+static Point Sub(Point a, Point b) { return { a.X - b.X, a.Y - b.Y, a.Z - b.Z }; }
+static float Dot(Point a, Point b) { return a.X * b.X + a.Y * b.Y + a.Z * b.Z; }
+static Point Cross(Point a, Point b) { return { a.Y * b.Z - a.Z * b.Y, a.Z * b.X - a.X * b.Z, a.X * b.Y - a.Y * b.X }; }
+static Point Normalize(Point a) {
+	float length = sqrtf(Dot(a, a));
+	return { a.X / length, a.Y / length, a.Z / length };
+}
+
+// A UV sphere with bumps, so meshlets on it face many ways and some have
+// normal cones too wide to cull. Clockwise seen from outside: front-facing
+// from outside in D3D12's default rasterizer state.
+static void MakeBumpySphere(uint32_t segments, uint32_t rings, std::vector<Point> &points,
+		std::vector<uint32_t> &indices) {
+	const float pi = 3.14159265f;
+	for (uint32_t r = 0; r <= rings; ++r) {
+		for (uint32_t s = 0; s <= segments; ++s) {
+			float phi = pi * r / rings, theta = 2.0f * pi * s / segments;
+			float radius = 1.0f + 0.15f * sinf(5.0f * phi) * sinf(4.0f * theta);
+			points.push_back(
+					{ radius * sinf(phi) * cosf(theta), radius * cosf(phi), radius * sinf(phi) * sinf(theta) });
+		}
+	}
+	for (uint32_t r = 0; r < rings; ++r)
+		for (uint32_t s = 0; s < segments; ++s) {
+			uint32_t a = r * (segments + 1) + s, b = a + 1, c = a + segments + 1, d = c + 1;
+			// The pole rows have one degenerate triangle per quad.
+			indices.insert(indices.end(), { a, b, c, b, d, c });
+		}
+}
+
+static std::vector<uint32_t> CacheOptimized(const std::vector<uint32_t> &indices, size_t vertexCount) {
+	std::vector<uint32_t> optimized(indices.size());
+	OptimizeVertexCache(optimized.data(), indices.data(), indices.size(), vertexCount);
+	return optimized;
+}
+
+static std::vector<std::array<uint32_t, 3>> SortedTriangles(const uint32_t *indices, size_t count) {
+	std::vector<std::array<uint32_t, 3>> triangles;
+	for (size_t i = 0; i + 2 < count; i += 3)
+		triangles.push_back({ indices[i], indices[i + 1], indices[i + 2] });
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+// Camera at eye looking at target: D3D left-handed view and a 60 degree
+// perspective projection with near 0.1 and far 20, as row vectors.
+static Frustum LookAt(Point eye, Point target) {
+	Point z = Normalize(Sub(target, eye));
+	Point up = fabsf(z.Y) > 0.99f ? Point{ 1.0f, 0.0f, 0.0f } : Point{ 0.0f, 1.0f, 0.0f };
+	Point x = Normalize(Cross(up, z));
+	Point y = Cross(z, x);
+	Float4x4 view;
+	Point axes[3] = { x, y, z };
+	for (int c = 0; c < 3; ++c) {
+		view.m[0][c] = axes[c].X;
+		view.m[1][c] = axes[c].Y;
+		view.m[2][c] = axes[c].Z;
+		view.m[3][c] = -Dot(axes[c], eye);
+	}
+
+	const float n = 0.1f, f = 20.0f, scale = 1.0f / tanf(0.5236f);
+	Float4x4 proj;
+	proj.m[0][0] = scale;
+	proj.m[1][1] = scale;
+	proj.m[2][2] = f / (f - n);
+	proj.m[2][3] = 1.0f;
+	proj.m[3][2] = -n * f / (f - n);
+	proj.m[3][3] = 0.0f;
+
+	Float4x4 viewProj;
+	for (int r = 0; r < 4; ++r)
+		for (int c = 0; c < 4; ++c) {
+			viewProj.m[r][c] = 0.0f;
+			for (int k = 0; k < 4; ++k)
+				viewProj.m[r][c] += view.m[r][k] * proj.m[k][c];
+		}
+	return Frustum::FromViewProj(viewProj);
+}
+
+static bool Inside(const Frustum &frustum, Point p) {
+	for (const Float4 &plane : frustum.Planes)
+		if (plane.x * p.X + plane.y * p.Y + plane.z * p.Z + plane.w < 0.0f)
+			return false;
+	return true;
+}
+
+TEST(MeshletsRespectTheirLimits) {
+	std::vector<Point> points;
+	std::vector<uint32_t> indices;
+	MakeBumpySphere(64, 32, points, indices);
+	indices = CacheOptimized(indices, points.size());
+
+	for (MeshletLimits limits : { MeshletLimits(), MeshletLimits{ 32, 32 }, MeshletLimits{ 16, 124 },
+				 MeshletLimits{ 255, 512 }, MeshletLimits{ 3, 1 } }) {
+		MeshletMesh mesh;
+		BuildMeshlets(mesh, indices.data(), indices.size(), &points[0].X, sizeof(Point), points.size(), limits);
+		CHECK(!mesh.Meshlets.empty());
+		CHECK_EQ(mesh.Bounds.size(), mesh.Meshlets.size());
+
+		// Meshlets are packed back to back, within the limits, and each lists
+		// exactly the vertices its triangles use, once.
+		uint32_t vertexOffset = 0, triangleOffset = 0;
+		bool withinLimits = true, packed = true, exactVertices = true;
+		for (const Meshlet &meshlet : mesh.Meshlets) {
+			withinLimits = withinLimits && meshlet.VertexCount <= limits.MaxVertices &&
+					meshlet.TriangleCount <= limits.MaxTriangles && meshlet.TriangleCount > 0;
+			packed = packed && meshlet.VertexOffset == vertexOffset && meshlet.TriangleOffset == triangleOffset;
+			vertexOffset += meshlet.VertexCount;
+			triangleOffset += meshlet.TriangleCount;
+
+			std::vector<uint32_t> listed(mesh.Vertices.begin() + meshlet.VertexOffset,
+					mesh.Vertices.begin() + meshlet.VertexOffset + meshlet.VertexCount);
+			std::vector<uint32_t> used(mesh.Indices.begin() + meshlet.TriangleOffset * 3,
+					mesh.Indices.begin() + (meshlet.TriangleOffset + meshlet.TriangleCount) * 3);
+			std::sort(listed.begin(), listed.end());
+			std::sort(used.begin(), used.end());
+			used.erase(std::unique(used.begin(), used.end()), used.end());
+			exactVertices = exactVertices && listed == used;
+		}
+		CHECK(withinLimits);
+		CHECK(packed);
+		CHECK(exactVertices);
+		CHECK_EQ(vertexOffset, mesh.Vertices.size());
+		CHECK_EQ(triangleOffset * 3, mesh.Indices.size());
+	}
+
+	// The default limits are well filled on a connected mesh.
+	MeshletMesh mesh;
+	BuildMeshlets(mesh, indices.data(), indices.size(), &points[0].X, sizeof(Point), points.size());
+	uint32_t fullVertices = 0;
+	for (const Meshlet &meshlet : mesh.Meshlets)
+		fullVertices += meshlet.VertexCount;
+	CHECK(fullVertices > mesh.Meshlets.size() * 48);
+}
+
+TEST(EveryTriangleIsInExactlyOneMeshlet) {
+	std::vector<Point> points;
+	std::vector<uint32_t> indices;
+	MakeBumpySphere(48, 24, points, indices);
+	// A separate triangle and a fully degenerate one.
+	uint32_t lone = static_cast<uint32_t>(points.size());
+	points.insert(points.end(), { { 5.0f, 0.0f, 0.0f }, { 5.0f, 1.0f, 0.0f }, { 6.0f, 0.0f, 0.0f } });
+	indices.insert(indices.end(), { lone, lone + 1, lone + 2, lone, lone, lone });
+
+	for (bool optimized : { false, true }) {
+		std::vector<uint32_t> source = optimized ? CacheOptimized(indices, points.size()) : indices;
+		for (MeshletLimits limits : { MeshletLimits(), MeshletLimits{ 3, 1 }, MeshletLimits{ 255, 512 } }) {
+			MeshletMesh mesh;
+			BuildMeshlets(mesh, source.data(), source.size(), &points[0].X, sizeof(Point), points.size(), limits);
+			// Same triangles, corners in the same order, none lost or repeated.
+			CHECK_EQ(mesh.Indices.size(), source.size());
+			CHECK(SortedTriangles(mesh.Indices.data(), mesh.Indices.size()) ==
+					SortedTriangles(source.data(), source.size()));
+		}
+	}
+
+	// Nothing to split gives no meshlets.
+	MeshletMesh empty;
+	BuildMeshlets(empty, indices.data(), 0, &points[0].X, sizeof(Point), points.size());
+	CHECK(empty.Meshlets.empty());
+	CHECK(empty.Indices.empty());
+}
+
+TEST(CullingNeverRejectsAVisibleMeshlet) {
+	std::vector<Point> points;
+	std::vector<uint32_t> indices;
+	MakeBumpySphere(64, 32, points, indices);
+	indices = CacheOptimized(indices, points.size());
+	MeshletMesh mesh;
+	BuildMeshlets(mesh, indices.data(), indices.size(), &points[0].X, sizeof(Point), points.size(),
+			MeshletLimits{ 32, 32 });
+	uint32_t count = static_cast<uint32_t>(mesh.Meshlets.size());
+
+	// Bounding spheres hold every vertex of their meshlet.
+	bool contained = true;
+	for (uint32_t m = 0; m < count; ++m) {
+		const MeshletBounds &bounds = mesh.Bounds[m];
+		Point center = { bounds.Center.x, bounds.Center.y, bounds.Center.z };
+		for (uint32_t v = 0; v < mesh.Meshlets[m].VertexCount; ++v) {
+			Point d = Sub(points[mesh.Vertices[mesh.Meshlets[m].VertexOffset + v]], center);
+			contained = contained && sqrtf(Dot(d, d)) <= bounds.Radius;
+		}
+	}
+	CHECK(contained);
+
+	// From views all around, near and far, looking at the mesh or past it: a
+	// meshlet with a front-facing triangle that has a corner in the frustum
+	// is always drawn.
+	std::mt19937 rng(17);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f), distance(1.3f, 12.0f);
+	MeshletCullStats stats;
+	uint32_t rejectedVisible = 0, visibleMeshlets = 0;
+	for (int sample = 0; sample < 300; ++sample) {
+		Point direction = Normalize({ unit(rng), unit(rng), unit(rng) });
+		float d = distance(rng);
+		Point eye = { direction.X * d, direction.Y * d, direction.Z * d };
+		Point target = sample % 3 == 0 ? Point{ unit(rng) * 2.0f, unit(rng) * 2.0f, unit(rng) * 2.0f } : Point{};
+		MeshletCullView view;
+		view.ViewFrustum = LookAt(eye, target);
+		view.CameraPosition = { eye.X, eye.Y, eye.Z };
+
+		std::vector<MeshletDrawRange> ranges;
+		for (uint32_t m = 0; m < count; ++m) {
+			const Meshlet &meshlet = mesh.Meshlets[m];
+			bool visible = false;
+			for (uint32_t t = 0; t < meshlet.TriangleCount && !visible; ++t) {
+				const uint32_t *tri = mesh.Indices.data() + (meshlet.TriangleOffset + t) * 3;
+				Point p0 = points[tri[0]], p1 = points[tri[1]], p2 = points[tri[2]];
+				bool front = Dot(Cross(Sub(p1, p0), Sub(p2, p0)), Sub(eye, p0)) > 0.0f;
+				visible = front && (Inside(view.ViewFrustum, p0) || Inside(view.ViewFrustum, p1) ||
+						Inside(view.ViewFrustum, p2));
+			}
+			bool drawn = CullMeshlets(mesh, view, m, 1, ranges, &stats) == 1;
+			visibleMeshlets += visible;
+			rejectedVisible += visible && !drawn;
+		}
+	}
+	CHECK_EQ(rejectedVisible, 0u);
+	CHECK(visibleMeshlets > 0);
+	// The tests do reject: both kinds of culling fire over these views.
+	CHECK(stats.FrustumCulled > stats.Meshlets / 50);
+	CHECK(stats.BackfaceCulled > stats.Meshlets / 20);
+}
+
+TEST(VisibleMeshletsMergeIntoContiguousRanges) {
+	std::vector<Point> points;
+	std::vector<uint32_t> indices;
+	MakeBumpySphere(64, 32, points, indices);
+	indices = CacheOptimized(indices, points.size());
+	MeshletMesh mesh;
+	BuildMeshlets(mesh, indices.data(), indices.size(), &points[0].X, sizeof(Point), points.size());
+	uint32_t count = static_cast<uint32_t>(mesh.Meshlets.size());
+
+	MeshletCullView view;
+	view.ViewFrustum = LookAt({ 0.0f, 0.0f, -4.0f }, {});
+	view.CameraPosition = { 0.0f, 0.0f, -4.0f };
+	std::vector<MeshletDrawRange> ranges;
+	MeshletCullStats stats;
+	uint32_t appended = CullMeshlets(mesh, view, 0, count, ranges, &stats);
+	CHECK_EQ(appended, ranges.size());
+	CHECK_EQ(stats.Meshlets, count);
+	CHECK(stats.BackfaceCulled > 0);
+
+	// Ranges are ascending, disjoint and never adjacent (adjacent ones merge),
+	// and add up to the visible triangles.
+	uint32_t indexTotal = 0;
+	bool ordered = true;
+	for (size_t r = 0; r < ranges.size(); ++r) {
+		indexTotal += ranges[r].IndexCount;
+		if (r > 0)
+			ordered = ordered && ranges[r].StartIndex > ranges[r - 1].StartIndex + ranges[r - 1].IndexCount;
+	}
+	CHECK(ordered);
+	CHECK_EQ(indexTotal, stats.VisibleTriangles * 3);
+	CHECK(ranges.size() < count - stats.BackfaceCulled - stats.FrustumCulled);
+
+	// With backface culling off, from inside the frustum, everything is one range.
+	view.Backface = false;
+	view.ViewFrustum = LookAt({ 0.0f, 0.0f, -12.0f }, {});
+	ranges.clear();
+	CHECK_EQ(CullMeshlets(mesh, view, 0, count, ranges), 1u);
+	CHECK_EQ(ranges[0].StartIndex, 0u);
+	CHECK_EQ(ranges[0].IndexCount, mesh.Indices.size());
+}
@@ -0,0 +1,76 @@
+#include "JobSystem.h"
+#include "ParallelCommandRecorder.h"
+#include "TestHarness.h"
+#include <algorithm>
+
+TEST(PlanCoversItemsInOrderWithBalancedChunks) {
+	std::vector<RecordChunk> chunks;
+	for (uint32_t items : { 0u, 1u, 63u, 64u, 65u, 1000u, 100003u }) {
+		for (uint32_t maxLists : { 1u, 3u, 8u }) {
+			ParallelCommandRecorder::PlanChunks(items, maxLists, 64, chunks);
+			CHECK(!chunks.empty());
+			CHECK(chunks.size() <= maxLists);
+			uint32_t next = 0, smallest = UINT32_MAX, largest = 0;
+			for (uint32_t i = 0; i < chunks.size(); ++i) {
+				CHECK_EQ(chunks[i].ListIndex, i);
+				CHECK_EQ(chunks[i].First, next);
+				next += chunks[i].Count;
+				smallest = std::min(smallest, chunks[i].Count);
+				largest = std::max(largest, chunks[i].Count);
+			}
+			CHECK_EQ(next, items);
+			CHECK(largest - smallest <= 1);
+			// No chunk is split below the minimum unless there is only one.
+			if (chunks.size() > 1)
+				CHECK(smallest >= 64);
+		}
+	}
+}
+
+TEST(ParallelRecordingReproducesSerialOrder) {
+	const uint32_t Items = 10007;
+	JobSystem jobs(3);
+	ParallelCommandRecorder recorder(&jobs, 8, 16);
+	StubCommandLists lists(8, 10);
+	for (int frame = 0; frame < 50; ++frame) {
+		lists.Reset();
+		uint32_t used = recorder.Record(Items, [&](const RecordChunk &chunk) { lists.Record(chunk); });
+		CHECK_EQ(used, 8u);
+		for (uint32_t i = 0; i < 8; ++i)
+			CHECK_EQ(lists.RecordCount(i), 1u);
+		std::vector<uint32_t> order = lists.ExecutionOrder();
+		CHECK_EQ(order.size(), Items);
+		bool serial = true;
+		for (uint32_t i = 0; i < order.size(); ++i)
+			serial = serial && order[i] == i;
+		CHECK(serial);
+	}
+}
+
+TEST(SerialAndParallelRecordTheSameWork) {
+	StubCommandLists serialLists(4, 25), parallelLists(4, 25);
+	ParallelCommandRecorder serial(nullptr, 4, 32);
+	JobSystem jobs(2);
+	ParallelCommandRecorder parallel(&jobs, 4, 32);
+	serial.Record(5000, [&](const RecordChunk &chunk) { serialLists.Record(chunk); });
+	parallel.Record(5000, [&](const RecordChunk &chunk) { parallelLists.Record(chunk); });
+	CHECK(serialLists.ExecutionOrder() == parallelLists.ExecutionOrder());
+	CHECK_EQ(serialLists.Checksum(), parallelLists.Checksum());
+}
+
+TEST(EmptyFrameStillGetsOneList) {
+	JobSystem jobs(1);
+	ParallelCommandRecorder recorder(&jobs, 4);
+	StubCommandLists lists(4);
+	CHECK_EQ(recorder.Record(0, [&](const RecordChunk &chunk) { lists.Record(chunk); }), 1u);
+	CHECK_EQ(lists.RecordCount(0), 1u);
+	CHECK_EQ(lists.RecordCount(1), 0u);
+	CHECK(lists.ExecutionOrder().empty());
+}
+
+TEST(SmallFramesUseFewerLists) {
+	ParallelCommandRecorder recorder(nullptr, 8, 64);
+	StubCommandLists lists(8);
+	CHECK_EQ(recorder.Record(200, [&](const RecordChunk &chunk) { lists.Record(chunk); }), 3u);
+	CHECK_EQ(lists.List(0).size() + lists.List(1).size() + lists.List(2).size(), 200u);
+}
@@ -0,0 +1,116 @@
+#include "PipelineCache.h"
+#include "TestHarness.h"
+
+// Stands in for a pipeline description: a root signature blob, shader
+// bytecode and a little fixed-function state.
+struct MockPipelineDesc {
+	std::vector<uint8_t> RootSignature = std::vector<uint8_t>(64, 0x11);
+	std::vector<uint8_t> VS = std::vector<uint8_t>(2048, 0x22);
+	std::vector<uint8_t> PS = std::vector<uint8_t>(1024, 0x33);
+	uint32_t CullMode = 3;
+	float DepthBias = 0.0f;
+	const char *Semantic = "POSITION";
+};
+
+static PipelineKey MakeKey(const MockPipelineDesc &desc) {
+	PipelineKey key;
+	key.Blob(desc.RootSignature.data(), desc.RootSignature.size());
+	key.Blob(desc.VS.data(), desc.VS.size());
+	key.Blob(desc.PS.data(), desc.PS.size());
+	key.U32(desc.CullMode);
+	key.F32(desc.DepthBias);
+	key.String(desc.Semantic);
+	return key;
+}
+
+// Mock backend: each create hands out the next pipeline id.
+struct MockCreator {
+	int Creates = 0;
+	std::function<int()> Fn() {
+		return [this]() { return ++Creates; };
+	}
+};
+
+TEST(EqualDescsHitAndDifferentDescsMiss) {
+	PipelineCache<int> cache;
+	MockCreator creator;
+	MockPipelineDesc desc;
+	int first = cache.GetOrCreate(MakeKey(desc), creator.Fn());
+	CHECK_EQ(cache.GetOrCreate(MakeKey(desc), creator.Fn()), first);
+	CHECK_EQ(creator.Creates, 1);
+
+	MockPipelineDesc culled = desc;
+	culled.CullMode = 2;
+	CHECK(cache.GetOrCreate(MakeKey(culled), creator.Fn()) != first);
+	CHECK_EQ(creator.Creates, 2);
+	CHECK_EQ(cache.Stats().Hits, 1u);
+	CHECK_EQ(cache.Stats().Misses, 2u);
+	CHECK_EQ(cache.Size(), 2u);
+}
+
+TEST(KeysCompareBytecodeInFull) {
+	MockPipelineDesc a, b;
+	b.PS[700] ^= 1;
+	PipelineKey keyA = MakeKey(a), keyB = MakeKey(b);
+	CHECK(!(keyA == keyB));
+	// The bytecode itself is in the key, not a digest of it.
+	CHECK(keyA.Data().size() >= a.VS.size() + a.PS.size() + a.RootSignature.size());
+
+	PipelineCache<int> cache;
+	MockCreator creator;
+	cache.GetOrCreate(keyA, creator.Fn());
+	cache.GetOrCreate(keyB, creator.Fn());
+	CHECK_EQ(creator.Creates, 2);
+}
+
+TEST(FieldBoundariesAreUnambiguous) {
+	// Moving a byte from one blob to the next must change the key.
+	PipelineKey a, b;
+	const uint8_t bytes[] = { 1, 2, 3, 4 };
+	a.Blob(bytes, 2);
+	a.Blob(bytes + 2, 2);
+	b.Blob(bytes, 3);
+	b.Blob(bytes + 3, 1);
+	CHECK(!(a == b));
+	CHECK(a.Hash() != b.Hash());
+
+	PipelineKey c, d;
+	c.String("AB");
+	c.String("C");
+	d.String("A");
+	d.String("BC");
+	CHECK(!(c == d));
+
+	PipelineKey empty, null;
+	empty.String("");
+	null.String(nullptr);
+	CHECK(empty == null);
+}
+
+TEST(HashMatchesDataAndNamesAreStable) {
+	MockPipelineDesc desc;
+	PipelineKey key = MakeKey(desc);
+	CHECK_EQ(key.Hash(), PipelineKey::HashBytes(key.Data().data(), key.Data().size()));
+	CHECK(key.Name() == MakeKey(desc).Name());
+	CHECK_EQ(key.Name().size(), size_t(4 + 16));
+	CHECK(key.Name().compare(0, 4, L"pso_") == 0);
+}
+
+TEST(TransientKeysAreFlagged) {
+	PipelineKey key;
+	CHECK(key.IsPersistent());
+	key.U64(0x1234);
+	key.MarkTransient();
+	CHECK(!key.IsPersistent());
+}
+
+TEST(ClearDropsEverything) {
+	PipelineCache<int> cache;
+	MockCreator creator;
+	MockPipelineDesc desc;
+	cache.GetOrCreate(MakeKey(desc), creator.Fn());
+	cache.Clear();
+	CHECK_EQ(cache.Size(), 0u);
+	cache.GetOrCreate(MakeKey(desc), creator.Fn());
+	CHECK_EQ(creator.Creates, 2);
+}
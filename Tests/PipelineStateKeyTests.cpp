@@ -0,0 +1,201 @@
+#include "PipelineStateKey.h"
+#include "TestHarness.h"
+#include <functional>
+#include <string>
+
+// Builds against Tests/Stubs/d3d12.h, so this is the production
+// CanonicalizePipelineDesc running headless.
+
+using RootSignatureMap = std::unordered_map<ID3D12RootSignature *, std::vector<uint8_t>>;
+
+// Stand-ins for objects the description points at; only their addresses and
+// contents matter.
+static const std::vector<uint8_t> sVS(512, 0x22), sPS(256, 0x33);
+static const D3D12_INPUT_ELEMENT_DESC sLayout[] = {
+	{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+};
+static ID3D12RootSignature *const sRootSignature = reinterpret_cast<ID3D12RootSignature *>(0x1000);
+
+static const RootSignatureMap &RootSignatures() {
+	static const RootSignatureMap map = { { sRootSignature, std::vector<uint8_t>(64, 0x11) } };
+	return map;
+}
+
+// An opaque scene pipeline as d3dx12's defaults describe it: one render
+// target, depth test on, stencil off.
+static D3D12_GRAPHICS_PIPELINE_STATE_DESC MakeDesc() {
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
+	desc.pRootSignature = sRootSignature;
+	desc.VS = { sVS.data(), sVS.size() };
+	desc.PS = { sPS.data(), sPS.size() };
+	for (D3D12_RENDER_TARGET_BLEND_DESC &rt : desc.BlendState.RenderTarget) {
+		rt = { FALSE, FALSE, D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD, D3D12_BLEND_ONE, D3D12_BLEND_ZERO,
+			D3D12_BLEND_OP_ADD, D3D12_LOGIC_OP_NOOP, D3D12_COLOR_WRITE_ENABLE_ALL };
+	}
+	desc.SampleMask = UINT32_MAX;
+	desc.RasterizerState = { D3D12_FILL_MODE_SOLID, D3D12_CULL_MODE_BACK, FALSE, 0, 0.0f, 0.0f, TRUE, FALSE, FALSE, 0,
+		D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF };
+	D3D12_DEPTH_STENCILOP_DESC keep = { D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP,
+		D3D12_COMPARISON_FUNC_ALWAYS };
+	desc.DepthStencilState = { TRUE, D3D12_DEPTH_WRITE_MASK_ALL, D3D12_COMPARISON_FUNC_LESS, FALSE, 0xff, 0xff, keep,
+		keep };
+	desc.InputLayout = { sLayout, 2 };
+	desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	desc.NumRenderTargets = 1;
+	desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	desc.SampleDesc = { 1, 0 };
+	return desc;
+}
+
+static PipelineKey KeyOf(const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc) {
+	PipelineKey key;
+	CanonicalizePipelineDesc(desc, RootSignatures(), key);
+	return key;
+}
+
+// Whether changing the base description with edit changes its key.
+static bool Changes(const std::function<void(D3D12_GRAPHICS_PIPELINE_STATE_DESC &)> &edit) {
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = MakeDesc();
+	edit(desc);
+	return !(KeyOf(desc) == KeyOf(MakeDesc()));
+}
+
+TEST(SignedZerosAreFolded) {
+	CHECK(!Changes([](auto &d) { d.RasterizerState.DepthBiasClamp = -0.0f; }));
+	CHECK(!Changes([](auto &d) { d.RasterizerState.SlopeScaledDepthBias = -0.0f; }));
+	CHECK(Changes([](auto &d) { d.RasterizerState.DepthBiasClamp = 0.5f; }));
+	CHECK(Changes([](auto &d) { d.RasterizerState.SlopeScaledDepthBias = -1.0f; }));
+}
+
+TEST(BlendStateOfUnusedTargetsIsIgnored) {
+	auto blendTarget1 = [](D3D12_GRAPHICS_PIPELINE_STATE_DESC &d) {
+		d.BlendState.RenderTarget[1].BlendEnable = TRUE;
+		d.BlendState.RenderTarget[1].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+		d.BlendState.RenderTarget[1].DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+		d.BlendState.RenderTarget[1].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_RED;
+	};
+	auto twoTargets = [](D3D12_GRAPHICS_PIPELINE_STATE_DESC &d) {
+		d.NumRenderTargets = 2;
+		d.RTVFormats[1] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	};
+
+	// Without independent blending every target uses RenderTarget[0].
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC shared = MakeDesc();
+	twoTargets(shared);
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC sharedEdited = shared;
+	blendTarget1(sharedEdited);
+	CHECK(KeyOf(shared) == KeyOf(sharedEdited));
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC independent = shared;
+	independent.BlendState.IndependentBlendEnable = TRUE;
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC independentEdited = independent;
+	blendTarget1(independentEdited);
+	CHECK(!(KeyOf(independent) == KeyOf(independentEdited)));
+
+	// Targets past NumRenderTargets do not count either way.
+	CHECK(!Changes([&](auto &d) {
+		d.BlendState.IndependentBlendEnable = TRUE;
+		blendTarget1(d);
+		d.BlendState.IndependentBlendEnable = FALSE;
+	}));
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC oneIndependent = MakeDesc();
+	oneIndependent.BlendState.IndependentBlendEnable = TRUE;
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC oneIndependentEdited = oneIndependent;
+	blendTarget1(oneIndependentEdited);
+	oneIndependentEdited.RTVFormats[3] = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	CHECK(KeyOf(oneIndependent) == KeyOf(oneIndependentEdited));
+
+	// Blend factors only count with blending on, the logic op with logic ops on.
+	CHECK(!Changes([](auto &d) { d.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA; }));
+	CHECK(!Changes([](auto &d) { d.BlendState.RenderTarget[0].LogicOp = D3D12_LOGIC_OP_CLEAR; }));
+	CHECK(Changes([](auto &d) {
+		d.BlendState.RenderTarget[0].BlendEnable = TRUE;
+		d.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+	}));
+	CHECK(Changes([](auto &d) { d.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_RED; }));
+}
+
+TEST(StencilStateIsIgnoredWhileStencilIsOff) {
+	auto stencilOps = [](D3D12_GRAPHICS_PIPELINE_STATE_DESC &d) {
+		d.DepthStencilState.StencilReadMask = 0x0f;
+		d.DepthStencilState.FrontFace.StencilPassOp = D3D12_STENCIL_OP_REPLACE;
+		d.DepthStencilState.BackFace.StencilFunc = D3D12_COMPARISON_FUNC_EQUAL;
+	};
+	CHECK(!Changes(stencilOps));
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC enabled = MakeDesc();
+	enabled.DepthStencilState.StencilEnable = TRUE;
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC enabledEdited = enabled;
+	stencilOps(enabledEdited);
+	CHECK(!(KeyOf(enabled) == KeyOf(enabledEdited)));
+	CHECK(Changes([](auto &d) { d.DepthStencilState.StencilEnable = TRUE; }));
+
+	// Likewise the depth test's settings while depth is off.
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC noDepth = MakeDesc();
+	noDepth.DepthStencilState.DepthEnable = FALSE;
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC noDepthEdited = noDepth;
+	noDepthEdited.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_GREATER;
+	noDepthEdited.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+	CHECK(KeyOf(noDepth) == KeyOf(noDepthEdited));
+	CHECK(Changes([](auto &d) { d.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_GREATER; }));
+}
+
+TEST(StepRateOnlyCountsForPerInstanceElements) {
+	D3D12_INPUT_ELEMENT_DESC layout[3] = { sLayout[0], sLayout[1],
+		{ "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 } };
+	auto withLayout = [&](D3D12_INPUT_ELEMENT_DESC *elements) {
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = MakeDesc();
+		desc.InputLayout = { elements, 3 };
+		return KeyOf(desc);
+	};
+	PipelineKey base = withLayout(layout);
+
+	D3D12_INPUT_ELEMENT_DESC perVertexStep[3] = { layout[0], layout[1], layout[2] };
+	perVertexStep[1].InstanceDataStepRate = 4;
+	CHECK(withLayout(perVertexStep) == base);
+
+	D3D12_INPUT_ELEMENT_DESC perInstanceStep[3] = { layout[0], layout[1], layout[2] };
+	perInstanceStep[2].InstanceDataStepRate = 2;
+	CHECK(!(withLayout(perInstanceStep) == base));
+
+	D3D12_INPUT_ELEMENT_DESC perVertex[3] = { layout[0], layout[1], layout[2] };
+	perVertex[2].InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
+	CHECK(!(withLayout(perVertex) == base));
+}
+
+TEST(PointersAreKeyedByWhatTheyPointAt) {
+	// Copies of the bytecode, layout and semantic names at other addresses.
+	std::vector<uint8_t> vs = sVS, ps = sPS;
+	std::string position = "POSITION", color = "COLOR";
+	D3D12_INPUT_ELEMENT_DESC layout[2] = { sLayout[0], sLayout[1] };
+	layout[0].SemanticName = position.c_str();
+	layout[1].SemanticName = color.c_str();
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC copy = MakeDesc();
+	copy.VS = { vs.data(), vs.size() };
+	copy.PS = { ps.data(), ps.size() };
+	copy.InputLayout = { layout, 2 };
+	CHECK(KeyOf(copy) == KeyOf(MakeDesc()));
+	CHECK(KeyOf(copy).IsPersistent());
+
+	ps[100] ^= 1;
+	CHECK(!(KeyOf(copy) == KeyOf(MakeDesc())));
+	color = "COLOUR";
+	layout[1].SemanticName = color.c_str();
+	ps[100] ^= 1;
+	CHECK(!(KeyOf(copy) == KeyOf(MakeDesc())));
+
+	// Unregistered root signatures are keyed by address and never persisted.
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC unregistered = MakeDesc();
+	unregistered.pRootSignature = reinterpret_cast<ID3D12RootSignature *>(0x2000);
+	CHECK(!KeyOf(unregistered).IsPersistent());
+	CHECK(!(KeyOf(unregistered) == KeyOf(MakeDesc())));
+}
+
+TEST(UnusedRenderTargetFormatsAreIgnored) {
+	CHECK(!Changes([](auto &d) { d.RTVFormats[5] = DXGI_FORMAT_R32G32_FLOAT; }));
+	CHECK(Changes([](auto &d) { d.RTVFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT; }));
+	CHECK(Changes([](auto &d) { d.SampleDesc.Count = 4; }));
+	CHECK(Changes([](auto &d) { d.RasterizerState.CullMode = D3D12_CULL_MODE_NONE; }));
+}
@@ -0,0 +1,243 @@
+#include "RenderGraph.h"
+#include "TestHarness.h"
+#include <string>
+
+// Each test builds a small frame, compiles it and compares the whole Dump()
+// against the expected schedule, so any change to culling, barrier placement
+// or heap layout shows up as a diff.
+
+static bool DumpIs(const RenderGraph &graph, const std::string &expected) {
+	std::string dump = graph.Dump();
+	if (dump == expected)
+		return true;
+	printf("expected:\n%sgot:\n%s", expected.c_str(), dump.c_str());
+	return false;
+}
+
+TEST(PassesWithoutObservedOutputAreCulled) {
+	RenderGraph graph;
+	RenderGraphResource backBuffer = graph.Import("BackBuffer", ResourceState::Present, ResourceState::Present);
+	RenderGraphResource scratch = graph.CreateTransient("Scratch", { 1024 });
+	RenderGraphResource temp = graph.CreateTransient("Temp", { 2048 });
+	RenderGraphResource log = graph.CreateTransient("Log", { 256 });
+
+	// Nothing reads Scratch, so its writer goes, and with it the chain that
+	// only feeds it. The debug pass writes nothing observed but is kept for
+	// its side effects.
+	uint32_t unobserved = graph.AddPass("unobserved", nullptr);
+	graph.Write(unobserved, scratch, ResourceState::RenderTarget);
+	uint32_t producer = graph.AddPass("producer", nullptr);
+	graph.Write(producer, temp, ResourceState::UnorderedAccess);
+	uint32_t consumer = graph.AddPass("consumer", nullptr);
+	graph.Read(consumer, temp, ResourceState::ShaderResource);
+	graph.Write(consumer, scratch, ResourceState::RenderTarget);
+	uint32_t debug = graph.AddPass("debug", nullptr);
+	graph.Write(debug, log, ResourceState::UnorderedAccess);
+	graph.SetSideEffects(debug);
+	uint32_t present = graph.AddPass("main", nullptr);
+	graph.Write(present, backBuffer, ResourceState::RenderTarget);
+	graph.Compile();
+
+	CHECK(graph.IsCulled(unobserved));
+	CHECK(graph.IsCulled(producer));
+	CHECK(graph.IsCulled(consumer));
+	CHECK(!graph.IsCulled(debug));
+	CHECK_EQ(graph.Stats().CulledPasses, 3u);
+	CHECK(DumpIs(graph,
+			"culled 0 unobserved\n"
+			"culled 1 producer\n"
+			"culled 2 consumer\n"
+			"pass 3 debug\n"
+			"pass 4 main\n"
+			"  before transition BackBuffer Present -> RenderTarget\n"
+			"  after transition BackBuffer RenderTarget -> Present\n"
+			"resource 0 BackBuffer imported passes 4..4\n"
+			"resource 1 Scratch transient 1024 bytes unused\n"
+			"resource 2 Temp transient 2048 bytes unused\n"
+			"resource 3 Log transient 256 bytes passes 3..3 at 0 created as UnorderedAccess\n"
+			"transient heap 256 bytes (committed 65536)\n"));
+}
+
+TEST(ConsecutiveReadsShareOneTransition) {
+	RenderGraph graph;
+	RenderGraphResource backBuffer = graph.Import("BackBuffer", ResourceState::Present, ResourceState::Present);
+	RenderGraphResource readback = graph.Import("Readback", ResourceState::CopyDest, ResourceState::CopyDest);
+	RenderGraphResource gbuffer = graph.CreateTransient("GBuffer", { 4096 });
+	RenderGraphResource hdr = graph.CreateTransient("HDR", { 4096 });
+
+	// GBuffer is read as a shader resource, a copy source and a shader
+	// resource again: one transition to the combined state covers all three.
+	uint32_t pass = graph.AddPass("gbuffer", nullptr);
+	graph.Write(pass, gbuffer, ResourceState::RenderTarget);
+	pass = graph.AddPass("lighting", nullptr);
+	graph.Read(pass, gbuffer, ResourceState::ShaderResource);
+	graph.Write(pass, hdr, ResourceState::RenderTarget);
+	pass = graph.AddPass("readback", nullptr);
+	graph.Read(pass, gbuffer, ResourceState::CopySource);
+	graph.Write(pass, readback, ResourceState::CopyDest);
+	pass = graph.AddPass("post", nullptr);
+	graph.Read(pass, hdr, ResourceState::ShaderResource);
+	graph.Read(pass, gbuffer, ResourceState::ShaderResource);
+	graph.Write(pass, backBuffer, ResourceState::RenderTarget);
+	graph.Compile();
+
+	CHECK_EQ(graph.Stats().Barriers, 6u);
+	CHECK(DumpIs(graph,
+			"pass 0 gbuffer\n"
+			"pass 1 lighting\n"
+			"  before transition GBuffer RenderTarget -> ShaderResource|CopySource\n"
+			"pass 2 readback\n"
+			"pass 3 post\n"
+			"  before transition HDR RenderTarget -> ShaderResource\n"
+			"  before transition BackBuffer Present -> RenderTarget\n"
+			"  after transition BackBuffer RenderTarget -> Present\n"
+			"  after transition GBuffer ShaderResource|CopySource -> RenderTarget\n"
+			"  after transition HDR ShaderResource -> RenderTarget\n"
+			"resource 0 BackBuffer imported passes 3..3\n"
+			"resource 1 Readback imported passes 2..2\n"
+			"resource 2 GBuffer transient 4096 bytes passes 0..3 at 0 created as RenderTarget\n"
+			"resource 3 HDR transient 4096 bytes passes 1..3 at 65536 created as RenderTarget\n"
+			"transient heap 69632 bytes (committed 131072)\n"));
+}
+
+TEST(UnorderedAccessPassesAreSeparatedByUavFlushes) {
+	RenderGraph graph;
+	RenderGraphResource backBuffer = graph.Import("BackBuffer", ResourceState::Present, ResourceState::Present);
+	RenderGraphResource particles = graph.CreateTransient("Particles", { 8192 });
+
+	uint32_t pass = graph.AddPass("clear", nullptr);
+	graph.Write(pass, particles, ResourceState::UnorderedAccess);
+	pass = graph.AddPass("emit", nullptr);
+	graph.ReadWrite(pass, particles, ResourceState::UnorderedAccess);
+	pass = graph.AddPass("simulate", nullptr);
+	graph.ReadWrite(pass, particles, ResourceState::UnorderedAccess);
+	pass = graph.AddPass("draw", nullptr);
+	graph.Read(pass, particles, ResourceState::ShaderResource);
+	graph.Write(pass, backBuffer, ResourceState::RenderTarget);
+	graph.Compile();
+
+	CHECK(DumpIs(graph,
+			"pass 0 clear\n"
+			"pass 1 emit\n"
+			"  before uav Particles\n"
+			"pass 2 simulate\n"
+			"  before uav Particles\n"
+			"pass 3 draw\n"
+			"  before transition Particles UnorderedAccess -> ShaderResource\n"
+			"  before transition BackBuffer Present -> RenderTarget\n"
+			"  after transition BackBuffer RenderTarget -> Present\n"
+			"  after transition Particles ShaderResource -> UnorderedAccess\n"
+			"resource 0 BackBuffer imported passes 3..3\n"
+			"resource 1 Particles transient 8192 bytes passes 0..3 at 0 created as UnorderedAccess\n"
+			"transient heap 8192 bytes (committed 65536)\n"));
+}
+
+TEST(OnlyUavReadsAfterAWriteAreFlushed) {
+	RenderGraph graph;
+	RenderGraphResource backBuffer = graph.Import("BackBuffer", ResourceState::Present, ResourceState::Present);
+	RenderGraphResource exposure = graph.Import("Exposure", ResourceState::CopyDest, ResourceState::CopyDest);
+	RenderGraphResource histogram = graph.CreateTransient("Histogram", { 1024 });
+
+	// reduce must wait for build's writes; apply only follows another read.
+	uint32_t pass = graph.AddPass("build", nullptr);
+	graph.Write(pass, histogram, ResourceState::UnorderedAccess);
+	pass = graph.AddPass("reduce", nullptr);
+	graph.Read(pass, histogram, ResourceState::UnorderedAccess);
+	graph.Write(pass, exposure, ResourceState::CopyDest);
+	pass = graph.AddPass("apply", nullptr);
+	graph.Read(pass, histogram, ResourceState::UnorderedAccess);
+	graph.Write(pass, backBuffer, ResourceState::RenderTarget);
+	graph.Compile();
+
+	CHECK(DumpIs(graph,
+			"pass 0 build\n"
+			"pass 1 reduce\n"
+			"  before uav Histogram\n"
+			"pass 2 apply\n"
+			"  before transition BackBuffer Present -> RenderTarget\n"
+			"  after transition BackBuffer RenderTarget -> Present\n"
+			"resource 0 BackBuffer imported passes 2..2\n"
+			"resource 1 Exposure imported passes 1..1\n"
+			"resource 2 Histogram transient 1024 bytes passes 0..2 at 0 created as UnorderedAccess\n"
+			"transient heap 1024 bytes (committed 65536)\n"));
+}
+
+TEST(TransientsSharingMemoryAreAliasedOnFirstUse) {
+	RenderGraph graph;
+	RenderGraphResource backBuffer = graph.Import("BackBuffer", ResourceState::Present, ResourceState::Present);
+	RenderGraphResource shadowMap = graph.CreateTransient("ShadowMap", { 65536 });
+	RenderGraphResource bloom = graph.CreateTransient("Bloom", { 65536 });
+	RenderGraphResource depth = graph.CreateTransient("Depth", { 131072 });
+
+	// Depth dies before Bloom is born, so they share offset 0; ShadowMap
+	// overlaps Depth's lifetime and gets memory of its own.
+	uint32_t pass = graph.AddPass("shadows", nullptr);
+	graph.Write(pass, shadowMap, ResourceState::DepthWrite);
+	pass = graph.AddPass("scene", nullptr);
+	graph.Read(pass, shadowMap, ResourceState::ShaderResource);
+	graph.Write(pass, depth, ResourceState::DepthWrite);
+	graph.Write(pass, backBuffer, ResourceState::RenderTarget);
+	pass = graph.AddPass("bloom", nullptr);
+	graph.Read(pass, backBuffer, ResourceState::ShaderResource);
+	graph.Write(pass, bloom, ResourceState::RenderTarget);
+	pass = graph.AddPass("composite", nullptr);
+	graph.Read(pass, bloom, ResourceState::ShaderResource);
+	graph.ReadWrite(pass, backBuffer, ResourceState::RenderTarget);
+	graph.Compile();
+
+	CHECK_EQ(graph.Stats().TransientHeapSize, 196608u);
+	CHECK(DumpIs(graph,
+			"pass 0 shadows\n"
+			"pass 1 scene\n"
+			"  before transition ShadowMap DepthWrite -> ShaderResource\n"
+			"  before alias Depth\n"
+			"  before transition BackBuffer Present -> RenderTarget\n"
+			"  after transition ShadowMap ShaderResource -> DepthWrite\n"
+			"pass 2 bloom\n"
+			"  before transition BackBuffer RenderTarget -> ShaderResource\n"
+			"  before alias Bloom\n"
+			"pass 3 composite\n"
+			"  before transition Bloom RenderTarget -> ShaderResource\n"
+			"  before transition BackBuffer ShaderResource -> RenderTarget\n"
+			"  after transition BackBuffer RenderTarget -> Present\n"
+			"  after transition Bloom ShaderResource -> RenderTarget\n"
+			"resource 0 BackBuffer imported passes 1..3\n"
+			"resource 1 ShadowMap transient 65536 bytes passes 0..1 at 131072 created as DepthWrite\n"
+			"resource 2 Bloom transient 65536 bytes passes 2..3 at 0 created as RenderTarget\n"
+			"resource 3 Depth transient 131072 bytes passes 1..1 at 0 created as DepthWrite\n"
+			"transient heap 196608 bytes (committed 262144)\n"));
+}
+
+TEST(ImportsReturnToTheirFinalState) {
+	RenderGraph graph;
+	// Already in its final state and only read in it: no barriers at all.
+	RenderGraphResource lut = graph.Import("Lut", ResourceState::ShaderResource, ResourceState::ShaderResource);
+	// Handed over in one state and expected back in another.
+	RenderGraphResource target = graph.Import("Target", ResourceState::Common, ResourceState::CopySource);
+
+	uint32_t pass = graph.AddPass("tonemap", nullptr);
+	graph.Read(pass, lut, ResourceState::ShaderResource);
+	graph.Write(pass, target, ResourceState::RenderTarget);
+	graph.Compile();
+
+	CHECK(DumpIs(graph,
+			"pass 0 tonemap\n"
+			"  before transition Target Common -> RenderTarget\n"
+			"  after transition Target RenderTarget -> CopySource\n"
+			"resource 0 Lut imported passes 0..0\n"
+			"resource 1 Target imported passes 0..0\n"
+			"transient heap 0 bytes (committed 0)\n"));
+}
+
+TEST(RecompilingGivesTheSameSchedule) {
+	RenderGraph graph;
+	RenderGraphResource backBuffer = graph.Import("BackBuffer", ResourceState::Present, ResourceState::Present);
+	RenderGraphResource depth = graph.CreateTransient("Depth", {});
+	uint32_t pass = graph.AddPass("scene", nullptr);
+	graph.Write(pass, depth, ResourceState::DepthWrite);
+	graph.Write(pass, backBuffer, ResourceState::RenderTarget);
+	graph.Compile();
+	std::string first = graph.Dump();
+	graph.Compile();
+	CHECK(DumpIs(graph, first));
+}
@@ -0,0 +1,115 @@
+#include "RenderItemStore.h"
+#include "TestHarness.h"
+#include <utility>
+#include <vector>
+
+static RenderItemDesc MakeDesc(float x) {
+	RenderItemDesc desc;
+	desc.World.m[3][0] = x;
+	desc.BoundsExtents = { 1.0f, 1.0f, 1.0f };
+	desc.IndexCount = 36;
+	return desc;
+}
+
+static std::vector<std::pair<uint32_t, uint32_t>> DirtyRanges(RenderItemStore &store, uint32_t frame) {
+	std::vector<std::pair<uint32_t, uint32_t>> ranges;
+	store.ForEachDirtyRange(frame, [&](uint32_t first, uint32_t count) { ranges.push_back({ first, count }); });
+	return ranges;
+}
+
+TEST(CreatedItemsAreDirtyInEveryFrame) {
+	RenderItemStore store(200, 3);
+	for (int i = 0; i < 130; ++i)
+		store.Create(MakeDesc(float(i)));
+	for (uint32_t frame = 0; frame < 3; ++frame) {
+		auto ranges = DirtyRanges(store, frame);
+		CHECK_EQ(ranges.size(), 1u);
+		CHECK_EQ(ranges[0].first, 0u);
+		CHECK_EQ(ranges[0].second, 130u);
+		CHECK(DirtyRanges(store, frame).empty());
+	}
+}
+
+TEST(SetWorldDirtiesOnlyThatItem) {
+	RenderItemStore store(200, 3);
+	std::vector<RenderItemHandle> handles;
+	for (int i = 0; i < 150; ++i)
+		handles.push_back(store.Create(MakeDesc(float(i))));
+	for (uint32_t frame = 0; frame < 3; ++frame)
+		DirtyRanges(store, frame);
+
+	Float4x4 world;
+	world.m[3][1] = 5.0f;
+	for (int i : { 3, 63, 64, 65, 140 })
+		store.SetWorld(handles[i], world);
+	auto ranges = DirtyRanges(store, 1);
+	CHECK_EQ(ranges.size(), 3u);
+	CHECK_EQ(ranges[0].first, 3u);
+	CHECK_EQ(ranges[0].second, 1u);
+	// Runs continue across bitset words.
+	CHECK_EQ(ranges[1].first, 63u);
+	CHECK_EQ(ranges[1].second, 3u);
+	CHECK_EQ(ranges[2].first, 140u);
+	CHECK_EQ(ranges[2].second, 1u);
+	CHECK_NEAR(store.World()[64].m[3][1], 5.0f, 0.0f);
+	// The bounds follow the world.
+	CHECK_NEAR(store.WorldBounds().CenterY[64], 5.0f, 1e-6f);
+	// Other frame resources still have it pending.
+	CHECK_EQ(DirtyRanges(store, 0).size(), 3u);
+}
+
+TEST(DrawArgsDoNotDirty) {
+	RenderItemStore store(8, 2);
+	RenderItemHandle handle = store.Create(MakeDesc(0.0f));
+	DirtyRanges(store, 0);
+	DirtyRanges(store, 1);
+	store.SetDrawArgs(handle, 12, 24);
+	CHECK(DirtyRanges(store, 0).empty());
+	CHECK_EQ(store.IndexCount()[0], 12u);
+	CHECK_EQ(store.StartIndexLocation()[0], 24u);
+}
+
+TEST(DestroyMovesLastItemAndInvalidatesHandle) {
+	RenderItemStore store(8, 2);
+	RenderItemHandle a = store.Create(MakeDesc(1.0f));
+	RenderItemHandle b = store.Create(MakeDesc(2.0f));
+	RenderItemHandle c = store.Create(MakeDesc(3.0f));
+	DirtyRanges(store, 0);
+	DirtyRanges(store, 1);
+
+	store.Destroy(a);
+	CHECK(!store.IsAlive(a));
+	CHECK(store.IsAlive(b));
+	CHECK_EQ(store.Size(), 2u);
+	CHECK_EQ(store.IndexOf(c), 0u);
+	CHECK_NEAR(store.World()[0].m[3][0], 3.0f, 0.0f);
+	// The moved item's constants are at a new slot.
+	auto ranges = DirtyRanges(store, 0);
+	CHECK_EQ(ranges.size(), 1u);
+	CHECK_EQ(ranges[0].first, 0u);
+	CHECK_EQ(ranges[0].second, 1u);
+
+	// The slot is reused with a new generation; the old handle stays dead.
+	RenderItemHandle d = store.Create(MakeDesc(4.0f));
+	CHECK_EQ(d.Slot, a.Slot);
+	CHECK(d.Generation != a.Generation);
+	CHECK(!store.IsAlive(a));
+	store.Destroy(a);
+	CHECK_EQ(store.Size(), 3u);
+}
+
+TEST(CreateFailsWhenFull) {
+	RenderItemStore store(2, 1);
+	CHECK(store.Create(MakeDesc(0.0f)).IsValid());
+	CHECK(store.Create(MakeDesc(0.0f)).IsValid());
+	CHECK(!store.Create(MakeDesc(0.0f)).IsValid());
+}
+
+TEST(MarkAllDirtyCoversPartialWord) {
+	RenderItemStore store(100, 1);
+	for (int i = 0; i < 70; ++i)
+		store.Create(MakeDesc(0.0f));
+	DirtyRanges(store, 0);
+	store.MarkAllDirty();
+	CHECK_EQ(store.ForEachDirtyRange(0, [](uint32_t, uint32_t) {}), 70u);
+}
@@ -0,0 +1,145 @@
+#include "ShaderBuildQueue.h"
+#include "TestHarness.h"
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+struct ScratchShaders {
+	fs::path Dir;
+
+	explicit ScratchShaders(const char *name, int count) {
+		Dir = fs::temp_directory_path() / name;
+		fs::remove_all(Dir);
+		fs::create_directories(Dir);
+		for (int i = 0; i < count; ++i)
+			std::ofstream(Path(i)) << "// shader " << i << "\n";
+	}
+	~ScratchShaders() { fs::remove_all(Dir); }
+
+	fs::path Path(int i) const { return Dir / ("shader" + std::to_string(i) + ".hlsl"); }
+
+	ShaderCompileRequest Request(int i, const char *entry = "VS") const {
+		ShaderCompileRequest request;
+		request.SourcePath = Path(i);
+		request.EntryPoint = entry;
+		request.Target = "vs_5_1";
+		return request;
+	}
+};
+
+TEST(IdenticalRequestsShareAHandle) {
+	ScratchShaders shaders("photon_buildqueue_dedup", 2);
+	FakeShaderCompiler compiler;
+	ShaderCache cache(shaders.Dir / "cache.bin", compiler.Fn(), "fake");
+	JobSystem jobs(2);
+	ShaderBuildQueue queue(&jobs, &cache);
+
+	ShaderBuildHandle a = queue.Enqueue(shaders.Request(0));
+	ShaderBuildHandle b = queue.Enqueue(shaders.Request(0));
+	ShaderBuildHandle c = queue.Enqueue(shaders.Request(1));
+	ShaderBuildHandle d = queue.Enqueue(shaders.Request(0, "PS"));
+	queue.WaitAll();
+
+	CHECK_EQ(a, b);
+	CHECK(a != c && a != d && c != d);
+	CHECK_EQ(compiler.Calls(), 3u);
+	const ShaderBuildStats &stats = queue.Stats();
+	CHECK_EQ(stats.Requested, 4u);
+	CHECK_EQ(stats.Deduplicated, 1u);
+	CHECK_EQ(stats.Built, 3u);
+	CHECK(queue.Succeeded(a));
+	CHECK(std::string(queue.ByteCode(d).begin(), queue.ByteCode(d).end()) == "PSvs_5_1");
+}
+
+TEST(FailuresKeepTheirErrors) {
+	ScratchShaders shaders("photon_buildqueue_fail", 1);
+	FakeShaderCompiler compiler;
+	ShaderCache cache(shaders.Dir / "cache.bin", compiler.Fn(), "fake");
+	JobSystem jobs(1);
+	ShaderBuildQueue queue(&jobs, &cache);
+	ShaderBuildHandle good = queue.Enqueue(shaders.Request(0));
+	ShaderBuildHandle bad = queue.Enqueue(shaders.Request(0, "BrokenPS"));
+	queue.WaitAll();
+	CHECK(queue.Succeeded(good));
+	CHECK(!queue.Succeeded(bad));
+	CHECK(queue.Errors(bad).find("X3000") != std::string::npos);
+	CHECK(queue.ByteCode(bad).empty());
+}
+
+TEST(BuildsOverlapAndStatsShowTheSpeedup) {
+	// Sleeping compiles overlap even on a single core.
+	const int Count = 8;
+	ScratchShaders shaders("photon_buildqueue_overlap", Count);
+	FakeShaderCompiler compiler(20.0, false);
+	ShaderCache cache(shaders.Dir / "cache.bin", compiler.Fn(), "fake");
+	JobSystem jobs(3);
+	ShaderBuildQueue queue(&jobs, &cache);
+	for (int i = 0; i < Count; ++i)
+		queue.Enqueue(shaders.Request(i));
+	queue.WaitAll();
+
+	CHECK(compiler.PeakConcurrency() > 1u);
+	CHECK(compiler.PeakConcurrency() <= jobs.ThreadCount());
+	const ShaderBuildStats &stats = queue.Stats();
+	CHECK(stats.SerialSeconds >= Count * 0.020 * 0.9);
+	CHECK(stats.WallSeconds > 0.0);
+	CHECK(stats.SerialSeconds / stats.WallSeconds > 1.5);
+}
+
+TEST(InlineQueueWithoutJobSystem) {
+	ScratchShaders shaders("photon_buildqueue_inline", 3);
+	FakeShaderCompiler compiler(1.0, false);
+	ShaderCache cache(shaders.Dir / "cache.bin", compiler.Fn(), "fake");
+	ShaderBuildQueue queue(nullptr, &cache);
+	for (int i = 0; i < 3; ++i)
+		queue.Enqueue(shaders.Request(i));
+	// Without a job system every build finished inside Enqueue().
+	CHECK_EQ(compiler.Calls(), 3u);
+	CHECK_EQ(compiler.PeakConcurrency(), 1u);
+	queue.WaitAll();
+	CHECK_EQ(queue.Stats().Built, 3u);
+	// Serial, so the two times are about equal.
+	CHECK(queue.Stats().SerialSeconds <= queue.Stats().WallSeconds);
+}
+
+TEST(CounterOrdersDependentJobs) {
+	ScratchShaders shaders("photon_buildqueue_counter", 4);
+	FakeShaderCompiler compiler(5.0, false);
+	ShaderCache cache(shaders.Dir / "cache.bin", compiler.Fn(), "fake");
+	JobSystem jobs(2);
+	ShaderBuildQueue queue(&jobs, &cache);
+	std::vector<ShaderBuildHandle> handles;
+	for (int i = 0; i < 4; ++i)
+		handles.push_back(queue.Enqueue(shaders.Request(i)));
+
+	// What BuildPSO does: a job that needs every shader.
+	bool allBuilt = false;
+	JobCounter pso;
+	jobs.RunAfter(queue.Counter(), [&]() {
+		allBuilt = true;
+		for (ShaderBuildHandle handle : handles)
+			allBuilt = allBuilt && queue.Succeeded(handle) && !queue.ByteCode(handle).empty();
+	}, &pso);
+	jobs.Wait(pso);
+	CHECK(allBuilt);
+	queue.WaitAll();
+}
+
+TEST(SecondRunHitsTheCache) {
+	ScratchShaders shaders("photon_buildqueue_warm", 4);
+	FakeShaderCompiler compiler;
+	ShaderCache cache(shaders.Dir / "cache.bin", compiler.Fn(), "fake");
+	JobSystem jobs(2);
+	{
+		ShaderBuildQueue queue(&jobs, &cache);
+		for (int i = 0; i < 4; ++i)
+			queue.Enqueue(shaders.Request(i));
+		queue.WaitAll();
+	}
+	ShaderBuildQueue queue(&jobs, &cache);
+	for (int i = 0; i < 4; ++i)
+		queue.Enqueue(shaders.Request(i));
+	queue.WaitAll();
+	CHECK_EQ(compiler.Calls(), 4u);
+	CHECK_EQ(cache.Stats().Hits, 4u);
+}
@@ -0,0 +1,238 @@
+#include "ShaderCache.h"
+#include "TestHarness.h"
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+// A scratch directory with a shader that includes a header.
+struct ShaderTree {
+	fs::path Dir;
+
+	explicit ShaderTree(const char *name) {
+		Dir = fs::temp_directory_path() / name;
+		fs::remove_all(Dir);
+		fs::create_directories(Dir / "inc");
+		Write("main.hlsl", "#include \"inc/common.hlsli\"\nfloat4 VS() : SV_Position { return Value(); }\n");
+		Write("inc/common.hlsli", "float4 Value() { return 1; }\n");
+	}
+	~ShaderTree() { fs::remove_all(Dir); }
+
+	void Write(const char *file, const std::string &text) const {
+		std::ofstream(Dir / file, std::ios::binary | std::ios::trunc) << text;
+	}
+
+	ShaderCompileRequest Request(const char *entry = "VS") const {
+		ShaderCompileRequest request;
+		request.SourcePath = Dir / "main.hlsl";
+		request.EntryPoint = entry;
+		request.Target = "vs_5_1";
+		return request;
+	}
+};
+
+// Produces "bytecode" from the entry point and counts how often it runs.
+struct FakeCompiler {
+	std::atomic<int> Calls{ 0 };
+
+	ShaderCompileFn Fn() {
+		return [this](const ShaderCompileRequest &request, std::vector<uint8_t> &byteCode, std::string &errors) {
+			++Calls;
+			if (request.EntryPoint == "Broken") {
+				errors = "error X3000: syntax error";
+				return false;
+			}
+			byteCode.assign(request.EntryPoint.begin(), request.EntryPoint.end());
+			return true;
+		};
+	}
+};
+
+TEST(MissThenHit) {
+	ShaderTree tree("photon_shadercache_hit");
+	FakeCompiler compiler;
+	ShaderCache cache(tree.Dir / "cache.bin", compiler.Fn(), "fake 1.0");
+	std::vector<uint8_t> code;
+	CHECK(cache.GetOrCompile(tree.Request(), code));
+	CHECK(cache.GetOrCompile(tree.Request(), code));
+	CHECK_EQ(compiler.Calls.load(), 1);
+	CHECK_EQ(cache.Stats().Misses, 1u);
+	CHECK_EQ(cache.Stats().Hits, 1u);
+	CHECK(std::string(code.begin(), code.end()) == "VS");
+}
+
+TEST(KeyCoversSourceIncludesOptionsAndCompiler) {
+	ShaderTree tree("photon_shadercache_key");
+	FakeCompiler compiler;
+	ShaderCache cache(tree.Dir / "cache.bin", compiler.Fn(), "fake 1.0");
+	ShaderCompileRequest request = tree.Request();
+	uint64_t base = cache.HashRequest(request);
+	CHECK_EQ(cache.HashRequest(request), base);
+
+	ShaderCompileRequest defined = request;
+	defined.Defines.push_back({ "USE_CUSTOM_COLOR", "1" });
+	CHECK(cache.HashRequest(defined) != base);
+	ShaderCompileRequest flagged = request;
+	flagged.Flags = 1;
+	CHECK(cache.HashRequest(flagged) != base);
+	CHECK(cache.HashRequest(tree.Request("PS")) != base);
+
+	ShaderCache newer(tree.Dir / "cache.bin", compiler.Fn(), "fake 1.1");
+	CHECK(newer.HashRequest(request) != base);
+
+	tree.Write("inc/common.hlsli", "float4 Value() { return 2; }\n");
+	uint64_t edited = cache.HashRequest(request);
+	CHECK(edited != base);
+	tree.Write("main.hlsl", "// comment\n#include \"inc/common.hlsli\"\nfloat4 VS() : SV_Position { return Value(); }\n");
+	CHECK(cache.HashRequest(request) != edited);
+}
+
+TEST(EditedIncludeRecompiles) {
+	ShaderTree tree("photon_shadercache_edit");
+	FakeCompiler compiler;
+	ShaderCache cache(tree.Dir / "cache.bin", compiler.Fn(), "fake 1.0");
+	std::vector<uint8_t> code;
+	cache.GetOrCompile(tree.Request(), code);
+	tree.Write("inc/common.hlsli", "float4 Value() { return 3; }\n");
+	cache.GetOrCompile(tree.Request(), code);
+	CHECK_EQ(compiler.Calls.load(), 2);
+	CHECK_EQ(cache.Stats().Misses, 2u);
+}
+
+TEST(FailuresAreReportedAndNotCached) {
+	ShaderTree tree("photon_shadercache_fail");
+	FakeCompiler compiler;
+	ShaderCache cache(tree.Dir / "cache.bin", compiler.Fn(), "fake 1.0");
+	std::vector<uint8_t> code;
+	std::string errors;
+	CHECK(!cache.GetOrCompile(tree.Request("Broken"), code, &errors));
+	CHECK(errors.find("X3000") != std::string::npos);
+	CHECK(!cache.GetOrCompile(tree.Request("Broken"), code, &errors));
+	CHECK_EQ(compiler.Calls.load(), 2);
+	CHECK_EQ(cache.Stats().Failures, 2u);
+	CHECK_EQ(cache.EntryCount(), 0u);
+}
+
+TEST(SaveLoadRoundTripsAndPrunesUnused) {
+	ShaderTree tree("photon_shadercache_prune");
+	FakeCompiler compiler;
+	fs::path cachePath = tree.Dir / "cache.bin";
+	std::vector<uint8_t> code;
+	{
+		ShaderCache cache(cachePath, compiler.Fn(), "fake 1.0");
+		CHECK(!cache.Load());
+		cache.GetOrCompile(tree.Request("VS"), code);
+		cache.GetOrCompile(tree.Request("PS"), code);
+		CHECK(cache.Save());
+	}
+	{
+		// Second run: only VS is requested, so PS is dropped on save.
+		ShaderCache cache(cachePath, compiler.Fn(), "fake 1.0");
+		CHECK(cache.Load());
+		CHECK_EQ(cache.EntryCount(), 2u);
+		CHECK(cache.GetOrCompile(tree.Request("VS"), code));
+		CHECK_EQ(compiler.Calls.load(), 2);
+		CHECK(cache.Save());
+		CHECK_EQ(cache.EntryCount(), 1u);
+	}
+	{
+		ShaderCache cache(cachePath, compiler.Fn(), "fake 1.0");
+		CHECK(cache.Load());
+		CHECK_EQ(cache.EntryCount(), 1u);
+		cache.GetOrCompile(tree.Request("VS"), code);
+		cache.GetOrCompile(tree.Request("PS"), code);
+		CHECK_EQ(compiler.Calls.load(), 3);
+	}
+	{
+		// A compiler update misses on everything and prunes the old entries.
+		ShaderCache cache(cachePath, compiler.Fn(), "fake 2.0");
+		CHECK(cache.Load());
+		cache.GetOrCompile(tree.Request("VS"), code);
+		CHECK_EQ(cache.Stats().Misses, 1u);
+		CHECK(cache.Save());
+		CHECK_EQ(cache.EntryCount(), 1u);
+	}
+}
+
+TEST(SavingWithoutPruningKeepsUnusedEntries) {
+	ShaderTree tree("photon_shadercache_keep");
+	FakeCompiler compiler;
+	fs::path cachePath = tree.Dir / "cache.bin";
+	std::vector<uint8_t> code;
+	{
+		ShaderCache cache(cachePath, compiler.Fn(), "fake 1.0");
+		cache.GetOrCompile(tree.Request("VS"), code);
+		cache.GetOrCompile(tree.Request("PS"), code);
+		CHECK(cache.Save());
+	}
+	{
+		// A mid-run save keeps PS, which a later frame may still want, and
+		// the new GS; the final save drops PS once it went unrequested.
+		ShaderCache cache(cachePath, compiler.Fn(), "fake 1.0");
+		CHECK(cache.Load());
+		cache.GetOrCompile(tree.Request("VS"), code);
+		CHECK(cache.Save(false));
+		CHECK_EQ(cache.EntryCount(), 2u);
+		cache.GetOrCompile(tree.Request("GS"), code);
+		CHECK(cache.Save(false));
+		CHECK_EQ(cache.EntryCount(), 3u);
+
+		ShaderCache reloaded(cachePath, compiler.Fn(), "fake 1.0");
+		CHECK(reloaded.Load());
+		CHECK_EQ(reloaded.EntryCount(), 3u);
+
+		CHECK(cache.Save());
+		CHECK_EQ(cache.EntryCount(), 2u);
+	}
+	ShaderCache cache(cachePath, compiler.Fn(), "fake 1.0");
+	CHECK(cache.Load());
+	CHECK_EQ(cache.EntryCount(), 2u);
+	cache.GetOrCompile(tree.Request("VS"), code);
+	cache.GetOrCompile(tree.Request("GS"), code);
+	CHECK_EQ(compiler.Calls.load(), 3);
+}
+
+TEST(CorruptFileLoadsEmpty) {
+	ShaderTree tree("photon_shadercache_corrupt");
+	FakeCompiler compiler;
+	fs::path cachePath = tree.Dir / "cache.bin";
+	std::vector<uint8_t> code;
+	{
+		ShaderCache cache(cachePath, compiler.Fn(), "fake 1.0");
+		cache.GetOrCompile(tree.Request(), code);
+		cache.Save();
+	}
+	fs::resize_file(cachePath, fs::file_size(cachePath) - 1);
+	ShaderCache truncated(cachePath, compiler.Fn(), "fake 1.0");
+	CHECK(!truncated.Load());
+	CHECK_EQ(truncated.EntryCount(), 0u);
+
+	tree.Write("cache.bin", "not a cache");
+	ShaderCache garbage(cachePath, compiler.Fn(), "fake 1.0");
+	CHECK(!garbage.Load());
+	CHECK_EQ(garbage.EntryCount(), 0u);
+}
+
+TEST(ConcurrentRequestsAllSucceed) {
+	ShaderTree tree("photon_shadercache_threads");
+	FakeCompiler compiler;
+	ShaderCache cache(tree.Dir / "cache.bin", compiler.Fn(), "fake 1.0");
+	std::atomic<int> failures{ 0 };
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([&]() {
+			std::vector<uint8_t> code;
+			for (const char *entry : { "VS", "PS", "CS", "GS" })
+				for (int i = 0; i < 20; ++i)
+					if (!cache.GetOrCompile(tree.Request(entry), code))
+						++failures;
+		});
+	}
+	for (std::thread &thread : threads)
+		thread.join();
+	CHECK_EQ(failures.load(), 0);
+	CHECK_EQ(cache.EntryCount(), 4u);
+	ShaderCacheStats stats = cache.Stats();
+	CHECK_EQ(stats.Hits + stats.Misses, 4u * 4u * 20u);
+}
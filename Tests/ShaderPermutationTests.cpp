@@ -0,0 +1,219 @@
+#include "ShaderPermutation.h"
+#include "TestHarness.h"
+#include <fstream>
+#include <map>
+
+namespace fs = std::filesystem;
+
+// Bytecode is the request's defines as "NAME=value;" text, so a variant's
+// code shows which options it was built with. Compiles are counted per
+// define set.
+struct FakeCompiler {
+	std::map<std::string, int> Compiles;
+
+	static std::string DefineText(const ShaderCompileRequest &request) {
+		std::string text;
+		for (const auto &[name, value] : request.Defines)
+			text += name + "=" + value + ";";
+		return text;
+	}
+
+	ShaderCompileFn Fn() {
+		return [this](const ShaderCompileRequest &request, std::vector<uint8_t> &byteCode, std::string &errors) {
+			std::string text = DefineText(request);
+			++Compiles[text];
+			if (text.find("QUALITY=BROKEN") != std::string::npos) {
+				errors = "error X3000";
+				return false;
+			}
+			byteCode.assign(text.begin(), text.end());
+			return true;
+		};
+	}
+
+	int TotalCompiles() const {
+		int total = 0;
+		for (const auto &[text, count] : Compiles)
+			total += count;
+		return total;
+	}
+};
+
+// A source file for ShaderCache to hash, and the cache over it.
+struct VariantFixture {
+	fs::path Dir;
+	FakeCompiler Compiler;
+	std::unique_ptr<ShaderCache> Cache;
+	ShaderCompileRequest Base;
+
+	explicit VariantFixture(const char *name) {
+		Dir = fs::temp_directory_path() / name;
+		fs::remove_all(Dir);
+		fs::create_directories(Dir);
+		std::ofstream(Dir / "color.hlsl") << "float4 VS() : SV_Position { return 1; }\n";
+		Cache = std::make_unique<ShaderCache>(Dir / "cache.bin", Compiler.Fn(), "fake 1.0");
+		Base.SourcePath = Dir / "color.hlsl";
+		Base.EntryPoint = "VS";
+		Base.Target = "vs_5_1";
+	}
+	~VariantFixture() { fs::remove_all(Dir); }
+};
+
+static std::string Text(const ShaderVariantCache::ByteCode &code) {
+	return code != nullptr ? std::string(code->begin(), code->end()) : std::string();
+}
+
+// SKINNED: bool, QUALITY: 3 values (2 bits), LIGHTS: 5 values (3 bits), FOG: bool.
+static ShaderPermutationDesc MakeDesc() {
+	ShaderPermutationDesc desc;
+	desc.AddBool("SKINNED");
+	desc.AddEnum("QUALITY", { "LOW", "MEDIUM", "HIGH" });
+	desc.AddEnum("LIGHTS", { "L0", "L1", "L2", "L4", "L8" });
+	desc.AddBool("FOG");
+	return desc;
+}
+
+TEST(OptionsPackIntoConsecutiveBits) {
+	ShaderPermutationDesc desc = MakeDesc();
+	CHECK_EQ(desc.OptionCount(), 4u);
+	CHECK_EQ(desc.KeyBits(), 7u);
+
+	// Each option's largest value lands at its offset, at its width.
+	CHECK_EQ(desc.Set(0, 0, 1), 0x1u);
+	CHECK_EQ(desc.Set(0, 1, 2), 0x2u << 1);
+	CHECK_EQ(desc.Set(0, 2, 4), 0x4u << 3);
+	CHECK_EQ(desc.Set(0, 3, 1), 0x1u << 6);
+
+	// A two-value enum takes one bit, like a bool.
+	ShaderPermutationDesc small;
+	small.AddEnum("MODE", { "A", "B" });
+	CHECK_EQ(small.KeyBits(), 1u);
+}
+
+TEST(SetAndGetRoundTrip) {
+	ShaderPermutationDesc desc = MakeDesc();
+	for (uint32_t skinned = 0; skinned < 2; ++skinned)
+		for (uint32_t quality = 0; quality < 3; ++quality)
+			for (uint32_t lights = 0; lights < 5; ++lights)
+				for (uint32_t fog = 0; fog < 2; ++fog) {
+					uint64_t key = desc.Set(desc.Set(desc.Set(desc.Set(0, 0, skinned), 1, quality), 2, lights), 3, fog);
+					CHECK(desc.IsValid(key));
+					CHECK_EQ(desc.Get(key, 0), skinned);
+					CHECK_EQ(desc.Get(key, 1), quality);
+					CHECK_EQ(desc.Get(key, 2), lights);
+					CHECK_EQ(desc.Get(key, 3), fog);
+				}
+
+	// Setting one option leaves the others alone, in either direction.
+	uint64_t all = desc.Set(desc.Set(desc.Set(desc.Set(0, 0, 1), 1, 2), 2, 4), 3, 1);
+	uint64_t changed = desc.Set(all, 2, 1);
+	CHECK_EQ(desc.Get(changed, 0), 1u);
+	CHECK_EQ(desc.Get(changed, 1), 2u);
+	CHECK_EQ(desc.Get(changed, 2), 1u);
+	CHECK_EQ(desc.Get(changed, 3), 1u);
+}
+
+TEST(OutOfRangeValuesAreRejected) {
+	ShaderPermutationDesc desc = MakeDesc();
+	uint64_t key = desc.Set(0, 1, 1);
+	// QUALITY has 3 values in 2 bits, LIGHTS 5 in 3 bits: the spare encodings
+	// are not values.
+	CHECK_EQ(desc.Set(key, 1, 3), key);
+	CHECK_EQ(desc.Set(key, 2, 5), key);
+	CHECK_EQ(desc.Set(key, 2, 7), key);
+	CHECK_EQ(desc.Set(key, 0, 2), key);
+
+	CHECK(desc.IsValid(key));
+	CHECK(!desc.IsValid(3u << 1));
+	CHECK(!desc.IsValid(6u << 3));
+	CHECK(!desc.IsValid(1u << 7));
+	CHECK(!desc.IsValid(uint64_t(1) << 63));
+}
+
+TEST(DefinesNameEveryOption) {
+	ShaderPermutationDesc desc = MakeDesc();
+	std::vector<std::pair<std::string, std::string>> defines = { { "EXISTING", "1" } };
+	desc.AppendDefines(0, defines);
+	desc.AppendDefines(desc.Set(desc.Set(desc.Set(0, 0, 1), 1, 2), 2, 3), defines);
+
+	std::vector<std::pair<std::string, std::string>> expected = {
+		{ "EXISTING", "1" },
+		{ "SKINNED", "0" }, { "QUALITY", "LOW" }, { "LIGHTS", "L0" }, { "FOG", "0" },
+		{ "SKINNED", "1" }, { "QUALITY", "HIGH" }, { "LIGHTS", "L4" }, { "FOG", "0" },
+	};
+	CHECK(defines == expected);
+}
+
+TEST(EachVariantCompilesOnce) {
+	VariantFixture fixture("photon_permutation_once");
+	ShaderPermutationDesc desc = MakeDesc();
+	ShaderVariantCache variants(&desc, fixture.Base, fixture.Cache.get(), 64);
+
+	uint64_t a = desc.Set(0, 1, 2), b = desc.Set(0, 3, 1);
+	for (int i = 0; i < 10; ++i) {
+		CHECK(Text(variants.Get(a)) == "SKINNED=0;QUALITY=HIGH;LIGHTS=L0;FOG=0;");
+		CHECK(Text(variants.Get(b)) == "SKINNED=0;QUALITY=LOW;LIGHTS=L0;FOG=1;");
+	}
+	CHECK_EQ(fixture.Compiler.TotalCompiles(), 2);
+	CHECK_EQ(variants.Stats().Misses, 2u);
+	CHECK_EQ(variants.Stats().Hits, 18u);
+	CHECK_EQ(variants.Size(), 2u);
+	// The same bytecode object comes back on a hit.
+	CHECK(variants.Get(a) == variants.Get(a));
+
+	// Invalid keys never reach the compiler; failed compiles are not kept.
+	std::string errors;
+	CHECK(variants.Get(3u << 1, &errors) == nullptr);
+	CHECK(errors == "invalid variant key 6");
+	CHECK_EQ(fixture.Compiler.TotalCompiles(), 2);
+
+	ShaderPermutationDesc broken;
+	broken.AddEnum("QUALITY", { "LOW", "BROKEN" });
+	ShaderVariantCache failing(&broken, fixture.Base, fixture.Cache.get(), 4);
+	CHECK(failing.Get(1, &errors) == nullptr);
+	CHECK(errors == "error X3000");
+	CHECK_EQ(failing.Stats().Failures, 1u);
+	CHECK_EQ(failing.Size(), 0u);
+}
+
+TEST(LeastRecentlyUsedVariantsAreEvicted) {
+	VariantFixture fixture("photon_permutation_lru");
+	ShaderPermutationDesc desc = MakeDesc();
+	ShaderVariantCache variants(&desc, fixture.Base, fixture.Cache.get(), 3);
+
+	uint64_t keys[5];
+	for (uint32_t i = 0; i < 5; ++i)
+		keys[i] = desc.Set(0, 2, i);
+
+	// 0, 1, 2 fill the cache; touching 0 makes 1 the oldest, so 3 evicts 1
+	// and 4 evicts 2.
+	ShaderVariantCache::ByteCode held = variants.Get(keys[1]);
+	variants.Get(keys[0]);
+	variants.Get(keys[2]);
+	variants.Get(keys[0]);
+	variants.Get(keys[3]);
+	CHECK_EQ(variants.Stats().Evictions, 1u);
+	variants.Get(keys[4]);
+	CHECK_EQ(variants.Stats().Evictions, 2u);
+	CHECK_EQ(variants.Size(), 3u);
+
+	// 0, 3 and 4 are resident; 1 and 2 miss again.
+	uint32_t misses = variants.Stats().Misses;
+	variants.Get(keys[0]);
+	variants.Get(keys[3]);
+	variants.Get(keys[4]);
+	CHECK_EQ(variants.Stats().Misses, misses);
+	variants.Get(keys[1]);
+	CHECK_EQ(variants.Stats().Misses, misses + 1);
+	// Inserting 1 evicted 0, the oldest of the three.
+	variants.Get(keys[0]);
+	CHECK_EQ(variants.Stats().Misses, misses + 2);
+	CHECK_EQ(variants.Stats().Evictions, 4u);
+
+	// Evicted variants are still in the ShaderCache, so none compiled twice,
+	// and bytecode held by a caller outlives eviction.
+	CHECK_EQ(fixture.Compiler.TotalCompiles(), 5);
+	for (const auto &[text, count] : fixture.Compiler.Compiles)
+		CHECK_EQ(count, 1);
+	CHECK(Text(held) == "SKINNED=0;QUALITY=LOW;LIGHTS=L1;FOG=0;");
+}
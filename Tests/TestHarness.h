@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+// Minimal self-registering test runner for the headless test executables.
+// Each test file defines TEST(Name) { ... } blocks and includes this header
+// once; the executable returns non-zero if any CHECK failed.
+
+struct TestCase {
+	const char *Name;
+	std::function<void()> Body;
+};
+
+inline std::vector<TestCase> &TestRegistry() {
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+inline int &TestFailures() {
+	static int failures = 0;
+	return failures;
+}
+
+struct TestRegistrar {
+	TestRegistrar(const char *name, std::function<void()> body) { TestRegistry().push_back({ name, std::move(body) }); }
+};
+
+#define TEST(name)                                                \
+	static void name();                                           \
+	static TestRegistrar name##Registrar(#name, name);            \
+	static void name()
+
+#define CHECK(condition)                                                              \
+	do {                                                                              \
+		if (!(condition)) {                                                           \
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			++TestFailures();                                                         \
+		}                                                                             \
+	} while (0)
+
+#define CHECK_EQ(a, b)                                                                       \
+	do {                                                                                     \
+		auto checkA = (a);                                                                   \
+		auto checkB = (b);                                                                   \
+		if (!(checkA == checkB)) {                                                           \
+			std::fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld vs %lld\n", __FILE__, __LINE__, #a, #b, \
+					static_cast<long long>(checkA), static_cast<long long>(checkB));         \
+			++TestFailures();                                                                \
+		}                                                                                    \
+	} while (0)
+
+#define CHECK_NEAR(a, b, tolerance)                                                             \
+	do {                                                                                        \
+		double checkA = (a);                                                                    \
+		double checkB = (b);                                                                    \
+		if (!(std::fabs(checkA - checkB) <= (tolerance))) {                                     \
+			std::fprintf(stderr, "%s:%d: CHECK_NEAR(%s, %s) failed: %g vs %g\n", __FILE__, __LINE__, #a, #b, \
+					checkA, checkB);                                                            \
+			++TestFailures();                                                                   \
+		}                                                                                       \
+	} while (0)
+
+int main() {
+	for (const TestCase &test : TestRegistry()) {
+		int before = TestFailures();
+		test.Body();
+		std::printf("%s %s\n", TestFailures() == before ? "[ ok ]" : "[FAIL]", test.Name);
+	}
+	std::printf("%zu tests, %d failed checks\n", TestRegistry().size(), TestFailures());
+	return TestFailures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+#include "TestHarness.h"
+#include "TransformBatch.h"
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Paths the running CPU can execute; scalar always works.
+static std::vector<SimdPath> SupportedPaths() {
+	std::vector<SimdPath> paths = { SimdPath::Scalar };
+	SimdPath best = DetectSimdPath();
+	if (best == SimdPath::SSE2 || best == SimdPath::AVX2)
+		paths.push_back(SimdPath::SSE2);
+	if (best == SimdPath::AVX2)
+		paths.push_back(SimdPath::AVX2);
+	return paths;
+}
+
+static std::vector<Float4x4> RandomWorlds(uint32_t count) {
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> dist(-10.0f, 10.0f);
+	std::vector<Float4x4> worlds(count);
+	for (Float4x4 &world : worlds)
+		for (int r = 0; r < 4; ++r)
+			for (int c = 0; c < 4; ++c)
+				world.m[r][c] = dist(rng);
+	return worlds;
+}
+
+static Float4x4 Multiply(const Float4x4 &a, const Float4x4 &b) {
+	Float4x4 result;
+	for (int r = 0; r < 4; ++r)
+		for (int c = 0; c < 4; ++c) {
+			float sum = 0.0f;
+			for (int k = 0; k < 4; ++k)
+				sum += a.m[r][k] * b.m[k][c];
+			result.m[r][c] = sum;
+		}
+	return result;
+}
+
+static Float4x4 ReadMatrix(const uint8_t *src) {
+	Float4x4 m;
+	memcpy(&m, src, sizeof(m));
+	return m;
+}
+
+// An odd stride and offsets so stores are unaligned, with padding around both
+// matrices to catch writes outside them.
+static TransformStreamLayout OddLayout() {
+	TransformStreamLayout layout;
+	layout.Stride = 4 + 64 + 12 + 64 + 4;
+	layout.WorldViewProjOffset = 4;
+	layout.WorldOffset = 4 + 64 + 12;
+	return layout;
+}
+
+TEST(WorldViewProjMatchesReferenceOnEveryPath) {
+	const uint32_t Count = 37;
+	std::vector<Float4x4> worlds = RandomWorlds(Count);
+	Float4x4 viewProj = RandomWorlds(1)[0];
+	TransformStreamLayout layout = OddLayout();
+
+	for (SimdPath path : SupportedPaths()) {
+		std::vector<uint8_t> out(Count * layout.Stride, 0xCD);
+		BatchWorldViewProj(worlds.data(), Count, viewProj, out.data(), layout, path);
+		for (uint32_t i = 0; i < Count; ++i) {
+			const uint8_t *element = out.data() + i * layout.Stride;
+			Float4x4 expected = Multiply(worlds[i], viewProj);
+			Float4x4 wvp = ReadMatrix(element + layout.WorldViewProjOffset);
+			Float4x4 world = ReadMatrix(element + layout.WorldOffset);
+			for (int r = 0; r < 4; ++r)
+				for (int c = 0; c < 4; ++c) {
+					// FMA rounds once per step, so allow a few ulps of the magnitude.
+					CHECK_NEAR(wvp.m[c][r], expected.m[r][c], 1e-3f);
+					CHECK_NEAR(world.m[c][r], worlds[i].m[r][c], 0.0f);
+				}
+			for (size_t b : { size_t(0), size_t(1), size_t(2), size_t(3), size_t(68), size_t(79), size_t(144),
+						 size_t(147) })
+				CHECK_EQ(element[b], 0xCD);
+		}
+	}
+}
+
+TEST(PathsAgreeWithScalar) {
+	const uint32_t Count = 1000;
+	std::vector<Float4x4> worlds = RandomWorlds(Count);
+	Float4x4 viewProj = RandomWorlds(2)[1];
+	TransformStreamLayout layout;
+	layout.Stride = 2 * sizeof(Float4x4);
+	layout.WorldViewProjOffset = 0;
+	layout.WorldOffset = sizeof(Float4x4);
+
+	std::vector<uint8_t> reference(Count * layout.Stride);
+	BatchWorldViewProj(worlds.data(), Count, viewProj, reference.data(), layout, SimdPath::Scalar);
+	for (SimdPath path : SupportedPaths()) {
+		std::vector<uint8_t> out(Count * layout.Stride);
+		BatchWorldViewProj(worlds.data(), Count, viewProj, out.data(), layout, path);
+		const float *a = reinterpret_cast<const float *>(reference.data());
+		const float *b = reinterpret_cast<const float *>(out.data());
+		float worst = 0.0f;
+		for (size_t f = 0; f < out.size() / sizeof(float); ++f) {
+			float diff = a[f] > b[f] ? a[f] - b[f] : b[f] - a[f];
+			worst = diff > worst ? diff : worst;
+		}
+		CHECK(worst < 1e-3f);
+	}
+}
+
+TEST(TransposeWorldsIsExactOnEveryPath) {
+	const uint32_t Count = 19;
+	std::vector<Float4x4> worlds = RandomWorlds(Count);
+	TransformStreamLayout layout = OddLayout();
+
+	for (SimdPath path : SupportedPaths()) {
+		std::vector<uint8_t> out(Count * layout.Stride, 0xCD);
+		BatchTransposeWorlds(worlds.data(), Count, out.data(), layout, path);
+		for (uint32_t i = 0; i < Count; ++i) {
+			const uint8_t *element = out.data() + i * layout.Stride;
+			Float4x4 world = ReadMatrix(element + layout.WorldOffset);
+			for (int r = 0; r < 4; ++r)
+				for (int c = 0; c < 4; ++c)
+					CHECK_NEAR(world.m[c][r], worlds[i].m[r][c], 0.0f);
+			// The view-projection slot is left alone.
+			CHECK_EQ(element[layout.WorldViewProjOffset], 0xCD);
+			CHECK_EQ(element[layout.WorldViewProjOffset + 63], 0xCD);
+		}
+	}
+}
+
+TEST(ZeroCountWritesNothing) {
+	TransformStreamLayout layout = OddLayout();
+	uint8_t out[148];
+	memset(out, 0xCD, sizeof(out));
+	for (SimdPath path : SupportedPaths()) {
+		BatchWorldViewProj(nullptr, 0, Float4x4(), out, layout, path);
+		BatchTransposeWorlds(nullptr, 0, out, layout, path);
+	}
+	for (uint8_t b : out)
+		CHECK_EQ(b, 0xCD);
+}
@@ -0,0 +1,161 @@
+#include "TestHarness.h"
+#include "TransientAllocator.h"
+#include <random>
+
+static const uint64_t MiB = 1024 * 1024;
+
+static bool Alive(const TransientAllocationRequest &r, uint32_t pass) {
+	return r.FirstPass <= pass && pass <= r.LastPass;
+}
+
+// Largest sum of sizes alive in one pass: no packing can beat it.
+static uint64_t PeakLiveBytes(const std::vector<TransientAllocationRequest> &requests) {
+	uint32_t passes = 0;
+	for (const TransientAllocationRequest &r : requests)
+		passes = r.LastPass + 1 > passes ? r.LastPass + 1 : passes;
+	uint64_t peak = 0;
+	for (uint32_t pass = 0; pass < passes; ++pass) {
+		uint64_t live = 0;
+		for (const TransientAllocationRequest &r : requests)
+			live += Alive(r, pass) ? r.ByteSize : 0;
+		peak = live > peak ? live : peak;
+	}
+	return peak;
+}
+
+// Aligned, in the heap, and no memory shared between requests that are
+// alive at the same time.
+static bool IsValidPacking(const std::vector<TransientAllocationRequest> &requests,
+		const TransientAllocationResult &result) {
+	if (result.Offsets.size() != requests.size())
+		return false;
+	for (size_t a = 0; a < requests.size(); ++a) {
+		const TransientAllocationRequest &ra = requests[a];
+		if (result.Offsets[a] % ra.Alignment != 0 || result.Offsets[a] + ra.ByteSize > result.HeapSize)
+			return false;
+		for (size_t b = a + 1; b < requests.size(); ++b) {
+			const TransientAllocationRequest &rb = requests[b];
+			bool together = ra.FirstPass <= rb.LastPass && rb.FirstPass <= ra.LastPass;
+			bool shared = result.Offsets[a] < result.Offsets[b] + rb.ByteSize &&
+					result.Offsets[b] < result.Offsets[a] + ra.ByteSize;
+			if (together && shared)
+				return false;
+		}
+	}
+	return result.HeapSize <= result.CommittedSize;
+}
+
+static TransientAllocationRequest Texture(uint64_t bytes, uint32_t first, uint32_t last) {
+	TransientAllocationRequest request;
+	request.ByteSize = bytes;
+	request.FirstPass = first;
+	request.LastPass = last;
+	return request;
+}
+
+TEST(EmptyTraceNeedsNoHeap) {
+	TransientAllocationResult result;
+	PackTransientAllocations({}, result);
+	CHECK_EQ(result.HeapSize, 0u);
+	CHECK_EQ(result.CommittedSize, 0u);
+	CHECK(result.Offsets.empty());
+}
+
+TEST(DisjointLifetimesShareMemory) {
+	std::vector<TransientAllocationRequest> requests = {
+		Texture(8 * MiB, 0, 1),
+		Texture(8 * MiB, 2, 3),
+		Texture(8 * MiB, 4, 5),
+	};
+	TransientAllocationResult result;
+	PackTransientAllocations(requests, result);
+	CHECK(IsValidPacking(requests, result));
+	CHECK_EQ(result.HeapSize, 8 * MiB);
+	CHECK_EQ(result.CommittedSize, 24 * MiB);
+	for (uint64_t offset : result.Offsets)
+		CHECK_EQ(offset, 0u);
+}
+
+TEST(OverlappingLifetimesDoNot) {
+	// Lifetimes are inclusive: passes 0-2 and 2-4 are both alive in pass 2.
+	std::vector<TransientAllocationRequest> requests = {
+		Texture(4 * MiB, 0, 2),
+		Texture(4 * MiB, 2, 4),
+		Texture(4 * MiB, 1, 3),
+	};
+	TransientAllocationResult result;
+	PackTransientAllocations(requests, result);
+	CHECK(IsValidPacking(requests, result));
+	CHECK_EQ(result.HeapSize, result.CommittedSize);
+}
+
+TEST(PingPongChainNeedsTwoSlots) {
+	// Each blur pass reads the previous target and writes the next.
+	std::vector<TransientAllocationRequest> requests;
+	for (uint32_t i = 0; i < 8; ++i)
+		requests.push_back(Texture(2 * MiB, i, i + 1));
+	TransientAllocationResult result;
+	PackTransientAllocations(requests, result);
+	CHECK(IsValidPacking(requests, result));
+	CHECK_EQ(result.HeapSize, 4 * MiB);
+}
+
+TEST(OffsetsRespectAlignment) {
+	std::vector<TransientAllocationRequest> requests = {
+		Texture(65536 + 1, 0, 1),
+		Texture(100, 0, 1),
+	};
+	requests[1].Alignment = 4 * MiB;
+	TransientAllocationResult result;
+	PackTransientAllocations(requests, result);
+	CHECK(IsValidPacking(requests, result));
+	CHECK_EQ(result.Offsets[0], 0u);
+	CHECK_EQ(result.Offsets[1], 4 * MiB);
+	// Committed allocations are rounded up to their alignment too.
+	CHECK_EQ(result.CommittedSize, 131072u + 4 * MiB);
+}
+
+TEST(DeferredFrameTrace) {
+	// 1080p deferred frame: G-buffer, depth, SSAO at half resolution, HDR
+	// lighting, a bloom chain and the tonemapped result.
+	const uint64_t Rgba8 = 1920 * 1080 * 4, Rgba16f = 1920 * 1080 * 8;
+	enum { GBuffer, Ssao, SsaoBlur, Lighting, BloomDown, BloomUp, Tonemap, Ui };
+	std::vector<TransientAllocationRequest> requests = {
+		Texture(Rgba8, GBuffer, Lighting),            // albedo
+		Texture(Rgba8, GBuffer, Lighting),            // normals
+		Texture(Rgba8, GBuffer, Lighting),            // material
+		Texture(Rgba8, GBuffer, Lighting),            // depth
+		Texture(Rgba8 / 4, Ssao, SsaoBlur),           // raw AO
+		Texture(Rgba8 / 4, SsaoBlur, Lighting),       // blurred AO
+		Texture(Rgba16f, Lighting, Tonemap),          // HDR scene
+		Texture(Rgba16f / 4, BloomDown, BloomUp),     // bloom mip 1
+		Texture(Rgba16f / 16, BloomDown, BloomUp),    // bloom mip 2
+		Texture(Rgba16f / 4, BloomUp, Tonemap),       // bloom result
+		Texture(Rgba8, Tonemap, Ui),                  // LDR output
+	};
+	TransientAllocationResult result;
+	PackTransientAllocations(requests, result);
+	CHECK(IsValidPacking(requests, result));
+	CHECK(result.HeapSize >= PeakLiveBytes(requests));
+	// The G-buffer is dead by the time bloom and tonemapping run.
+	CHECK(result.HeapSize < result.CommittedSize * 3 / 4);
+}
+
+TEST(RandomTracesPackValidly) {
+	std::mt19937 rng(53);
+	for (int trace = 0; trace < 200; ++trace) {
+		std::vector<TransientAllocationRequest> requests(1 + rng() % 40);
+		for (TransientAllocationRequest &request : requests) {
+			request.FirstPass = rng() % 20;
+			request.LastPass = request.FirstPass + rng() % 6;
+			request.ByteSize = 1 + rng() % (16 * MiB);
+			request.Alignment = rng() % 4 == 0 ? 4 * MiB : 65536;
+		}
+		TransientAllocationResult result;
+		PackTransientAllocations(requests, result);
+		if (!IsValidPacking(requests, result) || result.HeapSize < PeakLiveBytes(requests)) {
+			CHECK(false);
+			break;
+		}
+	}
+}
@@ -0,0 +1,205 @@
+#include "TestHarness.h"
+#include "UploadQueue.h"
+#include <cstring>
+#include <vector>
+
+// The fake fence only completes when retired or waited on, so batches stay
+// in flight until the test lets the "GPU" catch up.
+struct UploadFixture {
+	MallocPageProvider Pages;
+	FakeFence Fence;
+	NullUploadCopyQueue CopyQueue{ &Fence };
+};
+
+static UploadQueueDesc SmallDesc(uint64_t stagingBytes, uint64_t batchBytes, uint32_t batchCopies) {
+	UploadQueueDesc desc;
+	desc.StagingByteSize = stagingBytes;
+	desc.MaxBatchBytes = batchBytes;
+	desc.MaxBatchCopies = batchCopies;
+	return desc;
+}
+
+static const uint8_t *StagedBytes(const UploadCopy &copy) {
+	return static_cast<const uint8_t *>(copy.Source) + copy.SourceOffset;
+}
+
+TEST(BatchesCloseAtTheCopyLimit) {
+	UploadFixture f;
+	UploadQueue uploads(&f.Pages, &f.CopyQueue, &f.Fence, SmallDesc(1 << 16, 1 << 16, 4));
+	int destination = 0;
+	uint32_t data[10];
+	std::vector<uint64_t> ready;
+	for (uint32_t i = 0; i < 10; ++i) {
+		data[i] = 0x1000 + i;
+		ready.push_back(uploads.UploadBuffer(&destination, i * 4, &data[i], 4));
+	}
+	CHECK_EQ(f.CopyQueue.Batches, 2u);
+	CHECK_EQ(uploads.PendingFenceValue(), 3u);
+	CHECK_EQ(uploads.Flush(), 3u);
+	CHECK_EQ(f.CopyQueue.Batches, 3u);
+	CHECK_EQ(uploads.Flush(), 3u);
+	CHECK_EQ(f.CopyQueue.Batches, 3u);
+
+	// Each upload is ready at its own batch's fence value.
+	for (uint32_t i = 0; i < 10; ++i)
+		CHECK_EQ(ready[i], uint64_t(1 + i / 4));
+
+	// Copies arrive in order, with the data staged where they point.
+	CHECK_EQ(f.CopyQueue.Copies.size(), 10u);
+	for (uint32_t i = 0; i < 10; ++i) {
+		const UploadCopy &copy = f.CopyQueue.Copies[i];
+		CHECK(copy.Destination == &destination);
+		CHECK_EQ(copy.DestinationOffset, uint64_t(i * 4));
+		CHECK_EQ(copy.SourceOffset % UploadQueue::BufferAlignment, 0u);
+		uint32_t staged;
+		memcpy(&staged, StagedBytes(copy), 4);
+		CHECK_EQ(staged, data[i]);
+	}
+	f.Fence.RetireAll();
+}
+
+TEST(BatchesCloseAtTheByteLimit) {
+	UploadFixture f;
+	UploadQueue uploads(&f.Pages, &f.CopyQueue, &f.Fence, SmallDesc(1 << 16, 1024, 256));
+	int destination = 0;
+	std::vector<uint8_t> data(300, 7);
+	for (int i = 0; i < 3; ++i)
+		uploads.UploadBuffer(&destination, 0, data.data(), data.size());
+	CHECK_EQ(f.CopyQueue.Batches, 0u);
+	uploads.UploadBuffer(&destination, 0, data.data(), data.size());
+	CHECK_EQ(f.CopyQueue.Batches, 1u);
+	CHECK_EQ(uploads.Stats().BytesUploaded, 1200u);
+	f.Fence.RetireAll();
+}
+
+TEST(NoStallsWhileTheGpuKeepsUp) {
+	UploadFixture f;
+	UploadQueue uploads(&f.Pages, &f.CopyQueue, &f.Fence, SmallDesc(1024, 1 << 16, 1));
+	int destination = 0;
+	std::vector<uint8_t> data(400, 1);
+	for (int i = 0; i < 20; ++i) {
+		uploads.UploadBuffer(&destination, 0, data.data(), data.size());
+		f.Fence.RetireAll();
+	}
+	CHECK_EQ(uploads.Stats().Stalls, 0u);
+	CHECK_EQ(f.Fence.WaitCount(), 0u);
+	CHECK_EQ(uploads.Stats().Batches, 20u);
+}
+
+TEST(FullStagingStallsOnTheOldestBatch) {
+	UploadFixture f;
+	UploadQueue uploads(&f.Pages, &f.CopyQueue, &f.Fence, SmallDesc(1024, 1 << 16, 1));
+	int destination = 0;
+	std::vector<uint8_t> a(400, 0xaa), b(400, 0xbb), c(400, 0xcc);
+
+	uploads.UploadBuffer(&destination, 0, a.data(), a.size());
+	uploads.UploadBuffer(&destination, 0, b.data(), b.size());
+	CHECK_EQ(uploads.BatchesInFlight(), 2u);
+	CHECK_EQ(uploads.Stats().Stalls, 0u);
+
+	// 224 bytes left at the end, so c wraps to the start, which batch 1 still
+	// owns: the queue waits for batch 1 and only batch 1.
+	uploads.UploadBuffer(&destination, 0, c.data(), c.size());
+	CHECK_EQ(uploads.Stats().Stalls, 1u);
+	CHECK_EQ(f.Fence.WaitCount(), 1u);
+	CHECK_EQ(f.Fence.CompletedValue(), 1u);
+	CHECK_EQ(f.CopyQueue.Copies[2].SourceOffset, 0u);
+
+	// Batch 2's staging memory was left alone.
+	CHECK(StagedBytes(f.CopyQueue.Copies[1])[0] == 0xbb);
+	CHECK(StagedBytes(f.CopyQueue.Copies[1])[399] == 0xbb);
+	CHECK(StagedBytes(f.CopyQueue.Copies[2])[0] == 0xcc);
+	CHECK(uploads.StagingUsed() <= uploads.StagingCapacity());
+	CHECK(uploads.Stats().StagingHighWaterMark <= 1024u);
+	f.Fence.RetireAll();
+}
+
+TEST(StallFlushesTheOpenBatchFirst) {
+	// Nothing in flight yet, so the only way to free staging memory is to
+	// submit the open batch and wait for it.
+	UploadFixture f;
+	UploadQueue uploads(&f.Pages, &f.CopyQueue, &f.Fence, SmallDesc(1024, 1 << 16, 256));
+	int destination = 0;
+	std::vector<uint8_t> data(400, 3);
+	uint64_t first = uploads.UploadBuffer(&destination, 0, data.data(), data.size());
+	uploads.UploadBuffer(&destination, 0, data.data(), data.size());
+	CHECK_EQ(f.CopyQueue.Batches, 0u);
+	uint64_t third = uploads.UploadBuffer(&destination, 0, data.data(), data.size());
+	CHECK_EQ(f.CopyQueue.Batches, 1u);
+	CHECK_EQ(uploads.Stats().Stalls, 1u);
+	CHECK_EQ(first, 1u);
+	CHECK_EQ(third, 2u);
+	f.Fence.RetireAll();
+}
+
+TEST(OversizedUploadsGetTheirOwnPage) {
+	UploadFixture f;
+	UploadQueue uploads(&f.Pages, &f.CopyQueue, &f.Fence, SmallDesc(1024, 1 << 16, 256));
+	int destination = 0;
+	std::vector<uint8_t> data(5000, 9);
+	uploads.UploadBuffer(&destination, 0, data.data(), data.size());
+	CHECK_EQ(uploads.Stats().DedicatedPages, 1u);
+	CHECK_EQ(uploads.StagingUsed(), 0u);
+	uint64_t ready = uploads.Flush();
+	// The page belongs to the batch and is released when it retires.
+	CHECK(StagedBytes(f.CopyQueue.Copies[0])[4999] == 9);
+	uploads.Wait(ready);
+	CHECK_EQ(uploads.BatchesInFlight(), 0u);
+	CHECK_EQ(uploads.Stats().Stalls, 0u);
+}
+
+TEST(TextureRowsArePitchedAndAligned) {
+	UploadFixture f;
+	UploadQueue uploads(&f.Pages, &f.CopyQueue, &f.Fence, SmallDesc(1 << 16, 1 << 16, 256));
+	int destination = 0;
+	// Two 3x2 RGBA8 subresources; the staging pitch is 256.
+	uint8_t pixels[2][2][12];
+	for (int s = 0; s < 2; ++s)
+		for (int row = 0; row < 2; ++row)
+			for (int i = 0; i < 12; ++i)
+				pixels[s][row][i] = uint8_t(s * 100 + row * 20 + i);
+	UploadTextureFootprint footprints[2];
+	UploadSubresourceData data[2];
+	for (uint32_t s = 0; s < 2; ++s) {
+		footprints[s].Subresource = s;
+		footprints[s].Width = 3;
+		footprints[s].Height = 2;
+		footprints[s].RowPitch = 256;
+		footprints[s].RowCount = 2;
+		footprints[s].RowSizeInBytes = 12;
+		data[s].Data = pixels[s];
+		data[s].RowPitch = 12;
+		data[s].SlicePitch = 24;
+	}
+	uploads.UploadTexture(&destination, footprints, data, 2);
+	uploads.Wait(uploads.Flush());
+
+	CHECK_EQ(f.CopyQueue.Copies.size(), 2u);
+	for (uint32_t s = 0; s < 2; ++s) {
+		const UploadCopy &copy = f.CopyQueue.Copies[s];
+		CHECK(copy.Type == UploadCopy::Texture);
+		CHECK_EQ(copy.SourceOffset % UploadQueue::TextureAlignment, 0u);
+		CHECK_EQ(copy.Footprint.Subresource, s);
+		for (int row = 0; row < 2; ++row)
+			CHECK(memcmp(StagedBytes(copy) + row * 256, pixels[s][row], 12) == 0);
+	}
+}
+
+TEST(WaitSubmitsAnOpenValueAndDestructionDrains) {
+	UploadFixture f;
+	uint64_t ready;
+	{
+		UploadQueue uploads(&f.Pages, &f.CopyQueue, &f.Fence, SmallDesc(1024, 1 << 16, 256));
+		int destination = 0, value = 5;
+		ready = uploads.UploadBuffer(&destination, 0, &value, sizeof(value));
+		CHECK(!uploads.IsComplete(ready));
+		uploads.Wait(ready);
+		CHECK(uploads.IsComplete(ready));
+		CHECK_EQ(uploads.BatchesInFlight(), 0u);
+
+		uploads.UploadBuffer(&destination, 0, &value, sizeof(value));
+		uploads.Flush();
+		CHECK_EQ(uploads.BatchesInFlight(), 1u);
+	}
+	CHECK_EQ(f.Fence.CompletedValue(), ready + 1);
+}
@@ -0,0 +1,273 @@
+#include "TestHarness.h"
+#include "VertexInputLayout.h"
+#include "VertexPacking.h"
+#include <array>
+#include <cstring>
+
+// VertexInputLayout.cpp builds against Tests/Stubs/d3d12.h here, so the input
+// layout checked below is the one the renderer creates its pipeline with.
+
+static const uint32_t AllAttributes =
+		MeshAttributePosition | MeshAttributeNormal | MeshAttributeTexCoord | MeshAttributeColor | MeshAttributeTangent;
+
+// GameApp's Vertex: float3 position and float4 color.
+static const uint32_t BoxAttributes = MeshAttributePosition | MeshAttributeColor;
+static const uint32_t BoxVertexSize = 28;
+
+// A UV sphere per subset, each with its own center and radius, with every
+// attribute set from the sphere's parametrization.
+struct Sphere {
+	float Center[3];
+	float Radius;
+};
+
+static MeshData MakeSpheres(std::initializer_list<Sphere> spheres, uint32_t attributes = AllAttributes) {
+	const uint32_t Rings = 24, Segments = 48;
+	const float Pi = 3.14159265358979f;
+	MeshData mesh;
+	mesh.Attributes = attributes;
+	mesh.VertexStride = MeshVertexStride(attributes);
+	std::vector<uint32_t> indices;
+	for (const Sphere &sphere : spheres) {
+		MeshSubset subset;
+		subset.StartIndex = static_cast<uint32_t>(indices.size());
+		subset.BaseVertex = static_cast<int32_t>(mesh.VertexCount);
+		for (uint32_t r = 0; r <= Rings; ++r) {
+			for (uint32_t s = 0; s <= Segments; ++s) {
+				float theta = Pi * float(r) / Rings, phi = 2.0f * Pi * float(s) / Segments;
+				float n[3] = { sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi) };
+				float values[16] = {};
+				float *out = values;
+				for (int c = 0; c < 3; ++c)
+					*out++ = sphere.Center[c] + sphere.Radius * n[c];
+				if (attributes & MeshAttributeNormal)
+					for (int c = 0; c < 3; ++c)
+						*out++ = n[c];
+				if (attributes & MeshAttributeTexCoord) {
+					*out++ = float(s) / Segments;
+					*out++ = float(r) / Rings;
+				}
+				if (attributes & MeshAttributeColor) {
+					*out++ = 0.5f + 0.5f * n[0];
+					*out++ = 0.5f + 0.5f * n[1];
+					*out++ = 0.5f + 0.5f * n[2];
+					*out++ = float(s) / Segments;
+				}
+				if (attributes & MeshAttributeTangent) {
+					*out++ = -sinf(phi);
+					*out++ = 0.0f;
+					*out++ = cosf(phi);
+					*out++ = s % 2 == 0 ? 1.0f : -1.0f;
+				}
+				size_t offset = mesh.Vertices.size();
+				mesh.Vertices.resize(offset + mesh.VertexStride);
+				memcpy(mesh.Vertices.data() + offset, values, mesh.VertexStride);
+				++mesh.VertexCount;
+			}
+		}
+		for (uint32_t r = 0; r < Rings; ++r) {
+			for (uint32_t s = 0; s < Segments; ++s) {
+				uint32_t a = r * (Segments + 1) + s, b = a + Segments + 1;
+				for (uint32_t i : { a, b, a + 1, a + 1, b, b + 1 })
+					indices.push_back(i);
+			}
+		}
+		subset.IndexCount = static_cast<uint32_t>(indices.size()) - subset.StartIndex;
+		for (int c = 0; c < 3; ++c) {
+			subset.BoundsMin[c] = sphere.Center[c] - sphere.Radius;
+			subset.BoundsMax[c] = sphere.Center[c] + sphere.Radius;
+		}
+		mesh.Subsets.push_back(subset);
+	}
+	mesh.IndexCount = static_cast<uint32_t>(indices.size());
+	mesh.Indices.resize(indices.size() * sizeof(uint32_t));
+	memcpy(mesh.Indices.data(), indices.data(), mesh.Indices.size());
+	return mesh;
+}
+
+static uint32_t PackedIndex(const PackedMesh &packed, uint32_t i) {
+	if (packed.IndexByteSize == 2) {
+		uint16_t index;
+		memcpy(&index, packed.Indices.data() + size_t(i) * 2, sizeof(index));
+		return index;
+	}
+	uint32_t index;
+	memcpy(&index, packed.Indices.data() + size_t(i) * 4, sizeof(index));
+	return index;
+}
+
+TEST(PositionsAreWithinHalfAStepOfTheirSubsetBounds) {
+	// A tiny subset far from the origin next to a large one: each is quantized
+	// to its own bounds, so the small one keeps its precision.
+	MeshData mesh = MakeSpheres({ { { 1000.0f, -3.0f, 7.0f }, 0.05f }, { { 0.0f, 0.0f, 0.0f }, 300.0f } });
+	PackedMesh packed;
+	PackMesh(mesh, packed);
+	uint32_t positionOffset = packed.Layout.Find(MeshAttributePosition)->Offset;
+
+	for (size_t s = 0; s < mesh.Subsets.size(); ++s) {
+		const MeshSubset &source = mesh.Subsets[s], &subset = packed.Subsets[s];
+		const PackedSubset &quantization = packed.Quantization[s];
+		double worstSteps = 0.0;
+		for (uint32_t i = subset.StartIndex; i < subset.StartIndex + subset.IndexCount; ++i) {
+			float original[3];
+			memcpy(original,
+					mesh.Vertices.data() + size_t(mesh.Index(i) + source.BaseVertex) * mesh.VertexStride, sizeof(original));
+			uint16_t q[4];
+			memcpy(q, packed.Vertices.data() + size_t(PackedIndex(packed, i) + subset.BaseVertex) * packed.Layout.Stride +
+					positionOffset, sizeof(q));
+			for (int c = 0; c < 3; ++c) {
+				// Error in 16-bit steps of this subset's extent on this axis.
+				double step = quantization.PositionScale[c] / 65535.0;
+				double decoded = quantization.PositionOffset[c] + q[c] / 65535.0 * quantization.PositionScale[c];
+				worstSteps = fmax(worstSteps, fabs(decoded - original[c]) / step);
+			}
+		}
+		// Half a step, plus the float rounding of the source positions.
+		CHECK(worstSteps <= 0.5 + 0.02);
+		CHECK(worstSteps > 0.4);
+	}
+
+	// MeasurePackingError agrees: the small subset is accurate to micrometres
+	// at 1000 units from the origin, the large one to a few millimetres.
+	VertexPackingError error = MeasurePackingError(mesh, packed);
+	double largeBound = 0.5 * 600.0 / 65535.0 * sqrt(3.0);
+	CHECK(error.Position.Max <= largeBound * 1.01);
+	MeshData small = MakeSpheres({ { { 1000.0f, -3.0f, 7.0f }, 0.05f } });
+	PackMesh(small, packed);
+	CHECK(MeasurePackingError(small, packed).Position.Max < 2e-5);
+}
+
+TEST(OctahedralNormalsStayWithinAFixedAngle) {
+	MeshData mesh = MakeSpheres({ { { 0.0f, 0.0f, 0.0f }, 1.0f } });
+	PackedMesh packed;
+	PackMesh(mesh, packed);
+	VertexPackingError error = MeasurePackingError(mesh, packed);
+	// 16-bit octahedral normals: well under a hundredth of a degree.
+	CHECK(error.Normal.Max < 0.01);
+	CHECK(error.Normal.Mean < error.Normal.Max);
+	// 8-bit octahedral tangents: under a degree, with every sign kept.
+	CHECK(error.Tangent.Max < 1.0);
+	CHECK_EQ(error.TangentSignFlips, 0u);
+
+	// The unquantized mapping is lossless over the whole sphere: the folded
+	// hemisphere, the poles, the axes and the fold edges.
+	std::vector<std::array<float, 3>> directions = {
+		{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+		{ 0.6f, 0.8f, 0 }, { -0.6f, 0, -0.8f }, { 0, -0.8f, -0.6f },
+	};
+	for (int i = 0; i < 20000; ++i) {
+		float z = -1.0f + 2.0f * (float(i) + 0.5f) / 20000.0f, phi = 2.39996323f * float(i);
+		float r = sqrtf(1.0f - z * z);
+		directions.push_back({ r * cosf(phi), r * sinf(phi), z });
+	}
+	double worst = 0.0;
+	bool inSquare = true;
+	for (const std::array<float, 3> &n : directions) {
+		float u, v, decoded[3];
+		OctahedralEncode(n.data(), u, v);
+		inSquare = inSquare && fabsf(u) <= 1.0f && fabsf(v) <= 1.0f;
+		OctahedralDecode(u, v, decoded);
+		for (int c = 0; c < 3; ++c)
+			worst = fmax(worst, fabs(decoded[c] - n[c]));
+	}
+	CHECK(inSquare);
+	CHECK(worst < 1e-6);
+}
+
+TEST(ColorsAndTexCoordsRoundTripWithinTheirPrecision) {
+	MeshData mesh = MakeSpheres({ { { 0.0f, 0.0f, 0.0f }, 1.0f } });
+	PackedMesh packed;
+	PackMesh(mesh, packed);
+	VertexPackingError error = MeasurePackingError(mesh, packed);
+	// RGBA8: half of 1/255. Half floats in [0, 1]: half of the 2^-11 ulp just
+	// below 1.
+	CHECK(error.Color.Max <= 0.5 / 255.0 + 1e-7);
+	CHECK(error.TexCoord.Max <= 1.0 / 4096.0);
+	CHECK(error.TexCoord.Max > 0.0);
+
+	// Half conversion is exact for representable values and rounds the rest to
+	// within half an ulp, for tiling coordinates and negative ones too.
+	for (float value : { 0.0f, 1.0f, -2.0f, 0.5f, 1024.0f, 65504.0f, 6.103515625e-05f })
+		CHECK(HalfToFloat(FloatToHalf(value)) == value);
+	double worstUlps = 0.0;
+	for (int i = -40000; i <= 40000; ++i) {
+		float value = float(i) / 2500.0f;
+		float magnitude = fabsf(value) < 6.103515625e-05f ? 6.103515625e-05f : fabsf(value);
+		double ulp = ldexp(1.0, ilogb(magnitude) - 10);
+		worstUlps = fmax(worstUlps, fabs(double(HalfToFloat(FloatToHalf(value))) - value) / ulp);
+	}
+	CHECK(worstUlps <= 0.5);
+}
+
+TEST(InputLayoutMatchesThePackedStride) {
+	// Bytes of each DXGI format the input layout uses.
+	auto formatSize = [](DXGI_FORMAT format) -> uint32_t {
+		switch (format) {
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			return 16;
+		case DXGI_FORMAT_R32G32B32_FLOAT:
+			return 12;
+		case DXGI_FORMAT_R32G32_FLOAT:
+		case DXGI_FORMAT_R16G16B16A16_UNORM:
+			return 8;
+		case DXGI_FORMAT_R16G16_FLOAT:
+		case DXGI_FORMAT_R16G16_SNORM:
+		case DXGI_FORMAT_R8G8B8A8_SNORM:
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+			return 4;
+		default:
+			return 0;
+		}
+	};
+
+	for (uint32_t attributes : { AllAttributes, BoxAttributes, uint32_t(MeshAttributePosition | MeshAttributeTexCoord) }) {
+		for (bool packed : { false, true }) {
+			VertexLayout layout = MakeVertexLayout(attributes, packed);
+			std::vector<D3D12_INPUT_ELEMENT_DESC> elements = MakeInputLayout(layout);
+			CHECK_EQ(elements.size(), layout.Elements.size());
+
+			// Elements sit back to back in slot 0 and fill the stride exactly.
+			uint32_t offset = 0;
+			for (size_t e = 0; e < elements.size(); ++e) {
+				CHECK(strcmp(elements[e].SemanticName, layout.Elements[e].Semantic) == 0);
+				CHECK_EQ(elements[e].InputSlot, 0u);
+				CHECK_EQ(elements[e].AlignedByteOffset, offset);
+				CHECK_EQ(elements[e].AlignedByteOffset % 4, 0u);
+				CHECK_EQ(formatSize(elements[e].Format), VertexFormatSize(layout.Elements[e].Format));
+				CHECK_EQ(elements[e].InputSlotClass, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA);
+				offset += formatSize(elements[e].Format);
+			}
+			CHECK_EQ(offset, layout.Stride);
+			if (!packed)
+				CHECK_EQ(layout.Stride, MeshVertexStride(attributes));
+		}
+	}
+
+	// The packed formats, attribute by attribute.
+	std::vector<D3D12_INPUT_ELEMENT_DESC> elements = MakeInputLayout(MakeVertexLayout(AllAttributes, true));
+	const DXGI_FORMAT expected[] = { DXGI_FORMAT_R16G16B16A16_UNORM, DXGI_FORMAT_R16G16_SNORM, DXGI_FORMAT_R16G16_FLOAT,
+		DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R8G8B8A8_SNORM };
+	CHECK_EQ(elements.size(), 5u);
+	for (size_t e = 0; e < elements.size() && e < 5; ++e)
+		CHECK_EQ(elements[e].Format, expected[e]);
+}
+
+TEST(PackedVerticesAreSmallerThanTheFloatVertex) {
+	CHECK_EQ(MeshVertexStride(BoxAttributes), BoxVertexSize);
+
+	MeshData mesh = MakeSpheres({ { { 0.0f, 0.0f, 0.0f }, 1.0f }, { { 5.0f, 0.0f, 0.0f }, 2.0f } }, BoxAttributes);
+	PackedMesh packed;
+	PackMesh(mesh, packed);
+	CHECK_EQ(packed.Layout.Stride, 12u);
+	CHECK(packed.Layout.Stride < BoxVertexSize);
+	// Per-subset vertex ranges add no vertices when subsets share none.
+	CHECK_EQ(packed.VertexCount, mesh.VertexCount);
+	CHECK_EQ(packed.Vertices.size(), size_t(packed.VertexCount) * packed.Layout.Stride);
+	// Small subsets get 16-bit indices.
+	CHECK_EQ(packed.IndexByteSize, 2u);
+	CHECK(packed.ByteSize() < mesh.ByteSize() / 2);
+
+	// Every attribute together still packs into 28 bytes or less.
+	CHECK(MakeVertexLayout(AllAttributes, true).Stride <= BoxVertexSize);
+	CHECK_EQ(MakeVertexLayout(AllAttributes, false).Stride, 64u);
+}
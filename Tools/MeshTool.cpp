@@ -0,0 +1,289 @@
+// Offline mesh cooker: optimizes an OBJ or mesh file for the vertex cache,
+// overdraw and vertex fetch, prints the before/after statistics and
+// optionally writes the result as a mesh file. Also reports what packing the
+// vertices (VertexPacking.h) would save and how much precision it costs,
+// how the mesh splits into meshlets (Meshlets.h) and the LOD chain the
+// simplifier builds for it (MeshSimplifier.h).
+//
+//   meshtool input.obj|input.mesh [output.mesh]
+//   meshtool --cull-benchmark [triangles]
+//   meshtool --lod-benchmark [triangles]
+//
+// The benchmarks use a synthetic mesh (a million triangles by default). The
+// cull benchmark builds meshlets and times CPU meshlet culling from cameras
+// orbiting it; the LOD benchmark times simplifying it to a range of targets.
+//
+// Only uses the backend-neutral sources, so it builds anywhere; the headless
+// CMake build has it as the meshtool target.
+
+#include "MappedFile.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "VertexPacking.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static void PrintCacheStats(const char *label, const VertexCacheStats &stats, float fetch) {
+	printf("  %-7s ACMR %.3f  ATVR %.3f  overfetch %.2f  (%u vertices transformed)\n", label, stats.Acmr,
+			stats.Atvr, fetch, stats.VerticesTransformed);
+}
+
+static void PrintError(const char *attribute, const AttributeError &error, const char *unit) {
+	printf("    %-8s error max %.3g%s, mean %.3g%s\n", attribute, error.Max, unit, error.Mean, unit);
+}
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void Normalize(float *v) {
+	float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	for (int c = 0; c < 3; ++c)
+		v[c] /= length;
+}
+
+// Left-handed look-at view times perspective projection, row vectors, as
+// XMMatrixLookAtLH * XMMatrixPerspectiveFovLH would give.
+static Float4x4 LookAtPerspective(const float *eye, float fovY, float aspect, float nearZ, float farZ) {
+	float z[3] = { -eye[0], -eye[1], -eye[2] };
+	Normalize(z);
+	float up[3] = { 0.0f, 1.0f, 0.0f };
+	if (fabsf(z[1]) > 0.99f)
+		up[1] = 0.0f, up[2] = 1.0f;
+	float x[3] = { up[1] * z[2] - up[2] * z[1], up[2] * z[0] - up[0] * z[2], up[0] * z[1] - up[1] * z[0] };
+	Normalize(x);
+	float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+
+	float view[4][4] = {
+		{ x[0], y[0], z[0], 0.0f },
+		{ x[1], y[1], z[1], 0.0f },
+		{ x[2], y[2], z[2], 0.0f },
+		{ -(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]), -(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]),
+				-(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]), 1.0f },
+	};
+	float yScale = 1.0f / tanf(fovY * 0.5f);
+	float range = farZ / (farZ - nearZ);
+	float proj[4][4] = {
+		{ yScale / aspect, 0.0f, 0.0f, 0.0f },
+		{ 0.0f, yScale, 0.0f, 0.0f },
+		{ 0.0f, 0.0f, range, 1.0f },
+		{ 0.0f, 0.0f, -nearZ * range, 0.0f },
+	};
+
+	Float4x4 viewProj;
+	for (int r = 0; r < 4; ++r)
+		for (int c = 0; c < 4; ++c)
+			viewProj.m[r][c] = view[r][0] * proj[0][c] + view[r][1] * proj[1][c] + view[r][2] * proj[2][c] +
+					view[r][3] * proj[3][c];
+	return viewProj;
+}
+
+static void PrintMeshletStats(const MeshletMesh &meshlets, double ms) {
+	double vertices = 0.0, triangles = 0.0;
+	for (const Meshlet &meshlet : meshlets.Meshlets) {
+		vertices += meshlet.VertexCount;
+		triangles += meshlet.TriangleCount;
+	}
+	size_t count = meshlets.Meshlets.empty() ? 1 : meshlets.Meshlets.size();
+	printf("  meshlets %zu, %.1f vertices and %.1f triangles on average, built in %.1f ms\n",
+			meshlets.Meshlets.size(), vertices / count, triangles / count, ms);
+}
+
+// A lumpy sphere of about triangleCount triangles, so meshlets have varied
+// normals and some of them face away from any viewpoint.
+static void BuildBenchmarkMesh(uint32_t triangleCount, std::vector<float> &positions, std::vector<uint32_t> &indices) {
+	uint32_t rings = static_cast<uint32_t>(sqrt(triangleCount / 4.0));
+	rings = rings < 2 ? 2 : rings;
+	uint32_t segments = rings * 2;
+	const float Pi = 3.14159265f;
+	for (uint32_t r = 0; r <= rings; ++r) {
+		for (uint32_t s = 0; s <= segments; ++s) {
+			float theta = Pi * r / rings, phi = 2.0f * Pi * s / segments;
+			float radius = 1.0f + 0.05f * sinf(8.0f * theta) * cosf(6.0f * phi);
+			positions.push_back(radius * sinf(theta) * cosf(phi));
+			positions.push_back(radius * cosf(theta));
+			positions.push_back(radius * sinf(theta) * sinf(phi));
+		}
+	}
+	for (uint32_t r = 0; r < rings; ++r) {
+		for (uint32_t s = 0; s < segments; ++s) {
+			uint32_t a = r * (segments + 1) + s, b = a + segments + 1;
+			indices.insert(indices.end(), { a, a + 1, b, a + 1, b + 1, b });
+		}
+	}
+}
+
+static int RunCullBenchmark(uint32_t triangleCount) {
+	std::vector<float> positions;
+	std::vector<uint32_t> source;
+	BuildBenchmarkMesh(triangleCount, positions, source);
+	size_t vertexCount = positions.size() / 3;
+
+	std::vector<uint32_t> indices(source.size());
+	OptimizeVertexCache(indices.data(), source.data(), source.size(), vertexCount);
+	MeshletMesh meshlets;
+	auto start = std::chrono::steady_clock::now();
+	BuildMeshlets(meshlets, indices.data(), indices.size(), positions.data(), 3 * sizeof(float), vertexCount);
+	printf("synthetic mesh: %zu triangles, %zu vertices\n", indices.size() / 3, vertexCount);
+	PrintMeshletStats(meshlets, MillisecondsSince(start));
+
+	// Orbit at a distance where the mesh fills most of the view, so both
+	// frustum and backface rejection have work.
+	const uint32_t Views = 256;
+	std::vector<MeshletDrawRange> ranges;
+	MeshletCullStats stats;
+	uint64_t rangeCount = 0;
+	double cullMs = 0.0;
+	for (uint32_t i = 0; i < Views; ++i) {
+		float angle = 6.2831853f * i / Views;
+		float eye[3] = { 1.6f * cosf(angle), 0.8f * sinf(angle * 3.0f), 1.6f * sinf(angle) };
+		MeshletCullView view;
+		view.ViewFrustum = Frustum::FromViewProj(LookAtPerspective(eye, 0.8f, 16.0f / 9.0f, 0.1f, 100.0f));
+		view.CameraPosition = { eye[0], eye[1], eye[2] };
+
+		ranges.clear();
+		start = std::chrono::steady_clock::now();
+		rangeCount += CullMeshlets(meshlets, view, 0, static_cast<uint32_t>(meshlets.Meshlets.size()), ranges, &stats);
+		cullMs += MillisecondsSince(start);
+	}
+
+	double seconds = cullMs / 1000.0;
+	uint32_t culled = stats.Triangles - stats.VisibleTriangles;
+	printf("  %u views: %.3f ms per view, %.1f%% of triangles culled (%.1f%% frustum, %.1f%% backface meshlets)\n",
+			Views, cullMs / Views, 100.0 * culled / stats.Triangles, 100.0 * stats.FrustumCulled / stats.Meshlets,
+			100.0 * stats.BackfaceCulled / stats.Meshlets);
+	printf("  %.1f M meshlets/s, %.0f M triangles tested/s, %.0f M triangles culled/s, %.1f draw ranges per view\n",
+			stats.Meshlets / seconds / 1e6, stats.Triangles / seconds / 1e6, culled / seconds / 1e6,
+			double(rangeCount) / Views);
+	return 0;
+}
+
+static int RunLodBenchmark(uint32_t triangleCount) {
+	std::vector<float> positions;
+	std::vector<uint32_t> source;
+	BuildBenchmarkMesh(triangleCount, positions, source);
+	size_t vertexCount = positions.size() / 3;
+	std::vector<uint32_t> indices(source.size());
+	OptimizeVertexCache(indices.data(), source.data(), source.size(), vertexCount);
+	printf("synthetic mesh: %zu triangles, %zu vertices\n", indices.size() / 3, vertexCount);
+
+	// No error limit, so every run reaches its triangle target.
+	std::vector<uint32_t> simplified(indices.size());
+	const float Targets[] = { 0.5f, 0.25f, 0.1f, 0.01f };
+	for (float target : Targets) {
+		float error = 0.0f;
+		auto start = std::chrono::steady_clock::now();
+		size_t count = SimplifyMesh(simplified.data(), indices.data(), indices.size(), positions.data(),
+				3 * sizeof(float), vertexCount, size_t(indices.size() / 3 * target) * 3, INFINITY, &error);
+		double ms = MillisecondsSince(start);
+		printf("  to %4.1f%%: %zu triangles (%.1f%%), error %.5f, %.1f ms, %.2f M input triangles/s\n",
+				100.0 * target, count / 3, 100.0 * count / indices.size(), error, ms,
+				indices.size() / 3 / (ms / 1000.0) / 1e6);
+	}
+	return 0;
+}
+
+static void PrintLodChain(const MeshData &mesh, double ms) {
+	for (const MeshSubset &subset : mesh.Subsets) {
+		if (subset.LodLevel == 0)
+			printf("  subset '%s': %u triangles\n", subset.Name.c_str(), subset.IndexCount / 3);
+		else
+			printf("    lod %u: %u triangles, error %.5f\n", subset.LodLevel, subset.IndexCount / 3, subset.LodError);
+	}
+	printf("  LOD chain built in %.1f ms\n", ms);
+}
+
+int main(int argc, char **argv) {
+	if (argc >= 2 && strcmp(argv[1], "--cull-benchmark") == 0)
+		return RunCullBenchmark(argc >= 3 ? static_cast<uint32_t>(strtoul(argv[2], nullptr, 10)) : 1000000);
+	if (argc >= 2 && strcmp(argv[1], "--lod-benchmark") == 0)
+		return RunLodBenchmark(argc >= 3 ? static_cast<uint32_t>(strtoul(argv[2], nullptr, 10)) : 1000000);
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr,
+				"usage: %s input.obj|input.mesh [output.mesh]\n       %s --cull-benchmark [triangles]\n"
+				"       %s --lod-benchmark [triangles]\n",
+				argv[0], argv[0], argv[0]);
+		return 2;
+	}
+
+	MappedFile file;
+	if (!file.Open(argv[1])) {
+		fprintf(stderr, "cannot read %s\n", argv[1]);
+		return 1;
+	}
+	MeshData mesh;
+	std::string error;
+	bool decoded = IsMeshFile(file.Data(), file.Size()) ? DecodeMeshFile(file.Data(), file.Size(), mesh, error)
+														: DecodeObjMesh(file.Data(), file.Size(), mesh, error);
+	file.Close();
+	if (!decoded) {
+		fprintf(stderr, "%s: %s\n", argv[1], error.c_str());
+		return 1;
+	}
+
+	uint32_t vertexCount = mesh.VertexCount;
+	uint32_t indexByteSize = mesh.IndexByteSize;
+	auto start = std::chrono::steady_clock::now();
+	MeshOptimizeStats stats = OptimizeMesh(mesh);
+	double ms = MillisecondsSince(start);
+
+	printf("%s: %u triangles, %zu subsets, optimized in %.1f ms\n", argv[1], stats.Before.Triangles,
+			mesh.Subsets.size(), ms);
+	PrintCacheStats("before", stats.Before, stats.FetchBefore);
+	PrintCacheStats("after", stats.After, stats.FetchAfter);
+	printf("  vertices %u -> %u, %u-bit -> %u-bit indices\n", vertexCount, mesh.VertexCount, indexByteSize * 8,
+			mesh.IndexByteSize * 8);
+
+	uint32_t positionOffset = MeshAttributeOffset(mesh.Attributes, MeshAttributePosition);
+	if (positionOffset != UINT32_MAX) {
+		const float *positions = reinterpret_cast<const float *>(mesh.Vertices.data() + positionOffset);
+		for (const MeshSubset &subset : mesh.Subsets) {
+			if (subset.LodLevel != 0)
+				continue;
+			std::vector<uint32_t> indices(subset.IndexCount);
+			for (uint32_t i = 0; i < subset.IndexCount; ++i)
+				indices[i] = mesh.Index(subset.StartIndex + i) + subset.BaseVertex;
+			MeshletMesh meshlets;
+			start = std::chrono::steady_clock::now();
+			BuildMeshlets(meshlets, indices.data(), indices.size(), positions, mesh.VertexStride, mesh.VertexCount);
+			printf("  subset '%s':\n", subset.Name.c_str());
+			PrintMeshletStats(meshlets, MillisecondsSince(start));
+		}
+	}
+
+	start = std::chrono::steady_clock::now();
+	BuildLodChain(mesh);
+	PrintLodChain(mesh, MillisecondsSince(start));
+
+	PackedMesh packed;
+	PackMesh(mesh, packed);
+	VertexPackingError packingError = MeasurePackingError(mesh, packed);
+	double vertexBytes = double(mesh.Vertices.size());
+	double packedVertexBytes = double(packed.Vertices.size());
+	printf("  packed  %u -> %u bytes per vertex, vertex buffer %.1f -> %.1f KB, total %.1f -> %.1f KB (%.0f%%)\n",
+			mesh.VertexStride, packed.Layout.Stride, vertexBytes / 1024.0, packedVertexBytes / 1024.0,
+			mesh.ByteSize() / 1024.0, packed.ByteSize() / 1024.0, 100.0 * packed.ByteSize() / mesh.ByteSize());
+	if (mesh.Attributes & MeshAttributePosition)
+		PrintError("position", packingError.Position, "");
+	if (mesh.Attributes & MeshAttributeNormal)
+		PrintError("normal", packingError.Normal, " deg");
+	if (mesh.Attributes & MeshAttributeTexCoord)
+		PrintError("texcoord", packingError.TexCoord, "");
+	if (mesh.Attributes & MeshAttributeColor)
+		PrintError("color", packingError.Color, "");
+	if (mesh.Attributes & MeshAttributeTangent) {
+		PrintError("tangent", packingError.Tangent, " deg");
+		printf("    %u bitangent sign flips\n", packingError.TangentSignFlips);
+	}
+
+	if (argc == 3 && !WriteMeshFile(argv[2], mesh, error)) {
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	return 0;
+}